@@ -0,0 +1,374 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*this file is responsible to implement the ARC replacement cache
+ * the resident pages are kept in T1 (pages referenced once) and T2 (pages referenced at least twice)
+ * and the history of the evicted pages (only their ids) is kept in B1 and B2, respectively
+ * the target size of T1 (p) is adapted according to the hits in B1 and B2 */
+#include "buffer_handler.h"
+#include "../libraries/uthash/uthash.h"
+#include "../main/log_messages.h"
+
+#include "../main/statistical_processing.h"
+
+/* undefine the defaults */
+#undef uthash_malloc
+#undef uthash_free
+
+/* re-define to use the lwalloc and lwfree from the postgis */
+#define uthash_malloc(sz) lwalloc(sz)
+#define uthash_free(ptr,sz) lwfree(ptr)
+
+#undef uthash_fatal
+#define uthash_fatal(msg) _DEBUG(ERROR, msg)
+
+/* the lists of the ARC */
+#define ARC_T1      0
+#define ARC_T2      1
+#define ARC_B1      2
+#define ARC_B2      3
+
+typedef struct ARC {
+    UT_hash_handle hh;
+
+    int page_id; //the key
+    uint8_t *data; //the serialized node (NULL for the pages of B1 and B2)
+    bool modified; //this node has modification to be applied?
+    uint8_t list; //the list in which this page is (see above)
+    struct ARC *prev; //the previous page in its list
+    struct ARC *next; //the next page in its list
+} ARC;
+
+/* a list of pages, its head is the least recently used page */
+typedef struct {
+    ARC *head;
+    ARC *tail;
+    int size;
+} ARCList;
+
+/*
+ * Some considerations about the size of the buffer:
+ * 1 - it only considers the size of the node and its id (that is: page_size + sizeof(int))
+ * 2 - thus, the number of resident pages (c) is max_capacity / (page_size + sizeof(int))
+ * 3 - the pages of B1 and B2 are not considered since they only store ids (at most c ids)
+ * 4 - it does not consider the overhead size introduced by the UT_hash_handle!
+ */
+
+static ARC *arc = NULL; //all the pages (resident and history)
+static ARCList lists[4] = {{NULL, NULL, 0}, {NULL, NULL, 0}, {NULL, NULL, 0}, {NULL, NULL, 0}};
+static int target_t1 = 0; //the target size of T1 (i.e., p)
+
+static void arc_list_append(ARC *entry, uint8_t list) {
+    ARCList *l = &lists[list];
+
+    entry->list = list;
+    entry->next = NULL;
+    entry->prev = l->tail;
+    if (l->tail != NULL)
+        l->tail->next = entry;
+    else
+        l->head = entry;
+    l->tail = entry;
+    l->size++;
+}
+
+static void arc_list_remove(ARC *entry) {
+    ARCList *l = &lists[entry->list];
+
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        l->head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        l->tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+    l->size--;
+}
+
+/* it removes a page from its list and from the hash (its memory is released) */
+static void arc_destroy_entry(const SpatialIndex *si, ARC *entry) {
+    arc_list_remove(entry);
+    HASH_DEL(arc, entry);
+    if (entry->data != NULL)
+        buffer_free_page(si, entry->data);
+    lwfree(entry);
+}
+
+/* it moves the least recently used page of a resident list (T1 or T2) to its history list (B1 or B2)
+ * the page is written if it has modifications */
+static void arc_evict_lru(const SpatialIndex *si, uint8_t from) {
+    ARC *entry = lists[from].head;
+
+    arc_list_remove(entry);
+    if (entry->modified) {
+        buffer_write_one_page(si, entry->page_id, entry->data);
+        entry->modified = false;
+    }
+    buffer_free_page(si, entry->data);
+    entry->data = NULL;
+    arc_list_append(entry, from == ARC_T1 ? ARC_B1 : ARC_B2);
+}
+
+/* the subroutine REPLACE of the ARC, in_b2 indicates if the requested page is in B2 */
+static void arc_replace(const SpatialIndex *si, bool in_b2) {
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if (lists[ARC_T1].size >= 1 &&
+            (lists[ARC_T1].size > target_t1 || (in_b2 && lists[ARC_T1].size == target_t1)))
+        arc_evict_lru(si, ARC_T1);
+    else if (lists[ARC_T2].size >= 1)
+        arc_evict_lru(si, ARC_T2);
+    else
+        arc_evict_lru(si, ARC_T1);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+int buffer_arc_capacity(const SpatialIndex *si) {
+    return (int) (si->bs->max_capacity / (si->gp->page_size + sizeof (int)));
+}
+
+static void buffer_arc_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
+    ARC *entry;
+    int c;
+
+    if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
+            si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
+        _DEBUGF(WARNING, "The buffer has very low capacity (%zu) and thus, "
+                "cannot store any node (size of a node is %d)",
+                si->bs->min_capacity, si->gp->page_size);
+        if (mod) {
+            buffer_write_one_page(si, page, buf);
+        }
+        return;
+    }
+
+    c = buffer_arc_capacity(si);
+
+    HASH_FIND_INT(arc, &page, entry);
+    if (entry != NULL && (entry->list == ARC_T1 || entry->list == ARC_T2)) {
+        /* case I: a hit in T1 or T2, it becomes the most recently used page of T2 */
+        arc_list_remove(entry);
+        arc_list_append(entry, ARC_T2);
+
+        if (mod) {
+            entry->modified = mod;
+            memcpy(entry->data, buf, (size_t) si->gp->page_size);
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+        return;
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_page_fault++;
+#endif
+
+    if (entry != NULL) {
+        /* case II and III: a hit in the history, we adapt the target size of T1 */
+        int delta;
+        bool in_b2 = (entry->list == ARC_B2);
+
+        if (!in_b2) {
+            delta = lists[ARC_B1].size >= lists[ARC_B2].size ? 1 : lists[ARC_B2].size / lists[ARC_B1].size;
+            target_t1 = target_t1 + delta > c ? c : target_t1 + delta;
+        } else {
+            delta = lists[ARC_B2].size >= lists[ARC_B1].size ? 1 : lists[ARC_B1].size / lists[ARC_B2].size;
+            target_t1 = target_t1 - delta < 0 ? 0 : target_t1 - delta;
+        }
+        arc_list_remove(entry);
+        if (lists[ARC_T1].size + lists[ARC_T2].size >= c)
+            arc_replace(si, in_b2);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_ghost_hit++;
+#endif
+        entry->list = ARC_T2;
+    } else {
+        /* case IV: a page that is not in the buffer nor in the history */
+        int l1 = lists[ARC_T1].size + lists[ARC_B1].size;
+        int total = l1 + lists[ARC_T2].size + lists[ARC_B2].size;
+
+        if (l1 >= c) {
+            if (lists[ARC_T1].size < c) {
+                arc_destroy_entry(si, lists[ARC_B1].head);
+                if (lists[ARC_T1].size + lists[ARC_T2].size >= c)
+                    arc_replace(si, false);
+            } else {
+                //B1 is empty, the least recently used page of T1 is evicted without being remembered
+                arc_evict_lru(si, ARC_T1);
+                arc_destroy_entry(si, lists[ARC_B1].tail);
+            }
+        } else if (total >= c) {
+            if (total >= 2 * c)
+                arc_destroy_entry(si, lists[ARC_B2].head);
+            if (lists[ARC_T1].size + lists[ARC_T2].size >= c)
+                arc_replace(si, false);
+        }
+
+        entry = (ARC*) lwalloc(sizeof (ARC));
+        entry->page_id = page;
+        entry->modified = false;
+        entry->list = ARC_T1;
+        HASH_ADD_INT(arc, page_id, entry);
+    }
+
+    entry->data = buffer_alloc_page(si);
+    memcpy(entry->data, buf, si->gp->page_size);
+    entry->modified = mod;
+    arc_list_append(entry, entry->list);
+}
+
+void buffer_arc_find(const SpatialIndex *si, int page, uint8_t *buf) {
+    ARC *entry;
+    HASH_FIND_INT(arc, &page, entry);
+
+    if (entry != NULL && (entry->list == ARC_T1 || entry->list == ARC_T2)) {
+        arc_list_remove(entry);
+        arc_list_append(entry, ARC_T2);
+        //it is stored in our buffer
+        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+    } else {
+        //this page is not resident in our buffer
+        //then we have to get this node from the disk/flash
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        buffer_read_one_page(si, page, buf);
+
+        //now we add this page into the buffer
+        buffer_arc_add_entry(si, page, buf, false);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0) {
+            cpuend = get_CPU_time();
+            end = get_current_time();
+
+            _sbuffer_find_cpu_time += get_elapsed_time(cpustart, cpuend);
+            _sbuffer_find_time += get_elapsed_time(start, end);
+        }
+#endif
+    }
+}
+
+void buffer_arc_add(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_arc_add_entry(si, page, buf, true);
+}
+
+void buffer_arc_flush_all(const SpatialIndex *si) {
+    ARC *entry, *tmp_entry;
+    BufferWrite *writes;
+    int count = 0;
+    int i = 0;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    HASH_ITER(hh, arc, entry, tmp_entry) {
+        if (entry->modified) {
+            count++;
+        }
+    }
+
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
+
+    HASH_ITER(hh, arc, entry, tmp_entry) {
+        /* we have to write this page on the disk/flash memory only if this node has modifications*/
+        if (entry->modified) {
+            writes[i].page = entry->page_id;
+            writes[i].data = entry->data;
+            i++;
+        }
+    }
+
+    //the pages are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    HASH_ITER(hh, arc, entry, tmp_entry) {
+        //the history is also cleaned
+        arc_destroy_entry(si, entry);
+    }
+    target_t1 = 0;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+unsigned int buffer_arc_number_of_pages() {
+    return (unsigned int) (lists[ARC_T1].size + lists[ARC_T2].size);
+}
+
+int buffer_arc_resident_pages(int *pages, int max) {
+    ARC *entry;
+    int n = 0;
+
+    //the pages of T2 are the most valuable ones
+    for (entry = lists[ARC_T1].head; entry != NULL && n < max; entry = entry->next)
+        pages[n++] = entry->page_id;
+    for (entry = lists[ARC_T2].head; entry != NULL && n < max; entry = entry->next)
+        pages[n++] = entry->page_id;
+    return n;
+}
+
+void buffer_arc_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_arc_add_entry(si, page, buf, false);
+}
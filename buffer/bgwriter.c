@@ -0,0 +1,261 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for O_DIRECT */
+#endif
+
+/* this file implements the background writer of the standard buffers whose frames are stored in a FrameArena
+ * the foreground (i.e., the buffer) submits modified frames, which are written by a thread by using pwrite
+ * the thread does not call any function of the PostgreSQL (it only writes the frames)
+ * the submitted frames and the written frames are exchanged by two single-producer single-consumer lock-free queues
+ * while a frame is being written (its flag writing), the foreground must not modify or evict it
+ * a frame whose write failed is kept modified and no more frames are submitted until the next start,
+ * thus the foreground writes the modified frames by itself (and reports its own errors) */
+#include "buffer_handler.h"
+#include "../main/log_messages.h"
+#include "../main/statistical_processing.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+/* the capacity of the queues (a power of two), it is also the maximum number of frames being written */
+#define BGWRITER_QUEUE_SIZE     256
+
+typedef struct {
+    int frame;
+    int page;
+    int error; //errno of a failed write (0 means that the frame was written)
+} BGWriterItem;
+
+/* a single-producer single-consumer ring */
+typedef struct {
+    BGWriterItem items[BGWRITER_QUEUE_SIZE];
+    atomic_uint head; //the next position to be consumed
+    atomic_uint tail; //the next position to be produced
+} BGWriterQueue;
+
+typedef struct {
+    pthread_t thread;
+    sem_t pending; //the number of submitted frames (the thread waits on it)
+    BGWriterQueue submitted; //produced by the foreground, consumed by the thread
+    BGWriterQueue written; //produced by the thread, consumed by the foreground
+    atomic_bool stop;
+    int fd;
+    int page_size;
+    FrameArena *arena;
+    int in_flight; //number of submitted frames that were not collected yet (only accessed by the foreground)
+    bool running;
+    bool failed; //a write failed, then no more frames are submitted (only accessed by the foreground)
+} BGWriter;
+
+static BGWriter bgw;
+static double bgwriter_clean_perc = 0.0; //0 means that the background writer is disabled
+static bool bgwriter_warned = false; //a buffer that does not support the background writer was warned
+
+static bool bgwriter_push(BGWriterQueue *q, int frame, int page, int error) {
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+    if (tail - head == BGWRITER_QUEUE_SIZE)
+        return false;
+    q->items[tail & (BGWRITER_QUEUE_SIZE - 1)].frame = frame;
+    q->items[tail & (BGWRITER_QUEUE_SIZE - 1)].page = page;
+    q->items[tail & (BGWRITER_QUEUE_SIZE - 1)].error = error;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static bool bgwriter_pop(BGWriterQueue *q, BGWriterItem *item) {
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+    if (head == tail)
+        return false;
+    *item = q->items[head & (BGWRITER_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
+
+static void *bgwriter_main(void *arg) {
+    BGWriterItem item;
+
+    while (true) {
+        sem_wait(&bgw.pending);
+        if (!bgwriter_pop(&bgw.submitted, &item)) {
+            //it was woken up to stop
+            if (atomic_load(&bgw.stop))
+                break;
+            continue;
+        }
+        errno = 0;
+        if (pwrite(bgw.fd, FRAME_DATA(bgw.arena, item.frame), bgw.page_size,
+                (off_t) item.page * bgw.page_size) != bgw.page_size)
+            item.error = errno != 0 ? errno : EIO;
+        else
+            item.error = 0;
+        //the written queue never overflows since it has the capacity of the submitted queue
+        bgwriter_push(&bgw.written, item.frame, item.page, item.error);
+    }
+    return NULL;
+}
+
+void buffer_bgwriter_set(double clean_perc) {
+    if (clean_perc < 0 || clean_perc > 100) {
+        _DEBUGF(ERROR, "Value %f is not valid for the background writer", clean_perc);
+        return;
+    }
+    bgwriter_clean_perc = clean_perc;
+    bgwriter_warned = false;
+}
+
+void buffer_bgwriter_check(uint8_t buffer_type) {
+    //the warning is raised once per setting
+    if (bgwriter_clean_perc > 0 && buffer_type != BUFFER_LRU && !bgwriter_warned) {
+        _DEBUGF(WARNING, "The background writer is only supported by the LRU buffer, "
+                "the buffer %d writes its own pages", buffer_type);
+        bgwriter_warned = true;
+    }
+}
+
+double buffer_bgwriter_get(void) {
+    return bgwriter_clean_perc;
+}
+
+bool buffer_bgwriter_start(const SpatialIndex *si, FrameArena *arena) {
+    int flag = O_WRONLY;
+
+    if (bgwriter_clean_perc <= 0 || bgw.running)
+        return false;
+    if (si->gp->storage_system->type != SSD && si->gp->storage_system->type != HDD) {
+        _DEBUG(WARNING, "The background writer only supports HDDs and SSDs, the buffer will write its pages");
+        return false;
+    }
+
+    if (si->gp->io_access == DIRECT_ACCESS)
+        flag |= O_DIRECT;
+    if ((bgw.fd = open(si->index_file, flag)) < 0) {
+        _DEBUGF(WARNING, "It was impossible to open the \'%s\' for the background writer", si->index_file);
+        return false;
+    }
+
+    atomic_init(&bgw.submitted.head, 0);
+    atomic_init(&bgw.submitted.tail, 0);
+    atomic_init(&bgw.written.head, 0);
+    atomic_init(&bgw.written.tail, 0);
+    atomic_init(&bgw.stop, false);
+    bgw.failed = false;
+    bgw.page_size = si->gp->page_size;
+    bgw.arena = arena;
+    bgw.in_flight = 0;
+
+    if (sem_init(&bgw.pending, 0, 0) != 0) {
+        close(bgw.fd);
+        return false;
+    }
+    if (pthread_create(&bgw.thread, NULL, bgwriter_main, NULL) != 0) {
+        _DEBUG(WARNING, "It was impossible to create the thread of the background writer");
+        sem_destroy(&bgw.pending);
+        close(bgw.fd);
+        return false;
+    }
+    bgw.running = true;
+    return true;
+}
+
+bool buffer_bgwriter_running(void) {
+    return bgw.running;
+}
+
+bool buffer_bgwriter_submit(int frame) {
+    if (!bgw.running || bgw.failed || bgw.in_flight == BGWRITER_QUEUE_SIZE)
+        return false;
+
+    bgw.arena->desc[frame].writing = true;
+    bgwriter_push(&bgw.submitted, frame, bgw.arena->desc[frame].page_id, 0);
+    bgw.in_flight++;
+    sem_post(&bgw.pending);
+    return true;
+}
+
+int buffer_bgwriter_in_flight(void) {
+    return bgw.running ? bgw.in_flight : 0;
+}
+
+int buffer_bgwriter_collect(void) {
+    BGWriterItem item;
+    int n = 0;
+    int nofailed = 0;
+    int err = 0;
+
+    if (!bgw.running)
+        return 0;
+
+    while (bgwriter_pop(&bgw.written, &item)) {
+        bgw.arena->desc[item.frame].writing = false;
+        bgw.in_flight--;
+        if (item.error != 0) {
+            //the frame remains modified and will be written by the foreground
+            err = item.error;
+            nofailed++;
+            continue;
+        }
+        bgw.arena->desc[item.frame].modified = false;
+        n++;
+    }
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_bg_write_num += n;
+#endif
+
+    //each failure is reported only once and it does not prevent the thread from being stopped
+    if (nofailed > 0) {
+        if (!bgw.failed)
+            _DEBUGF(WARNING, "The background writer could not write %d page(s) (errno %d), "
+                "the buffer will write its modified pages", nofailed, err);
+        bgw.failed = true;
+    }
+    return n;
+}
+
+int buffer_bgwriter_wait(int frame) {
+    int n = 0;
+
+    while (bgw.running && (frame == FRAME_NONE ? bgw.in_flight > 0 : bgw.arena->desc[frame].writing)) {
+        n += buffer_bgwriter_collect();
+        if (frame == FRAME_NONE ? bgw.in_flight > 0 : bgw.arena->desc[frame].writing)
+            sched_yield();
+    }
+    return n;
+}
+
+int buffer_bgwriter_stop(void) {
+    int n;
+
+    if (!bgw.running)
+        return 0;
+
+    n = buffer_bgwriter_wait(FRAME_NONE);
+    atomic_store(&bgw.stop, true);
+    sem_post(&bgw.pending);
+    pthread_join(bgw.thread, NULL);
+    sem_destroy(&bgw.pending);
+    close(bgw.fd);
+    bgw.running = false;
+    bgw.arena = NULL;
+    return n;
+}
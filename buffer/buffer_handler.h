@@ -25,6 +25,64 @@
 #include "../main/spatial_index.h"
 #include "../main/io_handler.h"
 #include "../flashdbsim/flashdbsim.h"
+#include "frame_arena.h"
+
+/***********************************
+ * BUFFER POLICIES
+ * each buffer_type (see spatial_index.h) is registered with the functions of its replacement policy,
+ * which are called by the storage_handler.c
+ * *********************************/
+typedef struct {
+    uint8_t buffer_type;
+    /* it copies the page to buf, reading it from the storage device if it is not in the buffer */
+    void (*find)(const SpatialIndex *si, int page, uint8_t *buf, int height);
+    /* it stores a modified page in the buffer */
+    void (*add)(const SpatialIndex *si, int page, uint8_t *buf, int height);
+    /* it writes all the modified pages and empties the buffer */
+    void (*flush_all)(const SpatialIndex *si);
+    /* it is called when the height of the index changes (NULL if the policy does not consider heights) */
+    void (*on_height_change)(int new_height);
+    /* it returns the number of pages stored in the buffer */
+    unsigned int (*number_of_pages)(void);
+    /* it returns the frame of the page if it is stored in the buffer (NULL otherwise) and increments its pin count,
+     * a pinned page is not evicted until it is unpinned (NULL if the policy does not support pinning) */
+    uint8_t *(*pin)(const SpatialIndex *si, int page, int height);
+    /* it decrements the pin count of a page pinned by pin */
+    void (*unpin)(int page);
+    /* it copies the identifiers of the pages stored in the buffer to pages (and their heights, if the policy
+     * considers them), from the least to the most valuable page, and returns how many pages were copied (at most max) */
+    int (*resident_pages)(int *pages, int *heights, int max);
+    /* it stores a page read from the storage device (i.e., without modifications) in the buffer */
+    void (*load)(const SpatialIndex *si, int page, uint8_t *buf, int height);
+    /* it returns the maximum number of pages that the buffer stores for the configuration of the index */
+    int (*capacity)(const SpatialIndex *si);
+} BufferPolicy;
+
+/* it returns the policy of a buffer_type, it raises an error if there is no such policy */
+extern const BufferPolicy *buffer_get_policy(uint8_t buffer_type);
+
+/* the operations on the storage device used by the policies to read missed pages and to write back modified pages */
+extern void buffer_read_one_page(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_read_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int pagenum);
+extern void buffer_write_one_page(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_write_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int pagenum);
+/* a modified page to be written back and the memory of its content (e.g., its frame) */
+typedef struct {
+    int page;
+    uint8_t *data;
+} BufferWrite;
+
+/* it sorts the writes by the identifiers of their pages */
+extern void buffer_sort_writes(BufferWrite *w, int pagenum);
+/* it writes the pages in the order of their identifiers, thus consecutive pages are written by a single write
+ * (w is reordered), it is used to write back several modified pages of a buffer
+ * each content is copied once into staging (it is allocated if staging is NULL), the contents can only be
+ * stored in staging if they are already sorted (then they are not copied) */
+extern void buffer_write_sorted_pages(const SpatialIndex *si, BufferWrite *w, int pagenum, uint8_t *staging);
+/* memory of a page of the buffer (it is aligned for the direct access) */
+extern uint8_t *buffer_alloc_page(const SpatialIndex *si);
+extern uint8_t *buffer_alloc_pages(const SpatialIndex *si, int nofpages);
+extern void buffer_free_page(const SpatialIndex *si, uint8_t *data);
 
 /***********************************
  * LRU BUFFER
@@ -32,6 +90,12 @@
 extern void buffer_lru_find(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_lru_add(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_lru_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_lru_number_of_pages(void);
+extern uint8_t *buffer_lru_pin(const SpatialIndex *si, int page);
+extern void buffer_lru_unpin(int page);
+extern int buffer_lru_resident_pages(int *pages, int max);
+extern void buffer_lru_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_lru_capacity(const SpatialIndex *si);
 
 /***********************************
  * Hierarchical LRU BUFFER
@@ -39,6 +103,12 @@ extern void buffer_lru_flush_all(const SpatialIndex *si);
 extern void buffer_hlru_find(const SpatialIndex *si, int page, uint8_t *buf, int height);
 extern void buffer_hlru_add(const SpatialIndex *si, int page, uint8_t *buf, int height);
 extern void buffer_hlru_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_hlru_number_of_pages(void);
+extern uint8_t *buffer_hlru_pin(const SpatialIndex *si, int page, int height);
+extern void buffer_hlru_unpin(int page);
+extern int buffer_hlru_resident_pages(int *pages, int *heights, int max);
+extern void buffer_hlru_load(const SpatialIndex *si, int page, uint8_t *buf, int height);
+extern int buffer_hlru_capacity(const SpatialIndex *si);
 extern void buffer_hlru_update_tree_height(int new_height);
 
 
@@ -63,6 +133,12 @@ extern void buffer_hlru_update_tree_height(int new_height);
 extern void buffer_s2q_find(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_s2q_add(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_s2q_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_s2q_number_of_pages(void);
+extern uint8_t *buffer_s2q_pin(const SpatialIndex *si, int page);
+extern void buffer_s2q_unpin(int page);
+extern int buffer_s2q_resident_pages(int *pages, int max);
+extern void buffer_s2q_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_s2q_capacity(const SpatialIndex *si);
 
 /***********************************
  * Full version 2Q BUFFER
@@ -70,6 +146,93 @@ extern void buffer_s2q_flush_all(const SpatialIndex *si);
 extern void buffer_2q_find(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_2q_add(const SpatialIndex *si, int page, uint8_t *buf);
 extern void buffer_2q_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_2q_number_of_pages(void);
+extern uint8_t *buffer_2q_pin(const SpatialIndex *si, int page);
+extern void buffer_2q_unpin(int page);
+extern int buffer_2q_resident_pages(int *pages, int max);
+extern void buffer_2q_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_2q_capacity(const SpatialIndex *si);
+
+/***********************************
+ * Adaptive Replacement Cache (ARC), as proposed in
+ *
+ * MEGIDDO, N.; MODHA, D. S. ARC: A Self-Tuning, Low Overhead Replacement Cache.
+ * In Proceedings of the 2nd USENIX Conference on File and Storage Technologies (FAST '03), p. 115-130, 2003.
+ * *********************************/
+extern void buffer_arc_find(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_arc_add(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_arc_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_arc_number_of_pages(void);
+extern int buffer_arc_resident_pages(int *pages, int max);
+extern void buffer_arc_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_arc_capacity(const SpatialIndex *si);
+
+/***********************************
+ * CLOCK-Pro, as proposed in
+ *
+ * JIANG, S.; CHEN, F.; ZHANG, X. CLOCK-Pro: An Effective Improvement of the CLOCK Replacement.
+ * In Proceedings of the USENIX Annual Technical Conference (ATEC '05), p. 323-336, 2005.
+ * *********************************/
+extern void buffer_clockpro_find(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_clockpro_add(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_clockpro_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_clockpro_number_of_pages(void);
+extern int buffer_clockpro_resident_pages(int *pages, int max);
+extern void buffer_clockpro_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_clockpro_capacity(const SpatialIndex *si);
+
+/***********************************
+ * Clean-First LRU (CFLRU), as proposed in
+ *
+ * PARK, S.; JUNG, D.; KANG, J.; KIM, J.; LEE, J. CFLRU: A Replacement Algorithm for Flash Memory.
+ * In Proceedings of the International Conference on Compilers, Architecture and Synthesis for
+ * Embedded Systems (CASES '06), p. 234-241, 2006.
+ * *********************************/
+extern void buffer_cflru_find(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_cflru_add(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_cflru_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_cflru_number_of_pages(void);
+extern int buffer_cflru_resident_pages(int *pages, int max);
+extern void buffer_cflru_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_cflru_capacity(const SpatialIndex *si);
+
+/***********************************
+ * SHARED buffer, a buffer pool stored in the shared memory of the PostgreSQL (see shared_buffer.c)
+ * it requires FESTIval in shared_preload_libraries and festival.shared_buffer_size greater than 0
+ * *********************************/
+/* it defines its configuration parameters and requests its shared memory (it must be called by _PG_init) */
+extern void buffer_shared_init(void);
+extern void buffer_shared_find(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_shared_add(const SpatialIndex *si, int page, uint8_t *buf);
+extern void buffer_shared_flush_all(const SpatialIndex *si);
+extern unsigned int buffer_shared_number_of_pages(void);
+extern int buffer_shared_resident_pages(int *pages, int max);
+extern void buffer_shared_load(const SpatialIndex *si, int page, uint8_t *buf);
+extern int buffer_shared_capacity(const SpatialIndex *si);
+
+/***********************************
+ * BACKGROUND WRITER of the buffers stored in a FrameArena (currently, the LRU buffer)
+ * a thread writes modified frames ahead of their eviction in order to keep clean_perc% of the frames clean
+ * it is only used for HDDs and SSDs
+ * *********************************/
+/* it sets the percentage of clean frames (0 disables the background writer), it is applied to the next created arena */
+extern void buffer_bgwriter_set(double clean_perc);
+extern double buffer_bgwriter_get(void);
+/* it warns that the background writer is enabled but not supported by the buffer type (only LRU supports it) */
+extern void buffer_bgwriter_check(uint8_t buffer_type);
+/* it starts the thread for the arena, it returns false if the background writer is disabled or not supported */
+extern bool buffer_bgwriter_start(const SpatialIndex *si, FrameArena *arena);
+extern bool buffer_bgwriter_running(void);
+/* it submits a modified frame to be written (the frame is flagged as writing), false if the queue is full */
+extern bool buffer_bgwriter_submit(int frame);
+extern int buffer_bgwriter_in_flight(void);
+/* it marks the written frames as clean, returning how many frames were written
+ * the frames whose write failed remain modified, and the background writer stops accepting frames */
+extern int buffer_bgwriter_collect(void);
+/* it waits until the frame is written (or all the submitted frames if frame is FRAME_NONE) */
+extern int buffer_bgwriter_wait(int frame);
+/* it waits all the submitted frames and stops the thread */
+extern int buffer_bgwriter_stop(void);
 
 
 #endif /* BUFFER_HANDLER_H */
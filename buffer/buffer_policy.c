@@ -0,0 +1,331 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/* this file registers the replacement policies of the buffers (see BufferPolicy in buffer_handler.h)
+ * and implements the operations on the storage device that are common to all the policies */
+#include "buffer_handler.h"
+#include "../main/log_messages.h"
+#include "../main/statistical_processing.h"
+#include <stdlib.h> //for qsort
+
+void buffer_read_one_page(const SpatialIndex *si, int page, uint8_t *buf) {
+    FileSpecification fs;
+
+    fs.index_path = si->index_file;
+    fs.io_access = si->gp->io_access;
+    fs.page_size = si->gp->page_size;
+
+    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
+        disk_read_one_page(&fs, page, buf);
+    else if (si->gp->storage_system->type == FLASHDBSIM)
+        flashdbsim_read_one_page(si, page, buf);
+    else
+        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+}
+
+void buffer_read_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int pagenum) {
+    FileSpecification fs;
+
+    fs.index_path = si->index_file;
+    fs.io_access = si->gp->io_access;
+    fs.page_size = si->gp->page_size;
+
+    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
+        disk_read(&fs, pages, buf, pagenum);
+    else if (si->gp->storage_system->type == FLASHDBSIM)
+        flashdbsim_read_pages(si, pages, buf, pagenum);
+    else
+        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+}
+
+void buffer_write_one_page(const SpatialIndex *si, int page, uint8_t *buf) {
+    FileSpecification fs;
+
+    fs.index_path = si->index_file;
+    fs.io_access = si->gp->io_access;
+    fs.page_size = si->gp->page_size;
+
+    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
+        disk_write_one_page(&fs, page, buf);
+    else if (si->gp->storage_system->type == FLASHDBSIM)
+        flashdbsim_write_one_page(si, buf, page);
+    else
+        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+}
+
+void buffer_write_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int pagenum) {
+    FileSpecification fs;
+
+    fs.index_path = si->index_file;
+    fs.io_access = si->gp->io_access;
+    fs.page_size = si->gp->page_size;
+
+    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
+        disk_write(&fs, pages, buf, pagenum);
+    else if (si->gp->storage_system->type == FLASHDBSIM)
+        flashdbsim_write_pages(si, pages, buf, pagenum);
+    else
+        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+}
+
+static int buffer_write_comp(const void *a, const void *b) {
+    int p1 = ((const BufferWrite*) a)->page;
+    int p2 = ((const BufferWrite*) b)->page;
+    return (p1 > p2) - (p1 < p2);
+}
+
+void buffer_sort_writes(BufferWrite *w, int pagenum) {
+    if (pagenum > 1)
+        qsort(w, pagenum, sizeof (BufferWrite), buffer_write_comp);
+}
+
+void buffer_write_sorted_pages(const SpatialIndex *si, BufferWrite *w, int pagenum, uint8_t *staging) {
+    uint8_t *sorted;
+    int *pages;
+    int i;
+    int runs = 0;
+
+    if (pagenum <= 0)
+        return;
+    if (pagenum == 1) {
+        //the frames of the buffers are aligned, thus the page is written from its frame
+        buffer_write_one_page(si, w[0].page, w[0].data);
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0) {
+            _sbuffer_written_pages++;
+            _sbuffer_write_runs++;
+        }
+#endif
+        return;
+    }
+
+    buffer_sort_writes(w, pagenum);
+
+    //each frame is copied only once, already in the order of the pages
+    sorted = (staging != NULL) ? staging : buffer_alloc_pages(si, pagenum);
+    pages = (int*) lwalloc(sizeof (int) * pagenum);
+    for (i = 0; i < pagenum; i++) {
+        uint8_t *loc = sorted + (size_t) i * si->gp->page_size;
+
+        pages[i] = w[i].page;
+        if (w[i].data != loc)
+            memcpy(loc, w[i].data, si->gp->page_size);
+        if (i == 0 || pages[i] != pages[i - 1] + 1)
+            runs++;
+    }
+
+    //the consecutive pages are written together by the storage device (see disk_write)
+    buffer_write_pages(si, pages, sorted, pagenum);
+    lwfree(pages);
+    if (staging == NULL)
+        buffer_free_page(si, sorted);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        _sbuffer_written_pages += pagenum;
+        _sbuffer_write_runs += runs;
+    }
+#endif
+}
+
+uint8_t *buffer_alloc_pages(const SpatialIndex *si, int nofpages) {
+    uint8_t *data;
+
+    if (si->gp->io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &data, si->gp->page_size, (size_t) nofpages * si->gp->page_size)) {
+            _DEBUG(ERROR, "Allocation failed at buffer_alloc_pages");
+        }
+    } else {
+        data = (uint8_t*) lwalloc((size_t) nofpages * si->gp->page_size);
+    }
+    return data;
+}
+
+uint8_t *buffer_alloc_page(const SpatialIndex *si) {
+    uint8_t *data;
+
+    if (si->gp->io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &data, si->gp->page_size, si->gp->page_size)) {
+            _DEBUG(ERROR, "Allocation failed at buffer_alloc_page");
+        }
+    } else {
+        data = (uint8_t*) lwalloc(si->gp->page_size);
+    }
+    return data;
+}
+
+void buffer_free_page(const SpatialIndex *si, uint8_t *data) {
+    if (si->gp->io_access == DIRECT_ACCESS) {
+        free(data);
+    } else {
+        lwfree(data);
+    }
+}
+
+/* the policies that do not consider the height of the nodes */
+static void lru_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_lru_find(si, page, buf);
+}
+
+static void lru_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_lru_add(si, page, buf);
+}
+
+static int lru_resident_pages(int *pages, int *heights, int max) {
+    return buffer_lru_resident_pages(pages, max);
+}
+
+static void lru_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_lru_load(si, page, buf);
+}
+
+static uint8_t *lru_pin(const SpatialIndex *si, int page, int height) {
+    return buffer_lru_pin(si, page);
+}
+
+static void s2q_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_s2q_find(si, page, buf);
+}
+
+static void s2q_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_s2q_add(si, page, buf);
+}
+
+static int s2q_resident_pages(int *pages, int *heights, int max) {
+    return buffer_s2q_resident_pages(pages, max);
+}
+
+static void s2q_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_s2q_load(si, page, buf);
+}
+
+static uint8_t *s2q_pin(const SpatialIndex *si, int page, int height) {
+    return buffer_s2q_pin(si, page);
+}
+
+static void full2q_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_2q_find(si, page, buf);
+}
+
+static void full2q_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_2q_add(si, page, buf);
+}
+
+static int full2q_resident_pages(int *pages, int *heights, int max) {
+    return buffer_2q_resident_pages(pages, max);
+}
+
+static void full2q_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_2q_load(si, page, buf);
+}
+
+static uint8_t *full2q_pin(const SpatialIndex *si, int page, int height) {
+    return buffer_2q_pin(si, page);
+}
+
+static void arc_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_arc_find(si, page, buf);
+}
+
+static void arc_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_arc_add(si, page, buf);
+}
+
+static int arc_resident_pages(int *pages, int *heights, int max) {
+    return buffer_arc_resident_pages(pages, max);
+}
+
+static void arc_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_arc_load(si, page, buf);
+}
+
+static void clockpro_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_clockpro_find(si, page, buf);
+}
+
+static void clockpro_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_clockpro_add(si, page, buf);
+}
+
+static int clockpro_resident_pages(int *pages, int *heights, int max) {
+    return buffer_clockpro_resident_pages(pages, max);
+}
+
+static void clockpro_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_clockpro_load(si, page, buf);
+}
+
+static void cflru_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_cflru_find(si, page, buf);
+}
+
+static void cflru_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_cflru_add(si, page, buf);
+}
+
+static int cflru_resident_pages(int *pages, int *heights, int max) {
+    return buffer_cflru_resident_pages(pages, max);
+}
+
+static void cflru_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_cflru_load(si, page, buf);
+}
+
+static void shared_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_shared_find(si, page, buf);
+}
+
+static void shared_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_shared_add(si, page, buf);
+}
+
+static int shared_resident_pages(int *pages, int *heights, int max) {
+    return buffer_shared_resident_pages(pages, max);
+}
+
+static void shared_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_shared_load(si, page, buf);
+}
+
+static const BufferPolicy buffer_policies[] = {
+    {BUFFER_LRU, lru_find, lru_add, buffer_lru_flush_all, NULL, buffer_lru_number_of_pages,
+        lru_pin, buffer_lru_unpin, lru_resident_pages, lru_load, buffer_lru_capacity},
+    {BUFFER_HLRU, buffer_hlru_find, buffer_hlru_add, buffer_hlru_flush_all, buffer_hlru_update_tree_height,
+        buffer_hlru_number_of_pages, buffer_hlru_pin, buffer_hlru_unpin, buffer_hlru_resident_pages, buffer_hlru_load,
+        buffer_hlru_capacity},
+    {BUFFER_S2Q, s2q_find, s2q_add, buffer_s2q_flush_all, NULL, buffer_s2q_number_of_pages,
+        s2q_pin, buffer_s2q_unpin, s2q_resident_pages, s2q_load, buffer_s2q_capacity},
+    {BUFFER_2Q, full2q_find, full2q_add, buffer_2q_flush_all, NULL, buffer_2q_number_of_pages,
+        full2q_pin, buffer_2q_unpin, full2q_resident_pages, full2q_load, buffer_2q_capacity},
+    {BUFFER_ARC, arc_find, arc_add, buffer_arc_flush_all, NULL, buffer_arc_number_of_pages, NULL, NULL,
+        arc_resident_pages, arc_load, buffer_arc_capacity},
+    {BUFFER_CLOCKPRO, clockpro_find, clockpro_add, buffer_clockpro_flush_all, NULL, buffer_clockpro_number_of_pages,
+        NULL, NULL, clockpro_resident_pages, clockpro_load, buffer_clockpro_capacity},
+    {BUFFER_CFLRU, cflru_find, cflru_add, buffer_cflru_flush_all, NULL, buffer_cflru_number_of_pages, NULL, NULL,
+        cflru_resident_pages, cflru_load, buffer_cflru_capacity},
+    {BUFFER_SHARED, shared_find, shared_add, buffer_shared_flush_all, NULL, buffer_shared_number_of_pages, NULL, NULL,
+        shared_resident_pages, shared_load, buffer_shared_capacity}
+};
+
+const BufferPolicy *buffer_get_policy(uint8_t buffer_type) {
+    int i;
+    int n = (int) (sizeof (buffer_policies) / sizeof (BufferPolicy));
+
+    for (i = 0; i < n; i++) {
+        if (buffer_policies[i].buffer_type == buffer_type)
+            return &buffer_policies[i];
+    }
+    _DEBUGF(ERROR, "There is no this buffer scheme: %d ", buffer_type);
+    return NULL;
+}
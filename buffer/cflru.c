@@ -0,0 +1,388 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*this file is responsible to implement the CFLRU (clean-first LRU) replacement cache
+ * the pages are kept in a LRU list and its least recently used part is the clean-first window
+ * a victim is the least recently used clean page of the window, thus, dirty pages stay longer in the buffer
+ * if the window has only dirty pages, all of them are written together (see buffer_write_sorted_pages) and the
+ * least recently used page is evicted; the other pages of the window become clean victims for the next evictions
+ * the size of the window is given as a percentage of the buffer (CFLRU(window_perc)) or is adapted from
+ * the ratio between the cost of writing and reading a page (CFLRU) */
+#include "buffer_handler.h"
+#include "../libraries/uthash/uthash.h"
+#include "../main/log_messages.h"
+
+#include "../main/statistical_processing.h"
+
+/* undefine the defaults */
+#undef uthash_malloc
+#undef uthash_free
+
+/* re-define to use the lwalloc and lwfree from the postgis */
+#define uthash_malloc(sz) lwalloc(sz)
+#define uthash_free(ptr,sz) lwfree(ptr)
+
+#undef uthash_fatal
+#define uthash_fatal(msg) _DEBUG(ERROR, msg)
+
+/* the minimum number of measured reads and writes to adapt the window size for disks */
+#define CFLRU_MIN_SAMPLES       16
+/* the window size (in percentage) used while there are not enough measured reads and writes */
+#define CFLRU_DEFAULT_WINDOW    25.0
+
+typedef struct CFLRU {
+    UT_hash_handle hh;
+
+    int page_id; //the key
+    uint8_t *data; //the serialized node
+    bool modified; //this node has modification to be applied?
+    struct CFLRU *prev; //the previous page in the LRU list
+    struct CFLRU *next; //the next page in the LRU list
+} CFLRU;
+
+/*
+ * Some considerations about the size of the buffer:
+ * 1 - it only considers the size of the node and its id (that is: page_size + sizeof(int))
+ * 2 - it does not consider the overhead size introduced by the UT_hash_handle!
+ */
+
+static CFLRU *cflru = NULL;
+static CFLRU *lru_head = NULL; //the least recently used page
+static CFLRU *lru_tail = NULL; //the most recently used page
+static int cflru_size = 0;
+
+/* the measured costs of the storage device (only used for adaptive windows on disks)
+ * a write is a call that writes the dirty pages of the window (that is, the cost of evicting dirty pages),
+ * which is compared to the cost of reading a page again (that is, the cost of evicting a clean page)
+ * they are discarded by the flushing and when the storage device or the page size changes */
+static double read_cost = 0.0;
+static double write_cost = 0.0;
+static int read_num = 0;
+static int write_num = 0;
+static int cost_storage = -1; //the type of the storage device of the measured costs
+static int cost_page_size = 0;
+static uint8_t cost_io_access = 0;
+
+static void cflru_reset_costs(void) {
+    read_cost = 0.0;
+    write_cost = 0.0;
+    read_num = 0;
+    write_num = 0;
+    cost_storage = -1;
+}
+
+static void cflru_list_append(CFLRU *entry) {
+    entry->next = NULL;
+    entry->prev = lru_tail;
+    if (lru_tail != NULL)
+        lru_tail->next = entry;
+    else
+        lru_head = entry;
+    lru_tail = entry;
+}
+
+static void cflru_list_remove(CFLRU *entry) {
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        lru_head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        lru_tail = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void cflru_read_one_page(const SpatialIndex *si, int page, uint8_t *buf) {
+    struct timespec start = get_current_time();
+    buffer_read_one_page(si, page, buf);
+    read_cost += get_elapsed_time(start, get_current_time());
+    read_num++;
+}
+
+static void cflru_write_pages(const SpatialIndex *si, BufferWrite *writes, int pagenum) {
+    struct timespec start = get_current_time();
+    buffer_write_sorted_pages(si, writes, pagenum, NULL);
+    write_cost += get_elapsed_time(start, get_current_time());
+    write_num++;
+}
+
+/* the number of pages of the clean-first window
+ * for adaptive windows, the ratio r between the cost of writing and reading a page defines the
+ * percentage (r - 1) / 2r of the buffer, that is, no window if the costs are equal and at most half of the buffer */
+static int cflru_window_size(const SpatialIndex *si, int nofpages) {
+    BufferCFLRUSpecification *spec = (BufferCFLRUSpecification*) si->bs->buf_additional_param;
+    double perc = CFLRU_DEFAULT_WINDOW;
+    int w;
+
+    if (spec->window_perc >= 0) {
+        perc = spec->window_perc;
+    } else {
+        double ratio = 0.0;
+        if (si->gp->storage_system->type == FLASHDBSIM) {
+            FlashDBSim *f = (FlashDBSim*) si->gp->storage_system->info;
+            if (f->read_random_time > 0)
+                ratio = (double) f->program_time / (double) f->read_random_time;
+        } else if (cost_storage != (int) si->gp->storage_system->type || cost_page_size != si->gp->page_size ||
+                cost_io_access != si->gp->io_access) {
+            //the measured costs belong to another configuration
+            cflru_reset_costs();
+            cost_storage = (int) si->gp->storage_system->type;
+            cost_page_size = si->gp->page_size;
+            cost_io_access = si->gp->io_access;
+        } else if (read_num >= CFLRU_MIN_SAMPLES && write_num >= CFLRU_MIN_SAMPLES && read_cost > 0) {
+            ratio = (write_cost / write_num) / (read_cost / read_num);
+        }
+        if (ratio > 0)
+            perc = ratio <= 1.0 ? 0.0 : 100.0 * (ratio - 1.0) / (2.0 * ratio);
+    }
+
+    w = (int) ((double) nofpages * (perc / 100.0));
+    if (w < 1)
+        w = 1;
+    if (w > nofpages)
+        w = nofpages;
+    return w;
+}
+
+/* it evicts a page from the buffer (the least recently used clean page of the window) */
+static void cflru_evict(const SpatialIndex *si, int nofpages) {
+    CFLRU *entry;
+    CFLRU *victim = NULL;
+    int window = cflru_window_size(si, nofpages);
+    int i = 0;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    for (entry = lru_head; entry != NULL && i < window; entry = entry->next, i++) {
+        if (!entry->modified) {
+            victim = entry;
+            break;
+        }
+    }
+
+    if (victim == NULL) {
+        //all the pages of the window are dirty, we write them in a single write (ordered by their pages)
+        BufferWrite *writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (i + 1));
+        int j;
+
+        for (entry = lru_head, j = 0; j < i; entry = entry->next, j++) {
+            writes[j].page = entry->page_id;
+            writes[j].data = entry->data;
+            entry->modified = false;
+        }
+        cflru_write_pages(si, writes, i);
+
+        lwfree(writes);
+        victim = lru_head;
+    }
+
+    cflru_list_remove(victim);
+    HASH_DEL(cflru, victim);
+    buffer_free_page(si, victim->data);
+    lwfree(victim);
+    cflru_size--;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+int buffer_cflru_capacity(const SpatialIndex *si) {
+    return (int) (si->bs->max_capacity / (si->gp->page_size + sizeof (int)));
+}
+
+static void buffer_cflru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
+    CFLRU *entry;
+    int nofpages;
+
+    if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
+            si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
+        _DEBUGF(WARNING, "The buffer has very low capacity (%zu) and thus, "
+                "cannot store any node (size of a node is %d)",
+                si->bs->min_capacity, si->gp->page_size);
+        if (mod) {
+            buffer_write_one_page(si, page, buf);
+        }
+        return;
+    }
+
+    HASH_FIND_INT(cflru, &page, entry);
+    if (entry != NULL) {
+        cflru_list_remove(entry);
+        cflru_list_append(entry);
+
+        if (mod) {
+            entry->modified = mod;
+            memcpy(entry->data, buf, (size_t) si->gp->page_size);
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+        return;
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_page_fault++;
+#endif
+
+    nofpages = buffer_cflru_capacity(si);
+    if (cflru_size >= nofpages)
+        cflru_evict(si, nofpages);
+
+    entry = (CFLRU*) lwalloc(sizeof (CFLRU));
+    entry->page_id = page;
+    entry->data = buffer_alloc_page(si);
+    memcpy(entry->data, buf, si->gp->page_size);
+    entry->modified = mod;
+    HASH_ADD_INT(cflru, page_id, entry);
+    cflru_list_append(entry);
+    cflru_size++;
+}
+
+void buffer_cflru_find(const SpatialIndex *si, int page, uint8_t *buf) {
+    CFLRU *entry;
+    HASH_FIND_INT(cflru, &page, entry);
+
+    if (entry != NULL) {
+        cflru_list_remove(entry);
+        cflru_list_append(entry);
+        //it is stored in our buffer
+        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+    } else {
+        //this entry does not exist in our buffer
+        //then we have to get this node from the disk/flash
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        cflru_read_one_page(si, page, buf);
+
+        //now we add this page into the buffer
+        buffer_cflru_add_entry(si, page, buf, false);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0) {
+            cpuend = get_CPU_time();
+            end = get_current_time();
+
+            _sbuffer_find_cpu_time += get_elapsed_time(cpustart, cpuend);
+            _sbuffer_find_time += get_elapsed_time(start, end);
+        }
+#endif
+    }
+}
+
+void buffer_cflru_add(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_cflru_add_entry(si, page, buf, true);
+}
+
+void buffer_cflru_flush_all(const SpatialIndex *si) {
+    CFLRU *entry, *tmp_entry;
+    BufferWrite *writes;
+    int count = 0;
+    int i = 0;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    HASH_ITER(hh, cflru, entry, tmp_entry) {
+        if (entry->modified) {
+            count++;
+        }
+    }
+
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
+
+    HASH_ITER(hh, cflru, entry, tmp_entry) {
+        if (entry->modified) {
+            writes[i].page = entry->page_id;
+            writes[i].data = entry->data;
+            i++;
+        }
+    }
+
+    //the flushing is not a measure of the cost of evictions and the pages are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    HASH_ITER(hh, cflru, entry, tmp_entry) {
+        HASH_DEL(cflru, entry);
+        buffer_free_page(si, entry->data);
+        lwfree(entry);
+    }
+    lru_head = lru_tail = NULL;
+    cflru_size = 0;
+
+    cflru_reset_costs();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+unsigned int buffer_cflru_number_of_pages() {
+    return (unsigned int) cflru_size;
+}
+
+int buffer_cflru_resident_pages(int *pages, int max) {
+    CFLRU *entry;
+    int n = 0;
+
+    for (entry = lru_head; entry != NULL && n < max; entry = entry->next)
+        pages[n++] = entry->page_id;
+    return n;
+}
+
+void buffer_cflru_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_cflru_add_entry(si, page, buf, false);
+}
@@ -0,0 +1,392 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*this file is responsible to implement the CLOCK-Pro replacement cache
+ * all the pages are kept in a single clock, which is traversed by three hands:
+ * hand_cold evicts the cold pages (a cold page that was referenced becomes hot),
+ * hand_hot turns the hot pages that were not referenced into cold pages, and
+ * hand_test removes the test pages (i.e., non-resident pages that were recently evicted)
+ * a fault on a test page turns it into a hot page and increases the target number of cold pages (mem_cold)
+ * this implementation follows the structure of the CLOCK-Pro algorithm in https://github.com/dgryski/go-clockpro */
+#include "buffer_handler.h"
+#include "../libraries/uthash/uthash.h"
+#include "../main/log_messages.h"
+
+#include "../main/statistical_processing.h"
+
+/* undefine the defaults */
+#undef uthash_malloc
+#undef uthash_free
+
+/* re-define to use the lwalloc and lwfree from the postgis */
+#define uthash_malloc(sz) lwalloc(sz)
+#define uthash_free(ptr,sz) lwfree(ptr)
+
+#undef uthash_fatal
+#define uthash_fatal(msg) _DEBUG(ERROR, msg)
+
+/* the types of the pages */
+#define CLOCKPRO_HOT        0
+#define CLOCKPRO_COLD       1
+#define CLOCKPRO_TEST       2
+
+typedef struct ClockPro {
+    UT_hash_handle hh;
+
+    int page_id; //the key
+    uint8_t *data; //the serialized node (NULL for test pages)
+    bool modified; //this node has modification to be applied?
+    bool ref; //the reference bit
+    uint8_t type; //the type of the page (see above)
+    struct ClockPro *prev; //the previous page in the clock
+    struct ClockPro *next; //the next page in the clock
+} ClockPro;
+
+/*
+ * Some considerations about the size of the buffer:
+ * 1 - it only considers the size of the node and its id (that is: page_size + sizeof(int))
+ * 2 - thus, the number of resident pages (mem_max) is max_capacity / (page_size + sizeof(int))
+ * 3 - the test pages are not considered since they only store ids (at most mem_max ids)
+ * 4 - it does not consider the overhead size introduced by the UT_hash_handle!
+ */
+
+static ClockPro *clockpro = NULL; //all the pages (resident and test)
+static ClockPro *hand_hot = NULL;
+static ClockPro *hand_cold = NULL;
+static ClockPro *hand_test = NULL;
+static int mem_max = 0; //the maximum number of resident pages
+static int mem_cold = 0; //the target number of cold pages (0 means that it was not initialized)
+static int count_hot = 0;
+static int count_cold = 0;
+static int count_test = 0;
+
+static void clockpro_run_hand_cold(const SpatialIndex *si);
+static void clockpro_run_hand_hot(const SpatialIndex *si);
+static void clockpro_run_hand_test(const SpatialIndex *si);
+
+/* it removes a page from the clock and from the hash (its memory is released) */
+static void clockpro_meta_del(const SpatialIndex *si, ClockPro *entry) {
+    HASH_DEL(clockpro, entry);
+
+    if (entry->next == entry) {
+        //this is the last page of the clock
+        hand_hot = hand_cold = hand_test = NULL;
+    } else {
+        if (entry == hand_hot)
+            hand_hot = hand_hot->prev;
+        if (entry == hand_cold)
+            hand_cold = hand_cold->prev;
+        if (entry == hand_test)
+            hand_test = hand_test->prev;
+        entry->prev->next = entry->next;
+        entry->next->prev = entry->prev;
+    }
+
+    if (entry->data != NULL)
+        buffer_free_page(si, entry->data);
+    lwfree(entry);
+}
+
+/* it moves hand_cold until the resident pages fit in the buffer */
+static void clockpro_evict(const SpatialIndex *si) {
+    while (mem_max <= count_hot + count_cold) {
+        clockpro_run_hand_cold(si);
+    }
+}
+
+/* it adds a page in the clock (before hand_hot), some pages can be evicted before */
+static void clockpro_meta_add(const SpatialIndex *si, ClockPro *entry) {
+    clockpro_evict(si);
+
+    HASH_ADD_INT(clockpro, page_id, entry);
+    if (hand_hot == NULL) {
+        entry->prev = entry->next = entry;
+        hand_hot = hand_cold = hand_test = entry;
+    } else {
+        entry->next = hand_hot;
+        entry->prev = hand_hot->prev;
+        hand_hot->prev->next = entry;
+        hand_hot->prev = entry;
+    }
+    if (hand_cold == hand_hot)
+        hand_cold = hand_cold->prev;
+}
+
+static void clockpro_run_hand_cold(const SpatialIndex *si) {
+    ClockPro *entry = hand_cold;
+
+    if (entry->type == CLOCKPRO_COLD) {
+        if (entry->ref) {
+            entry->type = CLOCKPRO_HOT;
+            entry->ref = false;
+            count_cold--;
+            count_hot++;
+        } else {
+            //the page is evicted but remains as a test page
+            entry->type = CLOCKPRO_TEST;
+            if (entry->modified) {
+                buffer_write_one_page(si, entry->page_id, entry->data);
+                entry->modified = false;
+            }
+            buffer_free_page(si, entry->data);
+            entry->data = NULL;
+            count_cold--;
+            count_test++;
+            while (mem_max < count_test) {
+                clockpro_run_hand_test(si);
+            }
+        }
+    }
+
+    hand_cold = hand_cold->next;
+
+    while (mem_max - mem_cold < count_hot) {
+        clockpro_run_hand_hot(si);
+    }
+}
+
+static void clockpro_run_hand_hot(const SpatialIndex *si) {
+    ClockPro *entry;
+
+    if (hand_hot == hand_test)
+        clockpro_run_hand_test(si);
+
+    entry = hand_hot;
+    if (entry->type == CLOCKPRO_HOT) {
+        if (entry->ref) {
+            entry->ref = false;
+        } else {
+            entry->type = CLOCKPRO_COLD;
+            count_hot--;
+            count_cold++;
+        }
+    }
+
+    hand_hot = hand_hot->next;
+}
+
+static void clockpro_run_hand_test(const SpatialIndex *si) {
+    ClockPro *entry;
+
+    if (hand_test == hand_cold)
+        clockpro_run_hand_cold(si);
+
+    entry = hand_test;
+    if (entry->type == CLOCKPRO_TEST) {
+        //the page is removed from the clock, hand_test is moved to its previous page
+        clockpro_meta_del(si, entry);
+        count_test--;
+        if (mem_cold > 1)
+            mem_cold--;
+    }
+
+    if (hand_test != NULL)
+        hand_test = hand_test->next;
+}
+
+int buffer_clockpro_capacity(const SpatialIndex *si) {
+    return (int) (si->bs->max_capacity / (si->gp->page_size + sizeof (int)));
+}
+
+static void buffer_clockpro_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
+    ClockPro *entry;
+    bool hot = false;
+
+    if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
+            si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
+        _DEBUGF(WARNING, "The buffer has very low capacity (%zu) and thus, "
+                "cannot store any node (size of a node is %d)",
+                si->bs->min_capacity, si->gp->page_size);
+        if (mod) {
+            buffer_write_one_page(si, page, buf);
+        }
+        return;
+    }
+
+    mem_max = buffer_clockpro_capacity(si);
+    if (mem_cold == 0)
+        mem_cold = mem_max;
+
+    HASH_FIND_INT(clockpro, &page, entry);
+    if (entry != NULL && entry->type != CLOCKPRO_TEST) {
+        //a resident page, we only set its reference bit
+        entry->ref = true;
+        if (mod) {
+            entry->modified = mod;
+            memcpy(entry->data, buf, (size_t) si->gp->page_size);
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+        return;
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_page_fault++;
+#endif
+
+    if (entry != NULL) {
+        //a fault on a test page: it is within the test period, it becomes a hot page
+        if (mem_cold < mem_max)
+            mem_cold++;
+        clockpro_meta_del(si, entry);
+        count_test--;
+        hot = true;
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_ghost_hit++;
+#endif
+    }
+
+    entry = (ClockPro*) lwalloc(sizeof (ClockPro));
+    entry->page_id = page;
+    entry->data = buffer_alloc_page(si);
+    memcpy(entry->data, buf, si->gp->page_size);
+    entry->modified = mod;
+    entry->ref = false;
+    entry->type = hot ? CLOCKPRO_HOT : CLOCKPRO_COLD;
+
+    clockpro_meta_add(si, entry);
+    if (hot)
+        count_hot++;
+    else
+        count_cold++;
+}
+
+void buffer_clockpro_find(const SpatialIndex *si, int page, uint8_t *buf) {
+    ClockPro *entry;
+    HASH_FIND_INT(clockpro, &page, entry);
+
+    if (entry != NULL && entry->type != CLOCKPRO_TEST) {
+        entry->ref = true;
+        //it is stored in our buffer
+        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+    } else {
+        //this page is not resident in our buffer
+        //then we have to get this node from the disk/flash
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        buffer_read_one_page(si, page, buf);
+
+        //now we add this page into the buffer
+        buffer_clockpro_add_entry(si, page, buf, false);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0) {
+            cpuend = get_CPU_time();
+            end = get_current_time();
+
+            _sbuffer_find_cpu_time += get_elapsed_time(cpustart, cpuend);
+            _sbuffer_find_time += get_elapsed_time(start, end);
+        }
+#endif
+    }
+}
+
+void buffer_clockpro_add(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_clockpro_add_entry(si, page, buf, true);
+}
+
+void buffer_clockpro_flush_all(const SpatialIndex *si) {
+    ClockPro *entry, *tmp_entry;
+    BufferWrite *writes;
+    int count = 0;
+    int i = 0;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    HASH_ITER(hh, clockpro, entry, tmp_entry) {
+        if (entry->modified) {
+            count++;
+        }
+    }
+
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
+
+    HASH_ITER(hh, clockpro, entry, tmp_entry) {
+        /* we have to write this page on the disk/flash memory only if this node has modifications*/
+        if (entry->modified) {
+            writes[i].page = entry->page_id;
+            writes[i].data = entry->data;
+            i++;
+        }
+    }
+
+    //the pages are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    HASH_ITER(hh, clockpro, entry, tmp_entry) {
+        //the test pages are also removed
+        clockpro_meta_del(si, entry);
+    }
+    mem_cold = 0;
+    count_hot = 0;
+    count_cold = 0;
+    count_test = 0;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+unsigned int buffer_clockpro_number_of_pages() {
+    return (unsigned int) (count_hot + count_cold);
+}
+
+int buffer_clockpro_resident_pages(int *pages, int max) {
+    ClockPro *entry, *tmp_entry;
+    int n = 0;
+
+    HASH_ITER(hh, clockpro, entry, tmp_entry) {
+        if (n == max)
+            break;
+        //the test pages are not resident
+        if (entry->data != NULL)
+            pages[n++] = entry->page_id;
+    }
+    return n;
+}
+
+void buffer_clockpro_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_clockpro_add_entry(si, page, buf, false);
+}
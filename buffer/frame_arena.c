@@ -0,0 +1,209 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include "frame_arena.h"
+#include "../main/log_messages.h"
+#include <stdlib.h>
+#include <sys/mman.h> //for madvise
+
+/* the size of a huge page of the operating system (only used as alignment for large arenas) */
+#define FRAME_ARENA_HUGE_PAGE   (2 * 1024 * 1024)
+
+/* the memory of the arena is allocated by malloc since it survives the memory contexts of the SPI connections */
+
+static inline int frame_arena_slot(const FrameArena *arena, int page) {
+    //fibonacci hashing (the high bits of the product are used)
+    return (int) ((((uint32_t) page) * UINT32_C(2654435769)) >> arena->table_shift) & arena->table_mask;
+}
+
+FrameArena *frame_arena_create(int nofframes, int page_size) {
+    FrameArena *arena = (FrameArena*) malloc(sizeof (FrameArena));
+    size_t bytes = (size_t) nofframes * (size_t) page_size;
+    size_t alignment = (size_t) page_size;
+    int table_size = 1;
+    int table_bits = 0;
+
+    if (arena == NULL) {
+        _DEBUG(ERROR, "Allocation failed at frame_arena_create");
+        return NULL;
+    }
+
+    arena->nofframes = nofframes;
+    arena->page_size = page_size;
+
+    //an arena of pages of size 0 only stores identifiers of pages (e.g., the ghost lists of the 2Q)
+    if (bytes == 0) {
+        arena->frames = NULL;
+    } else {
+        //the frames are aligned to huge pages if the arena is large enough
+        if (bytes >= FRAME_ARENA_HUGE_PAGE && FRAME_ARENA_HUGE_PAGE % page_size == 0)
+            alignment = FRAME_ARENA_HUGE_PAGE;
+        if (posix_memalign((void**) &(arena->frames), alignment, bytes)) {
+            free(arena);
+            _DEBUG(ERROR, "Allocation failed at frame_arena_create");
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if (alignment == FRAME_ARENA_HUGE_PAGE)
+            madvise(arena->frames, bytes, MADV_HUGEPAGE);
+#endif
+    }
+
+    //the table has at least twice the number of frames (load factor of at most 0.5)
+    while (table_size < 2 * nofframes) {
+        table_size <<= 1;
+        table_bits++;
+    }
+    arena->table_mask = table_size - 1;
+    arena->table_shift = 32 - table_bits;
+    if (arena->table_shift >= 32)
+        arena->table_shift = 31;
+    arena->table = (int*) malloc(sizeof (int) * table_size);
+    arena->desc = (FrameDescriptor*) malloc(sizeof (FrameDescriptor) * nofframes);
+    if (arena->table == NULL || arena->desc == NULL) {
+        //free(NULL) has no effect
+        free(arena->table);
+        free(arena->desc);
+        free(arena->frames);
+        free(arena);
+        _DEBUG(ERROR, "Allocation failed at frame_arena_create");
+        return NULL;
+    }
+    frame_arena_reset(arena);
+
+    return arena;
+}
+
+void frame_arena_reset(FrameArena *arena) {
+    int i;
+
+    for (i = 0; i <= arena->table_mask; i++)
+        arena->table[i] = FRAME_NONE;
+
+    //all the frames are free
+    for (i = 0; i < arena->nofframes; i++) {
+        arena->desc[i].page_id = -1;
+        arena->desc[i].prev = FRAME_NONE;
+        arena->desc[i].next = (i + 1 < arena->nofframes) ? i + 1 : FRAME_NONE;
+        arena->desc[i].pin_count = 0;
+        arena->desc[i].modified = false;
+        arena->desc[i].writing = false;
+    }
+    arena->free_head = arena->nofframes > 0 ? 0 : FRAME_NONE;
+}
+
+void frame_arena_destroy(FrameArena *arena) {
+    if (arena) {
+        free(arena->frames);
+        free(arena->table);
+        free(arena->desc);
+        free(arena);
+    }
+}
+
+int frame_arena_lookup(const FrameArena *arena, int page) {
+    int slot = frame_arena_slot(arena, page);
+
+    while (arena->table[slot] != FRAME_NONE) {
+        if (arena->desc[arena->table[slot]].page_id == page)
+            return arena->table[slot];
+        slot = (slot + 1) & arena->table_mask;
+    }
+    return FRAME_NONE;
+}
+
+int frame_arena_alloc(FrameArena *arena, int page) {
+    int frame = arena->free_head;
+    int slot;
+
+    if (frame == FRAME_NONE)
+        return FRAME_NONE;
+
+    arena->free_head = arena->desc[frame].next;
+    arena->desc[frame].page_id = page;
+    arena->desc[frame].prev = FRAME_NONE;
+    arena->desc[frame].next = FRAME_NONE;
+    arena->desc[frame].pin_count = 0;
+    arena->desc[frame].modified = false;
+    arena->desc[frame].writing = false;
+
+    slot = frame_arena_slot(arena, page);
+    while (arena->table[slot] != FRAME_NONE)
+        slot = (slot + 1) & arena->table_mask;
+    arena->table[slot] = frame;
+
+    return frame;
+}
+
+void frame_arena_release(FrameArena *arena, int frame) {
+    int slot = frame_arena_slot(arena, arena->desc[frame].page_id);
+    int next;
+
+    while (arena->table[slot] != frame)
+        slot = (slot + 1) & arena->table_mask;
+
+    //backward shift deletion, thus the table does not need tombstones
+    next = (slot + 1) & arena->table_mask;
+    while (arena->table[next] != FRAME_NONE) {
+        int home = frame_arena_slot(arena, arena->desc[arena->table[next]].page_id);
+        //the entry of next can be moved to slot only if its home is not in (slot, next]
+        if (((next - home) & arena->table_mask) >= ((next - slot) & arena->table_mask)) {
+            arena->table[slot] = arena->table[next];
+            slot = next;
+        }
+        next = (next + 1) & arena->table_mask;
+    }
+    arena->table[slot] = FRAME_NONE;
+
+    arena->desc[frame].page_id = -1;
+    arena->desc[frame].pin_count = 0;
+    arena->desc[frame].modified = false;
+    arena->desc[frame].writing = false;
+    arena->desc[frame].prev = FRAME_NONE;
+    arena->desc[frame].next = arena->free_head;
+    arena->free_head = frame;
+}
+
+void frame_list_init(FrameList *list) {
+    list->head = FRAME_NONE;
+    list->tail = FRAME_NONE;
+    list->size = 0;
+}
+
+void frame_list_append(FrameArena *arena, FrameList *list, int frame) {
+    FrameDescriptor *d = &arena->desc[frame];
+
+    d->next = FRAME_NONE;
+    d->prev = list->tail;
+    if (list->tail != FRAME_NONE)
+        arena->desc[list->tail].next = frame;
+    else
+        list->head = frame;
+    list->tail = frame;
+    list->size++;
+}
+
+void frame_list_remove(FrameArena *arena, FrameList *list, int frame) {
+    FrameDescriptor *d = &arena->desc[frame];
+
+    if (d->prev != FRAME_NONE)
+        arena->desc[d->prev].next = d->next;
+    else
+        list->head = d->next;
+    if (d->next != FRAME_NONE)
+        arena->desc[d->next].prev = d->prev;
+    else
+        list->tail = d->prev;
+    d->prev = FRAME_NONE;
+    d->next = FRAME_NONE;
+    list->size--;
+}
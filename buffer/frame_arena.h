@@ -0,0 +1,84 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+ * File:   frame_arena.h
+ *
+ * Created on October 18, 2026
+ */
+
+/* This file specifies the memory of a standard buffer as a preallocated arena of frames.
+ *
+ * The pages are stored in a contiguous array of nofframes frames (aligned to the page size, and thus,
+ * usable by the direct access), which is advised to use huge pages when the operating system supports it.
+ * Each frame has a compact descriptor (page, pin count, modified flag, and the links of an intrusive list).
+ * The frame of a page is found by an open-addressing table (linear probing) that maps page ids to frames.
+ * Therefore, no memory is allocated after the creation of the arena, which is kept across the flushes of its buffer.
+ */
+
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_NONE      -1 //an invalid frame (e.g., the end of a list)
+
+typedef struct {
+    int page_id; //the page stored in this frame (-1 means that it is a free frame)
+    int prev; //the previous frame in its list
+    int next; //the next frame in its list (or in the list of free frames)
+    int pin_count; //number of pins of this frame (a pinned frame should not be evicted)
+    bool modified; //the page of this frame has modification to be applied?
+    bool writing; //the frame is being written by the background writer (it must not be modified or evicted)
+} FrameDescriptor;
+
+/* an intrusive list of frames, head is the least recently used frame */
+typedef struct {
+    int head;
+    int tail;
+    int size;
+} FrameList;
+
+typedef struct {
+    int nofframes; //the number of frames
+    int page_size; //the size of a frame
+    uint8_t *frames; //the contiguous memory of the frames
+    FrameDescriptor *desc; //the descriptors of the frames
+    int *table; //the open-addressing table from page ids to frames (FRAME_NONE means an empty slot)
+    int table_mask; //the size of the table minus one (the size is a power of two)
+    int table_shift; //32 minus the number of bits of the size of the table (for the hashing)
+    int free_head; //the first free frame
+} FrameArena;
+
+/* it creates an arena of nofframes frames of page_size bytes (all the frames are free)
+ * an arena with page_size equal to 0 only stores the identifiers of the pages */
+extern FrameArena *frame_arena_create(int nofframes, int page_size);
+extern void frame_arena_destroy(FrameArena *arena);
+/* it releases all the frames of the arena (its memory is kept) */
+extern void frame_arena_reset(FrameArena *arena);
+
+/* it returns the frame storing the page or FRAME_NONE */
+extern int frame_arena_lookup(const FrameArena *arena, int page);
+/* it takes a free frame for the page, FRAME_NONE if there is no free frame */
+extern int frame_arena_alloc(FrameArena *arena, int page);
+/* it releases a frame (it must not be in a list) */
+extern void frame_arena_release(FrameArena *arena, int frame);
+
+#define FRAME_DATA(arena, frame) ((arena)->frames + (size_t) (frame) * (size_t) (arena)->page_size)
+
+/* operations on the intrusive lists of frames */
+extern void frame_list_init(FrameList *list);
+extern void frame_list_append(FrameArena *arena, FrameList *list, int frame);
+extern void frame_list_remove(FrameArena *arena, FrameList *list, int frame);
+
+#endif /* FRAME_ARENA_H */
@@ -21,80 +21,60 @@
  */
 
 #include "buffer_handler.h"
-#include "../libraries/uthash/uthash.h" //for hashing structures
+#include "frame_arena.h"
 #include "../main/log_messages.h" //for messages
 
 #include "../main/statistical_processing.h" //for collection of statistical data
 
 #include <stringbuffer.h> /* for printing */
 
-/* undefine the defaults */
-#undef uthash_malloc
-#undef uthash_free
-
-/* re-define to use the lwalloc and lwfree from the postgis */
-#define uthash_malloc(sz) lwalloc(sz)
-#define uthash_free(ptr,sz) lwfree(ptr)
-
-
-//this corresponds to the Am part of the 2Q, which is managed as a LRU cache
-
-typedef struct {
-    UT_hash_handle hh;
-
-    int page_id; //the key
-    uint8_t *data; //the serialized node
-    bool modified; //this node has modification to be applied?
-} Am; //it stores the most frequent accessed pages
-
-//this corresponds to the A1in part of the 2Q, which is managed as a FIFO
+/*
+ * Some considerations about the size of the buffer:
+ * 1 - Am and A1in only consider the size of the node and its id (that is: page_size + sizeof(int)),
+ *      thus, their numbers of frames are the ceilings of Am_size / (page_size + sizeof(int)) and A1in_size / (page_size + sizeof(int))
+ * 2 - A1out only stores identifiers of pages, thus it stores A1out_size identifiers
+ * 3 - it does not consider the size of the frame descriptors and of the page tables (see frame_arena.h)
+ *
+ * The arenas are allocated in the first access to the buffer and kept across its flushings
+ * (they are only reallocated if the configuration of the buffer changes).
+ */
 
-typedef struct {
-    UT_hash_handle hh;
+//this corresponds to the Am part of the 2Q, which is managed as a LRU cache (head is the least recently used frame)
+static FrameArena *am_arena = NULL; //it stores the most frequent accessed pages
+static FrameList am_part = {FRAME_NONE, FRAME_NONE, 0};
 
-    int page_id; //the key    
-    uint8_t *data; //the serialized node
-    bool modified; //this node has modification to be applied?
-} A1in; //it stores the most recent accessed pages
+//this corresponds to the A1in part of the 2Q, which is managed as a FIFO (head is the oldest frame)
+static FrameArena *a1in_arena = NULL; //it stores the most recent accessed pages
+static FrameList a1in_part = {FRAME_NONE, FRAME_NONE, 0};
 
 //this corresponds to the A1out part of the 2Q, which is managed as a FIFO, storing the identifiers of the pages
-
-typedef struct {
-    UT_hash_handle hh;
-
-    int page_id; //the key
-} A1out; //it stores the ghost pages
-
-static Am *am_part = NULL;
-static A1in *a1in_part = NULL;
-static A1out *a1out_part = NULL;
+static FrameArena *a1out_arena = NULL; //it stores the ghost pages (an arena without frames)
+static FrameList a1out_part = {FRAME_NONE, FRAME_NONE, 0};
 
 /*function for debugging purposes
 static void buffer_2q_print() {
-    Am *entry_am, *tmp_entry_am;
-    A1in *entry_a1in, *tmp_entry_a1in;
-    A1out *entry_a1out, *tmp_entry_a1out;
+    int f;
     stringbuffer_t *sb;
-    int c = HASH_COUNT(am_part) + HASH_COUNT(a1in_part) + HASH_COUNT(a1out_part);
+    int c = am_part.size + a1in_part.size + a1out_part.size;
 
     sb = stringbuffer_create();
 
     stringbuffer_append(sb, "Pages in Am: ");
 
-    HASH_ITER(hh, am_part, entry_am, tmp_entry_am) {
-        stringbuffer_aprintf(sb, "%d ", entry_am->page_id);
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", am_arena->desc[f].page_id);
     }
 
     stringbuffer_append(sb, ". Pages in A1in: ");
 
-    HASH_ITER(hh, a1in_part, entry_a1in, tmp_entry_a1in) {
-        stringbuffer_aprintf(sb, "%d ", entry_a1in->page_id);
+    for (f = a1in_part.head; f != FRAME_NONE; f = a1in_arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", a1in_arena->desc[f].page_id);
     }
 
     stringbuffer_append(sb, ". Pages in A1out: ");
 
-    HASH_ITER(hh, a1out_part, entry_a1out, tmp_entry_a1out) {
-        stringbuffer_aprintf(sb, "%d ", entry_a1out->page_id);
+    for (f = a1out_part.head; f != FRAME_NONE; f = a1out_arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", a1out_arena->desc[f].page_id);
     }
 
     _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", c, stringbuffer_getstring(sb));
@@ -103,12 +83,129 @@ static void buffer_2q_print() {
 
 static void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod);
 
+/* it (re)creates an arena of a part that stores pages, the previous arena should have been flushed */
+static void buffer_2q_create_part(FrameArena **arena, FrameList *list, int nofframes, int page_size) {
+    if (*arena != NULL && ((*arena)->nofframes != nofframes || (*arena)->page_size != page_size)) {
+        //another configuration of buffer, the previous one should have been flushed
+        if (list->size > 0)
+            _DEBUG(ERROR, "The 2Q buffer was not flushed before changing its configuration");
+        frame_arena_destroy(*arena);
+        *arena = NULL;
+    }
+    if (*arena == NULL) {
+        *arena = frame_arena_create(nofframes, page_size);
+        frame_list_init(list);
+    }
+}
+
+/* the number of frames of a part that stores a page while its occupied size is lower than size
+ * (each part stores at least one page) */
+static int buffer_2q_part_frames(const SpatialIndex *si, size_t size) {
+    size_t frame_size = si->gp->page_size + sizeof (int);
+    int nofframes = (int) ((size + frame_size - 1) / frame_size);
+    return (nofframes < 1) ? 1 : nofframes;
+}
+
+/* Am and A1in store pages, A1out stores identifiers of pages */
+int buffer_2q_capacity(const SpatialIndex *si) {
+    Buffer2QSpecification *spec = (Buffer2QSpecification*) si->bs->buf_additional_param;
+    return buffer_2q_part_frames(si, spec->Am_size) + buffer_2q_part_frames(si, spec->A1in_size);
+}
+
+/* it creates the arenas of Am, A1in, and A1out, if needed */
+static void buffer_2q_create_arenas(const SpatialIndex *si) {
+    Buffer2QSpecification *spec = (Buffer2QSpecification*) si->bs->buf_additional_param;
+    int nofam = buffer_2q_part_frames(si, spec->Am_size);
+    int nofa1in = buffer_2q_part_frames(si, spec->A1in_size);
+    int nofa1out = (int) spec->A1out_size;
+
+    //each part stores at least one page
+    if (nofa1out < 1)
+        nofa1out = 1;
+
+    buffer_2q_create_part(&am_arena, &am_part, nofam, si->gp->page_size);
+    buffer_2q_create_part(&a1in_arena, &a1in_part, nofa1in, si->gp->page_size);
+
+    if (a1out_arena != NULL && a1out_arena->nofframes != nofa1out) {
+        //the ghost pages are only a history of accesses, thus they are discarded
+        frame_arena_destroy(a1out_arena);
+        a1out_arena = NULL;
+    }
+    if (a1out_arena == NULL) {
+        a1out_arena = frame_arena_create(nofa1out, 0);
+        frame_list_init(&a1out_part);
+    }
+}
+
+/* it appends the page in A1out, removing the oldest ghost page if A1out is full */
+static void buffer_2q_a1out_push(int page) {
+    int g = frame_arena_lookup(a1out_arena, page);
+
+    if (g != FRAME_NONE) {
+        //a page promoted to Am keeps its ghost, which becomes the newest one
+        frame_list_remove(a1out_arena, &a1out_part, g);
+        frame_list_append(a1out_arena, &a1out_part, g);
+        return;
+    }
+    if (a1out_part.size >= a1out_arena->nofframes) {
+        g = a1out_part.head;
+        frame_list_remove(a1out_arena, &a1out_part, g);
+        frame_arena_release(a1out_arena, g);
+    }
+    g = frame_arena_alloc(a1out_arena, page);
+    frame_list_append(a1out_arena, &a1out_part, g);
+}
+
+/* it stores the page in Am, evicting its least recently used frame if needed */
+static void buffer_2q_am_store(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
+    int f;
+
+    if (am_part.size >= am_arena->nofframes) {
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+        //pinned nodes are skipped
+        for (f = am_part.head; f != FRAME_NONE && am_arena->desc[f].pin_count > 0; f = am_arena->desc[f].next);
+        if (f != FRAME_NONE) {
+            /* we have to write this page on the disk/flash memory only if this node has modifications*/
+            if (am_arena->desc[f].modified) {
+                buffer_write_one_page(si, am_arena->desc[f].page_id, FRAME_DATA(am_arena, f));
+            }
+            frame_list_remove(am_arena, &am_part, f);
+            frame_arena_release(am_arena, f);
+        }
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0) {
+            cpuend = get_CPU_time();
+            end = get_current_time();
+
+            _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+            _sbuffer_flushing_time += get_elapsed_time(start, end);
+        }
+#endif
+        if (f == FRAME_NONE) {
+            //all the frames are pinned, then this page is not stored in the buffer
+            if (mod) {
+                buffer_write_one_page(si, page, buf);
+            }
+            return;
+        }
+    }
+
+    f = frame_arena_alloc(am_arena, page);
+    memcpy(FRAME_DATA(am_arena, f), buf, si->gp->page_size);
+    am_arena->desc[f].modified = mod;
+    frame_list_append(am_arena, &am_part, f);
+}
+
 void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
-    Am *entry_am, *tmp_entry_am;
-    A1in *entry_a1in, *tmp_entry_a1in;
-    A1out *entry_a1out, *tmp_entry_a1out;
-    int current_size;
-    FileSpecification fs;
+    int f;
 
     if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
             si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
@@ -116,34 +213,25 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
                 "cannot store any node (size of a node is %d)",
                 si->bs->min_capacity, si->gp->page_size);
         if (mod) {
-            fs.index_path = si->index_file;
-            fs.io_access = si->gp->io_access;
-            fs.page_size = si->gp->page_size;
-
-            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                disk_write_one_page(&fs, page, buf);
-            else if (si->gp->storage_system->type == FLASHDBSIM)
-                flashdbsim_write_one_page(si, buf, page);
-            else {
-                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-            }
+            buffer_write_one_page(si, page, buf);
         }
         return;
     }
 
     //_DEBUGF(NOTICE, "Putting %d", page);
 
-    HASH_FIND_INT(am_part, &page, entry_am);
+    buffer_2q_create_arenas(si);
+
+    f = frame_arena_lookup(am_arena, page);
 
-    if (entry_am != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(am_part, entry_am);
-        HASH_ADD_INT(am_part, page_id, entry_am);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(am_arena, &am_part, f);
+        frame_list_append(am_arena, &am_part, f);
         //it is stored in our buffer
         if (mod) {
-            memcpy(entry_am->data, buf, (size_t) si->gp->page_size);
-            entry_am->modified = mod;
+            memcpy(FRAME_DATA(am_arena, f), buf, (size_t) si->gp->page_size);
+            am_arena->desc[f].modified = mod;
         }
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
@@ -151,12 +239,12 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
 #endif
     } else {
         //we now should check if it is not stored in A1in
-        HASH_FIND_INT(a1in_part, &page, entry_a1in);
-        if (entry_a1in != NULL) {
+        f = frame_arena_lookup(a1in_arena, page);
+        if (f != FRAME_NONE) {
             //we only update its content and do not update its position in the list since it is managed as FIFO
             if (mod) {
-                memcpy(entry_a1in->data, buf, (size_t) si->gp->page_size);
-                entry_a1in->modified = mod;
+                memcpy(FRAME_DATA(a1in_arena, f), buf, (size_t) si->gp->page_size);
+                a1in_arena->desc[f].modified = mod;
             }
 #ifdef COLLECT_STATISTICAL_DATA
             if (_STORING == 0)
@@ -165,87 +253,18 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
         } else {
             /*this page is not in Am and A1in, let's check if it on the 'ghost' list, the A1out*/
             //we will only store it on Am if this page is contained on A1out
-            Buffer2QSpecification *spec = (Buffer2QSpecification*) si->bs->buf_additional_param;
 
 #ifdef COLLECT_STATISTICAL_DATA
             if (_STORING == 0)
                 _sbuffer_page_fault++;
 #endif 
 
-            HASH_FIND_INT(a1out_part, &page, entry_a1out);
-            if (entry_a1out != NULL) { //ok, we should store it on the Am
-                current_size = HASH_COUNT(am_part) * (si->gp->page_size + sizeof (int));
-                // prune the cache to MAX_CACHE_SIZE
-                if (current_size >= spec->Am_size) {
-#ifdef COLLECT_STATISTICAL_DATA
-                    struct timespec cpustart;
-                    struct timespec cpuend;
-                    struct timespec start;
-                    struct timespec end;
-
-                    cpustart = get_CPU_time();
-                    start = get_current_time();
-#endif
-
-                    HASH_ITER(hh, am_part, entry_am, tmp_entry_am) {
-                        // prune the first entry (loop is based on insertion order so this deletes the oldest item)
-                        HASH_DEL(am_part, entry_am);
-
-                        /* we have to write this page on the disk/flash memory only if this node has modifications*/
-                        if (entry_am->modified) {
-                            fs.index_path = si->index_file;
-                            fs.io_access = si->gp->io_access;
-                            fs.page_size = si->gp->page_size;
-
-                            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                                disk_write_one_page(&fs, entry_am->page_id, entry_am->data);
-                            else if (si->gp->storage_system->type == FLASHDBSIM)
-                                flashdbsim_write_one_page(si, entry_am->data, entry_am->page_id);
-                            else
-                                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                        }
-
-                        if (si->gp->io_access == DIRECT_ACCESS) {
-                            free(entry_am->data);
-                        } else {
-                            lwfree(entry_am->data);
-                        }
-                        lwfree(entry_am);
-
-                        break;
-                    }
-#ifdef COLLECT_STATISTICAL_DATA
-                    if (_STORING == 0) {
-                        cpuend = get_CPU_time();
-                        end = get_current_time();
-
-                        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
-                        _sbuffer_flushing_time += get_elapsed_time(start, end);
-                    }
-#endif
-                }
-
-                entry_am = (Am*) lwalloc(sizeof (Am));
-                entry_am->page_id = page;
-
-                if (si->gp->io_access == DIRECT_ACCESS) {
-                    //then the memory must be aligned in blocks!
-                    if (posix_memalign((void**) &(entry_am->data), si->gp->page_size, si->gp->page_size)) {
-                        _DEBUG(ERROR, "Allocation failed at buffer_s2q_add_entry");
-                    }
-                } else {
-                    entry_am->data = (uint8_t*) lwalloc(si->gp->page_size);
-                }
-                memcpy(entry_am->data, buf, si->gp->page_size);
-
-                entry_am->modified = mod;
-                HASH_ADD_INT(am_part, page_id, entry_am);
+            if (frame_arena_lookup(a1out_arena, page) != FRAME_NONE) { //ok, we should store it on the Am
+                buffer_2q_am_store(si, page, buf, mod);
             } else {
                 //this page is not contained in ghost, recent or frequent lists
                 //we check if A1in have enough space
-                current_size = HASH_COUNT(a1in_part) * (si->gp->page_size + sizeof (int));
-                // prune the cache to MAX_CACHE_SIZE
-                if (current_size >= spec->A1in_size) {
+                if (a1in_part.size >= a1in_arena->nofframes) {
 #ifdef COLLECT_STATISTICAL_DATA
                     struct timespec cpustart;
                     struct timespec cpuend;
@@ -255,46 +274,22 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
                     cpustart = get_CPU_time();
                     start = get_current_time();
 #endif
-
-                    HASH_ITER(hh, a1in_part, entry_a1in, tmp_entry_a1in) {
+                    //pinned nodes are skipped
+                    for (f = a1in_part.head; f != FRAME_NONE && a1in_arena->desc[f].pin_count > 0;
+                            f = a1in_arena->desc[f].next);
+                    if (f != FRAME_NONE) {
                         //in negative case, we remove an entry from A1in, respecting the FIFO, putting it into the 'ghost' list, A1out
-                        HASH_DEL(a1in_part, entry_a1in);
 
                         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-                        if (entry_a1in->modified) {
-                            fs.index_path = si->index_file;
-                            fs.io_access = si->gp->io_access;
-                            fs.page_size = si->gp->page_size;
-
-                            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                                disk_write_one_page(&fs, entry_a1in->page_id, entry_a1in->data);
-                            else if (si->gp->storage_system->type == FLASHDBSIM)
-                                flashdbsim_write_one_page(si, entry_a1in->data, entry_a1in->page_id);
-                            else
-                                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+                        if (a1in_arena->desc[f].modified) {
+                            buffer_write_one_page(si, a1in_arena->desc[f].page_id, FRAME_DATA(a1in_arena, f));
                         }
 
                         //put the flushed page into a1out
-                        current_size = HASH_COUNT(a1out_part);
-                        if (current_size >= spec->A1out_size) {
-                            HASH_ITER(hh, a1out_part, entry_a1out, tmp_entry_a1out) {
-                                HASH_DEL(a1out_part, entry_a1out);
-                                lwfree(entry_a1out);
-                                break;
-                            }
-                        }
-                        entry_a1out = (A1out*) lwalloc(sizeof (A1out));
-                        entry_a1out->page_id = page;
-                        HASH_ADD_INT(a1out_part, page_id, entry_a1out);
-
-                        if (si->gp->io_access == DIRECT_ACCESS) {
-                            free(entry_a1in->data);
-                        } else {
-                            lwfree(entry_a1in->data);
-                        }
-                        lwfree(entry_a1in);
+                        buffer_2q_a1out_push(a1in_arena->desc[f].page_id);
 
-                        break;
+                        frame_list_remove(a1in_arena, &a1in_part, f);
+                        frame_arena_release(a1in_arena, f);
                     }
 
 #ifdef COLLECT_STATISTICAL_DATA
@@ -306,22 +301,19 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
                         _sbuffer_flushing_time += get_elapsed_time(start, end);
                     }
 #endif
-                }
-
-                entry_a1in = (A1in*) lwalloc(sizeof (A1in));
-                entry_a1in->page_id = page;
-                if (si->gp->io_access == DIRECT_ACCESS) {
-                    //then the memory must be aligned in blocks!
-                    if (posix_memalign((void**) &(entry_a1in->data), si->gp->page_size, si->gp->page_size)) {
-                        _DEBUG(ERROR, "Allocation failed at buffer_s2q_add_entry");
+                    if (f == FRAME_NONE) {
+                        //all the frames are pinned, then this page is not stored in the buffer
+                        if (mod) {
+                            buffer_write_one_page(si, page, buf);
+                        }
+                        return;
                     }
-                } else {
-                    entry_a1in->data = (uint8_t*) lwalloc(si->gp->page_size);
                 }
-                memcpy(entry_a1in->data, buf, si->gp->page_size);
 
-                entry_a1in->modified = mod;
-                HASH_ADD_INT(a1in_part, page_id, entry_a1in);
+                f = frame_arena_alloc(a1in_arena, page);
+                memcpy(FRAME_DATA(a1in_arena, f), buf, si->gp->page_size);
+                a1in_arena->desc[f].modified = mod;
+                frame_list_append(a1in_arena, &a1in_part, f);
             }
         }
     }
@@ -330,18 +322,16 @@ void buffer_2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mo
 }
 
 void buffer_2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
-    Am *entry;
-    HASH_FIND_INT(am_part, &page, entry);
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
 
     //_DEBUGF(NOTICE, "Searching for %d", page);
 
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(am_part, entry);
-        HASH_ADD_INT(am_part, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(am_arena, &am_part, f);
+        frame_list_append(am_arena, &am_part, f);
         //it is stored in our buffer
-        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+        memcpy(buf, FRAME_DATA(am_arena, f), (size_t) si->gp->page_size);
 
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
@@ -349,11 +339,10 @@ void buffer_2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
 #endif
     } else {
         /*this entry does not exist in Am, we check in A1in*/
-        A1in *entry_a1in;
-        HASH_FIND_INT(a1in_part, &page, entry_a1in);
-        if (entry_a1in != NULL) {
+        f = (a1in_arena != NULL) ? frame_arena_lookup(a1in_arena, page) : FRAME_NONE;
+        if (f != FRAME_NONE) {
             //it is stored in our buffer, we do not change the position
-            memcpy(buf, entry_a1in->data, (size_t) si->gp->page_size);
+            memcpy(buf, FRAME_DATA(a1in_arena, f), (size_t) si->gp->page_size);
 
 #ifdef COLLECT_STATISTICAL_DATA
             if (_STORING == 0)
@@ -362,7 +351,6 @@ void buffer_2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
         } else {
             /* this page is not stored in the buffer, 
              * then we have to get this node from the storage device*/
-            FileSpecification fs;
 #ifdef COLLECT_STATISTICAL_DATA
             struct timespec cpustart;
             struct timespec cpuend;
@@ -375,16 +363,7 @@ void buffer_2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
 
             /* we have to read this page from the disk/flash memory*/
 
-            fs.index_path = si->index_file;
-            fs.io_access = si->gp->io_access;
-            fs.page_size = si->gp->page_size;
-
-            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                disk_read_one_page(&fs, page, buf);
-            else if (si->gp->storage_system->type == FLASHDBSIM)
-                flashdbsim_read_one_page(si, page, buf);
-            else
-                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+            buffer_read_one_page(si, page, buf);
 
             //now we add this page into the buffer
             buffer_2q_add_entry(si, page, buf, false);
@@ -404,18 +383,59 @@ void buffer_2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
    // buffer_2q_print();
 }
 
+uint8_t *buffer_2q_pin(const SpatialIndex *si, int page) {
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
+
+    if (f != FRAME_NONE) {
+        frame_list_remove(am_arena, &am_part, f);
+        frame_list_append(am_arena, &am_part, f);
+        am_arena->desc[f].pin_count++;
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+        return FRAME_DATA(am_arena, f);
+    }
+
+    f = (a1in_arena != NULL) ? frame_arena_lookup(a1in_arena, page) : FRAME_NONE;
+    if (f != FRAME_NONE) {
+        //we do not change its position since A1in is managed as FIFO
+        a1in_arena->desc[f].pin_count++;
+
+#ifdef COLLECT_STATISTICAL_DATA
+        if (_STORING == 0)
+            _sbuffer_page_hit++;
+#endif
+        return FRAME_DATA(a1in_arena, f);
+    }
+    return NULL;
+}
+
+void buffer_2q_unpin(int page) {
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
+
+    if (f != FRAME_NONE && am_arena->desc[f].pin_count > 0) {
+        am_arena->desc[f].pin_count--;
+        return;
+    }
+    f = (a1in_arena != NULL) ? frame_arena_lookup(a1in_arena, page) : FRAME_NONE;
+    if (f != FRAME_NONE && a1in_arena->desc[f].pin_count > 0) {
+        a1in_arena->desc[f].pin_count--;
+        return;
+    }
+    _DEBUGF(ERROR, "The page %d is not pinned in the 2Q buffer", page);
+}
+
 void buffer_2q_add(const SpatialIndex *si, int page, uint8_t * buf) {
     buffer_2q_add_entry(si, page, buf, true);
 }
 
 void buffer_2q_flush_all(const SpatialIndex * si) {
-    Am *entry, *tmp_entry;
-    A1in *entry_a1in, *tmp_entry_a1in;
-    FileSpecification fs;
-    int *pages;
+    int f;
+    BufferWrite *writes;
     int count = 0;
     int i = 0;
-    uint8_t *loc, *buf;
 #ifdef COLLECT_STATISTICAL_DATA
     struct timespec cpustart;
     struct timespec cpuend;
@@ -426,90 +446,52 @@ void buffer_2q_flush_all(const SpatialIndex * si) {
     start = get_current_time();
 #endif
 
-    HASH_ITER(hh, am_part, entry, tmp_entry) {
+    if (am_arena == NULL)
+        return;
+
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
+        if (am_arena->desc[f].modified) {
             count++;
         }
     }
 
-    HASH_ITER(hh, a1in_part, entry_a1in, tmp_entry_a1in) {
+    for (f = a1in_part.head; f != FRAME_NONE; f = a1in_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry_a1in->modified) {
+        if (a1in_arena->desc[f].modified) {
             count++;
         }
     }
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, count * si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at buffer_s2q_add_entry");
-        }
-    } else {
-        buf = (uint8_t*) lwalloc(count * si->gp->page_size);
-    }
-    pages = (int*) lwalloc(sizeof (int) * count);
-
-    loc = buf;
-
-    HASH_ITER(hh, am_part, entry, tmp_entry) {
-        // delete this entry
-        HASH_DEL(am_part, entry);
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
 
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            pages[i] = entry->page_id;
-            memcpy(loc, entry->data, si->gp->page_size);
-            loc += si->gp->page_size;
+        if (am_arena->desc[f].modified) {
+            writes[i].page = am_arena->desc[f].page_id;
+            writes[i].data = FRAME_DATA(am_arena, f);
             i++;
         }
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            free(entry->data);
-        } else {
-            lwfree(entry->data);
-        }
-        lwfree(entry);
     }
 
-    HASH_ITER(hh, a1in_part, entry_a1in, tmp_entry_a1in) {
-        // delete this entry
-        HASH_DEL(a1in_part, entry_a1in);
-
+    for (f = a1in_part.head; f != FRAME_NONE; f = a1in_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            pages[i] = entry_a1in->page_id;
-            memcpy(loc, entry_a1in->data, si->gp->page_size);
-            loc += si->gp->page_size;
+        if (a1in_arena->desc[f].modified) {
+            writes[i].page = a1in_arena->desc[f].page_id;
+            writes[i].data = FRAME_DATA(a1in_arena, f);
             i++;
         }
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            free(entry_a1in->data);
-        } else {
-            lwfree(entry_a1in->data);
-        }
-        lwfree(entry_a1in);
     }
 
-    if (count > 0) {
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write(&fs, pages, buf, count);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_write_pages(si, pages, buf, count);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-    }
-    lwfree(pages);
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        free(buf);
-    } else {
-        lwfree(buf);
-    }
+    //the frames are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    //the frames of Am and A1in are released, but the arenas are kept for the next accesses (A1out is also kept)
+    frame_arena_reset(am_arena);
+    frame_list_init(&am_part);
+    frame_arena_reset(a1in_arena);
+    frame_list_init(&a1in_part);
 
 #ifdef COLLECT_STATISTICAL_DATA
     if (_STORING == 0) {
@@ -521,3 +503,35 @@ void buffer_2q_flush_all(const SpatialIndex * si) {
     }
 #endif
 }
+
+unsigned int buffer_2q_number_of_pages() {
+    //the A1out part only stores identifiers of pages
+    return (unsigned int) (am_part.size + a1in_part.size);
+}
+
+int buffer_2q_resident_pages(int *pages, int max) {
+    int f;
+    int n = 0;
+
+    if (am_arena == NULL)
+        return 0;
+    for (f = a1in_part.head; f != FRAME_NONE && n < max; f = a1in_arena->desc[f].next)
+        pages[n++] = a1in_arena->desc[f].page_id;
+    //the most valuable pages are the last ones
+    for (f = am_part.head; f != FRAME_NONE && n < max; f = am_arena->desc[f].next)
+        pages[n++] = am_arena->desc[f].page_id;
+    return n;
+}
+
+void buffer_2q_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_2q_create_arenas(si);
+
+    //the pages are firstly loaded in A1in while it has space (the saved pages of A1in are the first ones)
+    if (frame_arena_lookup(am_arena, page) == FRAME_NONE && frame_arena_lookup(a1in_arena, page) == FRAME_NONE &&
+            a1in_part.size >= a1in_arena->nofframes) {
+        //the other pages are stored in Am since they were accessed before
+        buffer_2q_am_store(si, page, buf, false);
+        return;
+    }
+    buffer_2q_add_entry(si, page, buf, false);
+}
@@ -14,67 +14,148 @@
 
 /*this file is responsible to implement the LRU replacement cache */
 #include "buffer_handler.h"
-#include "../libraries/uthash/uthash.h"
+#include "frame_arena.h"
 #include "../main/log_messages.h"
 
 #include "../main/statistical_processing.h"
 
 #include <stringbuffer.h> /* for printing */
 
-/* undefine the defaults */
-#undef uthash_malloc
-#undef uthash_free
-
-/* re-define to use the lwalloc and lwfree from the postgis */
-#define uthash_malloc(sz) lwalloc(sz)
-#define uthash_free(ptr,sz) lwfree(ptr)
-
-#undef uthash_fatal
-#define uthash_fatal(msg) _DEBUG(ERROR, msg)
-
-typedef struct HLRU {
-    UT_hash_handle hh;
-
-    int page_id; //the key
-    uint8_t *data; //the serialized node
-    int height; //the height of this node
-    bool modified; //this node has modification to be applied?
-} HLRU;
+/* the maximum number of heights handled by the buffer (one LRU list per height) */
+#define HLRU_MAX_LEVELS 64
 
 /*
  * Some considerations about the size of the buffer:
- * 1 - it only considers the size of the node and its id (that is: page_size + sizeof(int))
- * 2 - it does not consider the overhead size introduced by the UT_hash_handle!
+ * 1 - it only considers the size of the node, its id, and its height (that is: page_size + sizeof(int) + sizeof(int))
+ * 2 - thus, the number of frames is the ceiling of max_capacity / (page_size + sizeof(int) + sizeof(int))
+ *      (a page is stored while the occupied size is lower than max_capacity)
+ * 3 - it does not consider the size of the frame descriptors and of the page table (see frame_arena.h)
+ *
+ * The frames are allocated in the first access to the buffer and kept across its flushings
+ * (they are only reallocated if the configuration of the buffer changes).
  */
 
-static HLRU *hlru = NULL;
+static FrameArena *arena = NULL;
+
+/* the frames are linked by height (head is the least recently used frame of the height), 
+ * thus the victim is the oldest head among the allowed heights */
+static FrameList levels[HLRU_MAX_LEVELS];
+static int *frame_heights = NULL; //the height of the node stored in each frame
+static uint64_t *frame_stamps = NULL; //the order of the last access of each frame, which compares different heights
+static int nofpages = 0;
+static uint64_t nonempty_levels = 0; //bitmap of the heights that have at least one frame
+static uint64_t hlru_clock = 0;
 
 static void buffer_hlru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod, int height);
 
 int tree_height = 0;
 
+/* it appends the frame as the most recently used frame of its height */
+static void hlru_level_link(int f) {
+    frame_stamps[f] = ++hlru_clock;
+    frame_list_append(arena, &levels[frame_heights[f]], f);
+    nonempty_levels |= UINT64_C(1) << frame_heights[f];
+}
+
+static void hlru_level_unlink(int f) {
+    FrameList *l = &levels[frame_heights[f]];
+
+    frame_list_remove(arena, l, f);
+    if (l->size == 0)
+        nonempty_levels &= ~(UINT64_C(1) << frame_heights[f]);
+}
+
+/* it returns the least recently used frame whose height is less than or equal to height or
+ * greater than the height of the tree (see buffer_hlru_add_entry), FRAME_NONE if there is no such frame
+ * pinned frames are not returned */
+static int hlru_victim(int height) {
+    uint64_t allowed = 0;
+    int victim = FRAME_NONE;
+    int h;
+
+    //heights less than or equal to height
+    if (height >= HLRU_MAX_LEVELS - 1)
+        allowed = ~UINT64_C(0);
+    else if (height >= 0)
+        allowed = (UINT64_C(1) << (height + 1)) - 1;
+    //heights greater than the height of the tree
+    if (tree_height < 0)
+        allowed = ~UINT64_C(0);
+    else if (tree_height < HLRU_MAX_LEVELS - 1)
+        allowed |= ~((UINT64_C(1) << (tree_height + 1)) - 1);
+
+    allowed &= nonempty_levels;
+    for (h = 0; allowed != 0; h++, allowed >>= 1) {
+        int f;
+        if ((allowed & 1) == 0)
+            continue;
+        for (f = levels[h].head; f != FRAME_NONE && arena->desc[f].pin_count > 0; f = arena->desc[f].next);
+        if (f != FRAME_NONE && (victim == FRAME_NONE || frame_stamps[f] < frame_stamps[victim]))
+            victim = f;
+    }
+    return victim;
+}
+
+/* it empties the lists of heights (the frames should be released in the arena) */
+static void hlru_reset(void) {
+    int h;
+
+    for (h = 0; h < HLRU_MAX_LEVELS; h++)
+        frame_list_init(&levels[h]);
+    nonempty_levels = 0;
+    nofpages = 0;
+}
+
+int buffer_hlru_capacity(const SpatialIndex *si) {
+    size_t frame_size = si->gp->page_size + sizeof (int) + sizeof (int);
+    return (int) ((si->bs->max_capacity + frame_size - 1) / frame_size);
+}
+
+/* it creates the arena of the buffer, if needed */
+static void buffer_hlru_create_arena(const SpatialIndex *si) {
+    int nofframes = buffer_hlru_capacity(si);
+
+    if (arena != NULL && (arena->nofframes != nofframes || arena->page_size != si->gp->page_size)) {
+        //another configuration of buffer, the previous one should have been flushed
+        if (nofpages > 0)
+            _DEBUG(ERROR, "The HLRU buffer was not flushed before changing its configuration");
+        frame_arena_destroy(arena);
+        free(frame_heights);
+        free(frame_stamps);
+        arena = NULL;
+    }
+    if (arena == NULL) {
+        frame_heights = (int*) malloc(sizeof (int) * nofframes);
+        frame_stamps = (uint64_t*) malloc(sizeof (uint64_t) * nofframes);
+        if (frame_heights == NULL || frame_stamps == NULL) {
+            _DEBUG(ERROR, "Allocation failed at buffer_hlru_create_arena");
+        }
+        arena = frame_arena_create(nofframes, si->gp->page_size);
+        hlru_reset();
+    }
+}
+
 /*function for debugging purposes
 static void buffer_hlru_print() {
-    HLRU *entry, *tmp_entry;
+    int h, f;
     stringbuffer_t *sb;
-    int c = HASH_COUNT(hlru);
 
     sb = stringbuffer_create();
 
     stringbuffer_append(sb, "Pages in the buffer: ");
 
-    HASH_ITER(hh, hlru, entry, tmp_entry) {
-        stringbuffer_aprintf(sb, "(%d, %d) ", entry->page_id, entry->height);
+    for (h = 0; h < HLRU_MAX_LEVELS; h++) {
+        for (f = levels[h].head; f != FRAME_NONE; f = arena->desc[f].next) {
+            stringbuffer_aprintf(sb, "(%d, %d) ", arena->desc[f].page_id, h);
+        }
     }
 
-    _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", c, stringbuffer_getstring(sb));
+    _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", nofpages, stringbuffer_getstring(sb));
     stringbuffer_destroy(sb);
 }*/
 
 void buffer_hlru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod, int height) {
-    HLRU *entry, *tmp_entry;
-    int current_size;
-    FileSpecification fs;
+    int f;
 
     if (si->bs->min_capacity < (si->gp->page_size + sizeof (int) + sizeof (int)) ||
             si->bs->max_capacity < (si->gp->page_size + sizeof (int) + sizeof (int))) {
@@ -82,34 +163,28 @@ void buffer_hlru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool
                 "cannot store any node (size of a node is %d)",
                 si->bs->min_capacity, si->gp->page_size);
         if (mod) {
-            fs.index_path = si->index_file;
-            fs.io_access = si->gp->io_access;
-            fs.page_size = si->gp->page_size;
-
-            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                disk_write_one_page(&fs, page, buf);
-            else if (si->gp->storage_system->type == FLASHDBSIM)
-                flashdbsim_write_one_page(si, buf, page);
-            else {
-                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-            }
+            buffer_write_one_page(si, page, buf);
         }
         return;
     }
+    if (height < 0 || height >= HLRU_MAX_LEVELS) {
+        _DEBUGF(ERROR, "The HLRU buffer does not support nodes with height %d", height);
+    }
 
     //_DEBUGF(NOTICE, "Putting %d with height %d", page, height);
 
-    HASH_FIND_INT(hlru, &page, entry);
+    buffer_hlru_create_arena(si);
+
+    f = frame_arena_lookup(arena, page);
     //we have to update this value
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(hlru, entry);
-        HASH_ADD_INT(hlru, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame of its height
+        hlru_level_unlink(f);
+        hlru_level_link(f);
         if (mod) {
-            entry->modified = mod;
+            arena->desc[f].modified = mod;
             //it is stored in our buffer
-            memcpy(entry->data, buf, (size_t) si->gp->page_size);
+            memcpy(FRAME_DATA(arena, f), buf, (size_t) si->gp->page_size);
         }
 #ifdef COLLECT_STATISTICAL_DATA
         _sbuffer_page_hit++;
@@ -118,119 +193,56 @@ void buffer_hlru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool
 #ifdef COLLECT_STATISTICAL_DATA
         _sbuffer_page_fault++;
 #endif
-        //check if we have enough space
-        current_size = HASH_COUNT(hlru) * (si->gp->page_size + sizeof (int) + sizeof (int));
-        // prune the cache to MAX_CACHE_SIZE
-        if (current_size >= si->bs->max_capacity) {
-            bool removed = false;
-
-            HASH_ITER(hh, hlru, entry, tmp_entry) {
-                /*
-                 * HLRU distinguishes itself from the traditional LRU in this if statement
-                 * it will only replace with a node with a height less than or equal to the requested node
-                 * it may replace the node that exceeds the height of the tree! 
-                 * (it avoids that a old root node be stored in the buffer)
-                 * */
-                if (entry->height <= height || entry->height > tree_height) {
+        //check if we have a free frame
+        if (nofpages >= arena->nofframes) {
+            /*
+             * HLRU distinguishes itself from the traditional LRU in the choice of the victim
+             * it will only replace with a node with a height less than or equal to the requested node
+             * it may replace the node that exceeds the height of the tree! 
+             * (it avoids that a old root node be stored in the buffer)
+             * */
+            int victim = hlru_victim(height);
+            if (victim != FRAME_NONE) {
 #ifdef COLLECT_STATISTICAL_DATA
-                    struct timespec cpustart;
-                    struct timespec cpuend;
-                    struct timespec start;
-                    struct timespec end;
+                struct timespec cpustart;
+                struct timespec cpuend;
+                struct timespec start;
+                struct timespec end;
 
-                    cpustart = get_CPU_time();
-                    start = get_current_time();
+                cpustart = get_CPU_time();
+                start = get_current_time();
 #endif
-                    //therefore, we remove this entry and add the new entry because it has height greater than this removed element
-                    // prune the first entry (loop is based on insertion order so this deletes the oldest item)
-                    HASH_DEL(hlru, entry);
-
-                    /* we have to write this page on the disk/flash memory only if this node has modifications*/
-                    if (entry->modified) {
-                        fs.index_path = si->index_file;
-                        fs.io_access = si->gp->io_access;
-                        fs.page_size = si->gp->page_size;
-
-                        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                            disk_write_one_page(&fs, entry->page_id, entry->data);
-                        else if (si->gp->storage_system->type == FLASHDBSIM)
-                            flashdbsim_write_one_page(si, entry->data, entry->page_id);
-                        else
-                            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                    }
-
-                    if (si->gp->io_access == DIRECT_ACCESS) {
-                        free(entry->data);
-                    } else {
-                        lwfree(entry->data);
-                    }
-                    lwfree(entry);
-
-                    removed = true;
+                /* we have to write this page on the disk/flash memory only if this node has modifications*/
+                if (arena->desc[victim].modified) {
+                    buffer_write_one_page(si, arena->desc[victim].page_id, FRAME_DATA(arena, victim));
+                }
+                //therefore, we remove this frame and add the new page because it has height greater than the victim
+                hlru_level_unlink(victim);
+                frame_arena_release(arena, victim);
+                nofpages--;
 
 #ifdef COLLECT_STATISTICAL_DATA
-                    cpuend = get_CPU_time();
-                    end = get_current_time();
+                cpuend = get_CPU_time();
+                end = get_current_time();
 
-                    _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
-                    _sbuffer_flushing_time += get_elapsed_time(start, end);
+                _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+                _sbuffer_flushing_time += get_elapsed_time(start, end);
 #endif
-                    break;
-                }
-            }
-
-            if (removed) {
-                entry = (HLRU*) lwalloc(sizeof (HLRU));
-                entry->page_id = page;
-
-                if (si->gp->io_access == DIRECT_ACCESS) {
-                    //then the memory must be aligned in blocks!
-                    if (posix_memalign((void**) &(entry->data), si->gp->page_size, si->gp->page_size)) {
-                        _DEBUG(ERROR, "Allocation failed at buffer_hlru_add_entry");
-                    }
-                } else {
-                    entry->data = (uint8_t*) lwalloc(si->gp->page_size);
-                }
-                memcpy(entry->data, buf, si->gp->page_size);
-
-                entry->modified = mod;
-                entry->height = height;
-                HASH_ADD_INT(hlru, page_id, entry);
             } else {
                 /* we have to check if we need to write this node because we will not store it in the buffer*/
                 if (mod) {
-                    fs.index_path = si->index_file;
-                    fs.io_access = si->gp->io_access;
-                    fs.page_size = si->gp->page_size;
-
-                    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                        disk_write_one_page(&fs, page, buf);
-                    else if (si->gp->storage_system->type == FLASHDBSIM)
-                        flashdbsim_write_one_page(si, buf, page);
-                    else
-                        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                }
-            }
-
-        } else {
-            //there is space in our buffer
-            entry = (HLRU*) lwalloc(sizeof (HLRU));
-            entry->page_id = page;
-
-            if (si->gp->io_access == DIRECT_ACCESS) {
-                //then the memory must be aligned in blocks!
-                if (posix_memalign((void**) &(entry->data), si->gp->page_size, si->gp->page_size)) {
-                    _DEBUG(ERROR, "Allocation failed at buffer_hlru_add_entry");
+                    buffer_write_one_page(si, page, buf);
                 }
-            } else {
-                entry->data = (uint8_t*) lwalloc(si->gp->page_size);
+                return;
             }
-            memcpy(entry->data, buf, si->gp->page_size);
-
-            entry->modified = mod;
-            entry->height = height;
-            HASH_ADD_INT(hlru, page_id, entry);
         }
+
+        f = frame_arena_alloc(arena, page);
+        memcpy(FRAME_DATA(arena, f), buf, si->gp->page_size);
+        arena->desc[f].modified = mod;
+        frame_heights[f] = height;
+        hlru_level_link(f);
+        nofpages++;
     }
 
    // buffer_hlru_print();
@@ -238,26 +250,22 @@ void buffer_hlru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool
 }
 
 void buffer_hlru_find(const SpatialIndex *si, int page, uint8_t *buf, int height) {
-    HLRU *entry;
-    HASH_FIND_INT(hlru, &page, entry);
+    int f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
 
     //_DEBUGF(NOTICE, "searching for %d with height %d", page, height);
 
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(hlru, entry);
-        HASH_ADD_INT(hlru, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame of its height
+        hlru_level_unlink(f);
+        hlru_level_link(f);
         //it is stored in our buffer
-        memcpy(buf, entry->data, (size_t) si->gp->page_size);
-        //entry->height = height;
+        memcpy(buf, FRAME_DATA(arena, f), (size_t) si->gp->page_size);
 #ifdef COLLECT_STATISTICAL_DATA
         _sbuffer_page_hit++;
 #endif
     } else {
         //this entry does not exist in our LRU buffer
         //then we have to get this node from the disk/flash
-        FileSpecification fs;
 #ifdef COLLECT_STATISTICAL_DATA
         struct timespec cpustart;
         struct timespec cpuend;
@@ -269,16 +277,7 @@ void buffer_hlru_find(const SpatialIndex *si, int page, uint8_t *buf, int height
 #endif 
         /* we have to read this page from the disk/flash memory*/
 
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_read_one_page(&fs, page, buf);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_read_one_page(si, page, buf);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_read_one_page(si, page, buf);
 
         //now we add this page into the buffer
         buffer_hlru_add_entry(si, page, buf, false, height);
@@ -295,6 +294,32 @@ void buffer_hlru_find(const SpatialIndex *si, int page, uint8_t *buf, int height
    // buffer_hlru_print();
 }
 
+uint8_t *buffer_hlru_pin(const SpatialIndex *si, int page, int height) {
+    int f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
+
+    if (f == FRAME_NONE)
+        return NULL;
+
+    hlru_level_unlink(f);
+    hlru_level_link(f);
+    arena->desc[f].pin_count++;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _sbuffer_page_hit++;
+#endif
+    return FRAME_DATA(arena, f);
+}
+
+void buffer_hlru_unpin(int page) {
+    int f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
+
+    if (f == FRAME_NONE || arena->desc[f].pin_count <= 0) {
+        _DEBUGF(ERROR, "The page %d is not pinned in the HLRU buffer", page);
+        return;
+    }
+    arena->desc[f].pin_count--;
+}
+
 void buffer_hlru_add(const SpatialIndex *si, int page, uint8_t *buf, int height) {
     buffer_hlru_add_entry(si, page, buf, true, height);
 }
@@ -304,12 +329,10 @@ void buffer_hlru_update_tree_height(int new_height) {
 }
 
 void buffer_hlru_flush_all(const SpatialIndex * si) {
-    HLRU *entry, *tmp_entry;
-    FileSpecification fs;
-    int *pages;
+    BufferWrite *writes;
     int count = 0;
     int i = 0;
-    uint8_t *loc, *buf;
+    int h, f;
 
 #ifdef COLLECT_STATISTICAL_DATA
     struct timespec cpustart;
@@ -321,64 +344,38 @@ void buffer_hlru_flush_all(const SpatialIndex * si) {
     start = get_current_time();
 #endif
 
-    HASH_ITER(hh, hlru, entry, tmp_entry) {
-        /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            count++;
-        }
-    }
+    if (arena == NULL)
+        return;
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, count * si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at buffer_hlru_add_entry");
+    for (h = 0; h < HLRU_MAX_LEVELS; h++) {
+        for (f = levels[h].head; f != FRAME_NONE; f = arena->desc[f].next) {
+            /* we have to write this page on the disk/flash memory only if this node has modifications*/
+            if (arena->desc[f].modified) {
+                count++;
+            }
         }
-    } else {
-        buf = (uint8_t*) lwalloc(count * si->gp->page_size);
     }
-    pages = (int*) lwalloc(sizeof (int) * count);
-
-    loc = buf;
 
-    HASH_ITER(hh, hlru, entry, tmp_entry) {
-        // delete this entry
-        HASH_DEL(hlru, entry);
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
 
-        /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            pages[i] = entry->page_id;
-            memcpy(loc, entry->data, si->gp->page_size);
-            loc += si->gp->page_size;
-            i++;
-        }
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            free(entry->data);
-        } else {
-            lwfree(entry->data);
+    for (h = 0; h < HLRU_MAX_LEVELS; h++) {
+        for (f = levels[h].head; f != FRAME_NONE; f = arena->desc[f].next) {
+            /* we have to write this page on the disk/flash memory only if this node has modifications*/
+            if (arena->desc[f].modified) {
+                writes[i].page = arena->desc[f].page_id;
+                writes[i].data = FRAME_DATA(arena, f);
+                i++;
+            }
         }
-        lwfree(entry);
     }
 
-    if (count > 0) {
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write(&fs, pages, buf, count);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_write_pages(si, pages, buf, count);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-    }
-    lwfree(pages);
+    //the frames are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        free(buf);
-    } else {
-        lwfree(buf);
-    }
+    //the frames are released, but the arena is kept for the next accesses
+    frame_arena_reset(arena);
+    hlru_reset();
 
 #ifdef COLLECT_STATISTICAL_DATA
     cpuend = get_CPU_time();
@@ -388,3 +385,45 @@ void buffer_hlru_flush_all(const SpatialIndex * si) {
     _sbuffer_flushing_time += get_elapsed_time(start, end);
 #endif
 }
+
+unsigned int buffer_hlru_number_of_pages() {
+    return (unsigned int) nofpages;
+}
+
+/* it compares frames by the order of their last accesses */
+static int hlru_stamp_cmp(const void *a, const void *b) {
+    uint64_t sa = frame_stamps[*(const int*) a];
+    uint64_t sb = frame_stamps[*(const int*) b];
+
+    return (sa > sb) - (sa < sb);
+}
+
+int buffer_hlru_resident_pages(int *pages, int *heights, int max) {
+    int *frames;
+    int h, f;
+    int n = 0, i;
+
+    if (arena == NULL || nofpages == 0)
+        return 0;
+
+    //the pages are returned in the order of the accesses
+    frames = (int*) lwalloc(sizeof (int) * nofpages);
+    for (h = 0; h < HLRU_MAX_LEVELS; h++) {
+        for (f = levels[h].head; f != FRAME_NONE; f = arena->desc[f].next)
+            frames[n++] = f;
+    }
+    qsort(frames, n, sizeof (int), hlru_stamp_cmp);
+
+    if (n > max)
+        n = max;
+    for (i = 0; i < n; i++) {
+        pages[i] = arena->desc[frames[i]].page_id;
+        heights[i] = frame_heights[frames[i]];
+    }
+    lwfree(frames);
+    return n;
+}
+
+void buffer_hlru_load(const SpatialIndex *si, int page, uint8_t *buf, int height) {
+    buffer_hlru_add_entry(si, page, buf, false, height);
+}
@@ -14,64 +14,175 @@
 
 /*this file is responsible to implement the LRU replacement cache */
 #include "buffer_handler.h"
-#include "../libraries/uthash/uthash.h"
+#include "frame_arena.h"
 #include "../main/log_messages.h"
 
 #include "../main/statistical_processing.h"
 
 #include <stringbuffer.h> /* for printing */
 
-/* undefine the defaults */
-#undef uthash_malloc
-#undef uthash_free
-
-/* re-define to use the lwalloc and lwfree from the postgis */
-#define uthash_malloc(sz) lwalloc(sz)
-#define uthash_free(ptr,sz) lwfree(ptr)
-
-#undef uthash_fatal
-#define uthash_fatal(msg) _DEBUG(ERROR, msg)
-
-typedef struct LRU {
-    UT_hash_handle hh;
-
-    int page_id; //the key
-    uint8_t *data; //the serialized node
-    bool modified; //this node has modification to be applied?
-} LRU;
-
 /*
  * Some considerations about the size of the buffer:
  * 1 - it only considers the size of the node and its id (that is: page_size + sizeof(int))
- * 2 - it does not consider the overhead size introduced by the UT_hash_handle!
+ * 2 - thus, the number of frames is the ceiling of max_capacity / (page_size + sizeof(int))
+ *      (a page is stored while the occupied size is lower than max_capacity)
+ * 3 - it does not consider the size of the frame descriptors and of the page table (see frame_arena.h)
+ *
+ * The frames are allocated in the first access to the buffer and kept across its flushings
+ * (they are only reallocated if the configuration of the buffer changes).
+ *
+ * If the background writer is enabled (see buffer_bgwriter_set), modified frames are written by a thread ahead of
+ * their eviction. A frame being written is neither modified nor evicted until its write is collected.
  */
 
-static LRU *lru = NULL;
+/* when a modified page is evicted, the other modified pages among the LRU_WRITEBACK_WINDOW least recently used
+ * pages are also written back (in a single sorted write), thus the next evictions are likely to find clean pages */
+#define LRU_WRITEBACK_WINDOW    32
+
+static FrameArena *arena = NULL;
+static uint8_t *writeback = NULL; //the staging area of the write-back of LRU_WRITEBACK_WINDOW pages (see buffer_lru_evict)
+static FrameList lru = {FRAME_NONE, FRAME_NONE, 0}; //head is the least recently used frame
+static int dirty = 0; //number of modified frames (including the frames being written by the background writer)
+static bool bgwriter_started = false; //the start of the background writer was tried since the last flushing
 
 static void buffer_lru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod);
 
 /*function for debugging purposes
 static void buffer_lru_print() {
-    LRU *entry, *tmp_entry;
+    int f;
     stringbuffer_t *sb;
-    int c = HASH_COUNT(lru);
 
     sb = stringbuffer_create();
 
     stringbuffer_append(sb, "Pages in the buffer: ");
 
-    HASH_ITER(hh, lru, entry, tmp_entry) {
-        stringbuffer_aprintf(sb, "%d ", entry->page_id);
+    for (f = lru.head; f != FRAME_NONE; f = arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", arena->desc[f].page_id);
     }
 
-    _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", c, stringbuffer_getstring(sb));
+    _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", lru.size, stringbuffer_getstring(sb));
     stringbuffer_destroy(sb);
 }*/
 
+int buffer_lru_capacity(const SpatialIndex *si) {
+    size_t frame_size = si->gp->page_size + sizeof (int);
+    return (int) ((si->bs->max_capacity + frame_size - 1) / frame_size);
+}
+
+/* it creates the arena of the buffer, if needed */
+static void buffer_lru_create_arena(const SpatialIndex *si) {
+    int nofframes = buffer_lru_capacity(si);
+
+    if (arena != NULL && (arena->nofframes != nofframes || arena->page_size != si->gp->page_size)) {
+        //another configuration of buffer, the previous one should have been flushed
+        if (lru.size > 0)
+            _DEBUG(ERROR, "The LRU buffer was not flushed before changing its configuration");
+        buffer_bgwriter_stop();
+        frame_arena_destroy(arena);
+        free(writeback);
+        arena = NULL;
+    }
+    if (arena == NULL) {
+        //the staging area is aligned to the page size as the frames (and thus, usable by the direct access)
+        if (posix_memalign((void**) &writeback, si->gp->page_size, (size_t) LRU_WRITEBACK_WINDOW * si->gp->page_size)) {
+            _DEBUG(ERROR, "Allocation failed at buffer_lru_create_arena");
+        }
+        arena = frame_arena_create(nofframes, si->gp->page_size);
+        frame_list_init(&lru);
+        dirty = 0;
+        bgwriter_started = false;
+    }
+    //the background writer is stopped by the flushing, it is started again for the index being accessed
+    if (!bgwriter_started) {
+        buffer_bgwriter_start(si, arena);
+        bgwriter_started = true;
+    }
+}
+
+/* it marks as clean the frames written by the background writer */
+static void buffer_lru_collect(void) {
+    if (buffer_bgwriter_running())
+        dirty -= buffer_bgwriter_collect();
+}
+
+/* it submits the least recently used modified frames to the background writer
+ * until the number of modified frames that are not being written respects the percentage of clean frames */
+static void buffer_lru_trickle(void) {
+    int threshold;
+    int f;
+
+    if (!buffer_bgwriter_running())
+        return;
+
+    threshold = (int) (arena->nofframes * (1.0 - buffer_bgwriter_get() / 100.0));
+    for (f = lru.head; f != FRAME_NONE && dirty - buffer_bgwriter_in_flight() > threshold;
+            f = arena->desc[f].next) {
+        if (arena->desc[f].modified && !arena->desc[f].writing) {
+            if (!buffer_bgwriter_submit(f))
+                break;
+        }
+    }
+}
+
+/* it evicts the least recently used frame that is not pinned (or being written), 
+ * it returns false if all the frames are pinned */
+static bool buffer_lru_evict(const SpatialIndex *si) {
+    int f;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    //pinned frames and frames being written are skipped
+    for (f = lru.head; f != FRAME_NONE && (arena->desc[f].pin_count > 0 || arena->desc[f].writing);
+            f = arena->desc[f].next);
+    if (f == FRAME_NONE && buffer_bgwriter_in_flight() > 0) {
+        //we wait for the background writer and try again
+        dirty -= buffer_bgwriter_wait(FRAME_NONE);
+        for (f = lru.head; f != FRAME_NONE && arena->desc[f].pin_count > 0; f = arena->desc[f].next);
+    }
+    if (f == FRAME_NONE)
+        return false;
+
+    /* we have to write this page on the disk/flash memory only if this node has modifications*/
+    if (arena->desc[f].modified) {
+        BufferWrite writes[LRU_WRITEBACK_WINDOW];
+        int count = 0;
+        int i, w;
+
+        for (w = f, i = 0; w != FRAME_NONE && i < LRU_WRITEBACK_WINDOW; w = arena->desc[w].next, i++) {
+            if (arena->desc[w].modified && arena->desc[w].pin_count == 0 && !arena->desc[w].writing) {
+                writes[count].page = arena->desc[w].page_id;
+                writes[count].data = FRAME_DATA(arena, w);
+                arena->desc[w].modified = false;
+                dirty--;
+                count++;
+            }
+        }
+        buffer_write_sorted_pages(si, writes, count, writeback);
+    }
+    frame_list_remove(arena, &lru, f);
+    frame_arena_release(arena, f);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+    return true;
+}
+
 void buffer_lru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
-    LRU *entry, *tmp_entry;
-    int current_size;
-    FileSpecification fs;
+    int f;
 
     if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
             si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
@@ -79,35 +190,32 @@ void buffer_lru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
                 "cannot store any node (size of a node is %d)",
                 si->bs->min_capacity, si->gp->page_size);
         if (mod) {
-            fs.index_path = si->index_file;
-            fs.io_access = si->gp->io_access;
-            fs.page_size = si->gp->page_size;
-
-            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                disk_write_one_page(&fs, page, buf);
-            else if (si->gp->storage_system->type == FLASHDBSIM)
-                flashdbsim_write_one_page(si, buf, page);
-            else {
-                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-            }
+            buffer_write_one_page(si, page, buf);
         }
         return;
     }
 
     //_DEBUGF(NOTICE, "Putting %d", page);
 
-    HASH_FIND_INT(lru, &page, entry);
+    buffer_lru_create_arena(si);
+    buffer_lru_collect();
+
+    f = frame_arena_lookup(arena, page);
     //we have to update this value
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(lru, entry);
-        HASH_ADD_INT(lru, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(arena, &lru, f);
+        frame_list_append(arena, &lru, f);
 
         if (mod) {
-            entry->modified = mod;
+            //the frame cannot be modified while it is being written
+            if (arena->desc[f].writing)
+                dirty -= buffer_bgwriter_wait(f);
+            if (!arena->desc[f].modified)
+                dirty++;
+            arena->desc[f].modified = mod;
             //it is stored in our buffer
-            memcpy(entry->data, buf, (size_t) si->gp->page_size);
+            memcpy(FRAME_DATA(arena, f), buf, (size_t) si->gp->page_size);
         }
 
 #ifdef COLLECT_STATISTICAL_DATA
@@ -120,92 +228,44 @@ void buffer_lru_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
             _sbuffer_page_fault++;
 #endif
 
-        //check if we have enough space
-        current_size = HASH_COUNT(lru) * (si->gp->page_size + sizeof (int));
-        // prune the cache to MAX_CACHE_SIZE
-        if (current_size >= si->bs->max_capacity) {
-#ifdef COLLECT_STATISTICAL_DATA
-            struct timespec cpustart;
-            struct timespec cpuend;
-            struct timespec start;
-            struct timespec end;
-
-            cpustart = get_CPU_time();
-            start = get_current_time();
-#endif
-
-            HASH_ITER(hh, lru, entry, tmp_entry) {
-                // prune the first entry (loop is based on insertion order so this deletes the oldest item)
-                HASH_DEL(lru, entry);
-
-                /* we have to write this page on the disk/flash memory only if this node has modifications*/
-                if (entry->modified) {
-                    fs.index_path = si->index_file;
-                    fs.io_access = si->gp->io_access;
-                    fs.page_size = si->gp->page_size;
-
-                    if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                        disk_write_one_page(&fs, entry->page_id, entry->data);
-                    else if (si->gp->storage_system->type == FLASHDBSIM)
-                        flashdbsim_write_one_page(si, entry->data, entry->page_id);
-                    else
-                        _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                }
-
-                if (si->gp->io_access == DIRECT_ACCESS) {
-                    free(entry->data);
-                } else {
-                    lwfree(entry->data);
-                }
-                lwfree(entry);
-
-                break;
-            }
-#ifdef COLLECT_STATISTICAL_DATA
-            if (_STORING == 0) {
-                cpuend = get_CPU_time();
-                end = get_current_time();
-
-                _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
-                _sbuffer_flushing_time += get_elapsed_time(start, end);
-            }
-#endif
-        }
-
-        entry = (LRU*) lwalloc(sizeof (LRU));
-        entry->page_id = page;
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            //then the memory must be aligned in blocks!
-            if (posix_memalign((void**) &(entry->data), si->gp->page_size, si->gp->page_size)) {
-                _DEBUG(ERROR, "Allocation failed at buffer_hlru_add_entry");
+        //check if we have a free frame
+        if (lru.size >= arena->nofframes && !buffer_lru_evict(si)) {
+            //all the frames are pinned, then this page is not stored in the buffer
+            if (mod) {
+                buffer_write_one_page(si, page, buf);
             }
-        } else {
-            entry->data = (uint8_t*) lwalloc(si->gp->page_size);
+            return;
         }
-        memcpy(entry->data, buf, si->gp->page_size);
 
-        entry->modified = mod;
-        HASH_ADD_INT(lru, page_id, entry);
+        f = frame_arena_alloc(arena, page);
+        memcpy(FRAME_DATA(arena, f), buf, si->gp->page_size);
+        arena->desc[f].modified = mod;
+        if (mod)
+            dirty++;
+        frame_list_append(arena, &lru, f);
     }
 
+    if (mod)
+        buffer_lru_trickle();
+
     //buffer_lru_print();
 
 }
 
 void buffer_lru_find(const SpatialIndex *si, int page, uint8_t *buf) {
-    LRU *entry;
-    HASH_FIND_INT(lru, &page, entry);
+    int f;
+
+    buffer_lru_collect();
+    f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
 
     //_DEBUGF(NOTICE, "Searching for %d", page);
 
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(lru, entry);
-        HASH_ADD_INT(lru, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(arena, &lru, f);
+        frame_list_append(arena, &lru, f);
         //it is stored in our buffer
-        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+        memcpy(buf, FRAME_DATA(arena, f), (size_t) si->gp->page_size);
 
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
@@ -214,7 +274,6 @@ void buffer_lru_find(const SpatialIndex *si, int page, uint8_t *buf) {
     } else {
         //this entry does not exist in our LRU buffer
         //then we have to get this node from the disk/flash
-        FileSpecification fs;
 #ifdef COLLECT_STATISTICAL_DATA
         struct timespec cpustart;
         struct timespec cpuend;
@@ -228,16 +287,7 @@ void buffer_lru_find(const SpatialIndex *si, int page, uint8_t *buf) {
 
         /* we have to read this page from the disk/flash memory*/
 
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_read_one_page(&fs, page, buf);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_read_one_page(si, page, buf);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_read_one_page(si, page, buf);
 
         //now we add this page into the buffer
         buffer_lru_add_entry(si, page, buf, false);
@@ -256,17 +306,45 @@ void buffer_lru_find(const SpatialIndex *si, int page, uint8_t *buf) {
     //buffer_lru_print();
 }
 
+uint8_t *buffer_lru_pin(const SpatialIndex *si, int page) {
+    int f;
+
+    buffer_lru_collect();
+    f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
+
+    if (f == FRAME_NONE)
+        return NULL;
+
+    frame_list_remove(arena, &lru, f);
+    frame_list_append(arena, &lru, f);
+    arena->desc[f].pin_count++;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_page_hit++;
+#endif
+    return FRAME_DATA(arena, f);
+}
+
+void buffer_lru_unpin(int page) {
+    int f = (arena != NULL) ? frame_arena_lookup(arena, page) : FRAME_NONE;
+
+    if (f == FRAME_NONE || arena->desc[f].pin_count <= 0) {
+        _DEBUGF(ERROR, "The page %d is not pinned in the LRU buffer", page);
+        return;
+    }
+    arena->desc[f].pin_count--;
+}
+
 void buffer_lru_add(const SpatialIndex *si, int page, uint8_t *buf) {
     buffer_lru_add_entry(si, page, buf, true);
 }
 
 void buffer_lru_flush_all(const SpatialIndex *si) {
-    LRU *entry, *tmp_entry;
-    FileSpecification fs;
-    int *pages;
+    int f;
+    BufferWrite *writes;
     int count = 0;
     int i = 0;
-    uint8_t *loc, *buf;
 #ifdef COLLECT_STATISTICAL_DATA
     struct timespec cpustart;
     struct timespec cpuend;
@@ -277,63 +355,39 @@ void buffer_lru_flush_all(const SpatialIndex *si) {
     start = get_current_time();
 #endif
 
-    HASH_ITER(hh, lru, entry, tmp_entry) {
+    if (arena == NULL)
+        return;
+
+    //the frames being written are collected before the flushing
+    buffer_bgwriter_stop();
+
+    for (f = lru.head; f != FRAME_NONE; f = arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
+        if (arena->desc[f].modified) {
             count++;
         }
     }
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, count * si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at buffer_hlru_add_entry");
-        }
-    } else {
-        buf = (uint8_t*) lwalloc(count * si->gp->page_size);
-    }
-    pages = (int*) lwalloc(sizeof (int) * count);
-
-    loc = buf;
-
-    HASH_ITER(hh, lru, entry, tmp_entry) {
-        // delete this entry
-        HASH_DEL(lru, entry);
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
 
+    for (f = lru.head; f != FRAME_NONE; f = arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            pages[i] = entry->page_id;
-            memcpy(loc, entry->data, si->gp->page_size);
-            loc += si->gp->page_size;
+        if (arena->desc[f].modified) {
+            writes[i].page = arena->desc[f].page_id;
+            writes[i].data = FRAME_DATA(arena, f);
             i++;
         }
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            free(entry->data);
-        } else {
-            lwfree(entry->data);
-        }
-        lwfree(entry);
     }
 
-    if (count > 0) {
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write(&fs, pages, buf, count);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_write_pages(si, pages, buf, count);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-    }
-    lwfree(pages);
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        free(buf);
-    } else {
-        lwfree(buf);
-    }
+    //the frames are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    //the frames are released, but the arena is kept for the next accesses
+    frame_arena_reset(arena);
+    frame_list_init(&lru);
+    dirty = 0;
+    bgwriter_started = false;
 
 #ifdef COLLECT_STATISTICAL_DATA
     if (_STORING == 0) {
@@ -345,3 +399,22 @@ void buffer_lru_flush_all(const SpatialIndex *si) {
     }
 #endif
 }
+
+unsigned int buffer_lru_number_of_pages() {
+    return (unsigned int) lru.size;
+}
+
+int buffer_lru_resident_pages(int *pages, int max) {
+    int f;
+    int n = 0;
+
+    if (arena == NULL)
+        return 0;
+    for (f = lru.head; f != FRAME_NONE && n < max; f = arena->desc[f].next)
+        pages[n++] = arena->desc[f].page_id;
+    return n;
+}
+
+void buffer_lru_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_lru_add_entry(si, page, buf, false);
+}
@@ -28,78 +28,117 @@
  */
 
 #include "buffer_handler.h"
-#include "../libraries/uthash/uthash.h" //for hashing structures
+#include "frame_arena.h"
 #include "../main/log_messages.h" //for messages
 
 #include "../main/statistical_processing.h" //for collection of statistical data
 
 #include <stringbuffer.h> /* for printing */
 
-/* undefine the defaults */
-#undef uthash_malloc
-#undef uthash_free
-
-/* re-define to use the lwalloc and lwfree from the postgis */
-#define uthash_malloc(sz) lwalloc(sz)
-#define uthash_free(ptr,sz) lwfree(ptr)
-
-
-//this corresponds to the Am part of the S2Q, which is managed as a LRU cache
-
-typedef struct {
-    UT_hash_handle hh;
-
-    int page_id; //the key
-    uint8_t *data; //the serialized node
-    bool modified; //this node has modification to be applied?
-} Am; //it stores the most frequent accessed pages
-
-//this corresponds to the A1 part of the S2Q, which is managed as a FIFO
-
-typedef struct {
-    UT_hash_handle hh;
+/*
+ * Some considerations about the size of the buffer:
+ * 1 - Am only considers the size of the node and its id (that is: page_size + sizeof(int)),
+ *      thus, its number of frames is the ceiling of Am_size / (page_size + sizeof(int))
+ * 2 - A1 only stores identifiers of pages, thus it stores A1_size identifiers
+ * 3 - it does not consider the size of the frame descriptors and of the page tables (see frame_arena.h)
+ *
+ * The arenas are allocated in the first access to the buffer and kept across its flushings
+ * (they are only reallocated if the configuration of the buffer changes).
+ */
 
-    int page_id; //the key    
-} A1; //it stores the most recent accessed pages
+//this corresponds to the Am part of the S2Q, which is managed as a LRU cache (head is the least recently used frame)
+static FrameArena *am_arena = NULL; //it stores the most frequent accessed pages
+static FrameList am_part = {FRAME_NONE, FRAME_NONE, 0};
 
-static Am *am_part = NULL;
-static A1 *a1_part = NULL;
+//this corresponds to the A1 part of the S2Q, which is managed as a FIFO (head is the oldest identifier)
+static FrameArena *a1_arena = NULL; //it stores the most recent accessed pages (an arena without frames)
+static FrameList a1_part = {FRAME_NONE, FRAME_NONE, 0};
 
 /*function for debugging purposes
 static void buffer_s2q_print() {
-    Am *entry_am, *tmp_entry_am;
-    A1 *entry_a1, *tmp_entry_a1;
+    int f;
     stringbuffer_t *sb;
-    int c = HASH_COUNT(am_part) + HASH_COUNT(a1_part);
+    int c = am_part.size + a1_part.size;
 
     sb = stringbuffer_create();
 
     stringbuffer_append(sb, "Pages in Am: ");
 
-    HASH_ITER(hh, am_part, entry_am, tmp_entry_am) {
-        stringbuffer_aprintf(sb, "%d ", entry_am->page_id);
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", am_arena->desc[f].page_id);
     }
 
     stringbuffer_append(sb, ". Pages in A1: ");
 
-    HASH_ITER(hh, a1_part, entry_a1, tmp_entry_a1) {
-        stringbuffer_aprintf(sb, "%d ", entry_a1->page_id);
+    for (f = a1_part.head; f != FRAME_NONE; f = a1_arena->desc[f].next) {
+        stringbuffer_aprintf(sb, "%d ", a1_arena->desc[f].page_id);
     }
 
     _DEBUGF(NOTICE, "TOTAL OF ELEMENTS: %d. %s", c, stringbuffer_getstring(sb));
     stringbuffer_destroy(sb);
-    
-    if(HASH_COUNT(a1_part) == 0 && HASH_COUNT(am_part) == 5)
-        _DEBUG(ERROR, "CHECAR");
 }*/
 
 static void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod);
 
+/* only Am stores pages, A1 stores identifiers of pages */
+int buffer_s2q_capacity(const SpatialIndex *si) {
+    BufferS2QSpecification *spec = (BufferS2QSpecification*) si->bs->buf_additional_param;
+    //Am stores a page while its occupied size is lower than Am_size
+    size_t frame_size = si->gp->page_size + sizeof (int);
+    int nofframes = (int) ((spec->Am_size + frame_size - 1) / frame_size);
+
+    //each part stores at least one page
+    return (nofframes < 1) ? 1 : nofframes;
+}
+
+/* it creates the arenas of Am and A1, if needed */
+static void buffer_s2q_create_arenas(const SpatialIndex *si) {
+    BufferS2QSpecification *spec = (BufferS2QSpecification*) si->bs->buf_additional_param;
+    int nofframes = buffer_s2q_capacity(si);
+    int nofids = (int) spec->A1_size;
+
+    if (nofids < 1)
+        nofids = 1;
+
+    if (am_arena != NULL && (am_arena->nofframes != nofframes || am_arena->page_size != si->gp->page_size)) {
+        //another configuration of buffer, the previous one should have been flushed
+        if (am_part.size > 0)
+            _DEBUG(ERROR, "The S2Q buffer was not flushed before changing its configuration");
+        frame_arena_destroy(am_arena);
+        am_arena = NULL;
+    }
+    if (am_arena == NULL) {
+        am_arena = frame_arena_create(nofframes, si->gp->page_size);
+        frame_list_init(&am_part);
+    }
+
+    if (a1_arena != NULL && a1_arena->nofframes != nofids) {
+        //the identifiers of A1 are only a history of accesses, thus they are discarded
+        frame_arena_destroy(a1_arena);
+        a1_arena = NULL;
+    }
+    if (a1_arena == NULL) {
+        a1_arena = frame_arena_create(nofids, 0);
+        frame_list_init(&a1_part);
+    }
+}
+
+/* it appends the page in A1, removing the oldest identifier if A1 is full */
+static void buffer_s2q_a1_push(int page) {
+    int g;
+
+    if (a1_part.size >= a1_arena->nofframes) {
+        //in negative case, we remove an entry from A1, respecting the FIFO
+        g = a1_part.head;
+        frame_list_remove(a1_arena, &a1_part, g);
+        frame_arena_release(a1_arena, g);
+    }
+    g = frame_arena_alloc(a1_arena, page);
+    frame_list_append(a1_arena, &a1_part, g);
+}
+
 void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool mod) {
-    Am *entry_am, *tmp_entry_am;
-    A1 *entry_a1, *tmp_entry_a1;
-    int current_size;
-    FileSpecification fs;
+    int f, g;
 
     if (si->bs->min_capacity < (si->gp->page_size + sizeof (int)) ||
             si->bs->max_capacity < (si->gp->page_size + sizeof (int))) {
@@ -107,34 +146,25 @@ void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
                 "cannot store any node (size of a node is %d)",
                 si->bs->min_capacity, si->gp->page_size);
         if (mod) {
-            fs.index_path = si->index_file;
-            fs.io_access = si->gp->io_access;
-            fs.page_size = si->gp->page_size;
-
-            if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                disk_write_one_page(&fs, page, buf);
-            else if (si->gp->storage_system->type == FLASHDBSIM)
-                flashdbsim_write_one_page(si, buf, page);
-            else {
-                _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-            }
+            buffer_write_one_page(si, page, buf);
         }
         return;
     }
 
    // _DEBUGF(NOTICE, "Putting %d", page);
 
-    HASH_FIND_INT(am_part, &page, entry_am);
+    buffer_s2q_create_arenas(si);
 
-    if (entry_am != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(am_part, entry_am);
-        HASH_ADD_INT(am_part, page_id, entry_am);
+    f = frame_arena_lookup(am_arena, page);
+
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(am_arena, &am_part, f);
+        frame_list_append(am_arena, &am_part, f);
         //it is stored in our buffer
         if (mod) {
-            memcpy(entry_am->data, buf, (size_t) si->gp->page_size);
-            entry_am->modified = mod;
+            memcpy(FRAME_DATA(am_arena, f), buf, (size_t) si->gp->page_size);
+            am_arena->desc[f].modified = mod;
         }
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
@@ -142,18 +172,15 @@ void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
 #endif
     } else {
         //we will only store it on Am if this page is contained on A1
-        BufferS2QSpecification *spec = (BufferS2QSpecification*) si->bs->buf_additional_param;
 
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
             _sbuffer_page_fault++;
 #endif 
 
-        HASH_FIND_INT(a1_part, &page, entry_a1);
-        if (entry_a1 != NULL) { //ok, we should store it on the Am and remove from A1           
-            current_size = HASH_COUNT(am_part) * (si->gp->page_size + sizeof (int));
-            // prune the cache to MAX_CACHE_SIZE
-            if (current_size >= spec->Am_size) {
+        g = frame_arena_lookup(a1_arena, page);
+        if (g != FRAME_NONE) { //ok, we should store it on the Am and remove from A1
+            if (am_part.size >= am_arena->nofframes) {
 #ifdef COLLECT_STATISTICAL_DATA
                 struct timespec cpustart;
                 struct timespec cpuend;
@@ -163,33 +190,16 @@ void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
                 cpustart = get_CPU_time();
                 start = get_current_time();
 #endif
-
-                HASH_ITER(hh, am_part, entry_am, tmp_entry_am) {
-                    // prune the first entry (loop is based on insertion order so this deletes the oldest item)
-                    HASH_DEL(am_part, entry_am);
-
+                //the least recently used frame that is not pinned
+                for (f = am_part.head; f != FRAME_NONE && am_arena->desc[f].pin_count > 0;
+                        f = am_arena->desc[f].next);
+                if (f != FRAME_NONE) {
                     /* we have to write this page on the disk/flash memory only if this node has modifications*/
-                    if (entry_am->modified) {
-                        fs.index_path = si->index_file;
-                        fs.io_access = si->gp->io_access;
-                        fs.page_size = si->gp->page_size;
-
-                        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                            disk_write_one_page(&fs, entry_am->page_id, entry_am->data);
-                        else if (si->gp->storage_system->type == FLASHDBSIM)
-                            flashdbsim_write_one_page(si, entry_am->data, entry_am->page_id);
-                        else
-                            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                    }
-
-                    if (si->gp->io_access == DIRECT_ACCESS) {
-                        free(entry_am->data);
-                    } else {
-                        lwfree(entry_am->data);
+                    if (am_arena->desc[f].modified) {
+                        buffer_write_one_page(si, am_arena->desc[f].page_id, FRAME_DATA(am_arena, f));
                     }
-                    lwfree(entry_am);
-
-                    break;
+                    frame_list_remove(am_arena, &am_part, f);
+                    frame_arena_release(am_arena, f);
                 }
 #ifdef COLLECT_STATISTICAL_DATA
                 if (_STORING == 0) {
@@ -202,56 +212,27 @@ void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
 #endif
             }
 
-            entry_am = (Am*) lwalloc(sizeof (Am));
-            entry_am->page_id = page;
-
-            if (si->gp->io_access == DIRECT_ACCESS) {
-                //then the memory must be aligned in blocks!
-                if (posix_memalign((void**) &(entry_am->data), si->gp->page_size, si->gp->page_size)) {
-                    _DEBUG(ERROR, "Allocation failed at buffer_s2q_add_entry");
+            if (am_part.size >= am_arena->nofframes) {
+                //all the frames are pinned, then this page is not stored in the buffer
+                if (mod) {
+                    buffer_write_one_page(si, page, buf);
                 }
             } else {
-                entry_am->data = (uint8_t*) lwalloc(si->gp->page_size);
+                f = frame_arena_alloc(am_arena, page);
+                memcpy(FRAME_DATA(am_arena, f), buf, si->gp->page_size);
+                am_arena->desc[f].modified = mod;
+                frame_list_append(am_arena, &am_part, f);
             }
-            memcpy(entry_am->data, buf, si->gp->page_size);
-
-            entry_am->modified = mod;
-            HASH_ADD_INT(am_part, page_id, entry_am);
 
             //remove from A1
-            HASH_DEL(a1_part, entry_a1);
-            lwfree(entry_a1);
+            frame_list_remove(a1_arena, &a1_part, g);
+            frame_arena_release(a1_arena, g);
         } else {
-            //we check if A1 have enough space
-            current_size = HASH_COUNT(a1_part);
-            // prune the cache to MAX_CACHE_SIZE
-            if (current_size >= spec->A1_size) {
-
-                HASH_ITER(hh, a1_part, entry_a1, tmp_entry_a1) {
-                    //in negative case, we remove an entry from A1in, respecting the FIFO
-                    HASH_DEL(a1_part, entry_a1);
-                    lwfree(entry_a1);
-                    break;
-                }
-            }
-
-            entry_a1 = (A1*) lwalloc(sizeof (A1));
-            entry_a1->page_id = page;
-            HASH_ADD_INT(a1_part, page_id, entry_a1);
+            buffer_s2q_a1_push(page);
 
             //after add in A1 part, we should write the page in the storage device if needed
             if (mod) {
-                fs.index_path = si->index_file;
-                fs.io_access = si->gp->io_access;
-                fs.page_size = si->gp->page_size;
-
-                if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-                    disk_write_one_page(&fs, page, buf);
-                else if (si->gp->storage_system->type == FLASHDBSIM)
-                    flashdbsim_write_one_page(si, buf, page);
-                else {
-                    _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-                }
+                buffer_write_one_page(si, page, buf);
             }
         }
     }
@@ -260,18 +241,16 @@ void buffer_s2q_add_entry(const SpatialIndex *si, int page, uint8_t *buf, bool m
 }
 
 void buffer_s2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
-    Am *entry;
-    HASH_FIND_INT(am_part, &page, entry);
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
 
     //_DEBUGF(NOTICE, "Searching for %d", page);
 
-    if (entry != NULL) {
-        // remove it (so the subsequent add will throw it on the front of the list)
-        //this happens because ut_hash stores the entries in a doubled linked list
-        HASH_DEL(am_part, entry);
-        HASH_ADD_INT(am_part, page_id, entry);
+    if (f != FRAME_NONE) {
+        //it becomes the most recently used frame
+        frame_list_remove(am_arena, &am_part, f);
+        frame_list_append(am_arena, &am_part, f);
         //it is stored in our buffer
-        memcpy(buf, entry->data, (size_t) si->gp->page_size);
+        memcpy(buf, FRAME_DATA(am_arena, f), (size_t) si->gp->page_size);
 
 #ifdef COLLECT_STATISTICAL_DATA
         if (_STORING == 0)
@@ -280,7 +259,6 @@ void buffer_s2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
     } else {
         /* this page is not stored in the buffer, 
          * then we have to get this node from the storage device*/
-        FileSpecification fs;
 #ifdef COLLECT_STATISTICAL_DATA
         struct timespec cpustart;
         struct timespec cpuend;
@@ -293,16 +271,7 @@ void buffer_s2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
 
         /* we have to read this page from the disk/flash memory*/
 
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_read_one_page(&fs, page, buf);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_read_one_page(si, page, buf);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_read_one_page(si, page, buf);
 
         //now we add this page into the buffer
         buffer_s2q_add_entry(si, page, buf, false);
@@ -321,17 +290,43 @@ void buffer_s2q_find(const SpatialIndex *si, int page, uint8_t * buf) {
    // buffer_s2q_print();
 }
 
+uint8_t *buffer_s2q_pin(const SpatialIndex *si, int page) {
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
+
+    //only the pages of Am are stored in the buffer
+    if (f == FRAME_NONE)
+        return NULL;
+
+    frame_list_remove(am_arena, &am_part, f);
+    frame_list_append(am_arena, &am_part, f);
+    am_arena->desc[f].pin_count++;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0)
+        _sbuffer_page_hit++;
+#endif
+    return FRAME_DATA(am_arena, f);
+}
+
+void buffer_s2q_unpin(int page) {
+    int f = (am_arena != NULL) ? frame_arena_lookup(am_arena, page) : FRAME_NONE;
+
+    if (f == FRAME_NONE || am_arena->desc[f].pin_count <= 0) {
+        _DEBUGF(ERROR, "The page %d is not pinned in the S2Q buffer", page);
+        return;
+    }
+    am_arena->desc[f].pin_count--;
+}
+
 void buffer_s2q_add(const SpatialIndex *si, int page, uint8_t * buf) {
     buffer_s2q_add_entry(si, page, buf, true);
 }
 
 void buffer_s2q_flush_all(const SpatialIndex * si) {
-    Am *entry, *tmp_entry;
-    FileSpecification fs;
-    int *pages;
+    int f;
+    BufferWrite *writes;
     int count = 0;
     int i = 0;
-    uint8_t *loc, *buf;
 #ifdef COLLECT_STATISTICAL_DATA
     struct timespec cpustart;
     struct timespec cpuend;
@@ -342,63 +337,34 @@ void buffer_s2q_flush_all(const SpatialIndex * si) {
     start = get_current_time();
 #endif
 
-    HASH_ITER(hh, am_part, entry, tmp_entry) {
+    if (am_arena == NULL)
+        return;
+
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
+        if (am_arena->desc[f].modified) {
             count++;
         }
     }
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, count * si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at buffer_s2q_add_entry");
-        }
-    } else {
-        buf = (uint8_t*) lwalloc(count * si->gp->page_size);
-    }
-    pages = (int*) lwalloc(sizeof (int) * count);
-
-    loc = buf;
-
-    HASH_ITER(hh, am_part, entry, tmp_entry) {
-        // delete this entry
-        HASH_DEL(am_part, entry);
+    writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (count + 1));
 
+    for (f = am_part.head; f != FRAME_NONE; f = am_arena->desc[f].next) {
         /* we have to write this page on the disk/flash memory only if this node has modifications*/
-        if (entry->modified) {
-            pages[i] = entry->page_id;
-            memcpy(loc, entry->data, si->gp->page_size);
-            loc += si->gp->page_size;
+        if (am_arena->desc[f].modified) {
+            writes[i].page = am_arena->desc[f].page_id;
+            writes[i].data = FRAME_DATA(am_arena, f);
             i++;
         }
-
-        if (si->gp->io_access == DIRECT_ACCESS) {
-            free(entry->data);
-        } else {
-            lwfree(entry->data);
-        }
-        lwfree(entry);
     }
 
-    if (count > 0) {
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write(&fs, pages, buf, count);
-        else if (si->gp->storage_system->type == FLASHDBSIM)
-            flashdbsim_write_pages(si, pages, buf, count);
-        else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
-    }
-    lwfree(pages);
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        free(buf);
-    } else {
-        lwfree(buf);
-    }
+    //the frames are written before their release
+    buffer_write_sorted_pages(si, writes, count, NULL);
+    lwfree(writes);
+
+    //the frames of Am are released, but the arena is kept for the next accesses (A1 is also kept)
+    frame_arena_reset(am_arena);
+    frame_list_init(&am_part);
 
 #ifdef COLLECT_STATISTICAL_DATA
     if (_STORING == 0) {
@@ -410,3 +376,29 @@ void buffer_s2q_flush_all(const SpatialIndex * si) {
     }
 #endif
 }
+
+unsigned int buffer_s2q_number_of_pages() {
+    //the A1 part only stores identifiers of pages
+    return (unsigned int) am_part.size;
+}
+
+int buffer_s2q_resident_pages(int *pages, int max) {
+    int f;
+    int n = 0;
+
+    if (am_arena == NULL)
+        return 0;
+    //the iteration follows the order of the accesses
+    for (f = am_part.head; f != FRAME_NONE && n < max; f = am_arena->desc[f].next)
+        pages[n++] = am_arena->desc[f].page_id;
+    return n;
+}
+
+void buffer_s2q_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    buffer_s2q_create_arenas(si);
+
+    //the page is stored in Am only if it is in A1, thus it is considered as a page accessed before
+    if (frame_arena_lookup(am_arena, page) == FRAME_NONE && frame_arena_lookup(a1_arena, page) == FRAME_NONE)
+        buffer_s2q_a1_push(page);
+    buffer_s2q_add_entry(si, page, buf, false);
+}
@@ -0,0 +1,793 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/* this file implements the SHARED buffer, a buffer pool stored in the shared memory of the PostgreSQL
+ * thus, the backends (i.e., the connections) that handle the same index share its cached pages
+ *
+ * the pool is allocated only if FESTIval is loaded by the shared_preload_libraries and festival.shared_buffer_size > 0
+ * its organization follows the buffer manager of the PostgreSQL:
+ * 1 - the page table maps (index file, page) to frames and is split in partitions, each one protected by a LWLock
+ * 2 - each frame has a content LWLock (shared for reads, exclusive for modifications)
+ * 3 - each frame has a spinlock that protects its header (reference count, usage count, and flags)
+ * 4 - the victims are chosen by a clock sweep over the usage counts, frames in use are never evicted
+ * 5 - a frame is written by only one backend at a time (io_in_progress, as BM_IO_IN_PROGRESS of the PostgreSQL)
+ *     and it only becomes clean if it was not modified after the copy of its content that was written
+ * */
+#include "postgres.h"
+#include "miscadmin.h" //for process_shared_preload_libraries_in_progress
+#include "storage/ipc.h" //for shmem_startup_hook
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "port/atomics.h"
+#include "utils/guc.h"
+#include "utils/hsearch.h"
+
+#include "buffer_handler.h"
+#include "../main/log_messages.h"
+#include "../main/statistical_processing.h"
+
+#include <limits.h>
+
+#define SHARED_BUFFER_PARTITIONS    16 //number of partitions of the page table
+#define SHARED_BUFFER_MAX_FILES     128 //number of index files whose pages can be stored
+#define SHARED_BUFFER_MAX_USAGE     5 //the maximum usage count of a frame (as in the PostgreSQL)
+#define SHARED_BUFFER_TRANCHE       "festival_shared_buffer"
+
+/* the identifier of a page */
+typedef struct {
+    int file; //the position of the index file in SharedBufferControl
+    int page;
+} SharedBufferTag;
+
+/* an entry of the page table */
+typedef struct {
+    SharedBufferTag tag; //the key
+    int frame;
+} SharedBufferEntry;
+
+typedef struct {
+    SharedBufferTag tag; //the page stored in this frame
+    slock_t mutex; //it protects the following fields
+    int refcount; //number of backends using this frame (it is not evicted while it is used)
+    int usage_count; //it is decremented by the clock sweep
+    bool valid; //the content of the frame was loaded
+    bool dirty; //the page of this frame has modification to be applied?
+    bool just_dirtied; //it was modified after the start of its current write
+    bool io_in_progress; //a backend is writing this frame
+} SharedFrame;
+
+typedef struct {
+    char path[MAXPGPATH];
+    uint8_t io_access;
+} SharedBufferFile;
+
+typedef struct {
+    int nofframes;
+    int page_size;
+    int noffiles;
+    pg_atomic_uint32 clock_hand;
+    SharedBufferFile files[SHARED_BUFFER_MAX_FILES];
+} SharedBufferControl;
+
+/* the configuration (see buffer_shared_init) */
+static int shared_buffer_size = 0; //in KB
+static int shared_buffer_page_size = 4096;
+
+/* the shared memory */
+static SharedBufferControl *ctl = NULL;
+static SharedFrame *frames = NULL;
+static uint8_t *blocks = NULL;
+static HTAB *table = NULL;
+static LWLockPadded *locks = NULL; //the partitions, the lock of the files, and the content locks
+
+#if PG_VERSION_NUM >= 150000
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+#endif
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+/* the last index file accessed by this backend */
+static char last_path[MAXPGPATH];
+static int last_file = -1;
+
+/* the frame pinned by this backend in an operation, it is released if the operation raises an error */
+static int held_frame = -1;
+/* the frame being written by this backend in an operation (outside buffer_shared_flush_all) */
+static int io_frame = -1;
+
+#define SHARED_BUFFER_PARTITION_LOCK(hash)  (&locks[(hash) % SHARED_BUFFER_PARTITIONS].lock)
+#define SHARED_BUFFER_FILE_LOCK             (&locks[SHARED_BUFFER_PARTITIONS].lock)
+#define SHARED_BUFFER_CONTENT_LOCK(frame)   (&locks[SHARED_BUFFER_PARTITIONS + 1 + (frame)].lock)
+#define SHARED_BUFFER_DATA(frame)           (blocks + (size_t) (frame) * (size_t) ctl->page_size)
+#define SHARED_BUFFER_FRAME(data)           ((int) (((data) - blocks) / (size_t) ctl->page_size))
+
+static int shared_buffer_nofframes(void) {
+    return (int) (((int64) shared_buffer_size * 1024) / shared_buffer_page_size);
+}
+
+/* the page size must be a power of two since the frames are aligned to it (TYPEALIGN) */
+static bool shared_buffer_check_page_size(int *newval, void **extra, GucSource source) {
+    if ((*newval & (*newval - 1)) != 0) {
+        GUC_check_errdetail("festival.shared_buffer_page_size must be a power of two.");
+        return false;
+    }
+    return true;
+}
+
+static Size shared_buffer_shmem_size(void) {
+    int n = shared_buffer_nofframes();
+    Size size = MAXALIGN(sizeof (SharedBufferControl));
+
+    size = add_size(size, mul_size(n, sizeof (SharedFrame)));
+    //the frames are aligned to the page size (for the direct access)
+    size = add_size(size, add_size(mul_size(n, shared_buffer_page_size), shared_buffer_page_size));
+    size = add_size(size, hash_estimate_size(n + SHARED_BUFFER_PARTITIONS, sizeof (SharedBufferEntry)));
+    return size;
+}
+
+static void shared_buffer_shmem_request(void) {
+#if PG_VERSION_NUM >= 150000
+    if (prev_shmem_request_hook)
+        prev_shmem_request_hook();
+#endif
+    RequestAddinShmemSpace(shared_buffer_shmem_size());
+    RequestNamedLWLockTranche(SHARED_BUFFER_TRANCHE, SHARED_BUFFER_PARTITIONS + 1 + shared_buffer_nofframes());
+}
+
+static void shared_buffer_shmem_startup(void) {
+    HASHCTL info;
+    bool found;
+    bool found_frames;
+    bool found_blocks;
+    int n = shared_buffer_nofframes();
+    int i;
+
+    if (prev_shmem_startup_hook)
+        prev_shmem_startup_hook();
+
+    LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+    ctl = (SharedBufferControl*) ShmemInitStruct("festival shared buffer", sizeof (SharedBufferControl), &found);
+    frames = (SharedFrame*) ShmemInitStruct("festival shared buffer frames", mul_size(n, sizeof (SharedFrame)),
+            &found_frames);
+    blocks = (uint8_t*) ShmemInitStruct("festival shared buffer blocks",
+            add_size(mul_size(n, shared_buffer_page_size), shared_buffer_page_size), &found_blocks);
+    blocks = (uint8_t*) TYPEALIGN(shared_buffer_page_size, blocks);
+
+    memset(&info, 0, sizeof (info));
+    info.keysize = sizeof (SharedBufferTag);
+    info.entrysize = sizeof (SharedBufferEntry);
+    info.num_partitions = SHARED_BUFFER_PARTITIONS;
+    table = ShmemInitHash("festival shared buffer table", n + SHARED_BUFFER_PARTITIONS, n + SHARED_BUFFER_PARTITIONS,
+            &info, HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+
+    if (!found) {
+        ctl->nofframes = n;
+        ctl->page_size = shared_buffer_page_size;
+        ctl->noffiles = 0;
+        pg_atomic_init_u32(&ctl->clock_hand, 0);
+        for (i = 0; i < n; i++) {
+            SpinLockInit(&frames[i].mutex);
+            frames[i].tag.file = -1;
+            frames[i].tag.page = -1;
+            frames[i].refcount = 0;
+            frames[i].usage_count = 0;
+            frames[i].valid = false;
+            frames[i].dirty = false;
+            frames[i].just_dirtied = false;
+            frames[i].io_in_progress = false;
+        }
+    }
+
+    LWLockRelease(AddinShmemInitLock);
+
+    locks = GetNamedLWLockTranche(SHARED_BUFFER_TRANCHE);
+}
+
+void buffer_shared_init(void) {
+    if (!process_shared_preload_libraries_in_progress)
+        return;
+
+    DefineCustomIntVariable("festival.shared_buffer_size",
+            "Size of the buffer shared by the backends (SHARED buffer of FESTIval), 0 disables it.",
+            NULL, &shared_buffer_size, 0, 0, INT_MAX / 2, PGC_POSTMASTER, GUC_UNIT_KB, NULL, NULL, NULL);
+    DefineCustomIntVariable("festival.shared_buffer_page_size",
+            "Size of the pages stored in the SHARED buffer of FESTIval (the page size of its indices).",
+            NULL, &shared_buffer_page_size, 4096, 512, 1024 * 1024, PGC_POSTMASTER, 0,
+            shared_buffer_check_page_size, NULL, NULL);
+
+    if (shared_buffer_nofframes() <= 0)
+        return;
+
+#if PG_VERSION_NUM >= 150000
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = shared_buffer_shmem_request;
+#else
+    shared_buffer_shmem_request();
+#endif
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = shared_buffer_shmem_startup;
+}
+
+static void shared_buffer_check(const SpatialIndex *si) {
+    if (ctl == NULL) {
+        _DEBUG(ERROR, "The SHARED buffer requires FESTIval in shared_preload_libraries "
+                "and festival.shared_buffer_size greater than 0");
+    }
+    if (si->gp->page_size != ctl->page_size) {
+        _DEBUGF(ERROR, "The page size of the index (%d) is not the page size of the SHARED buffer (%d), "
+                "see festival.shared_buffer_page_size", si->gp->page_size, ctl->page_size);
+    }
+    if (si->gp->storage_system->type != SSD && si->gp->storage_system->type != HDD) {
+        _DEBUG(ERROR, "The SHARED buffer only supports HDDs and SSDs");
+    }
+}
+
+/* it returns the position of the index file of si in the shared memory */
+static int shared_buffer_file(const SpatialIndex *si) {
+    int i;
+
+    if (last_file >= 0 && strcmp(last_path, si->index_file) == 0)
+        return last_file;
+
+    LWLockAcquire(SHARED_BUFFER_FILE_LOCK, LW_EXCLUSIVE);
+    for (i = 0; i < ctl->noffiles; i++) {
+        if (strcmp(ctl->files[i].path, si->index_file) == 0)
+            break;
+    }
+    if (i == ctl->noffiles) {
+        if (ctl->noffiles == SHARED_BUFFER_MAX_FILES) {
+            LWLockRelease(SHARED_BUFFER_FILE_LOCK);
+            _DEBUGF(ERROR, "The SHARED buffer cannot store pages of more than %d index files", SHARED_BUFFER_MAX_FILES);
+        }
+        strlcpy(ctl->files[i].path, si->index_file, MAXPGPATH);
+        ctl->files[i].io_access = si->gp->io_access;
+        ctl->noffiles++;
+    }
+    LWLockRelease(SHARED_BUFFER_FILE_LOCK);
+
+    strlcpy(last_path, si->index_file, MAXPGPATH);
+    last_file = i;
+    return i;
+}
+
+static void shared_buffer_pin(int frame) {
+    SharedFrame *d = &frames[frame];
+
+    SpinLockAcquire(&d->mutex);
+    d->refcount++;
+    if (d->usage_count < SHARED_BUFFER_MAX_USAGE)
+        d->usage_count++;
+    SpinLockRelease(&d->mutex);
+}
+
+static void shared_buffer_unpin(int frame) {
+    SharedFrame *d = &frames[frame];
+
+    SpinLockAcquire(&d->mutex);
+    d->refcount--;
+    SpinLockRelease(&d->mutex);
+}
+
+/* it starts the write of a pinned frame, it returns false if the frame has no modifications
+ * if another backend is writing the frame, it waits for the end of that write (if wait is true) or returns false */
+static bool shared_buffer_start_io(int frame, bool wait) {
+    SharedFrame *d = &frames[frame];
+
+    while (true) {
+        SpinLockAcquire(&d->mutex);
+        if (!d->io_in_progress) {
+            if (!d->valid || !d->dirty) {
+                SpinLockRelease(&d->mutex);
+                return false;
+            }
+            d->io_in_progress = true;
+            d->just_dirtied = false;
+            SpinLockRelease(&d->mutex);
+            return true;
+        }
+        SpinLockRelease(&d->mutex);
+        if (!wait)
+            return false;
+        CHECK_FOR_INTERRUPTS();
+        pg_usleep(1000L);
+    }
+}
+
+/* it finishes the write of a frame, which becomes clean only if the write succeeded and it was not modified meanwhile */
+static void shared_buffer_end_io(int frame, bool success) {
+    SharedFrame *d = &frames[frame];
+
+    SpinLockAcquire(&d->mutex);
+    if (success && !d->just_dirtied)
+        d->dirty = false;
+    d->io_in_progress = false;
+    SpinLockRelease(&d->mutex);
+}
+
+/* it unpins the frame held by an operation that raised an error */
+static void shared_buffer_release_held(void) {
+    if (io_frame >= 0) {
+        shared_buffer_end_io(io_frame, false);
+        io_frame = -1;
+    }
+    if (held_frame >= 0) {
+        shared_buffer_unpin(held_frame);
+        held_frame = -1;
+    }
+}
+
+/* it returns a pinned frame that is not used by any backend and whose usage count is 0 (clock sweep) */
+static int shared_buffer_victim(void) {
+    uint32 tries = 0;
+    uint32 max_tries = (uint32) ctl->nofframes * (SHARED_BUFFER_MAX_USAGE + 1);
+
+    while (true) {
+        int frame = (int) (pg_atomic_fetch_add_u32(&ctl->clock_hand, 1) % (uint32) ctl->nofframes);
+        SharedFrame *d = &frames[frame];
+
+        SpinLockAcquire(&d->mutex);
+        if (d->refcount == 0) {
+            if (d->usage_count == 0) {
+                d->refcount = 1;
+                SpinLockRelease(&d->mutex);
+                return frame;
+            }
+            d->usage_count--;
+        }
+        SpinLockRelease(&d->mutex);
+
+        if (++tries > max_tries)
+            _DEBUG(ERROR, "There is no frame available in the SHARED buffer");
+    }
+}
+
+static void shared_buffer_file_spec(int file, FileSpecification *fs) {
+    fs->index_path = ctl->files[file].path;
+    fs->io_access = ctl->files[file].io_access;
+    fs->page_size = ctl->page_size;
+}
+
+/* it writes a pinned frame if it has modifications (this backend must not be writing other frames) */
+static void shared_buffer_write_frame(int frame) {
+    SharedFrame *d = &frames[frame];
+    SharedBufferTag tag;
+    FileSpecification fs;
+
+    if (!shared_buffer_start_io(frame, true))
+        return;
+    io_frame = frame;
+
+    //the content lock avoids new modifications during the write
+    LWLockAcquire(SHARED_BUFFER_CONTENT_LOCK(frame), LW_SHARED);
+    SpinLockAcquire(&d->mutex);
+    tag = d->tag;
+    SpinLockRelease(&d->mutex);
+
+    shared_buffer_file_spec(tag.file, &fs);
+    disk_write_one_page(&fs, tag.page, SHARED_BUFFER_DATA(frame));
+    LWLockRelease(SHARED_BUFFER_CONTENT_LOCK(frame));
+
+    shared_buffer_end_io(frame, true);
+    io_frame = -1;
+}
+
+/* it loads the content of a pinned frame if it is not valid (data == NULL means that it is read) */
+static void shared_buffer_fill_frame(const SpatialIndex *si, int frame, const uint8_t *data) {
+    SharedFrame *d = &frames[frame];
+    bool valid;
+
+    LWLockAcquire(SHARED_BUFFER_CONTENT_LOCK(frame), LW_EXCLUSIVE);
+    SpinLockAcquire(&d->mutex);
+    valid = d->valid;
+    SpinLockRelease(&d->mutex);
+
+    if (!valid) {
+        if (data != NULL)
+            memcpy(SHARED_BUFFER_DATA(frame), data, ctl->page_size);
+        else
+            buffer_read_one_page(si, d->tag.page, SHARED_BUFFER_DATA(frame));
+
+        SpinLockAcquire(&d->mutex);
+        d->valid = true;
+        SpinLockRelease(&d->mutex);
+    }
+    LWLockRelease(SHARED_BUFFER_CONTENT_LOCK(frame));
+}
+
+/* it returns the frame of the page, which is pinned (held_frame) and valid
+ * if the page is not stored in the buffer, it is loaded from data (or read if data is NULL) */
+static int shared_buffer_get_frame(const SpatialIndex *si, const SharedBufferTag *tag, const uint8_t *data, bool *hit) {
+    uint32 hash = get_hash_value(table, tag);
+    SharedBufferEntry *entry;
+    int frame;
+
+    LWLockAcquire(SHARED_BUFFER_PARTITION_LOCK(hash), LW_SHARED);
+    entry = (SharedBufferEntry*) hash_search_with_hash_value(table, tag, hash, HASH_FIND, NULL);
+    if (entry != NULL) {
+        //the mapping does not change while we hold the partition lock
+        frame = entry->frame;
+        shared_buffer_pin(frame);
+        held_frame = frame;
+        LWLockRelease(SHARED_BUFFER_PARTITION_LOCK(hash));
+
+        //its content may not be loaded yet if the backend that loaded it raised an error
+        shared_buffer_fill_frame(si, frame, data);
+        *hit = true;
+        return frame;
+    }
+    LWLockRelease(SHARED_BUFFER_PARTITION_LOCK(hash));
+
+    *hit = false;
+    while (true) {
+        SharedFrame *d;
+        SharedBufferTag old_tag;
+        uint32 old_hash = 0;
+        bool old_valid;
+        LWLock *part, *old_part;
+        bool found;
+
+        frame = shared_buffer_victim();
+        held_frame = frame;
+        d = &frames[frame];
+
+        /* we have to write this page on the disk only if this node has modifications */
+        shared_buffer_write_frame(frame);
+
+        SpinLockAcquire(&d->mutex);
+        old_tag = d->tag;
+        old_valid = d->tag.file >= 0;
+        SpinLockRelease(&d->mutex);
+
+        part = SHARED_BUFFER_PARTITION_LOCK(hash);
+        old_part = NULL;
+        if (old_valid) {
+            old_hash = get_hash_value(table, &old_tag);
+            old_part = SHARED_BUFFER_PARTITION_LOCK(old_hash);
+        }
+        //the partitions are locked in the order of their addresses (avoiding deadlocks)
+        if (old_part == NULL || old_part == part) {
+            LWLockAcquire(part, LW_EXCLUSIVE);
+        } else if (old_part < part) {
+            LWLockAcquire(old_part, LW_EXCLUSIVE);
+            LWLockAcquire(part, LW_EXCLUSIVE);
+        } else {
+            LWLockAcquire(part, LW_EXCLUSIVE);
+            LWLockAcquire(old_part, LW_EXCLUSIVE);
+        }
+
+        //another backend may have stored this page in the meanwhile
+        entry = (SharedBufferEntry*) hash_search_with_hash_value(table, tag, hash, HASH_FIND, NULL);
+        if (entry != NULL) {
+            int other = entry->frame;
+
+            shared_buffer_pin(other);
+            held_frame = other;
+            if (old_part != NULL && old_part != part)
+                LWLockRelease(old_part);
+            LWLockRelease(part);
+            shared_buffer_unpin(frame);
+
+            shared_buffer_fill_frame(si, other, data);
+            *hit = true;
+            return other;
+        }
+
+        //the victim may have been pinned or modified by another backend in the meanwhile
+        SpinLockAcquire(&d->mutex);
+        if (d->refcount != 1 || d->dirty) {
+            SpinLockRelease(&d->mutex);
+            if (old_part != NULL && old_part != part)
+                LWLockRelease(old_part);
+            LWLockRelease(part);
+            shared_buffer_unpin(frame);
+            held_frame = -1;
+            continue;
+        }
+        d->tag = *tag;
+        d->valid = false;
+        d->dirty = false;
+        d->usage_count = 1;
+        SpinLockRelease(&d->mutex);
+
+        if (old_valid)
+            hash_search_with_hash_value(table, &old_tag, old_hash, HASH_REMOVE, NULL);
+        entry = (SharedBufferEntry*) hash_search_with_hash_value(table, tag, hash, HASH_ENTER, &found);
+        entry->frame = frame;
+
+        if (old_part != NULL && old_part != part)
+            LWLockRelease(old_part);
+        LWLockRelease(part);
+
+        //the backends that find this page wait for its content lock until it is loaded
+        shared_buffer_fill_frame(si, frame, data);
+        return frame;
+    }
+}
+
+void buffer_shared_find(const SpatialIndex *si, int page, uint8_t *buf) {
+    SharedBufferTag tag;
+    int frame;
+    bool hit;
+
+    shared_buffer_check(si);
+    tag.file = shared_buffer_file(si);
+    tag.page = page;
+
+    PG_TRY();
+    {
+        frame = shared_buffer_get_frame(si, &tag, NULL, &hit);
+
+        LWLockAcquire(SHARED_BUFFER_CONTENT_LOCK(frame), LW_SHARED);
+        memcpy(buf, SHARED_BUFFER_DATA(frame), ctl->page_size);
+        LWLockRelease(SHARED_BUFFER_CONTENT_LOCK(frame));
+
+        shared_buffer_unpin(frame);
+        held_frame = -1;
+    }
+    PG_CATCH();
+    {
+        shared_buffer_release_held();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        if (hit)
+            _sbuffer_page_hit++;
+        else
+            _sbuffer_page_fault++;
+    }
+#endif
+}
+
+void buffer_shared_add(const SpatialIndex *si, int page, uint8_t *buf) {
+    SharedBufferTag tag;
+    SharedFrame *d;
+    int frame;
+    bool hit;
+
+    shared_buffer_check(si);
+    tag.file = shared_buffer_file(si);
+    tag.page = page;
+
+    PG_TRY();
+    {
+        frame = shared_buffer_get_frame(si, &tag, buf, &hit);
+        d = &frames[frame];
+
+        LWLockAcquire(SHARED_BUFFER_CONTENT_LOCK(frame), LW_EXCLUSIVE);
+        memcpy(SHARED_BUFFER_DATA(frame), buf, ctl->page_size);
+        SpinLockAcquire(&d->mutex);
+        d->dirty = true;
+        d->just_dirtied = true;
+        SpinLockRelease(&d->mutex);
+        LWLockRelease(SHARED_BUFFER_CONTENT_LOCK(frame));
+
+        shared_buffer_unpin(frame);
+        held_frame = -1;
+    }
+    PG_CATCH();
+    {
+        shared_buffer_release_held();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        if (hit)
+            _sbuffer_page_hit++;
+        else
+            _sbuffer_page_fault++;
+    }
+#endif
+}
+
+void buffer_shared_load(const SpatialIndex *si, int page, uint8_t *buf) {
+    SharedBufferTag tag;
+    int frame;
+    bool hit;
+
+    shared_buffer_check(si);
+    tag.file = shared_buffer_file(si);
+    tag.page = page;
+
+    PG_TRY();
+    {
+        frame = shared_buffer_get_frame(si, &tag, buf, &hit);
+        shared_buffer_unpin(frame);
+        held_frame = -1;
+    }
+    PG_CATCH();
+    {
+        shared_buffer_release_held();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+}
+
+/* it writes the modified pages of the index and removes its pages from the buffer,
+ * thus a new index with the same file does not find old pages
+ * the pages in use by other backends are kept */
+void buffer_shared_flush_all(const SpatialIndex *si) {
+    int *pinned;
+    int *started;
+    BufferWrite *writes;
+    uint8_t *buf;
+    volatile int n = 0;
+    volatile int nofstarted = 0;
+    int count = 0;
+    int file;
+    int i;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if (ctl == NULL)
+        return;
+    file = shared_buffer_file(si);
+
+    pinned = (int*) lwalloc(sizeof (int) * ctl->nofframes);
+    started = (int*) lwalloc(sizeof (int) * ctl->nofframes);
+
+    PG_TRY();
+    {
+        //the frames of the index are pinned, thus they are not evicted until they are written
+        for (i = 0; i < ctl->nofframes; i++) {
+            SharedFrame *d = &frames[i];
+
+            SpinLockAcquire(&d->mutex);
+            if (d->valid && d->tag.file == file) {
+                d->refcount++;
+                pinned[n++] = i;
+            }
+            SpinLockRelease(&d->mutex);
+        }
+
+        writes = (BufferWrite*) lwalloc(sizeof (BufferWrite) * (n + 1));
+        buf = buffer_alloc_pages(si, n + 1);
+        /* the writes of the modified frames are started without waiting for frames being written by other backends
+         * (waiting while holding started writes could deadlock with another flushing) */
+        for (i = 0; i < n; i++) {
+            SharedFrame *d = &frames[pinned[i]];
+
+            if (!shared_buffer_start_io(pinned[i], false))
+                continue;
+            started[nofstarted++] = pinned[i];
+
+            SpinLockAcquire(&d->mutex);
+            writes[count].page = d->tag.page;
+            SpinLockRelease(&d->mutex);
+            writes[count].data = SHARED_BUFFER_DATA(pinned[i]);
+            count++;
+        }
+
+        //the frames are copied once, already in the order of their pages
+        buffer_sort_writes(writes, count);
+        for (i = 0; i < count; i++) {
+            int frame = SHARED_BUFFER_FRAME(writes[i].data);
+
+            //the copy is consistent since the modifications hold the content lock in exclusive mode
+            LWLockAcquire(SHARED_BUFFER_CONTENT_LOCK(frame), LW_SHARED);
+            memcpy(buf + (size_t) i * ctl->page_size, writes[i].data, ctl->page_size);
+            LWLockRelease(SHARED_BUFFER_CONTENT_LOCK(frame));
+            writes[i].data = buf + (size_t) i * ctl->page_size;
+        }
+
+        if (count > 0) {
+            buffer_write_sorted_pages(si, writes, count, buf);
+        }
+        //the dirty flags are only cleared after the writes succeeded
+        while (nofstarted > 0) {
+            shared_buffer_end_io(started[nofstarted - 1], true);
+            nofstarted--;
+        }
+        lwfree(writes);
+        buffer_free_page(si, buf);
+
+        //the frames that were being written by other backends (they may have been modified after those writes)
+        for (i = 0; i < n; i++)
+            shared_buffer_write_frame(pinned[i]);
+
+        while (n > 0) {
+            SharedFrame *d = &frames[pinned[n - 1]];
+            SharedBufferTag tag = d->tag; //it does not change while the frame is pinned
+            uint32 hash = get_hash_value(table, &tag);
+
+            LWLockAcquire(SHARED_BUFFER_PARTITION_LOCK(hash), LW_EXCLUSIVE);
+            SpinLockAcquire(&d->mutex);
+            if (d->refcount == 1 && !d->dirty) {
+                d->tag.file = -1;
+                d->tag.page = -1;
+                d->valid = false;
+                d->usage_count = 0;
+                hash_search_with_hash_value(table, &tag, hash, HASH_REMOVE, NULL);
+            }
+            d->refcount--;
+            SpinLockRelease(&d->mutex);
+            LWLockRelease(SHARED_BUFFER_PARTITION_LOCK(hash));
+            n--;
+        }
+    }
+    PG_CATCH();
+    {
+        //the frames whose writes were not finished keep their modifications
+        for (i = 0; i < nofstarted; i++)
+            shared_buffer_end_io(started[i], false);
+        if (io_frame >= 0) {
+            shared_buffer_end_io(io_frame, false);
+            io_frame = -1;
+        }
+        for (i = 0; i < n; i++)
+            shared_buffer_unpin(pinned[i]);
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    lwfree(pinned);
+    lwfree(started);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (_STORING == 0) {
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sbuffer_flushing_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sbuffer_flushing_time += get_elapsed_time(start, end);
+    }
+#endif
+}
+
+/* the pages of the index accessed by the last operation of this backend */
+int buffer_shared_resident_pages(int *pages, int max) {
+    int i;
+    int n = 0;
+
+    if (ctl == NULL || last_file < 0)
+        return 0;
+    //other backends may load pages of the index in the meanwhile
+    for (i = 0; i < ctl->nofframes && n < max; i++) {
+        SpinLockAcquire(&frames[i].mutex);
+        if (frames[i].valid && frames[i].tag.file == last_file)
+            pages[n++] = frames[i].tag.page;
+        SpinLockRelease(&frames[i].mutex);
+    }
+    return n;
+}
+
+/* the frames are shared by all the indices */
+int buffer_shared_capacity(const SpatialIndex *si) {
+    return (ctl == NULL) ? 0 : ctl->nofframes;
+}
+
+unsigned int buffer_shared_number_of_pages() {
+    int i;
+    unsigned int n = 0;
+
+    if (ctl == NULL || last_file < 0)
+        return 0;
+    for (i = 0; i < ctl->nofframes; i++) {
+        SpinLockAcquire(&frames[i].mutex);
+        if (frames[i].valid && frames[i].tag.file == last_file)
+            n++;
+        SpinLockRelease(&frames[i].mutex);
+    }
+    return n;
+}
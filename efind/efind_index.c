@@ -122,6 +122,67 @@ static SpatialIndexResult *efindindex_search_ss(SpatialIndex *si, const LWGEOM *
     }
 }
 
+/* only the R-tree and the R*-tree have a specialized point location */
+static SpatialIndexResult *efindindex_search_pt(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate) {
+    eFINDIndex *fi = (void *) si;
+    if (fi->efind_type_index == eFIND_RTREE_TYPE) {
+        eFINDRTree *fr;
+        fr = fi->efind_index.efind_rtree;
+        rtree_set_efindspecification(fr->spec);
+        return spatialindex_point_location(&(fr->rtree->base), search_object, predicate);
+    } else if (fi->efind_type_index == eFIND_RSTARTREE_TYPE) {
+        eFINDRStarTree *fr;
+        fr = fi->efind_index.efind_rstartree;
+        rstartree_set_efindspecification(fr->spec);
+        return spatialindex_point_location(&(fr->rstartree->base), search_object, predicate);
+    } else {
+        _DEBUGF(ERROR, "Point location is not supported by the eFIND index %d", fi->efind_type_index);
+        return NULL;
+    }
+}
+
+static SpatialIndexResult *efindindex_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    eFINDIndex *fi = (void *) si;
+    if (fi->efind_type_index == eFIND_RTREE_TYPE) {
+        eFINDRTree *fr;
+        fr = fi->efind_index.efind_rtree;
+        rtree_set_efindspecification(fr->spec);
+        return spatialindex_distance_selection(&(fr->rtree->base), search_object, distance);
+    } else if (fi->efind_type_index == eFIND_RSTARTREE_TYPE) {
+        eFINDRStarTree *fr;
+        fr = fi->efind_index.efind_rstartree;
+        rstartree_set_efindspecification(fr->spec);
+        return spatialindex_distance_selection(&(fr->rstartree->base), search_object, distance);
+    } else if(fi->efind_type_index == eFIND_HILBERT_RTREE_TYPE) {
+        eFINDHilbertRTree *fr;
+        fr = fi->efind_index.efind_hilbertrtree;
+        hilbertrtree_set_efindspecification(fr->spec);
+        efind_pagehandler_set_srid(fr->hilbertrtree->spec->srid);
+        return spatialindex_distance_selection(&(fr->hilbertrtree->base), search_object, distance);        
+    } else {
+        _DEBUGF(ERROR, "Unknown eFIND index %d", fi->efind_type_index);
+    }
+}
+
+/* only the R-tree and the R*-tree store aggregate counts */
+static SpatialIndexResult *efindindex_count_dw(SpatialIndex *si, const LWGEOM *search_object, double distance, uint64_t *nofobjects) {
+    eFINDIndex *fi = (void *) si;
+    if (fi->efind_type_index == eFIND_RTREE_TYPE) {
+        eFINDRTree *fr;
+        fr = fi->efind_index.efind_rtree;
+        rtree_set_efindspecification(fr->spec);
+        return spatialindex_distance_count(&(fr->rtree->base), search_object, distance, nofobjects);
+    } else if (fi->efind_type_index == eFIND_RSTARTREE_TYPE) {
+        eFINDRStarTree *fr;
+        fr = fi->efind_index.efind_rstartree;
+        rstartree_set_efindspecification(fr->spec);
+        return spatialindex_distance_count(&(fr->rstartree->base), search_object, distance, nofobjects);
+    } else {
+        _DEBUGF(ERROR, "Aggregate counts are not supported by the eFIND index %d", fi->efind_type_index);
+        return NULL;
+    }
+}
+
 static bool efindindex_header_writer(SpatialIndex *si, const char *file) {
     eFINDIndex *fi = (void *) si;
     festival_header_writer(file, fi->efind_type_index, si);
@@ -162,8 +223,8 @@ SpatialIndex *efindrtree_empty_create(char *file, Source *src, GenericParameters
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {efindindex_get_type,
-        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss,
-        efindindex_header_writer, efindindex_destroy
+        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss, efindindex_search_pt,
+        efindindex_search_dw, efindindex_count_dw, efindindex_header_writer, efindindex_destroy
     };
     static SpatialIndex base = {&vtable};
     base.bs = bs;
@@ -206,8 +267,8 @@ SpatialIndex *efindrstartree_empty_create(char *file, Source *src, GenericParame
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {efindindex_get_type,
-        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss,
-        efindindex_header_writer, efindindex_destroy
+        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss, efindindex_search_pt,
+        efindindex_search_dw, efindindex_count_dw, efindindex_header_writer, efindindex_destroy
     };
     static SpatialIndex base = {&vtable};
     base.bs = bs;
@@ -250,8 +311,8 @@ SpatialIndex *efindhilbertrtree_empty_create(char *file, Source *src, GenericPar
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {efindindex_get_type,
-        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss,
-        efindindex_header_writer, efindindex_destroy
+        efindindex_insert, efindindex_remove, efindindex_update, efindindex_search_ss, NULL,
+        efindindex_search_dw, NULL, efindindex_header_writer, efindindex_destroy
     };
     static SpatialIndex base = {&vtable};
     base.bs = bs;
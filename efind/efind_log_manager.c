@@ -32,6 +32,18 @@
 #include "../main/statistical_processing.h"
 
 static void raw_write_log(const char *file, uint8_t *buf, size_t bufsize);
+/*it writes the entries of the current group of the log (see efind_log_begin_group)*/
+static void flush_log_group(void);
+/*it appends a buffer in the log file*/
+static void raw_append_log(const char *file, uint8_t *buf, size_t bufsize);
+
+/* the entries of a group are kept in main memory and are appended in the log file by a single write
+ * the group is written before any read of the log since the compaction and the recovery read the log file*/
+static bool group_active = false;
+static char *group_file = NULL; //the log file of the pending entries
+static uint8_t *group_buf = NULL;
+static size_t group_size = 0;
+static size_t group_capacity = 0;
 static void raw_read_log(const char *file, size_t offset, uint8_t *buf, size_t bufsize);
 /*this function process the retrieved entry of the log 
  * it push in the redostack */
@@ -42,6 +54,60 @@ static int min_nof_flushing = 1; //a  global variable to decide if a compaction
 static int nof_flushing = 0; //the current number of flushings stored in the log file (that we now in the main memory)
 
 void raw_write_log(const char* file, uint8_t *buf, size_t bufsize) {
+    if (!group_active) {
+        raw_append_log(file, buf, bufsize);
+        return;
+    }
+
+    //the pending entries belong to another log file (e.g., during a compaction)
+    if (group_file != NULL && strcmp(group_file, file) != 0)
+        flush_log_group();
+
+    if (group_size + bufsize > group_capacity) {
+        group_capacity = (group_size + bufsize > 2 * group_capacity) ? group_size + bufsize : 2 * group_capacity;
+        if (group_buf == NULL)
+            group_buf = (uint8_t*) lwalloc(group_capacity);
+        else
+            group_buf = (uint8_t*) lwrealloc(group_buf, group_capacity);
+    }
+    memcpy(group_buf + group_size, buf, bufsize);
+    group_size += bufsize;
+
+    if (group_file == NULL) {
+        group_file = (char*) lwalloc(strlen(file) + 1);
+        strcpy(group_file, file);
+    }
+}
+
+void flush_log_group() {
+    size_t size = group_size;
+
+    //the entries are discarded before the write, so that a failed write does not keep them for the next group
+    group_size = 0;
+    if (size > 0)
+        raw_append_log(group_file, group_buf, size);
+    if (group_file != NULL) {
+        lwfree(group_file);
+        group_file = NULL;
+    }
+}
+
+void efind_log_begin_group() {
+    group_active = true;
+}
+
+void efind_log_end_group() {
+    //the group is closed even if its write raises an error
+    group_active = false;
+    flush_log_group();
+    if (group_buf != NULL) {
+        lwfree(group_buf);
+        group_buf = NULL;
+        group_capacity = 0;
+    }
+}
+
+void raw_append_log(const char* file, uint8_t *buf, size_t bufsize) {
     int f;
     size_t written;
     if ((f = open(file, O_CREAT | O_WRONLY | O_APPEND, S_IRUSR | S_IWUSR)) < 0) {
@@ -61,6 +127,10 @@ void raw_write_log(const char* file, uint8_t *buf, size_t bufsize) {
 void raw_read_log(const char* file, size_t offset, uint8_t *buf, size_t bufsize) {
     int f;
     size_t read_size;
+
+    //the pending entries of a group must be in the log file
+    if (group_size > 0)
+        flush_log_group();
     if ((f = open(file, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
         _DEBUGF(ERROR, "It was impossible to open the \'%s\'. ", file);
         return;
@@ -140,9 +210,9 @@ size_t efind_size_of_mod_node(void *entry, int height, uint8_t index_type) {
     bufsize += sizeof (uint32_t);
     if (index_type == eFIND_RTREE_TYPE || index_type == eFIND_RSTARTREE_TYPE) {
         REntry *re = (REntry*) entry;
-        //size of pointer + bbox
+        //size of pointer + bbox + count (for aggregate R-trees)
         if (re->bbox != NULL)
-            bufsize += sizeof (int) + sizeof (BBox);
+            bufsize += sizeof (int) + sizeof (BBox) + sizeof (uint32_t);
         else
             bufsize += sizeof (int);
     } else if (index_type == eFIND_HILBERT_RTREE_TYPE) {
@@ -229,6 +299,7 @@ eFINDLogEntry *efind_retrieve_log_entry(uint8_t *buf, size_t *offset, uint8_t in
         if (index_type == eFIND_RTREE_TYPE || index_type == eFIND_RSTARTREE_TYPE) {
             BBox *bbox;
             int p;
+            uint32_t count = 0;
             //we read the pointer of the entry
             memcpy(&p, buf, sizeof (int));
             buf += sizeof (int);
@@ -240,9 +311,14 @@ eFINDLogEntry *efind_retrieve_log_entry(uint8_t *buf, size_t *offset, uint8_t in
                 bbox = (BBox*) lwalloc(sizeof (BBox));
                 memcpy(bbox, buf, sizeof (BBox));
                 buf += sizeof (BBox);
+
+                //we read the count of the entry (it is only valid for aggregate R-trees)
+                memcpy(&count, buf, sizeof (uint32_t));
+                buf += sizeof (uint32_t);
             }
 
             ret->value.mod->entry = (void *) rentry_create(p, bbox);
+            ((REntry*) ret->value.mod->entry)->count = count;
         } else if (index_type == eFIND_HILBERT_RTREE_TYPE) {
             BBox *bbox;
             int p;
@@ -472,6 +548,10 @@ void efind_write_log_mod_node(const SpatialIndex *base, eFINDSpecification *spec
             //we write the bbox
             memcpy(loc, re->bbox, sizeof (BBox));
             loc += sizeof (BBox);
+
+            //we write the count (it is only valid for aggregate R-trees)
+            memcpy(loc, &(re->count), sizeof (uint32_t));
+            loc += sizeof (uint32_t);
         }
     } else if (index_type == eFIND_HILBERT_RTREE_TYPE) {
 
@@ -928,6 +1008,9 @@ void efind_compact_log(const SpatialIndex *base, eFINDSpecification * spec) {
     }
     efind_log_stack_destroy(stack, index_type);
 
+    //the pending entries of a group are written before the renaming of the log file
+    flush_log_group();
+
     //we remove the last version of the log file
     remove(old_log);
 
@@ -966,6 +1049,25 @@ void efind_compact_log(const SpatialIndex *base, eFINDSpecification * spec) {
 #endif
 }
 
+void efind_clean_log(eFINDSpecification *spec) {
+    //the pending entries of a group are discarded too
+    group_size = 0;
+    if (group_file != NULL) {
+        lwfree(group_file);
+        group_file = NULL;
+    }
+    //the log file is created again by the next write in the log
+    remove(spec->log_file);
+    spec->offset_last_elem_log = 0;
+    spec->size_last_elem_log = 0;
+    nof_flushing = 0;
+    min_nof_flushing = 1;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _cur_log_size = 0;
+#endif
+}
+
 void efind_recovery_log(const SpatialIndex *base, eFINDSpecification * spec) {
     int *flushed_nodes = NULL; //an auxiliary array
     int n_fn = 0; //the total elements in flushed_nodes
@@ -1076,6 +1178,9 @@ void efind_recovery_log(const SpatialIndex *base, eFINDSpecification * spec) {
     }
     efind_log_stack_destroy(stack, index_type);
 
+    //the pending entries of a group are written before the renaming of the log file
+    flush_log_group();
+
     //we remove the last version of the log file
     remove(old_log);
 
@@ -65,6 +65,13 @@ extern void efind_write_log_flush(const SpatialIndex *base, eFINDSpecification *
 
 extern void efind_compact_log(const SpatialIndex *base, eFINDSpecification *spec);
 extern void efind_recovery_log(const SpatialIndex *base, eFINDSpecification *spec);
+/*it removes all the entries of the log (e.g., after a bulk loading, whose nodes are directly written)*/
+extern void efind_clean_log(eFINDSpecification *spec);
+
+/*the entries written between these functions form a group, which is appended in the log by a single write
+ (e.g., the entries of a batch of operations)*/
+extern void efind_log_begin_group(void);
+extern void efind_log_end_group(void);
 
 #endif /* FASINF_LOG_H */
 
@@ -27,20 +27,41 @@
 
 #include "../main/statistical_processing.h" //for collection of statistical data
 
+/* the maximum number of heights handled by the read buffer (one LRU list per height) */
+#define RB_HLRU_MAX_LEVELS 64
+
 typedef struct ReadBufferHLRU {
     UT_hash_handle hh;
 
     int page_id; //the key
     void *node; //the entries of this node (e.g., RNode pointer or HilbertRNode)
     int height; //the height of this node, which determines if it is stored here or not
+
+    size_t size; //the size of this entry in the read buffer
+    uint64_t stamp; //the order of its last access, which compares entries of different heights
+    struct ReadBufferHLRU *prev_level; //the LRU list of the entries with the same height
+    struct ReadBufferHLRU *next_level;
 } ReadBufferHLRU;
 
+/* the LRU list of a height (head is the least recently used entry) and the sum of the sizes of its entries */
+typedef struct {
+    ReadBufferHLRU *head;
+    ReadBufferHLRU *tail;
+    size_t size;
+} ReadBufferHLRULevel;
+
 
 static ReadBufferHLRU *rb = NULL;
 static size_t efind_read_buffer_size = 0; //size in bytes of our read buffer
 
 static int tree_height = 0; //the current height of the index
 
+/* the entries are also linked by height, thus, the candidates for removal are found without traversing the whole buffer
+ * the hash keeps the global order of accesses */
+static ReadBufferHLRULevel levels[RB_HLRU_MAX_LEVELS];
+static uint64_t nonempty_levels = 0; //bitmap of the heights that have at least one entry
+static uint64_t rb_clock = 0;
+
 /***
  * common functions
  ***/
@@ -51,9 +72,99 @@ static void check_if_index_is_supported(uint8_t index_type) {
     }
 }
 
+/* it appends the entry as the most recently used entry of its height */
+static void efind_readbuffer_level_link(ReadBufferHLRU *entry) {
+    ReadBufferHLRULevel *l;
+
+    if (entry->height < 0 || entry->height >= RB_HLRU_MAX_LEVELS) {
+        _DEBUGF(ERROR, "The HLRU read buffer does not support nodes with height %d", entry->height);
+    }
+    l = &levels[entry->height];
+
+    entry->stamp = ++rb_clock;
+    entry->next_level = NULL;
+    entry->prev_level = l->tail;
+    if (l->tail != NULL)
+        l->tail->next_level = entry;
+    else
+        l->head = entry;
+    l->tail = entry;
+    l->size += entry->size;
+    nonempty_levels |= UINT64_C(1) << entry->height;
+}
+
+static void efind_readbuffer_level_unlink(ReadBufferHLRU *entry) {
+    ReadBufferHLRULevel *l = &levels[entry->height];
+
+    if (entry->prev_level != NULL)
+        entry->prev_level->next_level = entry->next_level;
+    else
+        l->head = entry->next_level;
+    if (entry->next_level != NULL)
+        entry->next_level->prev_level = entry->prev_level;
+    else
+        l->tail = entry->prev_level;
+    l->size -= entry->size;
+    if (l->head == NULL)
+        nonempty_levels &= ~(UINT64_C(1) << entry->height);
+}
+
+/* the heights that can be removed in order to store a node with the given height:
+ * the heights less than or equal to height and
+ * the heights greater than the tree_height (it eliminates previous removed root nodes) */
+static uint64_t efind_readbuffer_allowed_levels(int height) {
+    uint64_t allowed = 0;
+
+    if (height >= RB_HLRU_MAX_LEVELS - 1)
+        allowed = ~UINT64_C(0);
+    else if (height >= 0)
+        allowed = (UINT64_C(1) << (height + 1)) - 1;
+    if (tree_height < 0)
+        allowed = ~UINT64_C(0);
+    else if (tree_height < RB_HLRU_MAX_LEVELS - 1)
+        allowed |= ~((UINT64_C(1) << (tree_height + 1)) - 1);
+
+    return allowed & nonempty_levels;
+}
+
+/* the space that would be released by removing all the allowed entries, except the entry exclude (if any) */
+static size_t efind_readbuffer_allowed_space(int height, const ReadBufferHLRU *exclude) {
+    uint64_t allowed = efind_readbuffer_allowed_levels(height);
+    size_t space = 0;
+    int h;
+
+    for (h = 0; allowed != 0; h++, allowed >>= 1) {
+        if (allowed & 1)
+            space += levels[h].size;
+    }
+    if (exclude != NULL && (efind_readbuffer_allowed_levels(height) & (UINT64_C(1) << exclude->height)))
+        space -= exclude->size;
+    return space;
+}
+
+/* the least recently used entry among the allowed entries, except the entry exclude (if any) */
+static ReadBufferHLRU *efind_readbuffer_victim(int height, const ReadBufferHLRU *exclude) {
+    uint64_t allowed = efind_readbuffer_allowed_levels(height);
+    ReadBufferHLRU *victim = NULL;
+    ReadBufferHLRU *cand;
+    int h;
+
+    for (h = 0; allowed != 0; h++, allowed >>= 1) {
+        if (!(allowed & 1))
+            continue;
+        cand = levels[h].head;
+        if (cand == exclude)
+            cand = cand->next_level;
+        if (cand != NULL && (victim == NULL || cand->stamp < victim->stamp))
+            victim = cand;
+    }
+    return victim;
+}
+
 static void efind_readbuffer_remove_entry(ReadBufferHLRU *entry, UIPage *page) {
     //page and this points to the same RNode
     HASH_DEL(rb, entry);
+    efind_readbuffer_level_unlink(entry);
     efind_read_buffer_size -= (efind_pagehandler_get_size(page) + sizeof (int) + sizeof (int));
     efind_pagehandler_destroy(page);
     lwfree(entry);
@@ -95,6 +206,8 @@ UIPage *efind_readbuffer_hlru_get(const SpatialIndex *base,
         //this happens because ut_hash stores the entries in a doubled linked list
         HASH_DEL(rb, entry);
         HASH_ADD_INT(rb, page_id, entry);
+        efind_readbuffer_level_unlink(entry);
+        efind_readbuffer_level_link(entry);
 
         ret = efind_pagehandler_create_clone(entry->node, index_type);
 
@@ -145,7 +258,7 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
         const eFINDSpecification *spec, UIPage *page, int node_page,
         int height, bool mod) {
     if (spec->read_buffer_size > 0) {
-        ReadBufferHLRU *entry, *tmp_entry;
+        ReadBufferHLRU *entry;
         UIPage *this;
         int required_size;
         uint8_t index_type;
@@ -200,6 +313,9 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                     // remove it (so the subsequent add will throw it on the front of the list)
                     HASH_DEL(rb, entry);
                     HASH_ADD_INT(rb, page_id, entry);
+                    efind_readbuffer_level_unlink(entry);
+                    entry->size += diff_size;
+                    efind_readbuffer_level_link(entry);
 
                     efind_pagehandler_copy_page(this, page);
 
@@ -221,27 +337,18 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                      * removing the old entries with height less than or equal to the height of this entry and
                      * the old entries that have height greater than the tree_height (it eliminates previous removed root nodes)
                      * would be sufficient to store the new version of this page*/
-                    HASH_ITER(hh, rb, entry, tmp_entry) {
-                        if (height >= entry->height || entry->height > tree_height) {
-                            this = efind_pagehandler_create(entry->node, index_type);
-                            possible_new_space += (efind_pagehandler_get_size(this) + sizeof (int) + sizeof (int));
-                            lwfree(this);
-                        }
-                    }
+                    possible_new_space = efind_readbuffer_allowed_space(height, NULL);
 
                     //if we have enough size, then we made the changes
                     if (possible_new_space >= required_size) {
 
-                        HASH_ITER(hh, rb, entry, tmp_entry) {
-                            //we remove other entries until we have enough space
-                            if (spec->read_buffer_size >= (efind_read_buffer_size + required_size)) {
+                        //we remove the least recently used allowed entries until we have enough space
+                        while (spec->read_buffer_size < (efind_read_buffer_size + required_size)) {
+                            entry = efind_readbuffer_victim(height, NULL);
+                            if (entry == NULL)
                                 break;
-                            } else {
-                                if (height >= entry->height || entry->height > tree_height) {
-                                    this = efind_pagehandler_create(entry->node, index_type);
-                                    efind_readbuffer_remove_entry(entry, this);
-                                }
-                            }
+                            this = efind_pagehandler_create(entry->node, index_type);
+                            efind_readbuffer_remove_entry(entry, this);
                         }
 
                         //now we have space to put our entry!
@@ -250,6 +357,8 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                         entry->height = height;
                         entry->node = efind_pagehandler_get_clone(page);
                         HASH_ADD_INT(rb, page_id, entry);
+                        entry->size = required_size;
+                        efind_readbuffer_level_link(entry);
                         efind_read_buffer_size += required_size;
                     }
                 }
@@ -276,27 +385,18 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                  * removing the old entries with height less than or equal to the height of this entry and
                  * the old entries that have height greater than the tree_height (it eliminates previous removed root nodes)
                  * would be sufficient to store the new version of this page*/
-                HASH_ITER(hh, rb, entry, tmp_entry) {
-                    if (height >= entry->height || entry->height > tree_height) {
-                        this = efind_pagehandler_create(entry->node, index_type);
-                        possible_new_space += (efind_pagehandler_get_size(this) + sizeof (int) + sizeof (int));
-                        lwfree(this);
-                    }
-                }
+                possible_new_space = efind_readbuffer_allowed_space(height, NULL);
 
                 //if we have enough size, then we made the changes
                 if (possible_new_space >= required_size) {
 
-                    HASH_ITER(hh, rb, entry, tmp_entry) {
-                        //we remove other entries until we have enough space
-                        if (spec->read_buffer_size >= (efind_read_buffer_size + required_size)) {
+                    //we remove the least recently used allowed entries until we have enough space
+                    while (spec->read_buffer_size < (efind_read_buffer_size + required_size)) {
+                        entry = efind_readbuffer_victim(height, NULL);
+                        if (entry == NULL)
                             break;
-                        } else {
-                            if (height >= entry->height || entry->height > tree_height) {
-                                this = efind_pagehandler_create(entry->node, index_type);
-                                efind_readbuffer_remove_entry(entry, this);
-                            }
-                        }
+                        this = efind_pagehandler_create(entry->node, index_type);
+                        efind_readbuffer_remove_entry(entry, this);
                     }
 
                     //now we have space to put our entry!
@@ -305,6 +405,8 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                     entry->height = height;
                     entry->node = efind_pagehandler_get_clone(page);
                     HASH_ADD_INT(rb, page_id, entry);
+                    entry->size = required_size;
+                    efind_readbuffer_level_link(entry);
                     efind_read_buffer_size += required_size;
                 }
             } else {
@@ -316,6 +418,8 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
                 entry->height = height;
                 entry->node = efind_pagehandler_get_clone(page);
                 HASH_ADD_INT(rb, page_id, entry);
+                entry->size = required_size;
+                efind_readbuffer_level_link(entry);
                 efind_read_buffer_size += required_size;
             }
         }
@@ -334,7 +438,7 @@ void efind_readbuffer_hlru_put(const SpatialIndex *base,
 
 void efind_readbuffer_hlru_update_if_needed(const SpatialIndex* base,
         const eFINDSpecification *spec, int node_page, int height, UIPage *flushed) {
-    ReadBufferHLRU *entry, *entry1, *tmp_entry;
+    ReadBufferHLRU *entry, *entry1;
     int index_type;
     int required_size;
     UIPage *this;
@@ -374,6 +478,8 @@ void efind_readbuffer_hlru_update_if_needed(const SpatialIndex* base,
              */
             efind_pagehandler_copy_page(this, flushed);
             efind_read_buffer_size += required_size;
+            entry->size += required_size;
+            levels[entry->height].size += required_size;
 
             lwfree(this);
         } else {
@@ -389,29 +495,18 @@ void efind_readbuffer_hlru_update_if_needed(const SpatialIndex* base,
              * removing the old entries with height less than or equal to the height of this entry and
              * the old entries that have height greater than the tree_height (it eliminates previous removed root nodes)
              * would be sufficient to store the new version of this page*/
-            HASH_ITER(hh, rb, entry1, tmp_entry) {
-                if ((height >= entry1->height || entry1->height > tree_height) &&
-                        (entry1->page_id != entry->page_id)) {
-                    t2 = efind_pagehandler_create(entry1->node, index_type);
-                    possible_new_space += (efind_pagehandler_get_size(t2) + sizeof (int) + sizeof (int));
-                    lwfree(t2);
-                }
-            }
+            possible_new_space = efind_readbuffer_allowed_space(height, entry);
 
             //if we have enough size, then we made the changes
             if (possible_new_space >= required_size) {
 
-                HASH_ITER(hh, rb, entry1, tmp_entry) {
-                    //we remove other entries until we have enough space
-                    if (spec->read_buffer_size >= (efind_read_buffer_size + required_size)) {
+                //we remove the least recently used allowed entries until we have enough space
+                while (spec->read_buffer_size < (efind_read_buffer_size + required_size)) {
+                    entry1 = efind_readbuffer_victim(height, entry);
+                    if (entry1 == NULL)
                         break;
-                    } else {
-                        if ((height >= entry1->height || entry1->height > tree_height) &&
-                                (entry1->page_id != entry->page_id)) {
-                            t2 = efind_pagehandler_create(entry1->node, index_type);
-                            efind_readbuffer_remove_entry(entry1, t2);
-                        }
-                    }
+                    t2 = efind_pagehandler_create(entry1->node, index_type);
+                    efind_readbuffer_remove_entry(entry1, t2);
                 }
 
                 /*we perform the change 
@@ -421,6 +516,8 @@ void efind_readbuffer_hlru_update_if_needed(const SpatialIndex* base,
                  */
                 efind_pagehandler_copy_page(this, flushed);
                 efind_read_buffer_size += required_size;
+                entry->size += required_size;
+                levels[entry->height].size += required_size;
 
                 lwfree(this);
             } else {
@@ -69,6 +69,7 @@ static size_t size_of_new_node(void *rnode, uint8_t index_type);
 static size_t size_of_pointer_mod(void);
 static size_t size_of_hole_mod(void);
 static size_t size_of_hilbert_value_mod(void);
+static size_t size_of_count_mod(void);
 static size_t size_of_bbox_mod(BBox *bbox);
 static size_t size_of_del_node(void);
 
@@ -106,6 +107,11 @@ size_t size_of_hilbert_value_mod() {
     return sizeof (uint8_t) + sizeof (int) + sizeof (hilbert_value_t);
 }
 
+size_t size_of_count_mod() {
+    //size of type, position, count
+    return sizeof (uint8_t) + sizeof (int) + sizeof (uint32_t);
+}
+
 size_t size_of_bbox_mod(BBox *bbox) {
     if (bbox == NULL) {
         //size of type and position
@@ -662,6 +668,9 @@ void fb_put_mod_pointer(const SpatialIndex *base, FASTSpecification *fs,
                 //in this case we have to create a new entry
                 hilbertnode->entries.leaf[position] = (REntry*) lwalloc(sizeof (REntry));
                 hilbertnode->entries.leaf[position]->bbox = bbox_create();
+                hilbertnode->entries.leaf[position]->nofclips = 0;
+                hilbertnode->entries.leaf[position]->count = 0;
+                hilbertnode->entries.leaf[position]->clips = NULL;
                 hilbertnode->entries.leaf[position]->pointer = new_pointer;
             }
             //in this case we have created a new entry
@@ -834,6 +843,109 @@ void fb_put_mod_lhv(const SpatialIndex *base, FASTSpecification *fs,
 #endif
 }
 
+/*we put a new count In the buffer -> key equal to rnode_page and the value is MOD and a triple:
+ * (C, position, new_count)
+ if we already have a key equal to rnode_page, then we append this modification
+ IMPORTANT NOTE: this function is only valid for aggregate R-trees and R*-trees*/
+void fb_put_mod_count(const SpatialIndex *base, FASTSpecification *fs,
+        int node_page, uint32_t new_count, int position, int height) {
+    FASTBuffer *buf_entry;
+    size_t required_size = 0;
+    uint8_t index_type;
+
+    //we get the index type
+    index_type = spatialindex_get_type(base);
+    if (!(index_type == FAST_RTREE_TYPE || index_type == FAST_RSTARTREE_TYPE))
+        _DEBUGF(ERROR, "This functions should be only called for R-trees and R*-trees (%d)", index_type);
+
+    //is rnode_page already in the hash?
+    HASH_FIND_INT(fb, &node_page, buf_entry);
+
+    /*we firstly compute the size in order to know if
+     * it fits in our buffer or if we need to execute the flushing*/
+    if (buf_entry == NULL) {
+        required_size = size_of_new_hash_element() + size_of_count_mod();
+    } else {
+        if (buf_entry->status == FAST_STATUS_NEW) {
+            RNode *rnode;
+            rnode = (RNode *) buf_entry->value.fast_node;
+            if (position >= rnode->nofentries) {
+                /* this case is not allowed since it will put "holes" in a node */
+                _DEBUGF(ERROR, "fb_put_mod_count: invalid position (%d) "
+                        "to modify an element (number of elements %d)",
+                        position, rnode->nofentries);
+            }
+            //the count is only serialized for entries with a valid count (see rnode_size)
+            if (rnode->entries[position]->count == 0 && new_count > 0) {
+                required_size = sizeof (uint32_t);
+            }
+        } else if (buf_entry->status == FAST_STATUS_DEL) {
+            /* this case is not allowed since a removed page must be allocated 
+             * again as new node */
+            _DEBUG(ERROR, "fb_put_mod_count: it is not allowed to add a "
+                    "modification in a removed node. Use fb_put_new_rnode instead");
+        } else {
+            required_size = size_of_count_mod();
+        }
+    }
+
+    //if we do not have space, we execute the flushing
+    if (required_size > 0 && fs->buffer_size < (required_size + fast_buffer_size)) {
+        fast_execute_flushing(base, fs);
+
+        /*we have to execute again a search in the hash table 
+        since this node can be flushed by the flushing operation*/
+        HASH_FIND_INT(fb, &node_page, buf_entry);
+        /*we have to add the hashing key size if a new element will be created again*/
+        if (buf_entry == NULL) {
+            required_size = size_of_new_hash_element() + size_of_count_mod();
+        }
+    }
+
+    if (buf_entry == NULL) {
+        //in the negative case, we have to add a new entry
+        buf_entry = (FASTBuffer*) lwalloc(sizeof (FASTBuffer));
+        buf_entry->hash_key = node_page;
+        buf_entry->status = FAST_STATUS_MOD;
+        buf_entry->value.list = flm_init();
+        buf_entry->nofmod = 0;
+        buf_entry->node_height = height;
+        HASH_ADD_INT(fb, hash_key, buf_entry); //we add it 
+    }
+    buf_entry->nofmod++;
+    //if this node was created only in main memory, we modify it
+    if (buf_entry->status == FAST_STATUS_NEW) {
+        RNode *rnode;
+        rnode = (RNode *) buf_entry->value.fast_node;
+        rnode->entries[position]->count = new_count;
+    } else {
+        FASTModItem *flm_item;
+        flm_item = (FASTModItem*) lwalloc(sizeof (FASTModItem));
+        flm_item->type = FAST_ITEM_TYPE_C;
+        flm_item->position = position;
+        flm_item->value.count = new_count;
+
+        //we append the new count in the mod list
+        flm_append(buf_entry->value.list, flm_item);
+    }
+
+    //we increment the fast_buffer_size
+    fast_buffer_size += required_size;
+
+    //we also put this modification in the log
+    write_log_mod_count(base, fs, node_page, new_count, position, height);
+
+    //we modify its correspondingly flushing unit
+    fast_set_flushing_unit(fs, node_page);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _cur_mod_node_buffer_num++;
+    _mod_node_buffer_num++;
+
+    _cur_buffer_size = fast_buffer_size;
+#endif
+}
+
 /*we put a NULL pointer in the buffer -> key equal to rnode_page and the value is DEL and a value NULL*/
 void fb_del_node(const SpatialIndex *base, FASTSpecification *spec, int node_page, int height) {
     FASTBuffer *buf_entry;
@@ -900,6 +1012,8 @@ void fb_del_node(const SpatialIndex *base, FASTSpecification *spec, int node_pag
                     removed_size += size_of_pointer_mod();
                 } else if (item->type == FAST_ITEM_TYPE_L) {
                     removed_size += size_of_hilbert_value_mod();
+                } else if (item->type == FAST_ITEM_TYPE_C) {
+                    removed_size += size_of_count_mod();
                 } else {
                     removed_size += size_of_hole_mod();
                 }
@@ -1056,6 +1170,8 @@ void *fb_retrieve_node(const SpatialIndex *base, int node_page, int height) {
                     //here, we check if this modification refers to the pointer
                     if (item->type == FAST_ITEM_TYPE_P) {
                         rnode->entries[item->position]->pointer = item->value.pointer;
+                    } else if (item->type == FAST_ITEM_TYPE_C) {
+                        rnode->entries[item->position]->count = item->value.count;
                     } else {
                         //otherwise, we have to modify the BBOX of an entry
                         if (item->value.bbox == NULL) {
@@ -1138,6 +1254,9 @@ void *fb_retrieve_node(const SpatialIndex *base, int node_page, int height) {
                             }
                             hilbertnode->entries.leaf[item->position] = (REntry*) lwalloc(sizeof (REntry));
                             hilbertnode->entries.leaf[item->position]->bbox = bbox_create();
+                            hilbertnode->entries.leaf[item->position]->nofclips = 0;
+                            hilbertnode->entries.leaf[item->position]->count = 0;
+                            hilbertnode->entries.leaf[item->position]->clips = NULL;
                             hilbertnode->entries.leaf[item->position]->pointer = item->value.pointer;
                             hilbertnode->nofentries++;
                         } else if (item->type == FAST_ITEM_TYPE_L) {
@@ -1222,6 +1341,8 @@ void fb_free_hashvalue(int node_page, uint8_t index_type) {
                         removed_size += size_of_bbox_mod(item->value.bbox);
                     } else if (item->type == FAST_ITEM_TYPE_L) {
                         removed_size += size_of_hilbert_value_mod();
+                    } else if (item->type == FAST_ITEM_TYPE_C) {
+                        removed_size += size_of_count_mod();
                     } else if (item->type == FAST_ITEM_TYPE_P) {
                         removed_size += size_of_pointer_mod();
                     } else {
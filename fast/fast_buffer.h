@@ -42,6 +42,11 @@ extern void fb_put_mod_bbox(const SpatialIndex *base, FASTSpecification *spec,
  if we already have a key equal to rnode_page, then we append this modification*/
 extern void fb_put_mod_pointer(const SpatialIndex *base, FASTSpecification *spec, 
         int node_page, int new_pointer, int position, int height);
+/*we put a new count In the buffer -> key equal to rnode_page and the value is MOD and a triple:
+ * (C, position, new_count)
+ this is only used by aggregate R-trees, whose internal entries store the number of objects of their subtrees*/
+extern void fb_put_mod_count(const SpatialIndex *base, FASTSpecification *spec, 
+        int node_page, uint32_t new_count, int position, int height);
 /*we put a NULL pointer in the buffer -> key equal to node_page and the value is DEL and a value NULL*/
 extern void fb_del_node(const SpatialIndex *base, FASTSpecification *spec, 
         int node_page, int height);
@@ -30,18 +30,20 @@
 #define FAST_ITEM_TYPE_P    2
 #define FAST_ITEM_TYPE_L    3
 #define FAST_ITEM_TYPE_H    4 //for holes in hilbert nodes
+#define FAST_ITEM_TYPE_C    5 //for counts of entries of aggregate R-trees
 
 /*this is the struct of a item of the modification for the list of modification 
  * in the FAST buffer*/
 typedef struct {
     uint8_t type; //can be K, L or P (we group Pf and Pm in order to handle it better in the implementation) 
     //the value can be a BBOX (when type equal to k) or int (when type equal to P)
-    //or hilbert_value_t (when type equal to L)
+    //or hilbert_value_t (when type equal to L) or uint32_t (when type equal to C)
     int position; //the index of the modified entry in the rnode
     union {
         int pointer; //it is only a valid value if type is equal to P
         BBox *bbox; //it is only a valid value if type is equal to K
         hilbert_value_t lhv; //it is only a valid value if type is equal to L
+        uint32_t count; //it is only a valid value if type is equal to C
     } value;
 } FASTModItem;
 
@@ -117,6 +117,66 @@ static SpatialIndexResult *fastindex_search_ss(SpatialIndex *si, const LWGEOM *s
     }
 }
 
+/* only the R-tree and the R*-tree have a specialized point location */
+static SpatialIndexResult *fastindex_search_pt(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate) {
+    FASTIndex *fi = (void *) si;
+    if (fi->fast_type_index == FAST_RTREE_TYPE) {
+        FASTRTree *fr;
+        fr = fi->fast_index.fast_rtree;
+        rtree_set_fastspecification(fr->spec);
+        return spatialindex_point_location(&(fr->rtree->base), search_object, predicate);
+    } else if (fi->fast_type_index == FAST_RSTARTREE_TYPE) {
+        FASTRStarTree *fr;
+        fr = fi->fast_index.fast_rstartree;
+        rstartree_set_fastspecification(fr->spec);
+        return spatialindex_point_location(&(fr->rstartree->base), search_object, predicate);
+    } else {
+        _DEBUGF(ERROR, "Point location is not supported by the FAST index %d", fi->fast_type_index);
+        return NULL;
+    }
+}
+
+static SpatialIndexResult *fastindex_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    FASTIndex *fi = (void *) si;
+    if (fi->fast_type_index == FAST_RTREE_TYPE) {
+        FASTRTree *fr;
+        fr = fi->fast_index.fast_rtree;
+        rtree_set_fastspecification(fr->spec);
+        return spatialindex_distance_selection(&(fr->rtree->base), search_object, distance);
+    } else if (fi->fast_type_index == FAST_RSTARTREE_TYPE) {
+        FASTRStarTree *fr;
+        fr = fi->fast_index.fast_rstartree;
+        rstartree_set_fastspecification(fr->spec);
+        return spatialindex_distance_selection(&(fr->rstartree->base), search_object, distance);
+    } else if (fi->fast_type_index == FAST_HILBERT_RTREE_TYPE) {
+        FASTHilbertRTree *fr;
+        fr = fi->fast_index.fast_hilbertrtree;
+        hilbertrtree_set_fastspecification(fr->spec);
+        return spatialindex_distance_selection(&(fr->hilbertrtree->base), search_object, distance);
+    } else {
+        _DEBUGF(ERROR, "Unknown fast index %d", fi->fast_type_index);
+    }
+}
+
+/* only the R-tree and the R*-tree store aggregate counts */
+static SpatialIndexResult *fastindex_count_dw(SpatialIndex *si, const LWGEOM *search_object, double distance, uint64_t *nofobjects) {
+    FASTIndex *fi = (void *) si;
+    if (fi->fast_type_index == FAST_RTREE_TYPE) {
+        FASTRTree *fr;
+        fr = fi->fast_index.fast_rtree;
+        rtree_set_fastspecification(fr->spec);
+        return spatialindex_distance_count(&(fr->rtree->base), search_object, distance, nofobjects);
+    } else if (fi->fast_type_index == FAST_RSTARTREE_TYPE) {
+        FASTRStarTree *fr;
+        fr = fi->fast_index.fast_rstartree;
+        rstartree_set_fastspecification(fr->spec);
+        return spatialindex_distance_count(&(fr->rstartree->base), search_object, distance, nofobjects);
+    } else {
+        _DEBUGF(ERROR, "Aggregate counts are not supported by the FAST index %d", fi->fast_type_index);
+        return NULL;
+    }
+}
+
 static bool fastindex_header_writer(SpatialIndex *si, const char *file) {
     FASTIndex *fi = (void *) si;
     festival_header_writer(file, fi->fast_type_index, si);
@@ -157,8 +217,8 @@ SpatialIndex *fastrtree_empty_create(char *file, Source *src, GenericParameters
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {fastindex_get_type,
-        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss,
-        fastindex_header_writer, fastindex_destroy};
+        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss, fastindex_search_pt,
+        fastindex_search_dw, fastindex_count_dw, fastindex_header_writer, fastindex_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -200,8 +260,8 @@ SpatialIndex *fastrstartree_empty_create(char *file, Source *src, GenericParamet
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {fastindex_get_type,
-        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss,
-        fastindex_header_writer, fastindex_destroy};
+        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss, fastindex_search_pt,
+        fastindex_search_dw, fastindex_count_dw, fastindex_header_writer, fastindex_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -243,8 +303,8 @@ SpatialIndex *fasthilbertrtree_empty_create(char *file, Source *src, GenericPara
 
     /*define the general functions of the fast*/
     static const SpatialIndexInterface vtable = {fastindex_get_type,
-        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss,
-        fastindex_header_writer, fastindex_destroy};
+        fastindex_insert, fastindex_remove, fastindex_update, fastindex_search_ss, NULL,
+        fastindex_search_dw, NULL, fastindex_header_writer, fastindex_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -32,6 +32,18 @@
 uint8_t is_compacting = 0;
 
 static void raw_write_log(const char *file, uint8_t *buf, size_t bufsize);
+/*it writes the entries of the current group of the log (see fast_log_begin_group)*/
+static void flush_log_group(void);
+/*it appends a buffer in the log file*/
+static void raw_append_log(const char *file, uint8_t *buf, size_t bufsize);
+
+/* the entries of a group are kept in main memory and are appended in the log file by a single write
+ * the group is written before any read of the log since the compaction and the recovery read the log file*/
+static bool group_active = false;
+static char *group_file = NULL; //the log file of the pending entries
+static uint8_t *group_buf = NULL;
+static size_t group_size = 0;
+static size_t group_capacity = 0;
 static void raw_read_log(const char *file, size_t offset, uint8_t *buf, size_t bufsize);
 /*this function process the retrieved entry of the log 
  * it push in the redostack */
@@ -39,6 +51,60 @@ static void raw_read_log(const char *file, size_t offset, uint8_t *buf, size_t b
 static LogEntry *retrieve_log_entry(uint8_t *buf, size_t *offset, uint8_t index_type);
 
 void raw_write_log(const char* file, uint8_t *buf, size_t bufsize) {
+    if (!group_active) {
+        raw_append_log(file, buf, bufsize);
+        return;
+    }
+
+    //the pending entries belong to another log file (e.g., during a compaction)
+    if (group_file != NULL && strcmp(group_file, file) != 0)
+        flush_log_group();
+
+    if (group_size + bufsize > group_capacity) {
+        group_capacity = (group_size + bufsize > 2 * group_capacity) ? group_size + bufsize : 2 * group_capacity;
+        if (group_buf == NULL)
+            group_buf = (uint8_t*) lwalloc(group_capacity);
+        else
+            group_buf = (uint8_t*) lwrealloc(group_buf, group_capacity);
+    }
+    memcpy(group_buf + group_size, buf, bufsize);
+    group_size += bufsize;
+
+    if (group_file == NULL) {
+        group_file = (char*) lwalloc(strlen(file) + 1);
+        strcpy(group_file, file);
+    }
+}
+
+void flush_log_group() {
+    size_t size = group_size;
+
+    //the entries are discarded before the write, so that a failed write does not keep them for the next group
+    group_size = 0;
+    if (size > 0)
+        raw_append_log(group_file, group_buf, size);
+    if (group_file != NULL) {
+        lwfree(group_file);
+        group_file = NULL;
+    }
+}
+
+void fast_log_begin_group() {
+    group_active = true;
+}
+
+void fast_log_end_group() {
+    //the group is closed even if its write raises an error
+    group_active = false;
+    flush_log_group();
+    if (group_buf != NULL) {
+        lwfree(group_buf);
+        group_buf = NULL;
+        group_capacity = 0;
+    }
+}
+
+void raw_append_log(const char* file, uint8_t *buf, size_t bufsize) {
     int f;
     size_t written;
     if ((f = open(file, O_CREAT | O_WRONLY | O_APPEND, S_IRUSR | S_IWUSR)) < 0) {
@@ -58,6 +124,10 @@ void raw_write_log(const char* file, uint8_t *buf, size_t bufsize) {
 void raw_read_log(const char* file, size_t offset, uint8_t *buf, size_t bufsize) {
     int f;
     size_t read_size;
+
+    //the pending entries of a group must be in the log file
+    if (group_size > 0)
+        flush_log_group();
     if ((f = open(file, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR)) < 0) {
         _DEBUGF(ERROR, "It was impossible to open the \'%s\'. ", file);
         return;
@@ -103,6 +173,7 @@ void log_entry_free(LogEntry* le, uint8_t index_type) {
 static size_t size_of_new_node(void * node, uint8_t index_type);
 static size_t size_of_pointer_mod(void);
 static size_t size_of_lhv_mod(void); //only for Hilbert R-trees
+static size_t size_of_count_mod(void); //only for aggregate R-trees
 static size_t size_of_bbox_mod(BBox *bbox);
 static size_t size_of_del_node(void);
 static size_t size_of_hole_mod(void);
@@ -172,6 +243,17 @@ size_t size_of_lhv_mod() {
     return bufsize;
 }
 
+size_t size_of_count_mod() {
+    size_t bufsize;
+    //the size of previous element in the log file and the type of modification
+    bufsize = sizeof (size_t) + sizeof (uint8_t);
+    //size of the node_page, type of the modification, position, the new count
+    bufsize += sizeof (int) + sizeof (uint8_t) + sizeof (uint32_t) + sizeof (uint32_t);
+    //size of the node height
+    bufsize += sizeof (int);
+    return bufsize;
+}
+
 size_t size_of_del_node() {
     size_t bufsize;
     //the size of previous element in the log file and the type of modification
@@ -220,22 +302,38 @@ LogEntry * retrieve_log_entry(uint8_t *buf, size_t * offset, uint8_t index_type)
 
         if (index_type == FAST_RTREE_TYPE || index_type == FAST_RSTARTREE_TYPE) {
             RNode *rnode = rnode_create_empty();
+            bool with_counts = false;
 
             memcpy(&n, buf, sizeof (uint32_t));
             buf += sizeof (uint32_t);
 
+            /* nodes of aggregate R-trees also store the counts of their entries (see rnode_serialize)
+             * note that clip points are never stored here since they are not maintained by FAST indices */
+            if (n & RNODE_AGGREGATE_FLAG) {
+                with_counts = true;
+                n &= ~RNODE_AGGREGATE_FLAG;
+            }
+
             rnode->nofentries = n;
             rnode->entries = (REntry**) lwalloc(sizeof (REntry*) * n);
 
             for (i = 0; i < n; i++) {
                 rnode->entries[i] = (REntry*) lwalloc(sizeof (REntry));
                 rnode->entries[i]->bbox = (BBox*) lwalloc(sizeof (BBox));
+                rnode->entries[i]->nofclips = 0;
+                rnode->entries[i]->count = 0;
+                rnode->entries[i]->clips = NULL;
 
                 memcpy(&(rnode->entries[i]->pointer), buf, sizeof (uint32_t));
                 buf += sizeof (uint32_t);
 
                 memcpy(rnode->entries[i]->bbox, buf, sizeof (BBox));
                 buf += sizeof (BBox);
+
+                if (with_counts) {
+                    memcpy(&(rnode->entries[i]->count), buf, sizeof (uint32_t));
+                    buf += sizeof (uint32_t);
+                }
             }
             ret->value.node = (void *) rnode;
         } else if (index_type == FAST_HILBERT_RTREE_TYPE) {
@@ -269,6 +367,9 @@ LogEntry * retrieve_log_entry(uint8_t *buf, size_t * offset, uint8_t index_type)
                 for (i = 0; i < n; i++) {
                     hilbertnode->entries.leaf[i] = (REntry*) lwalloc(sizeof (REntry));
                     hilbertnode->entries.leaf[i]->bbox = (BBox*) lwalloc(sizeof (BBox));
+                    hilbertnode->entries.leaf[i]->nofclips = 0;
+                    hilbertnode->entries.leaf[i]->count = 0;
+                    hilbertnode->entries.leaf[i]->clips = NULL;
 
                     memcpy(&(hilbertnode->entries.leaf[i]->pointer), buf, sizeof (uint32_t));
                     buf += sizeof (uint32_t);
@@ -315,6 +416,9 @@ LogEntry * retrieve_log_entry(uint8_t *buf, size_t * offset, uint8_t index_type)
         } else if (ret->value.mod->type == FAST_ITEM_TYPE_L) {
             memcpy(&(ret->value.mod->value.lhv), buf, sizeof (hilbert_value_t));
             buf += sizeof (hilbert_value_t);
+        } else if (ret->value.mod->type == FAST_ITEM_TYPE_C) {
+            memcpy(&(ret->value.mod->value.count), buf, sizeof (uint32_t));
+            buf += sizeof (uint32_t);
         } else if (ret->value.mod->type != FAST_ITEM_TYPE_H) {
             _DEBUGF(ERROR, "Unknown type of modification (%d) at log entry", ret->value.mod->type);
             return NULL;
@@ -687,6 +791,82 @@ void write_log_mod_lhv(const SpatialIndex *base, FASTSpecification *spec,
 #endif
 }
 
+void write_log_mod_count(const SpatialIndex *base, FASTSpecification *spec,
+        int node_page, uint32_t new_count, int position, int height) {
+    uint8_t *loc;
+    uint8_t *buf;
+    size_t bufsize;
+    uint8_t tm = FAST_ITEM_TYPE_C;
+    uint8_t t = FAST_STATUS_MOD;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    bufsize = size_of_count_mod();
+
+    //if we our log does not have space, we need to compact it
+    if (spec->offset_last_elem_log + spec->size_last_elem_log + bufsize > spec->log_size) {
+        compact_fast_log(base, spec);
+    }
+
+    buf = (uint8_t*) lwalloc(bufsize);
+
+    loc = buf;
+
+    //now we have to serialize the offset of the previous element
+    memcpy(loc, &(spec->offset_last_elem_log), sizeof (size_t));
+    loc += sizeof (size_t);
+
+    //now we serialize the type of modification
+    memcpy(loc, &t, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    //now we serialize the identifier of the node
+    memcpy(loc, &node_page, sizeof (int));
+    loc += sizeof (int);
+
+    //now we serialize the height of the node
+    memcpy(loc, &height, sizeof (int));
+    loc += sizeof (int);
+
+    //now we serialize the type of modification (p or k or l or c)
+    memcpy(loc, &tm, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    /* now we have to serialize the position*/
+    memcpy(loc, &position, sizeof (uint32_t));
+    loc += sizeof (uint32_t);
+
+    /* now we have to serialize the count*/
+    memcpy(loc, &new_count, sizeof (uint32_t));
+    loc += sizeof (uint32_t);
+
+    //we sequentially write it
+    raw_write_log(spec->log_file, buf, bufsize);
+    //we update the information
+    spec->offset_last_elem_log += spec->size_last_elem_log;
+    spec->size_last_elem_log = bufsize;
+
+    lwfree(buf);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _cur_log_size = spec->offset_last_elem_log + spec->size_last_elem_log;
+
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _write_log_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _write_log_time += get_elapsed_time(start, end);
+#endif
+}
+
 void write_log_mod_hole(const SpatialIndex *base, FASTSpecification *spec,
         int node_page, int position, int height) {
     uint8_t *loc;
@@ -1021,6 +1201,9 @@ void compact_fast_log(const SpatialIndex *base, FASTSpecification * spec) {
             } else if (le->value.mod->type == FAST_ITEM_TYPE_L) {
                 write_log_mod_lhv(base, spec, le->node_page, le->value.mod->value.lhv,
                         le->value.mod->position, le->node_height);
+            } else if (le->value.mod->type == FAST_ITEM_TYPE_C) {
+                write_log_mod_count(base, spec, le->node_page, le->value.mod->value.count,
+                        le->value.mod->position, le->node_height);
             } else if (le->value.mod->type == FAST_ITEM_TYPE_H) {
                 write_log_mod_hole(base, spec, le->node_page, le->value.mod->position, le->node_height);
             }
@@ -1029,6 +1212,9 @@ void compact_fast_log(const SpatialIndex *base, FASTSpecification * spec) {
     }
     redostack_destroy(stack, index_type);
 
+    //the pending entries of a group are written before the renaming of the log file
+    flush_log_group();
+
     //we remove the last version of the log file
     remove(old_log);
 
@@ -1050,6 +1236,23 @@ void compact_fast_log(const SpatialIndex *base, FASTSpecification * spec) {
 #endif
 }
 
+void clean_fast_log(FASTSpecification *spec) {
+    //the pending entries of a group are discarded too
+    group_size = 0;
+    if (group_file != NULL) {
+        lwfree(group_file);
+        group_file = NULL;
+    }
+    //the log file is created again by the next write in the log
+    remove(spec->log_file);
+    spec->offset_last_elem_log = 0;
+    spec->size_last_elem_log = 0;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _cur_log_size = 0;
+#endif
+}
+
 void recovery_fast_log(const SpatialIndex *base, FASTSpecification * spec) {
     int *flushed_nodes = NULL; //an auxiliary array
     int n_fn = 0; //the total elements in flushed_nodes
@@ -1166,6 +1369,9 @@ void recovery_fast_log(const SpatialIndex *base, FASTSpecification * spec) {
             } else if (le->value.mod->type == FAST_ITEM_TYPE_L) {
                 fb_put_mod_lhv(base, spec, le->node_page,
                         le->value.mod->value.lhv, le->value.mod->position, le->node_height);
+            } else if (le->value.mod->type == FAST_ITEM_TYPE_C) {
+                fb_put_mod_count(base, spec, le->node_page,
+                        le->value.mod->value.count, le->value.mod->position, le->node_height);
             } else if (le->value.mod->type == FAST_ITEM_TYPE_H) {
                 fb_put_mod_hole(base, spec, le->node_page, le->value.mod->position, le->node_height);
             }
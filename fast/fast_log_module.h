@@ -34,6 +34,7 @@ typedef struct {
         int pointer; //only if type is equal to P
         BBox *bbox; //only if type is equal to K
         hilbert_value_t lhv;
+        uint32_t count; //only if type is equal to C
     } value;
 } LogMOD;
 
@@ -65,6 +66,8 @@ extern void write_log_mod_pointer(const SpatialIndex *base, FASTSpecification *s
         int node_page, int new_pointer, int position, int height);
 extern void write_log_mod_lhv(const SpatialIndex *base, FASTSpecification *spec, 
         int node_page, hilbert_value_t new_lhv, int position, int height);
+extern void write_log_mod_count(const SpatialIndex *base, FASTSpecification *spec, 
+        int node_page, uint32_t new_count, int position, int height);
 extern void write_log_mod_hole(const SpatialIndex *base, FASTSpecification *spec,
         int node_page, int position, int height);
 extern void write_log_del_node(const SpatialIndex *base, FASTSpecification *spec, 
@@ -74,6 +77,13 @@ extern void write_log_flush(const SpatialIndex *base, FASTSpecification *spec, i
 
 extern void compact_fast_log(const SpatialIndex *base, FASTSpecification *spec);
 extern void recovery_fast_log(const SpatialIndex *base, FASTSpecification *spec);
+/*it removes all the entries of the log (e.g., after a bulk loading, whose nodes are directly written)*/
+extern void clean_fast_log(FASTSpecification *spec);
+
+/*the entries written between these functions form a group, which is appended in the log by a single write
+ (e.g., the entries of a batch of operations)*/
+extern void fast_log_begin_group(void);
+extern void fast_log_end_group(void);
 
 extern void log_entry_free(LogEntry *le, uint8_t index_type);
 
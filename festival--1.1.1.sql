@@ -102,7 +102,7 @@ CREATE TABLE fds.FlashDBSimConfiguration (
 
 CREATE TABLE fds.BufferConfiguration (
   buf_id INTEGER NOT NULL,
-  buf_type VARCHAR NOT NULL CHECK (upper(buf_type) IN ('NONE', 'LRU', 'HLRU') OR upper(buf_type) LIKE 'S2Q%' OR upper(buf_type) LIKE '2Q%'),
+  buf_type VARCHAR NOT NULL CHECK (upper(buf_type) IN ('NONE', 'LRU', 'HLRU', 'ARC', 'CLOCKPRO', 'SHARED') OR upper(buf_type) LIKE 'CFLRU%' OR upper(buf_type) LIKE 'S2Q%' OR upper(buf_type) LIKE '2Q%'),
   buf_size INTEGER NOT NULL CHECK (buf_size >= 0),
   PRIMARY KEY(buf_id)
 );
@@ -183,6 +183,9 @@ CREATE TABLE fds.RStarTreeConfiguration (
   reinsertion_perc_leaf_node DOUBLE PRECISION NOT NULL CHECK (reinsertion_perc_leaf_node >= 0),
   reinsertion_type VARCHAR NOT NULL CHECK (upper(reinsertion_type) IN ('FAR REINSERT', 'CLOSE REINSERT')),
   max_neighbors_exam INTEGER NOT NULL,
+  clip_points INTEGER NOT NULL DEFAULT 0 CHECK (clip_points BETWEEN 0 AND 4),
+  aggregate BOOLEAN NOT NULL DEFAULT FALSE,
+  leaf_hint BOOLEAN NOT NULL DEFAULT FALSE,
   PRIMARY KEY(sc_id),
   FOREIGN KEY(sc_id)
     REFERENCES fds.SpecializedConfiguration(sc_id)
@@ -213,6 +216,9 @@ CREATE TABLE fds.RTreeConfiguration (
   sc_id INTEGER NOT NULL,
   or_id INTEGER NOT NULL,
   split_type VARCHAR NOT NULL CHECK (upper(split_type) IN ('EXPONENTIAL', 'LINEAR', 'QUADRATIC', 'RSTARTREE SPLIT', 'GREENE SPLIT', 'ANGTAN SPLIT')),
+  clip_points INTEGER NOT NULL DEFAULT 0 CHECK (clip_points BETWEEN 0 AND 4),
+  aggregate BOOLEAN NOT NULL DEFAULT FALSE,
+  leaf_hint BOOLEAN NOT NULL DEFAULT FALSE,
   PRIMARY KEY(sc_id),
   FOREIGN KEY(sc_id)
     REFERENCES fds.SpecializedConfiguration(sc_id)
@@ -345,6 +351,17 @@ CREATE TABLE fds.Execution (
   efind_write_tc_stride INTEGER NULL,
   efind_write_tc_seqstride INTEGER NULL,
   efind_write_tc_filled INTEGER NULL,
+  sort_time NUMERIC NULL,
+  sort_cpu_time NUMERIC NULL,
+  sort_runs_num INTEGER NULL,
+  batch_num INTEGER NULL,
+  batch_op_num INTEGER NULL,
+  leaf_hint_num INTEGER NULL,
+  sbuffer_page_num INTEGER NULL,
+  sbuffer_ghost_hit INTEGER NULL,
+  sbuffer_written_pages INTEGER NULL,
+  sbuffer_write_runs INTEGER NULL,
+  sbuffer_bg_write_num INTEGER NULL,
   PRIMARY KEY(pe_id),
   FOREIGN KEY(idx_id)
     REFERENCES fds.SpatialIndex(idx_id)
@@ -489,21 +506,164 @@ $$
 $$ 
 LANGUAGE SQL;
 
+------------------------------------------------------------------
+-------------------------- BULK LOADING AN INDEX -----------------
+------------------------------------------------------------------
+--it builds an empty index from all the objects of its source by using the Sort-Tile-Recursive (STR) packing
+--(or the Hilbert packing for Hilbert R-trees)
+--fill_factor (0 < fill_factor <= 1) is the percentage of the maximum number of entries stored in each node
+--it is available for all the indices (index_id from 1 to 10). The flash-aware indices (FAST, FOR-tree, and eFIND)
+--write their packed nodes in sequential extents aligned to their flushing units, and start with an empty write buffer and a clean log
+--the Hilbert R-trees sort their objects by using an external sort, which uses at most sort_memory kB of main memory
+--and merges at most sort_fan_in runs at once (its runs are stored in temporary files in the directory of the index)
+--the R-tree and R*-tree sort and pack their leaf nodes by using nofthreads threads (the nodes are still written sequentially)
+CREATE OR REPLACE FUNCTION FT_BulkLoad(index_name text, index_path text, fill_factor float8 default 1.0, sort_memory int4 default 262144, sort_fan_in int4 default 64, nofthreads int4 default 1)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_bulk_load'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_BulkLoad(absolute_path text, fill_factor float8 default 1.0, sort_memory int4 default 262144, sort_fan_in int4 default 64, nofthreads int4 default 1)
+	RETURNS bool AS
+$$
+	SELECT FT_BulkLoad(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	fill_factor, sort_memory, sort_fan_in, nofthreads)
+$$ 
+LANGUAGE SQL;
+
+------------------------------------------------------------------
+-------------------------- BUILDING AN INDEX FROM A SOURCE -------
+------------------------------------------------------------------
+--it inserts all the objects of a source (src_id of fds.source) into an index, one by one, by using its insertion algorithm
+--the source is read in the order of its primary key by cursors with keyset pagination, and the index is obtained only once
+--a notice is reported after each progress_interval inserted objects (0 means no report)
+CREATE OR REPLACE FUNCTION FT_BuildFromSource(index_name text, index_path text, src_id int4, progress_interval int4 default 0)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_build_from_source'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_BuildFromSource(absolute_path text, src_id int4, progress_interval int4 default 0)
+	RETURNS bool AS
+$$
+	SELECT FT_BuildFromSource(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	src_id, progress_interval)
+$$ 
+LANGUAGE SQL;
+
+--the same of the previous one, but for several indices (absolute paths), which are fed by a single scan of the source
+--the statistical data of each index is collected in its own statistic context (see FT_UseStatisticContext)
+CREATE OR REPLACE FUNCTION FT_BuildFromSource(absolute_paths text[], src_id int4, progress_interval int4 default 0)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_build_many_from_source'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+------------------------------------------------------------------
+-------------------------- BATCH OPERATIONS ----------------------
+------------------------------------------------------------------
+--the elements of pointers and geoms (with the same length) form the entries of the batch, and the index is obtained only once
+--if sort is true, the operations are applied in the order of the hilbert values of the bboxes of the geometries
+--for FAST and eFIND indices, the log entries of the batch are written as a single group
+CREATE OR REPLACE FUNCTION FT_InsertBatch(index_name text, index_path text, pointers int4[], geoms geometry[], sort bool default true)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_insert_batch'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_InsertBatch(absolute_path text, pointers int4[], geoms geometry[], sort bool default true)
+	RETURNS bool AS
+$$
+	SELECT FT_InsertBatch(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	pointers, geoms, sort)
+$$ 
+LANGUAGE SQL;
+
+CREATE OR REPLACE FUNCTION FT_DeleteBatch(index_name text, index_path text, pointers int4[], geoms geometry[], sort bool default true)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_remove_batch'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_DeleteBatch(absolute_path text, pointers int4[], geoms geometry[], sort bool default true)
+	RETURNS bool AS
+$$
+	SELECT FT_DeleteBatch(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	pointers, geoms, sort)
+$$ 
+LANGUAGE SQL;
+
+--the updates are sorted by their old geometries
+CREATE OR REPLACE FUNCTION FT_UpdateBatch(index_name text, index_path text, old_pointers int4[], old_geoms geometry[], new_pointers int4[], new_geoms geometry[], sort bool default true)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_update_batch'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_UpdateBatch(absolute_path text, old_pointers int4[], old_geoms geometry[], new_pointers int4[], new_geoms geometry[], sort bool default true)
+	RETURNS bool AS
+$$
+	SELECT FT_UpdateBatch(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	old_pointers, old_geoms, new_pointers, new_geoms, sort)
+$$ 
+LANGUAGE SQL;
+
+--it removes all the indexed objects whose bboxes are inside the bbox of region by traversing the index once
+--the subtrees inside the region are removed as a whole, only the nodes in its boundary are modified
+--it is supported by R-trees and R*-trees (conventional, FAST, and eFIND)
+CREATE OR REPLACE FUNCTION FT_DeleteRegion(index_name text, index_path text, region geometry)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_remove_region'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_DeleteRegion(absolute_path text, region geometry)
+	RETURNS bool AS
+$$
+	SELECT FT_DeleteRegion(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	region)
+$$ 
+LANGUAGE SQL;
+
 ------------------------------------------------------------------
 -------------------------- QUERYING AN INDEX ---------------------
 ------------------------------------------------------------------
 --processing option = 1 means that the refinement and filter step will be processed. processing option = 2 means that only the filter step will be processed
-CREATE OR REPLACE FUNCTION FT_QuerySpatialIndex(index_name text, index_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1)
+--distance is only considered by distance range queries (type_query = 4)
+CREATE OR REPLACE FUNCTION FT_QuerySpatialIndex(index_name text, index_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, distance float8 default 0)
 	RETURNS SETOF __query_result
 	AS 'MODULE_PATHNAME', 'STI_query_spatial_index'
 	LANGUAGE 'c' VOLATILE STRICT;
 
-CREATE OR REPLACE FUNCTION FT_QuerySpatialIndex(absolute_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1)
+CREATE OR REPLACE FUNCTION FT_QuerySpatialIndex(absolute_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, distance float8 default 0)
 	RETURNS SETOF __query_result AS
 $$
 	SELECT FT_QuerySpatialIndex(REGEXP_REPLACE(absolute_path, '.*/', ''), 
 	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
-	type_query, obj, predicate, processing_option)
+	type_query, obj, predicate, processing_option, distance)
+$$ 
+LANGUAGE SQL;
+
+--this function sets the number of threads of the filter step of the range queries (1 means the sequential search, default)
+--only conventional R-trees and R*-trees stored in HDDs and SSDs employ the threads
+CREATE OR REPLACE FUNCTION FT_SetParallelSearch(nofthreads int4)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_set_parallel_search'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+--it returns the number of indexed objects within the distance of obj (distance = 0 means that the objects intersect obj)
+--aggregate R-trees and R*-trees (aggregate = true in their configuration) answer it by using the counts stored in their internal nodes
+--processing option = 2 returns an upper bound, since the candidates of the filter step are not refined
+CREATE OR REPLACE FUNCTION FT_CountSpatialIndex(index_name text, index_path text, obj geometry, processing_option int4 default 1, distance float8 default 0)
+	RETURNS int8
+	AS 'MODULE_PATHNAME', 'STI_count_spatial_index'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+CREATE OR REPLACE FUNCTION FT_CountSpatialIndex(absolute_path text, obj geometry, processing_option int4 default 1, distance float8 default 0)
+	RETURNS int8 AS
+$$
+	SELECT FT_CountSpatialIndex(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), 
+	obj, processing_option, distance)
 $$ 
 LANGUAGE SQL;
 
@@ -525,6 +685,28 @@ CREATE OR REPLACE FUNCTION FT_ApplyAllModificationsFromBuffer(index_name text, i
 	AS 'MODULE_PATHNAME', 'STI_finish_buffer'
 	LANGUAGE 'c' VOLATILE STRICT;
 
+--this function enables the background writer of the standard buffer (only for LRU on HDDs and SSDs)
+--a thread writes the modified pages ahead of their eviction in order to keep clean_perc% of the buffer clean
+--0 disables it. It is applied to the buffer created after the next FT_ApplyAllModificationsFromBuffer
+--the other buffers ignore it (a warning is raised)
+CREATE OR REPLACE FUNCTION FT_SetBackgroundWriter(clean_perc float8)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_set_background_writer'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+--this function saves the identifiers of the pages stored in the standard buffer in a file next to the header of the index
+--if auto_prewarm is true, these pages are automatically loaded in the first access to the index by a new connection
+CREATE OR REPLACE FUNCTION FT_SaveBufferState(index_name text, index_path text, auto_prewarm bool default false)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_save_buffer_state'
+	LANGUAGE 'c' VOLATILE STRICT;
+
+--this function loads the pages saved by FT_SaveBufferState in the standard buffer, returning the number of loaded pages
+CREATE OR REPLACE FUNCTION FT_PrewarmBuffer(index_name text, index_path text)
+	RETURNS int4
+	AS 'MODULE_PATHNAME', 'STI_prewarm_buffer'
+	LANGUAGE 'c' VOLATILE STRICT;
+
 CREATE OR REPLACE FUNCTION FT_ApplyAllModificationsForFAI(absolute_path text)
 	RETURNS bool AS
 $$
@@ -541,6 +723,22 @@ $$
 $$ 
 LANGUAGE SQL;
 
+CREATE OR REPLACE FUNCTION FT_SaveBufferState(absolute_path text, auto_prewarm bool default false)
+	RETURNS bool AS
+$$
+	SELECT FT_SaveBufferState(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1), auto_prewarm)
+$$ 
+LANGUAGE SQL;
+
+CREATE OR REPLACE FUNCTION FT_PrewarmBuffer(absolute_path text)
+	RETURNS int4 AS
+$$
+	SELECT FT_PrewarmBuffer(REGEXP_REPLACE(absolute_path, '.*/', ''), 
+	substr(absolute_path, 0, char_length(absolute_path) - char_length(REGEXP_REPLACE(absolute_path, '.*/', '')) + 1))
+$$ 
+LANGUAGE SQL;
+
 ----------------------------------------------------------------------------------------------
 ----------------------------- AUXILIARY OPERATIONS -------------------------------------------
 ----------------------------------------------------------------------------------------------
@@ -560,6 +758,14 @@ CREATE OR REPLACE FUNCTION FT_CollectOrderOfReadWrite()
 	LANGUAGE 'c' VOLATILE STRICT;
 
 --return the execution_id generated
+--it activates the statistic context of an index (absolute_path), which keeps its statistical data apart from the other indices
+--all the statistical data collected from now on refers to this context (e.g., the one stored by FT_StoreStatisticalData)
+--NULL activates the default context. FT_StartCollectStatistics removes all the contexts
+CREATE OR REPLACE FUNCTION FT_UseStatisticContext(absolute_path text default NULL)
+	RETURNS bool
+	AS 'MODULE_PATHNAME', 'STI_use_statistic_context'
+	LANGUAGE 'c' VOLATILE;
+
 CREATE OR REPLACE FUNCTION FT_StoreStatisticalData(absolute_path text, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
 	RETURNS int4 AS
 $$
@@ -654,14 +860,14 @@ $BODY$
 -------------------------- QUERYING AN INDEX AS AN ATOMIC OPERATION ---------------------
 -----------------------------------------------------------------------------------------
 
-CREATE OR REPLACE FUNCTION FT_AQuerySpatialIndex(index_name text, index_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
+CREATE OR REPLACE FUNCTION FT_AQuerySpatialIndex(index_name text, index_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL, distance float8 default 0)
 	RETURNS SETOF __query_result AS
 $BODY$
 BEGIN
 	--we start to collect the statistical data of the related index
 	PERFORM FT_StartCollectStatistics();
 	--we perform the spatial query
-	RETURN QUERY SELECT * FROM FT_QuerySpatialIndex(index_name, index_path, type_query, obj, predicate, processing_option);
+	RETURN QUERY SELECT * FROM FT_QuerySpatialIndex(index_name, index_path, type_query, obj, predicate, processing_option, distance);
 	--we collect and store all the statistical data related to the spatial index creation
 	PERFORM FT_StoreStatisticalData(index_name, index_path, statistic_options, location_statistics, file_statistics);
 	
@@ -671,14 +877,14 @@ $BODY$
   LANGUAGE plpgsql VOLATILE
   COST 100;
 
-CREATE OR REPLACE FUNCTION FT_AQuerySpatialIndex(absolute_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
+CREATE OR REPLACE FUNCTION FT_AQuerySpatialIndex(absolute_path text, type_query int4, obj geometry, predicate int4, processing_option int4 default 1, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL, distance float8 default 0)
 	RETURNS SETOF __query_result AS
 $BODY$
 BEGIN
 	--we start to collect the statistical data of the related index
 	PERFORM FT_StartCollectStatistics();
 	--we perform the spatial query
-	RETURN QUERY SELECT * FROM FT_QuerySpatialIndex(absolute_path, type_query, obj, predicate, processing_option);
+	RETURN QUERY SELECT * FROM FT_QuerySpatialIndex(absolute_path, type_query, obj, predicate, processing_option, distance);
 	--we collect and store all the statistical data related to the spatial index creation
 	PERFORM FT_StoreStatisticalData(absolute_path, statistic_options, location_statistics, file_statistics);
 	
@@ -800,47 +1006,15 @@ $BODY$
 CREATE OR REPLACE FUNCTION FT_CreateSpatialIndex(index_id int4, absolute_path text, src_id int4, bc_id int4, sc_id int4, buf_id int4, apply_fai bool default false, apply_stdbuffer bool default false, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
 	RETURNS bool AS 
 $BODY$
-DECLARE
-	src REFCURSOR;
-	i INTEGER;
-	sch VARCHAR;
-	tab VARCHAR;
-	colu VARCHAR;
-	pk VARCHAR;	
-	total INTEGER := 0;	
-	rec RECORD;	
 BEGIN
-	EXECUTE 'SELECT schema_name, table_name, column_name, pk_name FROM fds.source WHERE src_id = $1'
-		INTO sch, tab, colu, pk 
-		USING src_id;
-
-	--TODO checking if the parameters really exist in the FESTIval's data schema
-	
-	EXECUTE 'SELECT count(*) from ' || sch || '.' || tab 
-		INTO total;	
-
 	--we start to collect the statistical data of the related index
 	PERFORM FT_StartCollectStatistics();
 
 	--we create the empty new index
 	PERFORM FT_CreateEmptySpatialIndex(index_id, absolute_path, src_id, bc_id, sc_id, buf_id);
 
-	i := 0;
-	WHILE (i <= total) LOOP
-		OPEN src FOR 
-			EXECUTE 'SELECT ' || pk || ' as pk,' || colu || ' as geom ' ||
-				'FROM ' || sch || '.' || tab || ' ORDER BY ' || pk || ' LIMIT 100000 OFFSET $1' 
-					USING i;
-		LOOP
-			FETCH src INTO rec;
-			--check if we have more entries to be inserted
-			EXIT WHEN NOT FOUND;
-			--we insert entry by entry here
-			PERFORM FT_Insert(absolute_path, rec.pk, rec.geom);
-		END LOOP;
-		CLOSE src;
-		i := i + 100000;
-	END LOOP;
+	--we insert entry by entry here (the source is read inside FESTIval, without a call of FT_Insert per entry)
+	PERFORM FT_BuildFromSource(absolute_path, src_id);
 
 	-- this is applied only for FAST and FOR-tree indices, which are flash-aware indices (FAI)
 	IF (apply_fai AND (index_id = 4 OR index_id = 5 OR index_id = 6 OR index_id = 7 OR index_id = 8 OR index_id = 9 OR index_id = 10)) THEN
@@ -867,3 +1041,97 @@ $$
 	SELECT FT_CreateSpatialIndex(index_id, index_path || index_name, src_id, bc_id, sc_id, buf_id, apply_fai, apply_stdbuffer, statistic_options, location_statistics, file_statistics)
 $$ 
 LANGUAGE SQL;
+
+--this is the same of the FT_CreateSpatialIndex, but for several indices built from a single scan of their source
+--the i-th index is specified by the i-th element of each array, and the statistical data of each index is stored separately
+--it returns the identifiers of the stored statistical data (one per index, in the order of the arrays)
+--since the buffers of the flash-aware indices and the standard buffers are shared by the indices of a session,
+--at most one flash-aware index (index_id from 4 to 10) and at most one index with a standard buffer can be built at once
+CREATE OR REPLACE FUNCTION FT_CreateSpatialIndexes(index_ids int4[], absolute_paths text[], src_id int4, bc_ids int4[], sc_ids int4[], buf_ids int4[], apply_fai bool default false, apply_stdbuffer bool default false, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
+	RETURNS SETOF int4 AS 
+$BODY$
+DECLARE
+	n int4;
+	i int4;
+BEGIN
+	n := array_length(absolute_paths, 1);
+	IF (n IS NULL OR array_length(index_ids, 1) <> n OR array_length(bc_ids, 1) <> n 
+		OR array_length(sc_ids, 1) <> n OR array_length(buf_ids, 1) <> n) THEN
+		RAISE EXCEPTION 'The arrays of FT_CreateSpatialIndexes must have the same length';
+	END IF;
+	IF ((SELECT count(*) FROM unnest(index_ids) AS t(id) WHERE id >= 4) > 1) THEN
+		RAISE EXCEPTION 'At most one flash-aware index can be built by FT_CreateSpatialIndexes';
+	END IF;
+	IF ((SELECT count(*) FROM unnest(buf_ids) AS t(id), fds.bufferconfiguration AS c 
+		WHERE c.buf_id = t.id AND upper(c.buf_type) <> 'NONE') > 1) THEN
+		RAISE EXCEPTION 'At most one index with a standard buffer can be built by FT_CreateSpatialIndexes';
+	END IF;
+
+	--we start to collect the statistical data of the related indices
+	PERFORM FT_StartCollectStatistics();
+
+	--we create the empty new indices
+	FOR i IN 1..n LOOP
+		PERFORM FT_UseStatisticContext(absolute_paths[i]);
+		PERFORM FT_CreateEmptySpatialIndex(index_ids[i], absolute_paths[i], src_id, bc_ids[i], sc_ids[i], buf_ids[i]);
+	END LOOP;
+
+	--each object of the source is read once and inserted into all the indices
+	PERFORM FT_BuildFromSource(absolute_paths, src_id);
+
+	FOR i IN 1..n LOOP
+		PERFORM FT_UseStatisticContext(absolute_paths[i]);
+		-- this is applied only for FAST and FOR-tree indices, which are flash-aware indices (FAI)
+		IF (apply_fai AND index_ids[i] >= 4 AND index_ids[i] <= 10) THEN
+			PERFORM FT_ApplyAllModificationsForFAI(absolute_paths[i]);
+		END IF;
+	
+		--we then apply all the modifications contained in the standard buffer
+		IF (apply_stdbuffer) THEN
+			PERFORM FT_ApplyAllModificationsFromBuffer(absolute_paths[i]);
+		END IF;
+
+		--we collect and store all the statistical data related to the creation of this index
+		RETURN NEXT FT_StoreStatisticalData(absolute_paths[i], statistic_options, location_statistics, file_statistics);
+	END LOOP;
+	PERFORM FT_UseStatisticContext();
+
+	RETURN;
+END;
+$BODY$
+  LANGUAGE plpgsql VOLATILE
+  COST 500;
+
+--this is the same of the FT_CreateSpatialIndex, but the index is built by the bulk loading (see FT_BulkLoad)
+CREATE OR REPLACE FUNCTION FT_BulkLoadSpatialIndex(index_id int4, absolute_path text, src_id int4, bc_id int4, sc_id int4, buf_id int4, fill_factor float8 default 1.0, apply_stdbuffer bool default false, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
+	RETURNS bool AS 
+$BODY$
+BEGIN
+	--we start to collect the statistical data of the related index
+	PERFORM FT_StartCollectStatistics();
+
+	--we create the empty new index
+	PERFORM FT_CreateEmptySpatialIndex(index_id, absolute_path, src_id, bc_id, sc_id, buf_id);
+
+	--we pack all the objects of the source at once
+	PERFORM FT_BulkLoad(absolute_path, fill_factor);
+
+	--we then apply all the modifications contained in the standard buffer
+	IF (apply_stdbuffer) THEN
+		PERFORM FT_ApplyAllModificationsFromBuffer(absolute_path);
+	END IF;
+
+	--we collect and store all the statistical data related to the spatial index creation
+	PERFORM FT_StoreStatisticalData(absolute_path, statistic_options, location_statistics, file_statistics);
+
+	RETURN true;
+END;
+$BODY$
+LANGUAGE plpgsql VOLATILE;
+
+CREATE OR REPLACE FUNCTION FT_BulkLoadSpatialIndex(index_id int4, index_name text, index_path text, src_id int4, bc_id int4, sc_id int4, buf_id int4, fill_factor float8 default 1.0, apply_stdbuffer bool default false, statistic_options int4 default 1, location_statistics int4 default 1, file_statistics text default NULL)
+	RETURNS bool AS
+$$
+	SELECT FT_BulkLoadSpatialIndex(index_id, index_path || index_name, src_id, bc_id, sc_id, buf_id, fill_factor, apply_stdbuffer, statistic_options, location_statistics, file_statistics)
+$$ 
+LANGUAGE SQL;
@@ -19,6 +19,7 @@
 #include "fortree_buffer.h"
 #include "fornode_stack.h"
 #include "fortree_nodeset.h"
+#include "../rtree/rtree.h" //for the STR packing of the bulk loading
 
 #include "../main/header_handler.h" //for header storage
 
@@ -28,6 +29,7 @@
 #include "../main/storage_handler.h" //for the tree height update
 
 #include "../main/statistical_processing.h"
+#include "../main/distance_query.h" //for distance range queries
 
 /* undefine the defaults */
 #undef uthash_malloc
@@ -69,6 +71,9 @@ static BBox *fortree_union_allnodes(RNode *p, FORNodeSet *s);
 static void fortree_mergeback(FORTree *fr, const FORNodeSet *src, FORNodeSet *dest, const RNode *oldp, RNode *p, int p_node, int level);
 static FORNodeSet *fortree_add_element(FORTree *fr, int level, int p_node, RNode *p, REntry *e, bool *mb);
 static SpatialIndexResult *fortree_recursive_search(FORTree *fr, int node_page, const BBox *query, uint8_t predicate, int height, SpatialIndexResult *result);
+/*the same as above, but for distance range queries
+ within indicates that all the entries of the current node (and its o-nodes) are within the distance*/
+static SpatialIndexResult *fortree_recursive_search_dw(FORTree *fr, int node_page, const DistanceQuery *dq, bool within, int height, SpatialIndexResult *result);
 static RNode *fortree_choose_node(FORTree *fr, REntry *input, int level, FORNodeStack *stack, int *chosen_address);
 static FORNodeSet *fortree_adjust_tree(FORTree *fr, RNode *l, FORNodeSet *s, bool *mb, int l_level, FORNodeStack *stack);
 static ChooseLeaf *fortree_choose_leaf(FORTree *fr, int p_node_add, REntry *to_remove, int height, FORNodeStack *stack, ChooseLeaf *cl);
@@ -77,6 +82,18 @@ static bool fortree_remove_entry(FORTree *fr, REntry *to_remove);
 static SpatialIndexResult *fortree_search(FORTree *fr, const BBox *query, uint8_t predicate);
 static void fortree_insert_entry(FORTree *fr, REntry *input, int level);
 static BBox *fortree_union_allnodes(RNode *p, FORNodeSet *s);
+/*the only child of the root node becomes the new root node*/
+static void fortree_shorten_tree(FORTree *fr);
+
+/* functions of the region deletion (see fortree_remove_region)
+ * a fornode is a P-node and its O-nodes, whose entries are handled together in a single RNode (the P-node entries first) */
+static RNode *fortree_read_fornode(FORTree *fr, int page, const RNode *p, int height, int *nofpentries, FORNodeSet **s);
+static void fortree_write_fornode(FORTree *fr, int page, int height, const RNode *all, int nofpentries, const FORNodeSet *s);
+static void fortree_delete_node(FORTree *fr, int page, int height);
+static void fortree_delete_fornode(FORTree *fr, int page, int height);
+static void fortree_drop_subtree(FORTree *fr, int page, int height);
+static bool fortree_remove_region_node(FORTree *fr, RNode *all, int height, const BBox *window, RNodeStack *orphans);
+static void fortree_push_orphan(FORTree *fr, RNodeStack *removed_nodes, RNode *n, int level);
 
 BBox *fortree_union_allnodes(RNode *p, FORNodeSet *s) {
     BBox *ret;
@@ -199,6 +216,80 @@ SpatialIndexResult *fortree_recursive_search(FORTree *fr, int node_page,
     return result;
 }
 
+SpatialIndexResult *fortree_recursive_search_dw(FORTree *fr, int node_page,
+        const DistanceQuery *dq, bool within, int height, SpatialIndexResult *result) {
+    RNode *node;
+    int node_p;
+    int i, j; //counter for the FOR
+    int k; //number of nodes to traverse (p-node + possible o-nodes)
+    uint8_t c;
+    OverflowNodeTable *hash_entry;
+
+    node = rnode_clone(fr->current_node);
+
+    //we check if this node has o-node or not (an O-NODE only points to a P-NODE)
+    HASH_FIND_INT(ont, &node_page, hash_entry);
+    if (hash_entry != NULL) {
+        //if this node has o-nodes, we increment the tsc value
+        hash_entry->tsc++;
+        k = hash_entry->k + 1;
+    } else {
+        k = 1;
+    }
+
+    for (j = 0; j < k; j++) {
+        //if we have to retrieve a node, we have to update the current node
+        if (j > 0) {
+            rnode_free(fr->current_node);
+            fr->current_node = forb_retrieve_rnode(&fr->base, hash_entry->o_nodes[j - 1], height);
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height != 0)
+                _visited_int_node_num++;
+            else
+                _visited_leaf_node_num++;
+            insert_reads_per_height(height, 1);
+#endif
+            rnode_copy(node, fr->current_node);
+        }
+
+        for (i = 0; i < fr->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within)
+                c = distancequery_classify(dq, fr->current_node->entries[i]->bbox, height == 0);
+            if (c == DQ_DISJOINT)
+                continue;
+
+            if (height != 0) {
+                //we get the node in which the entry points to
+                node_p = fr->current_node->entries[i]->pointer;
+                fr->current_node = forb_retrieve_rnode(&fr->base, fr->current_node->entries[i]->pointer, height - 1);
+
+#ifdef COLLECT_STATISTICAL_DATA
+                if (height - 1 != 0) {
+                    _visited_int_node_num++;
+                } else {
+                    _visited_leaf_node_num++;
+                }
+                insert_reads_per_height(height - 1, 1);
+#endif
+                /* if the MAXDIST of the entry is within the distance, then its subtree is accepted */
+                result = fortree_recursive_search_dw(fr, node_p, dq, c == DQ_WITHIN, height - 1, result);
+
+                rnode_copy(fr->current_node, node);
+            } else if (c == DQ_WITHIN) {
+                spatial_index_result_add_final(result, fr->current_node->entries[i]->pointer);
+            } else {
+                spatial_index_result_add(result, fr->current_node->entries[i]->pointer);
+            }
+        }
+    }
+    rnode_free(node);
+    return result;
+}
+
 /*this function inserts the O-nodes into the corresponding P-node and 
  * sets the "dest" as the remaining O-nodes to be inserted in the parent P-node*/
 void fortree_mergeback(FORTree *fr, const FORNodeSet *src, FORNodeSet *dest,
@@ -1532,58 +1623,350 @@ bool fortree_remove_entry(FORTree *fr, REntry * to_remove) {
 
     //rnode_print(fr->current_node, fr->info->root_page);
 
-    if (fr->current_node->nofentries == 1 && fr->info->height > 0) {
-        int p;
-        RNode *new_root;
+    if (fr->current_node->nofentries == 1 && fr->info->height > 0)
+        fortree_shorten_tree(fr);
 
-        //(NOTICE, "Tem que cortar a arvore");
+    //(NOTICE, "Limpando stack");
+    fornode_stack_destroy(stack);
+    //(NOTICE, "Feito");
 
-        p = fr->current_node->entries[0]->pointer;
+    if (chosen_entry->entry_chosen_node != -1) {
+        rnode_free(chosen_entry->chosen_node);
+        rnode_free(chosen_entry->p_node);
+        fortree_nodeset_destroy(chosen_entry->s);
+        lwfree(chosen_entry);
+        //(NOTICE, "memory cleaned");
+        return true;
+    } else {
+        return false;
+    }
+}
+
+void fortree_shorten_tree(FORTree *fr) {
+    int p;
+    RNode *new_root;
 
-        forb_put_del_rnode(&fr->base, fr->spec, fr->info->root_page, fr->info->height);
-        //we add the removed page as an empty page now
-        rtreesinfo_add_empty_page(fr->info, fr->info->root_page);
+    //(NOTICE, "Tem que cortar a arvore");
+
+    p = fr->current_node->entries[0]->pointer;
+
+    forb_put_del_rnode(&fr->base, fr->spec, fr->info->root_page, fr->info->height);
+    //we add the removed page as an empty page now
+    rtreesinfo_add_empty_page(fr->info, fr->info->root_page);
 
 #ifdef COLLECT_STATISTICAL_DATA
-        _deleted_int_node_num++;
-        insert_writes_per_height(fr->info->height, 1);
+    _deleted_int_node_num++;
+    insert_writes_per_height(fr->info->height, 1);
 #endif
 
-        fr->info->root_page = p;
+    fr->info->root_page = p;
 
-        new_root = forb_retrieve_rnode(&fr->base, p, fr->info->height - 1);
+    new_root = forb_retrieve_rnode(&fr->base, p, fr->info->height - 1);
 
 #ifdef COLLECT_STATISTICAL_DATA
-        if (fr->info->height > 1) {
-            //we visited one internal node, then we add it
+    if (fr->info->height > 1) {
+        //we visited one internal node, then we add it
+        _visited_int_node_num++;
+    } else {
+        //we visited one leaf node
+        _visited_leaf_node_num++;
+    }
+#endif
+
+    rnode_free(fr->current_node);
+    fr->current_node = new_root;
+    fr->info->height--;
+
+    storage_update_tree_height(&fr->base, fr->info->height);
+}
+
+/* if p is not NULL, it is the P-node stored in page (e.g., the root node) and thus, it is not read */
+RNode *fortree_read_fornode(FORTree *fr, int page, const RNode *p, int height, int *nofpentries, FORNodeSet **s) {
+    RNode *all;
+    OverflowNodeTable *hash_entry;
+    int i, j;
+
+    if (p != NULL) {
+        all = rnode_clone(p);
+    } else {
+        all = forb_retrieve_rnode(&fr->base, page, height);
+#ifdef COLLECT_STATISTICAL_DATA
+        if (height != 0)
             _visited_int_node_num++;
-        } else {
-            //we visited one leaf node
+        else
             _visited_leaf_node_num++;
+        insert_reads_per_height(height, 1);
+#endif
+    }
+    *nofpentries = all->nofentries;
+    *s = NULL;
+
+    HASH_FIND_INT(ont, &page, hash_entry);
+    if (hash_entry != NULL) {
+        *s = fortree_nodeset_create(hash_entry->k);
+        for (j = 0; j < hash_entry->k; j++) {
+            (*s)->o_nodes[j] = forb_retrieve_rnode(&fr->base, hash_entry->o_nodes[j], height);
+            (*s)->o_nodes_pages[j] = hash_entry->o_nodes[j];
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height != 0)
+                _visited_int_node_num++;
+            else
+                _visited_leaf_node_num++;
+            insert_reads_per_height(height, 1);
+#endif
+            for (i = 0; i < (*s)->o_nodes[j]->nofentries; i++)
+                rnode_add_rentry(all, rentry_clone((*s)->o_nodes[j]->entries[i]));
         }
+    }
+    return all;
+}
+
+/* several entries of the fornode may have been removed, thus we rewrite it as a merge-back does:
+ * the P-node is filled first and then, the existing O-nodes (no O-node is created since entries were only removed)
+ * the O-nodes left without entries are removed from the buffer and from the overflow node table */
+void fortree_write_fornode(FORTree *fr, int page, int height, const RNode *all, int nofpentries, const FORNodeSet *s) {
+    int max = (height == 0) ? fr->spec->max_entries_leaf_node : fr->spec->max_entries_int_node;
+    int k = (s != NULL) ? s->n : 0;
+    int needed = (all->nofentries > max) ? (all->nofentries - 1) / max : 0; //the number of O-nodes to be kept
+    int i, j, node;
+    OverflowNodeTable *hash_entry;
+
+    //we have to remove all the existing entries from the buffer (in the reverse order)
+    for (i = nofpentries - 1; i >= 0; i--)
+        forb_put_mod_rnode(&fr->base, fr->spec, page, i, NULL, height);
+    for (j = 0; j < k; j++) {
+        for (i = s->o_nodes[j]->nofentries - 1; i >= 0; i--)
+            forb_put_mod_rnode(&fr->base, fr->spec, s->o_nodes_pages[j], i, NULL, height);
+    }
+
+    for (i = 0; i < all->nofentries; i++) {
+        node = i / max;
+        forb_put_mod_rnode(&fr->base, fr->spec, (node == 0) ? page : s->o_nodes_pages[node - 1], i % max,
+                rentry_clone(all->entries[i]), height);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (height > 0)
+        _written_int_node_num += needed + 1;
+    else
+        _written_leaf_node_num += needed + 1;
+    insert_writes_per_height(height, needed + 1);
 #endif
 
-        rnode_free(fr->current_node);
-        fr->current_node = new_root;
-        fr->info->height--;
-        
-        storage_update_tree_height(&fr->base, fr->info->height);
+    for (j = needed; j < k; j++)
+        fortree_delete_node(fr, s->o_nodes_pages[j], height);
+
+    HASH_FIND_INT(ont, &page, hash_entry);
+    if (hash_entry != NULL) {
+        if (needed == 0) {
+            HASH_DEL(ont, hash_entry);
+            lwfree(hash_entry->o_nodes);
+            lwfree(hash_entry);
+        } else {
+            //the kept O-nodes are the first ones
+            hash_entry->k = needed;
+        }
     }
+}
 
-    //(NOTICE, "Limpando stack");
-    fornode_stack_destroy(stack);
-    //(NOTICE, "Feito");
+void fortree_delete_node(FORTree *fr, int page, int height) {
+    forb_put_del_rnode(&fr->base, fr->spec, page, height);
+    //we add the removed page as an empty page now
+    rtreesinfo_add_empty_page(fr->info, page);
 
-    if (chosen_entry->entry_chosen_node != -1) {
-        rnode_free(chosen_entry->chosen_node);
-        rnode_free(chosen_entry->p_node);
-        fortree_nodeset_destroy(chosen_entry->s);
-        lwfree(chosen_entry);
-        //(NOTICE, "memory cleaned");
-        return true;
+#ifdef COLLECT_STATISTICAL_DATA
+    if (height != 0) {
+        //we removed an internal node, then we add it
+        _deleted_int_node_num++;
     } else {
+        //we removed a leaf node
+        _deleted_leaf_node_num++;
+    }
+    insert_writes_per_height(height, 1);
+#endif
+}
+
+/* it removes the P-node stored in page and its O-nodes, which are found in the overflow node table */
+void fortree_delete_fornode(FORTree *fr, int page, int height) {
+    OverflowNodeTable *hash_entry;
+    int j;
+
+    HASH_FIND_INT(ont, &page, hash_entry);
+    if (hash_entry != NULL) {
+        for (j = 0; j < hash_entry->k; j++)
+            fortree_delete_node(fr, hash_entry->o_nodes[j], height);
+        HASH_DEL(ont, hash_entry);
+        lwfree(hash_entry->o_nodes);
+        lwfree(hash_entry);
+    }
+    fortree_delete_node(fr, page, height);
+}
+
+/* it removes the subtree whose root fornode is stored in page
+ * only the internal nodes are read since they store the pages of their children (the leaf nodes are not read) */
+void fortree_drop_subtree(FORTree *fr, int page, int height) {
+    RNode *all;
+    FORNodeSet *s;
+    int i, nofpentries;
+
+    if (height > 0) {
+        all = fortree_read_fornode(fr, page, NULL, height, &nofpentries, &s);
+        for (i = 0; i < all->nofentries; i++)
+            fortree_drop_subtree(fr, all->entries[i]->pointer, height - 1);
+        rnode_free(all);
+        fortree_nodeset_destroy(s);
+    }
+    fortree_delete_fornode(fr, page, height);
+}
+
+/* it removes from the fornode all (which is in main memory) the objects inside the window
+ * the entries inside the window are removed without visiting their subtrees
+ * the children intersecting the window are processed recursively and written here,
+ * except for the under-full ones, which are eliminated and stored in orphans
+ * it returns true if all was modified, then the caller is responsible to write it */
+bool fortree_remove_region_node(FORTree *fr, RNode *all, int height, const BBox *window, RNodeStack *orphans) {
+    RNode *child;
+    FORNodeSet *s;
+    REntry *entry;
+    BBox *bbox;
+    int i, page, min, nofpentries;
+    bool modified = false;
+
+    //the backward traversal keeps the positions of the entries not processed yet
+    for (i = all->nofentries - 1; i >= 0; i--) {
+        entry = all->entries[i];
+
+#ifdef COLLECT_STATISTICAL_DATA
+        _processed_entries_num++;
+#endif
+
+        if (bbox_check_predicate(entry->bbox, window, INSIDE_OR_COVEREDBY)) {
+            //the whole subtree (or object) is removed
+            if (height > 0)
+                fortree_drop_subtree(fr, entry->pointer, height - 1);
+            rnode_remove_rentry(all, i);
+            modified = true;
+        } else if (height > 0 && bbox_check_predicate(window, entry->bbox, INTERSECTS)) {
+            //a boundary fornode
+            page = entry->pointer;
+            child = fortree_read_fornode(fr, page, NULL, height - 1, &nofpentries, &s);
+            if (fortree_remove_region_node(fr, child, height - 1, window, orphans)) {
+                if (height - 1 == 0)
+                    min = fr->spec->min_entries_leaf_node;
+                else
+                    min = fr->spec->min_entries_int_node;
+
+                if (child->nofentries < min) {
+                    //the under-full fornode is eliminated and its remaining entries are reinserted later
+                    fortree_delete_fornode(fr, page, height - 1);
+                    rnode_remove_rentry(all, i);
+                    if (child->nofentries > 0) {
+                        rnode_stack_push(orphans, child, height - 1, -1);
+                        child = NULL;
+                    }
+                } else {
+                    fortree_write_fornode(fr, page, height - 1, child, nofpentries, s);
+                    bbox = rnode_compute_bbox(child);
+                    memcpy(entry->bbox, bbox, sizeof (BBox));
+                    lwfree(bbox);
+                }
+                modified = true;
+            }
+            if (child != NULL)
+                rnode_free(child);
+            fortree_nodeset_destroy(s);
+        }
+    }
+    return modified;
+}
+
+/* it stores an eliminated fornode whose entries will be reinserted at level
+ * if the tree is no longer high enough, the fornode is replaced by its children */
+void fortree_push_orphan(FORTree *fr, RNodeStack *removed_nodes, RNode *n, int level) {
+    RNode *child;
+    FORNodeSet *s;
+    int i, nofpentries;
+
+    if (level > 0 && level >= fr->info->height) {
+        for (i = 0; i < n->nofentries; i++) {
+            child = fortree_read_fornode(fr, n->entries[i]->pointer, NULL, level - 1, &nofpentries, &s);
+            fortree_delete_fornode(fr, n->entries[i]->pointer, level - 1);
+            fortree_nodeset_destroy(s);
+            fortree_push_orphan(fr, removed_nodes, child, level - 1);
+        }
+        rnode_free(n);
+    } else {
+        rnode_stack_push(removed_nodes, n, level, -1);
+    }
+}
+
+/*region deletion (defined in fortree.h)*/
+bool fortree_remove_region(FORTree *fr, const BBox *window) {
+    RNodeStack *orphans, *removed_nodes;
+    FORNodeSet *s;
+    RNode *all, *n;
+    bool removed;
+    int i, level, nofpentries, max;
+
+    if (fr->current_node == NULL)
         return false;
+
+    orphans = rnode_stack_init();
+
+    all = fortree_read_fornode(fr, fr->info->root_page, fr->current_node, fr->info->height, &nofpentries, &s);
+    removed = fortree_remove_region_node(fr, all, fr->info->height, window, orphans);
+
+    if (removed) {
+        fortree_write_fornode(fr, fr->info->root_page, fr->info->height, all, nofpentries, s);
+
+        if (all->nofentries == 0 && fr->info->height > 0) {
+            /* all the children of the root node were eliminated
+             * then, the root node is replaced by an empty leaf node */
+            fortree_delete_node(fr, fr->info->root_page, fr->info->height);
+            fr->info->root_page = rtreesinfo_get_valid_page(fr->info);
+            forb_create_new_rnode(&fr->base, fr->spec, fr->info->root_page, 0);
+#ifdef COLLECT_STATISTICAL_DATA
+            _written_leaf_node_num++;
+            insert_writes_per_height(0, 1);
+#endif
+            fr->info->height = 0;
+            storage_update_tree_height(&fr->base, 0);
+        }
+
+        //the root node in main memory is the P-node of the root fornode
+        max = (fr->info->height == 0) ? fr->spec->max_entries_leaf_node : fr->spec->max_entries_int_node;
+        rnode_free(fr->current_node);
+        fr->current_node = rnode_create_empty();
+        for (i = 0; i < all->nofentries && i < max; i++)
+            rnode_add_rentry(fr->current_node, rentry_clone(all->entries[i]));
+    }
+    rnode_free(all);
+    fortree_nodeset_destroy(s);
+
+    removed_nodes = rnode_stack_init();
+    while (orphans->size > 0) {
+        n = rnode_stack_pop(orphans, &level, NULL);
+        fortree_push_orphan(fr, removed_nodes, n, level);
+    }
+    rnode_stack_destroy(orphans);
+
+    //the entries of the eliminated fornodes are reinserted by the FOR-tree insertion
+    while (removed_nodes->size > 0) {
+        n = rnode_stack_pop(removed_nodes, &level, NULL);
+        for (i = 0; i < n->nofentries; i++) {
+            //the insertion keeps the entry, then we pass a copy of it
+            fortree_insert_entry(fr, rentry_clone(n->entries[i]), level);
+        }
+        rnode_free(n);
     }
+    rnode_stack_destroy(removed_nodes);
+
+    //several levels can become useless here
+    while (fr->current_node->nofentries == 1 && fr->info->height > 0 &&
+            fortree_get_nof_onodes(fr->info->root_page) == 0)
+        fortree_shorten_tree(fr);
+
+    return removed;
 }
 
 SpatialIndexResult * fortree_search(FORTree *fr, const BBox *query, uint8_t predicate) {
@@ -1676,6 +2059,64 @@ static SpatialIndexResult * fortree_search_ss(SpatialIndex *si, const LWGEOM *se
     return sir;
 }
 
+static SpatialIndexResult * fortree_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    SpatialIndexResult *sir;
+    FORTree *fr = (void *) si;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    sir = spatial_index_result_create();
+    /* current node here MUST be equal to the root node */
+    if (fr->current_node != NULL) {
+        sir = fortree_recursive_search_dw(fr, fr->info->root_page, dq, false, fr->info->height, sir);
+    }
+
+    distancequery_free(dq);
+    return sir;
+}
+
+/*STR bulk loading of a FOR-tree (defined in fortree.h)*/
+bool fortree_bulk_load(FORTree *fr, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads) {
+    RTree *r;
+    bool ret;
+
+    if (fr->info->height != 0 || (fr->current_node != NULL && fr->current_node->nofentries > 0)) {
+        _DEBUG(ERROR, "Bulk loading requires an empty index");
+        return false;
+    }
+    if (n == 0)
+        return true;
+
+    /* the empty root node is still in the buffer of the FOR-tree
+     * we discard it since the packed nodes are directly written in the storage device */
+    forb_destroy_buffer();
+
+    //the packing is the same of the rtree since the P-nodes are RNodes (without clip points and counts)
+    r = (void *) rtree_empty_create(fr->base.index_file, fr->base.src, fr->base.gp, fr->base.bs, false);
+    rtreesinfo_free(r->info);
+    r->info = fr->info;
+    r->spec->max_entries_int_node = fr->spec->max_entries_int_node;
+    r->spec->max_entries_leaf_node = fr->spec->max_entries_leaf_node;
+    r->spec->min_entries_int_node = fr->spec->min_entries_int_node;
+    r->spec->min_entries_leaf_node = fr->spec->min_entries_leaf_node;
+    r->spec->split_type = RTREE_QUADRATIC_SPLIT;
+    r->spec->nof_clip_points = 0;
+    r->spec->aggregate = false;
+    r->spec->leaf_hint = false;
+
+    ret = rtree_bulk_pack(r, entries, n, fill_factor, nofthreads, fr->spec->flushing_unit_size);
+
+    //the info is shared and the root node is moved to the FOR-tree
+    if (fr->current_node != NULL)
+        rnode_free(fr->current_node);
+    fr->current_node = r->current_node;
+
+    lwfree(r->spec);
+    lwfree(r);
+    return ret;
+}
+
 static bool fortree_header_writer(SpatialIndex *si, const char *file) {
     festival_header_writer(file, FORTREE_TYPE, si);
     return true;
@@ -1703,8 +2144,8 @@ SpatialIndex * fortree_empty_create(char *file, Source *src, GenericParameters *
 
     /*define the general functions of the rstartree*/
     static const SpatialIndexInterface vtable = {fortree_get_type,
-        fortree_insert, fortree_remove, fortree_update, fortree_search_ss,
-        fortree_header_writer, fortree_destroy};
+        fortree_insert, fortree_remove, fortree_update, fortree_search_ss, NULL,
+        fortree_search_dw, NULL, fortree_header_writer, fortree_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -32,6 +32,7 @@ Applications, v. 42, n. 10, p. 4676–4686, 2015.
 
 #include "../main/spatial_index.h" //this is a sub type of spatial_index
 #include "../rtree/rnode.h"
+#include "../main/bulk_load.h" //for bulk loading
 
 /* THE SPECIFICATION OF FOR-TREE 
  i.e., the parameters that a FOR-tree can has */
@@ -74,6 +75,18 @@ extern bool fortree_delete_entry(FORTree *fr, REntry *to_remove);
 
 extern bool update_fortree(FORTree *fr, REntry *old, REntry *to_update);
 
+/* region deletion: it removes all the objects whose bboxes are inside the window in one traversal
+ * a P-node and its O-nodes are handled together: the subtrees inside the window are removed (including their O-nodes)
+ * without visiting their leaf nodes, and only the boundary nodes are rewritten (as a merge-back, reusing their O-nodes)
+ * the under-full nodes are eliminated and their entries are reinserted at the end by the FOR-tree insertion
+ * it returns true if at least one object was removed */
+extern bool fortree_remove_region(FORTree *fr, const BBox *window);
+
+/* bulk loading of an empty FOR-tree by using the STR packing of the R-tree (see rtree_bulk_load)
+ * the packed nodes have no O-nodes and are written in extents aligned to the flushing unit size
+ * the buffer of the FOR-tree becomes empty */
+extern bool fortree_bulk_load(FORTree *fr, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads);
+
 extern int fortree_get_nof_onodes(int n_page);
 
 extern int fortree_get_onode(int n_page, int index);
@@ -223,6 +223,9 @@ void hilbertnode_copy(HilbertRNode *dest, const HilbertRNode *src) {
             if (i >= old) {
                 dest->entries.leaf[i] = (REntry*) lwalloc(sizeof (REntry));
                 dest->entries.leaf[i]->bbox = (BBox*) lwalloc(sizeof (BBox));
+                dest->entries.leaf[i]->nofclips = 0;
+                dest->entries.leaf[i]->count = 0;
+                dest->entries.leaf[i]->clips = NULL;
             }
             dest->entries.leaf[i]->pointer = src->entries.leaf[i]->pointer;
             memcpy(dest->entries.leaf[i]->bbox, src->entries.leaf[i]->bbox, sizeof (BBox));
@@ -345,23 +348,27 @@ HilbertIEntry *hilbertentry_create(int pointer, BBox *bbox, hilbert_value_t lhv)
 HilbertRNode *get_hilbertnode(const SpatialIndex *si, int page_num, int height) {
     HilbertRNode *node = (HilbertRNode*) lwalloc(sizeof (HilbertRNode));
     int i;
-    uint8_t *buf;
+    uint8_t *buf = NULL;
     uint8_t *loc;
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at get_hilbertnode");
-            return NULL;
+    //if the node is in the buffer, we deserialize it directly from its frame
+    loc = storage_pin_page(si, page_num, height);
+    if (loc == NULL) {
+        if (si->gp->io_access == DIRECT_ACCESS) {
+            //then the memory must be aligned in blocks!
+            if (posix_memalign((void**) &buf, si->gp->page_size, si->gp->page_size)) {
+                _DEBUG(ERROR, "Allocation failed at get_hilbertnode");
+                return NULL;
+            }
+        } else {
+            buf = (uint8_t*) lwalloc(si->gp->page_size);
         }
-    } else {
-        buf = (uint8_t*) lwalloc(si->gp->page_size);
-    }
 
-    //we recover the requested node
-    storage_read_one_page(si, page_num, buf, height);
+        //we recover the requested node
+        storage_read_one_page(si, page_num, buf, height);
 
-    loc = buf;
+        loc = buf;
+    }
 
     /* now we have to deserialize the buf*/
     memcpy(&node->nofentries, loc, sizeof (uint32_t));
@@ -387,6 +394,9 @@ HilbertRNode *get_hilbertnode(const SpatialIndex *si, int page_num, int height)
             for (i = 0; i < node->nofentries; i++) {
                 node->entries.leaf[i] = (REntry*) lwalloc(sizeof (REntry));
                 node->entries.leaf[i]->bbox = (BBox*) lwalloc(sizeof (BBox));
+                node->entries.leaf[i]->nofclips = 0;
+                node->entries.leaf[i]->count = 0;
+                node->entries.leaf[i]->clips = NULL;
 
                 memcpy(&(node->entries.leaf[i]->pointer), loc, sizeof (uint32_t));
                 loc += sizeof (uint32_t);
@@ -412,7 +422,9 @@ HilbertRNode *get_hilbertnode(const SpatialIndex *si, int page_num, int height)
         }
     }
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
+    if (buf == NULL) {
+        storage_unpin_page(si, page_num);
+    } else if (si->gp->io_access == DIRECT_ACCESS) {
         free(buf);
     } else {
         lwfree(buf);
@@ -100,3 +100,18 @@ hilbert_value_t calculate_hilbert_value(double x, double y, int srid) {
 
     return ret;
 }
+
+/*return the hilbert value from a given coordinate (x, y) normalized by an extent (i.e., without SRID)*/
+hilbert_value_t calculate_hilbert_value_in_extent(double x, double y, const BBox *extent) {
+    hilbert_value_t normalized[2];
+    double newRange = pow(2, RESOLUTION) - 1;
+    double oldRangeX = extent->max[0] - extent->min[0];
+    double oldRangeY = extent->max[1] - extent->min[1];
+
+    //a degenerated extent has only one value in its dimension
+    normalized[0] = oldRangeX > 0 ? (hilbert_value_t) (((x - extent->min[0]) * newRange) / oldRangeX) : 0;
+    normalized[1] = oldRangeY > 0 ? (hilbert_value_t) (((y - extent->min[1]) * newRange) / oldRangeY) : 0;
+
+    //number of dimensions here is 2
+    return hilbert_c2i(2, RESOLUTION, (const bitmask_t*) normalized);
+}
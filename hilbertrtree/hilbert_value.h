@@ -24,10 +24,13 @@
 
 #include "srid.h"
 #include "../main/spatial_approximation.h"
+#include "../main/bbox_handler.h"
 
 #define RESOLUTION              ((8*sizeof(unsigned long long)) / NUM_OF_DIM) 
 
 extern hilbert_value_t calculate_hilbert_value(double x, double y, int srid);
+/* the same as above, but the coordinates are normalized by the given extent instead of the domain of an SRID */
+extern hilbert_value_t calculate_hilbert_value_in_extent(double x, double y, const BBox *extent);
 
 #endif /* HILBER_VALUE_H */
 
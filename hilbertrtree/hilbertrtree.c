@@ -19,17 +19,25 @@
 
 #include "hilbertrtree.h"
 #include <math.h>
+#include <stdlib.h> //for posix_memalign
 
 #include "../main/log_messages.h" //messages errors
 #include "../fast/fast_buffer.h" //for FAST indices
+#include "../fast/fast_flush_module.h"
+#include "../fast/fast_log_module.h"
 #include "../efind/efind_buffer_manager.h" //for eFIND indices
 #include "../efind/efind_read_buffer_policies.h"
+#include "../efind/efind_temporal_control.h"
+#include "../efind/efind_log_manager.h"
 
 #include "../main/header_handler.h" //for header storage
 #include "../main/storage_handler.h" //for the tree height update
+#include "../main/io_handler.h" //for the DIRECT_ACCESS of the bulk loading
 
 #include "../main/statistical_processing.h"
 #include "hilbertnode_stack.h" // in order to collect statistical data
+#include "../main/polygon_mask.h" //for polygonal query objects
+#include "../main/distance_query.h" //for distance range queries
 
 //the possible cases of an insertion/remotion
 #define HILBERT_DIRECT       1
@@ -38,6 +46,9 @@
 #define HILBERT_SPLIT               4
 #define HILBERT_MERGE           5        
 
+/*number of packed nodes that are sequentially written at a time by the bulk loading*/
+#define BULKLOAD_WRITE_PAGES    64
+
 /*we need this function in order to make this R-tree index "FASTable"
  that is, in order to be used as a FAST index*/
 static FASTSpecification *fast_spc;
@@ -56,9 +67,16 @@ void hilbertrtree_set_efindspecification(eFINDSpecification *fesp) {
 
 /*recursive search for the r-tree, such that specified in the original R-tree paper.*/
 static SpatialIndexResult *recursive_search(HilbertRTree *rtree, const BBox *query,
-        uint8_t predicate, int height, SpatialIndexResult *result);
+        const PolygonMask *mask, uint8_t predicate, int height, SpatialIndexResult *result);
+/*it adds all the entries of the subtree rooted by the current node without checking any predicate*/
+static SpatialIndexResult *collect_subtree(HilbertRTree *hrtree, int height, SpatialIndexResult *result);
+/*recursive search for distance range queries
+ within indicates that all the entries of the current node are within the distance of the query object*/
+static SpatialIndexResult *recursive_search_dw(HilbertRTree *hrtree, const DistanceQuery *dq,
+        bool within, int height, SpatialIndexResult *result);
 /*this function calls the recursive search, which is almost the same algorithm of the R-tree*/
-static SpatialIndexResult *hilbertrtree_search(HilbertRTree *hrtree, const BBox *search, uint8_t predicate);
+static SpatialIndexResult *hilbertrtree_search(HilbertRTree *hrtree, const BBox *search,
+        const PolygonMask *mask, uint8_t predicate);
 static bool insert_entry(HilbertRTree *hrtree, REntry *input);
 static bool remove_entry(HilbertRTree *hrtree, REntry *rem);
 /*this function implements the classical split 1-to-2 to be applied in the root node*/
@@ -89,10 +107,11 @@ static HilbertRNode *adjust_tree(HilbertRTree *hrtree, HilbertRNode *l, HilbertR
         int *split_address, int *removed_entry, int l_height, HilbertRNodeStack *stack, uint8_t flag);
 
 SpatialIndexResult *recursive_search(HilbertRTree *hrtree, const BBox *query,
-        uint8_t predicate, int height, SpatialIndexResult *result) {
+        const PolygonMask *mask, uint8_t predicate, int height, SpatialIndexResult *result) {
     HilbertRNode *node;
     int i;
     uint8_t p;
+    uint8_t m;
 
     /* we copy the current node for backtracking purposes 
      that is, in order to follow several positive paths in the tree*/
@@ -124,6 +143,15 @@ whose root node is pointed to by Ep
 
             /*it is only internal nodes*/
             if (bbox_check_predicate(query, hrtree->current_node->entries.internal[i]->bbox, p)) {
+                /* if the query object is a polygon, we check the entry against the polygon itself
+                 * note that all the predicates employed in the filter step require an intersection */
+                m = MASK_PARTIAL;
+                if (mask != NULL) {
+                    m = polygonmask_classify(mask, hrtree->current_node->entries.internal[i]->bbox);
+                    if (m == MASK_DISJOINT)
+                        continue;
+                }
+
                 //we get the node in which the entry points to
                 if (hrtree->type == CONVENTIONAL_HILBERT_RTREE)
                     hrtree->current_node = get_hilbertnode(&hrtree->base,
@@ -148,7 +176,12 @@ whose root node is pointed to by Ep
                 insert_reads_per_height(height - 1, 1);
 #endif
 
-                result = recursive_search(hrtree, query, predicate, height - 1, result);
+                /* if the entry is entirely inside the query polygon, 
+                 * then all the entries of its subtree intersect the query object */
+                if (m == MASK_INSIDE && predicate == INTERSECTS)
+                    result = collect_subtree(hrtree, height - 1, result);
+                else
+                    result = recursive_search(hrtree, query, mask, predicate, height - 1, result);
 
                 /*after to traverse this child, we need to back 
                  * the reference of the current_node for the original one */
@@ -169,7 +202,8 @@ whether EI overlaps S. If so, E is a qualifying record
             /*  * We employ MBRs relationships, like defined in: 
              * CLEMENTINI, E.; SHARMA, J.; EGENHOFER, M. J. Modelling topological spatial relations:
  Strategies for query processing. Computers & Graphics, v. 18, n. 6, p. 815–822, 1994.*/
-            if (bbox_check_predicate(query, hrtree->current_node->entries.leaf[i]->bbox, predicate)) {
+            if (bbox_check_predicate(query, hrtree->current_node->entries.leaf[i]->bbox, predicate) &&
+                    (mask == NULL || polygonmask_classify(mask, hrtree->current_node->entries.leaf[i]->bbox) != MASK_DISJOINT)) {
                 spatial_index_result_add(result, hrtree->current_node->entries.leaf[i]->pointer);
             }
         }
@@ -178,12 +212,125 @@ whether EI overlaps S. If so, E is a qualifying record
     return result;
 }
 
+SpatialIndexResult *collect_subtree(HilbertRTree *hrtree, int height, SpatialIndexResult *result) {
+    HilbertRNode *node;
+    int i;
+
+    if (height != 0) {
+        node = hilbertnode_clone(hrtree->current_node);
+        for (i = 0; i < node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            if (hrtree->type == CONVENTIONAL_HILBERT_RTREE)
+                hrtree->current_node = get_hilbertnode(&hrtree->base,
+                    node->entries.internal[i]->pointer, height - 1);
+            else if (hrtree->type == FAST_HILBERT_RTREE_TYPE)
+                hrtree->current_node = (HilbertRNode *) fb_retrieve_node(&hrtree->base,
+                    node->entries.internal[i]->pointer, height - 1);
+            else if (hrtree->type == eFIND_HILBERT_RTREE_TYPE)
+                hrtree->current_node = (HilbertRNode *) efind_buf_retrieve_node(&hrtree->base, efind_spc,
+                    node->entries.internal[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid Hilbert R-tree specification %d", hrtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
+            }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            result = collect_subtree(hrtree, height - 1, result);
+
+            hilbertnode_copy(hrtree->current_node, node);
+        }
+        hilbertnode_free(node);
+    } else {
+        for (i = 0; i < hrtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            spatial_index_result_add(result, hrtree->current_node->entries.leaf[i]->pointer);
+        }
+    }
+    return result;
+}
+
+SpatialIndexResult *recursive_search_dw(HilbertRTree *hrtree, const DistanceQuery *dq,
+        bool within, int height, SpatialIndexResult *result) {
+    HilbertRNode *node;
+    int i;
+    uint8_t c;
+
+    node = hilbertnode_clone(hrtree->current_node);
+
+    if (height != 0) {
+        for (i = 0; i < hrtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within) {
+                c = distancequery_classify(dq, hrtree->current_node->entries.internal[i]->bbox, false);
+                if (c == DQ_DISJOINT)
+                    continue;
+            }
+
+            if (hrtree->type == CONVENTIONAL_HILBERT_RTREE)
+                hrtree->current_node = get_hilbertnode(&hrtree->base,
+                    hrtree->current_node->entries.internal[i]->pointer, height - 1);
+            else if (hrtree->type == FAST_HILBERT_RTREE_TYPE)
+                hrtree->current_node = (HilbertRNode *) fb_retrieve_node(&hrtree->base,
+                    hrtree->current_node->entries.internal[i]->pointer, height - 1);
+            else if (hrtree->type == eFIND_HILBERT_RTREE_TYPE)
+                hrtree->current_node = (HilbertRNode *) efind_buf_retrieve_node(&hrtree->base, efind_spc,
+                    hrtree->current_node->entries.internal[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid Hilbert R-tree specification %d", hrtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
+            }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            /* if the MAXDIST of the entry is within the distance, then its subtree is accepted */
+            result = recursive_search_dw(hrtree, dq, c == DQ_WITHIN, height - 1, result);
+
+            hilbertnode_copy(hrtree->current_node, node);
+        }
+    } else {
+        for (i = 0; i < hrtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within)
+                c = distancequery_classify(dq, hrtree->current_node->entries.leaf[i]->bbox, true);
+
+            if (c == DQ_WITHIN)
+                spatial_index_result_add_final(result, hrtree->current_node->entries.leaf[i]->pointer);
+            else if (c == DQ_PARTIAL)
+                spatial_index_result_add(result, hrtree->current_node->entries.leaf[i]->pointer);
+        }
+    }
+    hilbertnode_free(node);
+    return result;
+}
+
 /*default searching algorithm of the Hilbert R-tree (defined in rtree.h)*/
-SpatialIndexResult *hilbertrtree_search(HilbertRTree *hrtree, const BBox *search, uint8_t predicate) {
+SpatialIndexResult *hilbertrtree_search(HilbertRTree *hrtree, const BBox *search,
+        const PolygonMask *mask, uint8_t predicate) {
     SpatialIndexResult *sir = spatial_index_result_create();
     /* current node here MUST be equal to the root node */
     if (hrtree->current_node != NULL) {
-        sir = recursive_search(hrtree, search, predicate, hrtree->info->height, sir);
+        sir = recursive_search(hrtree, search, mask, predicate, hrtree->info->height, sir);
     }
     return sir;
 }
@@ -1804,6 +1951,186 @@ bool remove_entry(HilbertRTree *hrtree, REntry *rem) {
         return false;
 }
 
+/*Hilbert-packed bulk loading (defined in hilbertrtree.h)*/
+bool hilbertrtree_bulk_load(HilbertRTree *hrtree, ExternalSort *sorted, int srid, double fill_factor) {
+    SortRecord rec;
+    HilbertIEntry **level = NULL; //the entries of the current level (for internal nodes), already in the LHV order
+    HilbertIEntry **parents = NULL; //the entries pointing to the nodes of the current level
+    HilbertRNode *node = NULL;
+    BBox *bbox;
+    hilbert_value_t lhv;
+    uint8_t *buf;
+    int *pages, *heights;
+    int nofpages = 0;
+    int page_size = hrtree->base.gp->page_size;
+    int n = (int) externalsort_size(sorted);
+    int page = 0, height = 0, m = n;
+    int write_unit = BULKLOAD_WRITE_PAGES;
+    int cap, min, nofnodes, size, offset, i, j;
+
+    if (!(hrtree->type == CONVENTIONAL_HILBERT_RTREE || hrtree->type == FAST_HILBERT_RTREE_TYPE
+            || hrtree->type == eFIND_HILBERT_RTREE_TYPE)) {
+        _DEBUGF(ERROR, "Bulk loading is not supported by the Hilbert R-tree type %d", hrtree->type);
+        return false;
+    }
+    if (hrtree->info->height != 0 || (hrtree->current_node != NULL && hrtree->current_node->nofentries > 0)) {
+        _DEBUG(ERROR, "Bulk loading requires an empty index");
+        return false;
+    }
+    /*we should check the information regarding the SRID because of the hilbert values*/
+    if (hrtree->spec->srid != srid && hrtree->spec->srid != 0) {
+        _DEBUGF(ERROR, "SRID does not match on the Hilbert index (%d) with the loading objects (%d)",
+                hrtree->spec->srid, srid);
+    }
+    hrtree->spec->srid = srid;
+    if (n == 0)
+        return true;
+
+    /* the empty root node of FAST and eFIND indices is still in their buffers and logs
+     * we discard them since the packed nodes are directly written in the storage device
+     * by using writes of flushing units. After that, the index works with an empty write buffer and a clean log */
+    if (hrtree->type == FAST_HILBERT_RTREE_TYPE) {
+        fb_destroy_buffer(hrtree->type);
+        fast_destroy_flushing();
+        clean_fast_log(fast_spc);
+        write_unit = fast_spc->flushing_unit_size;
+    } else if (hrtree->type == eFIND_HILBERT_RTREE_TYPE) {
+        efind_write_buf_destroy(hrtree->type);
+        efind_read_buf_destroy(efind_spc, hrtree->type);
+        efind_temporal_control_destroy();
+        efind_clean_log(efind_spc);
+        write_unit = efind_spc->flushing_unit_size;
+    }
+    if (write_unit < 1)
+        write_unit = BULKLOAD_WRITE_PAGES;
+
+    if (hrtree->base.gp->io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &buf, page_size, page_size * write_unit)) {
+            _DEBUG(ERROR, "Allocation failed at hilbertrtree_bulk_load");
+            return false;
+        }
+    } else {
+        buf = (uint8_t*) lwalloc(page_size * write_unit);
+    }
+    pages = (int*) lwalloc(sizeof (int) * write_unit);
+    heights = (int*) lwalloc(sizeof (int) * write_unit);
+
+    /* the levels are packed bottom-up and their nodes are written in sequential pages
+     * each write ends at a multiple of write_unit (i.e., the writes are aligned to the write unit)
+     * since the nodes of a level are created in the hilbert order, the entries of the upper levels
+     * are already sorted by their LHVs. The root node is the last written node */
+    while (true) {
+        if (height == 0) {
+            cap = bulkload_node_capacity(hrtree->spec->max_entries_leaf_node,
+                    hrtree->spec->min_entries_leaf_node, fill_factor);
+            min = hrtree->spec->min_entries_leaf_node;
+        } else {
+            cap = bulkload_node_capacity(hrtree->spec->max_entries_int_node,
+                    hrtree->spec->min_entries_int_node, fill_factor);
+            min = hrtree->spec->min_entries_int_node;
+        }
+
+        nofnodes = bulkload_number_of_nodes(m, cap);
+        if (nofnodes > 1)
+            parents = (HilbertIEntry**) lwalloc(sizeof (HilbertIEntry*) * nofnodes);
+
+        offset = 0;
+        for (i = 0; i < nofnodes; i++) {
+            size = bulkload_node_size(m, cap, min, i);
+            bbox = bbox_create();
+            if (height == 0) {
+                node = hilbertnode_create_empty(HILBERT_LEAF_NODE);
+                node->entries.leaf = (REntry**) lwalloc(sizeof (REntry*) * size);
+                for (j = 0; j < size; j++) {
+                    if (!externalsort_next(sorted, &rec)) {
+                        _DEBUG(ERROR, "The sorted objects ended before the packing of the leaf nodes");
+                        return false;
+                    }
+                    node->entries.leaf[j] = rentry_create(rec.pointer, bbox_clone(&(rec.bbox)));
+                }
+                node->nofentries = size;
+                rentry_create_bbox((const REntry**) node->entries.leaf, size, bbox);
+                //the LHV of a leaf node is the hilbert value of its last entry
+                lhv = rec.key;
+            } else {
+                node = hilbertnode_create_empty(HILBERT_INTERNAL_NODE);
+                node->entries.internal = (HilbertIEntry**) lwalloc(sizeof (HilbertIEntry*) * size);
+                memcpy(node->entries.internal, level + offset, sizeof (HilbertIEntry*) * size);
+                node->nofentries = size;
+                lhv = hilbertnode_compute_bbox(node, srid, bbox);
+            }
+            offset += size;
+
+            hilbertnode_serialize(node, buf + nofpages * page_size);
+            pages[nofpages] = page;
+            heights[nofpages] = height;
+            nofpages++;
+            if ((page + 1) % write_unit == 0) {
+                storage_write_pages(&hrtree->base, pages, buf, heights, nofpages);
+                nofpages = 0;
+            }
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height == 0)
+                _written_leaf_node_num++;
+            else
+                _written_int_node_num++;
+#endif
+
+            //the root node is kept as the current node of the index
+            if (nofnodes == 1) {
+                lwfree(bbox);
+                break;
+            }
+
+            parents[i] = hilbertentry_create(page, bbox, lhv);
+
+            hilbertnode_free(node);
+            page++;
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        insert_writes_per_height(height, nofnodes);
+#endif
+
+        //the entries of this level are now owned by the packed nodes
+        if (height > 0)
+            lwfree(level);
+
+        if (nofnodes == 1)
+            break;
+
+        //the entries of the next level point to the packed nodes
+        level = parents;
+        m = nofnodes;
+        height++;
+    }
+
+    if (nofpages > 0)
+        storage_write_pages(&hrtree->base, pages, buf, heights, nofpages);
+
+    if (hrtree->base.gp->io_access == DIRECT_ACCESS) {
+        free(buf);
+    } else {
+        lwfree(buf);
+    }
+    lwfree(pages);
+    lwfree(heights);
+
+    if (hrtree->current_node != NULL)
+        hilbertnode_free(hrtree->current_node);
+    hrtree->current_node = node;
+    hrtree->info->root_page = page;
+    hrtree->info->last_allocated_page = page;
+    hrtree->info->height = height;
+    if (hrtree->type == eFIND_HILBERT_RTREE_TYPE && efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
+        efind_readbuffer_hlru_set_tree_height(height);
+    storage_update_tree_height(&hrtree->base, height);
+
+    return true;
+}
+
 /*********************************
  * functions in order to make HilbertRTree a standard SpatialIndex (see spatial_index.h)
  *********************************/
@@ -1861,16 +2188,37 @@ static SpatialIndexResult *hilbertrtree_search_ss(SpatialIndex *si, const LWGEOM
     SpatialIndexResult *sir;
     BBox *search = (BBox*) lwalloc(sizeof (BBox));
     HilbertRTree *hrtree = (void *) si;
+    PolygonMask *mask;
 
     gbox_to_bbox(search_object->bbox, search);
+    mask = polygonmask_create(search_object);
 
-    sir = hilbertrtree_search(hrtree, search, predicate);
+    sir = hilbertrtree_search(hrtree, search, mask, predicate);
 
+    polygonmask_free(mask);
     lwfree(search);
 
     return sir;
 }
 
+static SpatialIndexResult *hilbertrtree_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    SpatialIndexResult *sir;
+    HilbertRTree *hrtree = (void *) si;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    sir = spatial_index_result_create();
+    /* current node here MUST be equal to the root node */
+    if (hrtree->current_node != NULL) {
+        sir = recursive_search_dw(hrtree, dq, false, hrtree->info->height, sir);
+    }
+
+    distancequery_free(dq);
+
+    return sir;
+}
+
 static bool hilbertrtree_header_writer(SpatialIndex *si, const char *file) {
     festival_header_writer(file, CONVENTIONAL_HILBERT_RTREE, si);
 
@@ -1898,8 +2246,8 @@ SpatialIndex *hilbertrtree_empty_create(char *file, Source *src, GenericParamete
 
     /*define the general functions of the hilbertrtree*/
     static const SpatialIndexInterface vtable = {hilbertrtree_get_type,
-        hilbertrtree_insert, hilbertrtree_remove, hilbertrtree_update, hilbertrtree_search_ss,
-        hilbertrtree_header_writer, hilbertrtree_destroy};
+        hilbertrtree_insert, hilbertrtree_remove, hilbertrtree_update, hilbertrtree_search_ss, NULL,
+        hilbertrtree_search_dw, NULL, hilbertrtree_header_writer, hilbertrtree_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -28,6 +28,8 @@
  */
 
 #include "hilbert_node.h"
+#include "../main/bulk_load.h"
+#include "../main/external_sort.h"
 
 
 /* THE SPECIFICATION OF Hilbert R-tree
@@ -70,5 +72,14 @@ extern void hilbertrtree_set_fastspecification(FASTSpecification *fesp);
 /*for eFIND Hilbert R-tree indices we have to specify this parameter*/
 extern void hilbertrtree_set_efindspecification(eFINDSpecification *fesp);
 
+/* Hilbert-packed bulk loading of an empty Hilbert R-tree (conventional, FAST, or eFIND)
+ * sorted is a finished external sort whose records have the hilbert values of the centers of the objects as keys
+ * the nodes are packed bottom-up, each node has (fill_factor * max entries) entries and the pages are sequentially written
+ * for FAST and eFIND, the writes are aligned to the flushing unit size, the write buffer becomes empty, and the log is cleaned
+ * Reference: KAMEL, I.; FALOUTSOS, C. On packing R-trees.
+ * Proceedings of the ACM CIKM, p. 490-499, 1993.
+ */
+extern bool hilbertrtree_bulk_load(HilbertRTree *hrtree, ExternalSort *sorted, int srid, double fill_factor);
+
 #endif /* HILBERTRTREE_H */
 
@@ -247,6 +247,24 @@ bool bbox_check_predicate(const BBox *bbox1, const BBox *bbox2, uint8_t predicat
     return false;
 }
 
+bool bbox_contains_point(const BBox *bbox, const double *p) {
+    int i;
+    for (i = 0; i <= MAX_DIM; i++) {
+        if (p[i] < bbox->min[i] || p[i] > bbox->max[i])
+            return false;
+    }
+    return true;
+}
+
+bool bbox_is_point(const BBox *bbox, const double *p) {
+    int i;
+    for (i = 0; i <= MAX_DIM; i++) {
+        if (bbox->min[i] != p[i] || bbox->max[i] != p[i])
+            return false;
+    }
+    return true;
+}
+
 double bbox_area(const BBox *bbox) {
     int i;
     double area = 1.0;
@@ -365,3 +383,54 @@ BBox *bbox_clone(const BBox *bbox) {
     memcpy(ret, bbox, sizeof (BBox));
     return ret;
 }
+
+double bbox_mindist(const BBox *bbox1, const BBox *bbox2) {
+    double sum = 0.0;
+    double d;
+    int i;
+    for (i = 0; i <= MAX_DIM; i++) {
+        if (bbox1->max[i] < bbox2->min[i])
+            d = bbox2->min[i] - bbox1->max[i];
+        else if (bbox2->max[i] < bbox1->min[i])
+            d = bbox1->min[i] - bbox2->max[i];
+        else
+            d = 0.0;
+        sum += d * d;
+    }
+    return sqrt(sum);
+}
+
+double bbox_maxdist_point(const BBox *bbox, const double *p) {
+    double sum = 0.0;
+    double d;
+    int i;
+    for (i = 0; i <= MAX_DIM; i++) {
+        //the farthest coordinate of this dimension
+        d = DB_MAX(fabs(p[i] - bbox->min[i]), fabs(p[i] - bbox->max[i]));
+        sum += d * d;
+    }
+    return sqrt(sum);
+}
+
+/* Reference: ROUSSOPOULOS, N.; KELLEY, S.; VINCENT, F. Nearest neighbor queries. 
+ * Proceedings of the ACM SIGMOD, p. 71-79, 1995. */
+double bbox_minmaxdist_point(const BBox *bbox, const double *p) {
+    double rm, rM;
+    double s = 0.0; //sum of the farthest coordinates
+    double ret = DBL_MAX;
+    double aux;
+    int i, k;
+
+    for (i = 0; i <= MAX_DIM; i++) {
+        rM = (p[i] >= (bbox->min[i] + bbox->max[i]) / 2.0) ? bbox->min[i] : bbox->max[i];
+        s += (p[i] - rM) * (p[i] - rM);
+    }
+    for (k = 0; k <= MAX_DIM; k++) {
+        rm = (p[k] <= (bbox->min[k] + bbox->max[k]) / 2.0) ? bbox->min[k] : bbox->max[k];
+        rM = (p[k] >= (bbox->min[k] + bbox->max[k]) / 2.0) ? bbox->min[k] : bbox->max[k];
+        aux = s - (p[k] - rM) * (p[k] - rM) + (p[k] - rm) * (p[k] - rm);
+        if (aux < ret)
+            ret = aux;
+    }
+    return sqrt(ret);
+}
@@ -60,6 +60,12 @@ extern LWGEOM *bbox_to_geom(const BBox *bbox);
  */
 extern bool bbox_check_predicate(const BBox *bbox1, const BBox *bbox2, uint8_t predicate);
 
+/* point location: exact comparisons (i.e., without tolerance) between a bbox and a point p */
+/*does the bbox contain (or cover) p?*/
+extern bool bbox_contains_point(const BBox *bbox, const double *p);
+/*is the bbox degenerated to p? (then its object is located at p)*/
+extern bool bbox_is_point(const BBox *bbox, const double *p);
+
 /**
  * computation of the area (this is useful for ties in the ChooseLeaf algorithm
  * In fact, this corresponds to the volume of a multidimensional object!
@@ -101,5 +107,16 @@ double bbox_distance_between_centers(const BBoxCenter *c1, const BBoxCenter *c2)
 
 extern BBox *bbox_clone(const BBox *bbox);
 
+/******
+ * distances between bboxes (they are employed in distance-based queries)
+ */
+/*the minimum distance between two bboxes (MINDIST), i.e., a lower bound for their objects*/
+extern double bbox_mindist(const BBox *bbox1, const BBox *bbox2);
+/*the maximum distance between a point and a bbox (MAXDIST), i.e., the distance to its farthest corner*/
+extern double bbox_maxdist_point(const BBox *bbox, const double *p);
+/*an upper bound for the distance between a point and an object whose MBR is bbox (MINMAXDIST)
+ it is only valid if the object touches all the faces of the bbox*/
+extern double bbox_minmaxdist_point(const BBox *bbox, const double *p);
+
 #endif /* _BBOX_HANDLER_H */
 
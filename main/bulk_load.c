@@ -0,0 +1,202 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include <stdlib.h> //for qsort and malloc
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "bulk_load.h"
+#include "log_messages.h"
+
+/*global variable to store the current dimension to be considered in the comparator of the qsort
+ it is local to each thread since the slabs can be ordered in parallel*/
+static __thread int _str_dimension = 0;
+static int center_comp_entry(const void *a, const void *b);
+/*it orders the entries from the dimension dim to the last dimension*/
+static void str_order(BulkLoadEntry *entries, int n, int node_capacity, int dim);
+/*the number of entries of each slab of the dimension dim*/
+static int str_slab_size(int n, int node_capacity, int dim);
+
+/*the slabs ordered by a thread: first_slab, first_slab + step, first_slab + 2*step, ...*/
+typedef struct {
+    BulkLoadEntry *entries;
+    int n;
+    int node_capacity;
+    int slab_size;
+    int first_slab;
+    int step;
+} STRSlabTask;
+
+/*it only uses the given entries (i.e., there is no palloc and no ereport here)*/
+static void *str_slab_worker(void *arg);
+
+BulkLoadEntries *bulkload_entries_create() {
+    BulkLoadEntries *ble = (BulkLoadEntries*) lwalloc(sizeof (BulkLoadEntries));
+    ble->max = 1024;
+    ble->nofentries = 0;
+    ble->entries = (BulkLoadEntry*) malloc(sizeof (BulkLoadEntry) * ble->max);
+    if (ble->entries == NULL)
+        _DEBUG(ERROR, "Allocation failed at bulkload_entries_create");
+    return ble;
+}
+
+void bulkload_entries_add(BulkLoadEntries *ble, int pointer, const BBox *bbox) {
+    /* we need to realloc more space */
+    if (ble->max < ble->nofentries + 1) {
+        ble->max *= 2;
+        ble->entries = (BulkLoadEntry*) realloc(ble->entries, sizeof (BulkLoadEntry) * ble->max);
+        if (ble->entries == NULL)
+            _DEBUG(ERROR, "Allocation failed at bulkload_entries_add");
+    }
+    ble->entries[ble->nofentries].pointer = pointer;
+    memcpy(&(ble->entries[ble->nofentries].bbox), bbox, sizeof (BBox));
+    ble->nofentries++;
+}
+
+void bulkload_entries_free(BulkLoadEntries *ble) {
+    if (ble->entries)
+        free(ble->entries);
+    lwfree(ble);
+}
+
+int bulkload_node_capacity(int max_entries, int min_entries, double fill_factor) {
+    int cap = (int) floor(max_entries * fill_factor);
+    if (cap > max_entries)
+        cap = max_entries;
+    if (cap < min_entries)
+        cap = min_entries;
+    if (cap < 2)
+        cap = 2;
+    return cap;
+}
+
+int bulkload_number_of_nodes(int n, int node_capacity) {
+    return (n + node_capacity - 1) / node_capacity;
+}
+
+int bulkload_node_size(int n, int node_capacity, int min_entries, int i) {
+    int nofnodes = bulkload_number_of_nodes(n, node_capacity);
+    int last = n - (nofnodes - 1) * node_capacity;
+
+    /* the last node would be underfull, then we balance it with its previous node */
+    if (nofnodes > 1 && last < min_entries && i >= nofnodes - 2) {
+        int both = node_capacity + last;
+        if (i == nofnodes - 2)
+            return both - both / 2;
+        return both / 2;
+    }
+    if (i == nofnodes - 1)
+        return last;
+    return node_capacity;
+}
+
+int center_comp_entry(const void *a, const void *b) {
+    const BulkLoadEntry *e1 = (const BulkLoadEntry*) a;
+    const BulkLoadEntry *e2 = (const BulkLoadEntry*) b;
+    //we compare the double of the centers (this avoids a division)
+    double c1 = e1->bbox.min[_str_dimension] + e1->bbox.max[_str_dimension];
+    double c2 = e2->bbox.min[_str_dimension] + e2->bbox.max[_str_dimension];
+
+    if (c1 < c2)
+        return -1;
+    else if (c1 > c2)
+        return 1;
+    else
+        return 0;
+}
+
+int str_slab_size(int n, int node_capacity, int dim) {
+    int nofnodes, nofslabs;
+    /* the space is divided in nofslabs slabs along the dimension dim */
+    nofnodes = bulkload_number_of_nodes(n, node_capacity);
+    nofslabs = (int) ceil(pow((double) nofnodes, 1.0 / (double) (NUM_OF_DIM - dim)));
+    return node_capacity * ((nofnodes + nofslabs - 1) / nofslabs);
+}
+
+void str_order(BulkLoadEntry *entries, int n, int node_capacity, int dim) {
+    int slab_size, i;
+
+    _str_dimension = dim;
+    qsort(entries, n, sizeof (BulkLoadEntry), center_comp_entry);
+
+    if (dim == MAX_DIM)
+        return;
+
+    /* each slab is recursively ordered by considering the next dimensions */
+    slab_size = str_slab_size(n, node_capacity, dim);
+    for (i = 0; i < n; i += slab_size) {
+        str_order(entries + i, (n - i < slab_size) ? n - i : slab_size, node_capacity, dim + 1);
+    }
+}
+
+void *str_slab_worker(void *arg) {
+    STRSlabTask *task = (STRSlabTask*) arg;
+    int i;
+
+    for (i = task->first_slab * task->slab_size; i < task->n; i += task->step * task->slab_size) {
+        str_order(task->entries + i, (task->n - i < task->slab_size) ? task->n - i : task->slab_size,
+                task->node_capacity, 1);
+    }
+    return NULL;
+}
+
+void bulkload_str_order(BulkLoadEntry *entries, int n, int node_capacity) {
+    if (n <= node_capacity)
+        return;
+    str_order(entries, n, node_capacity, 0);
+}
+
+void bulkload_str_order_parallel(BulkLoadEntry *entries, int n, int node_capacity, int nofthreads) {
+    STRSlabTask *tasks;
+    pthread_t *threads;
+    bool *created;
+    int slab_size, t;
+
+    if (n <= node_capacity)
+        return;
+    if (nofthreads <= 1 || MAX_DIM == 0) {
+        str_order(entries, n, node_capacity, 0);
+        return;
+    }
+
+    //the first dimension is ordered by the caller thread
+    _str_dimension = 0;
+    qsort(entries, n, sizeof (BulkLoadEntry), center_comp_entry);
+
+    //then, the slabs are ordered by the threads
+    slab_size = str_slab_size(n, node_capacity, 0);
+    tasks = (STRSlabTask*) malloc(sizeof (STRSlabTask) * nofthreads);
+    threads = (pthread_t*) malloc(sizeof (pthread_t) * nofthreads);
+    created = (bool*) malloc(sizeof (bool) * nofthreads);
+    if (tasks == NULL || threads == NULL || created == NULL)
+        _DEBUG(ERROR, "Allocation failed at bulkload_str_order_parallel");
+
+    for (t = 0; t < nofthreads; t++) {
+        tasks[t].entries = entries;
+        tasks[t].n = n;
+        tasks[t].node_capacity = node_capacity;
+        tasks[t].slab_size = slab_size;
+        tasks[t].first_slab = t;
+        tasks[t].step = nofthreads;
+        created[t] = (pthread_create(&threads[t], NULL, str_slab_worker, &tasks[t]) == 0);
+    }
+    for (t = 0; t < nofthreads; t++) {
+        if (created[t])
+            pthread_join(threads[t], NULL);
+        else //if the thread could not be created, the caller orders its slabs
+            str_slab_worker(&tasks[t]);
+    }
+
+    free(tasks);
+    free(threads);
+    free(created);
+}
@@ -0,0 +1,75 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+ * File:   bulk_load.h
+ *
+ * Created on October 18, 2026
+ */
+
+/* This file specifies the common functions of the bulk loading algorithms,
+ * which build a spatial index from a whole dataset by packing its nodes level by level
+ * (instead of inserting the objects one by one).
+ *
+ * The objects of the dataset are represented by compact records (pointer + bbox).
+ * Since the number of records may exceed the limit of a palloc (1GB), 
+ * arrays of records are allocated by using malloc (see bulkload_entries_*)
+ */
+
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include <stdbool.h>
+#include "bbox_handler.h"
+
+/* a compact record of an object (or of a node) to be packed */
+typedef struct {
+    int pointer; //the row identifier of the object (or the position of the entry of a node)
+    BBox bbox;
+} BulkLoadEntry;
+
+/* a growable array of records */
+typedef struct {
+    BulkLoadEntry *entries;
+    int nofentries;
+    int max;
+} BulkLoadEntries;
+
+extern BulkLoadEntries *bulkload_entries_create(void);
+extern void bulkload_entries_add(BulkLoadEntries *ble, int pointer, const BBox *bbox);
+extern void bulkload_entries_free(BulkLoadEntries *ble);
+
+/* the number of entries of each packed node according to a fill factor (0 < fill_factor <= 1)
+ * the result is always between min_entries and max_entries */
+extern int bulkload_node_capacity(int max_entries, int min_entries, double fill_factor);
+
+/* Sort-Tile-Recursive (STR) ordering of the entries
+ * after this function, each consecutive group of node_capacity entries forms a tile of the space,
+ * that is, a node of the packed level
+ * Reference: LEUTENEGGER, S. T.; LOPEZ, M. A.; EDGINGTON, J. STR: A simple and efficient algorithm
+ * for R-tree packing. Proceedings of the IEEE ICDE, p. 497-506, 1997.
+ */
+extern void bulkload_str_order(BulkLoadEntry *entries, int n, int node_capacity);
+
+/* the same as bulkload_str_order, but the slabs of the first dimension are ordered by nofthreads threads
+ * the threads only touch the array of entries (i.e., they do not call palloc or SPI) */
+extern void bulkload_str_order_parallel(BulkLoadEntry *entries, int n, int node_capacity, int nofthreads);
+
+/* the number of entries of the i-th node of a packed level with n entries
+ * all the nodes have node_capacity entries, except the last two nodes that may be balanced
+ * in order to guarantee the minimum number of entries for the last node */
+extern int bulkload_node_size(int n, int node_capacity, int min_entries, int i);
+
+/* the number of nodes of a packed level with n entries */
+extern int bulkload_number_of_nodes(int n, int node_capacity);
+
+#endif /* BULK_LOAD_H */
@@ -0,0 +1,156 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include "distance_query.h"
+#include "math_util.h"
+
+/* it counts the vertices of a geometry */
+static int count_vertices(const LWGEOM *geom);
+/* it stores every step-th vertex of a geometry in dq->points */
+static void collect_vertices(const LWGEOM *geom, DistanceQuery *dq, int step, int *cur);
+static void collect_pointarray(const POINTARRAY *pa, DistanceQuery *dq, int step, int *cur);
+
+int count_vertices(const LWGEOM *geom) {
+    LWCOLLECTION *col;
+    uint32_t i;
+    int n = 0;
+
+    if (geom->type == POINTTYPE) {
+        return lwgeom_as_lwpoint(geom)->point->npoints;
+    } else if (geom->type == LINETYPE) {
+        return lwgeom_as_lwline(geom)->points->npoints;
+    } else if (geom->type == POLYGONTYPE) {
+        //the vertices of the outer ring are enough
+        if (lwgeom_as_lwpoly(geom)->nrings > 0)
+            return lwgeom_as_lwpoly(geom)->rings[0]->npoints;
+        return 0;
+    } else if (lwgeom_is_collection(geom)) {
+        col = lwgeom_as_lwcollection(geom);
+        for (i = 0; i < col->ngeoms; i++)
+            n += count_vertices(col->geoms[i]);
+    }
+    return n;
+}
+
+void collect_pointarray(const POINTARRAY *pa, DistanceQuery *dq, int step, int *cur) {
+    POINT2D pt;
+    uint32_t i;
+    for (i = 0; i < pa->npoints; i++, (*cur)++) {
+        if ((*cur) % step == 0 && dq->nofpoints < DQ_MAX_POINTS) {
+            getPoint2d_p(pa, i, &pt);
+            dq->points[dq->nofpoints * NUM_OF_DIM] = pt.x;
+            dq->points[dq->nofpoints * NUM_OF_DIM + 1] = pt.y;
+            dq->nofpoints++;
+        }
+    }
+}
+
+void collect_vertices(const LWGEOM *geom, DistanceQuery *dq, int step, int *cur) {
+    LWCOLLECTION *col;
+    uint32_t i;
+
+    if (geom->type == POINTTYPE) {
+        collect_pointarray(lwgeom_as_lwpoint(geom)->point, dq, step, cur);
+    } else if (geom->type == LINETYPE) {
+        collect_pointarray(lwgeom_as_lwline(geom)->points, dq, step, cur);
+    } else if (geom->type == POLYGONTYPE) {
+        if (lwgeom_as_lwpoly(geom)->nrings > 0)
+            collect_pointarray(lwgeom_as_lwpoly(geom)->rings[0], dq, step, cur);
+    } else if (lwgeom_is_collection(geom)) {
+        col = lwgeom_as_lwcollection(geom);
+        for (i = 0; i < col->ngeoms; i++)
+            collect_vertices(col->geoms[i], dq, step, cur);
+    }
+}
+
+DistanceQuery *distancequery_create(const LWGEOM *geom, double distance) {
+    DistanceQuery *dq;
+    int n, step, cur = 0;
+    int i;
+
+    dq = (DistanceQuery*) lwalloc(sizeof (DistanceQuery));
+    dq->distance = distance;
+    gbox_to_bbox(geom->bbox, &dq->bbox);
+    for (i = 0; i <= MAX_DIM; i++) {
+        dq->window.min[i] = dq->bbox.min[i] - distance;
+        dq->window.max[i] = dq->bbox.max[i] + distance;
+    }
+    dq->polygonal = (geom->type == POLYGONTYPE || geom->type == MULTIPOLYGONTYPE);
+    dq->mask = polygonmask_create(geom);
+
+    n = count_vertices(geom);
+    step = (n + DQ_MAX_POINTS - 1) / DQ_MAX_POINTS;
+    if (step < 1)
+        step = 1;
+    dq->nofpoints = 0;
+    dq->points = (double*) lwalloc(sizeof (double) * NUM_OF_DIM * DQ_MAX_POINTS);
+    collect_vertices(geom, dq, step, &cur);
+
+    return dq;
+}
+
+uint8_t distancequery_classify(const DistanceQuery *dq, const BBox *bbox, bool object_mbr) {
+    BBox expanded;
+    double upper, aux;
+    int i;
+
+    /* MINDIST is a lower bound of the distance between the query object and any object in the bbox */
+    if (DB_GT(bbox_mindist(&dq->bbox, bbox), dq->distance))
+        return DQ_DISJOINT;
+
+    if (dq->polygonal) {
+        if (dq->mask != NULL) {
+            /* if the bbox enlarged by the distance does not share any point with the polygon, 
+             * then no point of the bbox is within the distance */
+            for (i = 0; i <= MAX_DIM; i++) {
+                expanded.min[i] = bbox->min[i] - dq->distance;
+                expanded.max[i] = bbox->max[i] + dq->distance;
+            }
+            if (polygonmask_classify(dq->mask, &expanded) == MASK_DISJOINT)
+                return DQ_DISJOINT;
+            /* objects inside the polygon have distance equal to 0 */
+            if (polygonmask_classify(dq->mask, bbox) == MASK_INSIDE)
+                return DQ_WITHIN;
+        } else {
+            /* the polygon has no mask only if it is equal to its bbox */
+            for (i = 0; i <= MAX_DIM; i++) {
+                if (bbox->min[i] < dq->bbox.min[i] || bbox->max[i] > dq->bbox.max[i])
+                    break;
+            }
+            if (i > MAX_DIM)
+                return DQ_WITHIN;
+        }
+    }
+
+    /* the distance to any vertex of the query object is an upper bound */
+    upper = DBL_MAX;
+    for (i = 0; i < dq->nofpoints; i++) {
+        if (object_mbr)
+            aux = bbox_minmaxdist_point(bbox, &dq->points[i * NUM_OF_DIM]);
+        else
+            aux = bbox_maxdist_point(bbox, &dq->points[i * NUM_OF_DIM]);
+        if (aux < upper)
+            upper = aux;
+    }
+    if (DB_LT(upper, dq->distance))
+        return DQ_WITHIN;
+
+    return DQ_PARTIAL;
+}
+
+void distancequery_free(DistanceQuery *dq) {
+    if (dq != NULL) {
+        polygonmask_free(dq->mask);
+        lwfree(dq->points);
+        lwfree(dq);
+    }
+}
@@ -0,0 +1,63 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+ * File:   distance_query.h
+ *
+ * Created on October 18, 2026
+ */
+
+/* This file specifies how the filter step of a distance range query (i.e., ST_DWithin)
+ * classifies the bounding boxes of the index entries.
+ * The classification employs the MINDIST between the bounding boxes to prune entries and
+ * upper bounds of the distance (MAXDIST and MINMAXDIST) to accept entries without refinement.
+ * Upper bounds are computed with respect to a sample of the vertices of the query object since
+ * the distance to any of its vertices is an upper bound for the distance to the query object.
+ */
+
+#ifndef DISTANCE_QUERY_H
+#define DISTANCE_QUERY_H
+
+#include <liblwgeom.h>
+#include <stdbool.h>
+#include "bbox_handler.h"
+#include "polygon_mask.h"
+
+/* results of a classification */
+#define DQ_DISJOINT             0 //no object in the bbox is within the distance
+#define DQ_PARTIAL              1 //the objects in the bbox must be checked
+#define DQ_WITHIN               2 //every object in the bbox is within the distance
+
+/* maximum number of vertices of the query object used to compute upper bounds */
+#define DQ_MAX_POINTS           32
+
+typedef struct {
+    double distance;
+    BBox bbox; //the bounding box of the query object
+    BBox window; //the bounding box of the query object enlarged by the distance
+    int nofpoints;
+    double *points; //vertices of the query object (NUM_OF_DIM coordinates per vertex)
+    bool polygonal; //is the query object a polygon or a multipolygon?
+    PolygonMask *mask; //the polygon mask of the query object, if any (see polygon_mask.h)
+} DistanceQuery;
+
+extern DistanceQuery *distancequery_create(const LWGEOM *geom, double distance);
+
+/* it classifies a bbox with respect to the query (see the DQ_* definitions)
+ * object_mbr indicates that the bbox is the MBR of an object (i.e., a leaf entry),
+ * which allows us to employ the MINMAXDIST as upper bound */
+extern uint8_t distancequery_classify(const DistanceQuery *dq, const BBox *bbox, bool object_mbr);
+
+extern void distancequery_free(DistanceQuery *dq);
+
+#endif /* DISTANCE_QUERY_H */
+
@@ -0,0 +1,586 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include <stdlib.h> //for qsort, malloc, and posix_memalign
+#include <stdio.h> //for sprintf
+#include <string.h>
+#include "external_sort.h"
+#include "io_handler.h" //for the temporary files
+#include "log_messages.h"
+#include "statistical_processing.h" //for the sort statistics
+
+/* a run stored in a temporary file */
+typedef struct {
+    FileSpecification fs;
+    uint64_t nofrecords;
+    int nofblocks; //the number of blocks written in its file (the file only exists if it is positive)
+} SortRun;
+
+/* a sequential reader of a run (used by the merge) */
+typedef struct {
+    SortRun *run;
+    uint8_t *buf; //the current block of the run
+    int block; //the next block to be read
+    int pos; //the position of the current record in the block
+    int inbuf; //the number of records of the current block
+    uint64_t remaining; //the number of records of the run that were not read yet
+    bool exhausted;
+} RunReader;
+
+/* a sequential writer of a run */
+typedef struct {
+    SortRun *run;
+    uint8_t *buf; //the current block of the run
+    int block; //the block number of buf
+    int inbuf; //the number of records in buf
+} RunWriter;
+
+/* a loser tree used in a k-way merge
+ * tree[0] is the reader with the smallest record and tree[1..k-1] store the losers of the matches
+ * Reference: KNUTH, D. E. The Art of Computer Programming, Volume 3: Sorting and Searching. 2nd ed., 1998. */
+typedef struct {
+    RunReader *readers;
+    int k;
+    int *tree;
+    bool final; //is it the last merge? (it is performed on demand by externalsort_next)
+} LoserTree;
+
+struct ExternalSort {
+    ExternalSortSpecification spec;
+    int records_per_block;
+
+    /* the memory area used to generate the runs (or to sort all the records if they fit in it) */
+    SortRecord *records;
+    uint64_t capacity;
+    uint64_t nofrecords;
+
+    uint64_t total; //the number of added records
+
+    SortRun **runs;
+    int nofruns;
+    int maxruns;
+    int run_id; //the identifier of the next temporary file
+
+    bool finished;
+    uint64_t output; //the position of the next record (when all the records fit in memory)
+    LoserTree *merge; //the last merge (when there are runs)
+
+    /* the resources of the operation in progress, which are released by externalsort_free if the operation
+     * raises an error (e.g., a failed write of a temporary file) */
+    SortRun *writing; //the run being written
+    uint8_t *writing_buf; //the block of the run being written
+    LoserTree *pass_merge; //the merge of an intermediate pass
+    SortRun **pass; //the runs of an intermediate pass
+    int nofpass; //the number of runs of the pass
+    int pass_next; //the first run of the pass that is still owned by the pass
+};
+
+/* the memory of the external sort is allocated by malloc since
+ * the number of records may exceed the limit of a palloc (1GB) and the sort may be used inside a SPI connection */
+static void *es_malloc(size_t size);
+static int sortrecord_comp(const void *a, const void *b);
+static uint8_t *alloc_block(const ExternalSort *es);
+static SortRun *new_run(ExternalSort *es);
+static void remove_run(SortRun *run);
+static void append_run(ExternalSort *es, SortRun *run);
+/* it sorts the memory area and writes it as a new run */
+static void write_run_from_memory(ExternalSort *es);
+
+static void runwriter_add(const ExternalSort *es, RunWriter *w, const SortRecord *r);
+static void runwriter_close(const ExternalSort *es, RunWriter *w);
+
+static void runreader_load(const ExternalSort *es, RunReader *r);
+static void runreader_advance(const ExternalSort *es, RunReader *r);
+
+/* the loser tree is stored in owner before its runs are read, thus it is released by externalsort_free on errors */
+static LoserTree *losertree_create(const ExternalSort *es, SortRun **runs, int k, bool final, LoserTree **owner);
+static bool losertree_greater(const LoserTree *lt, int a, int b);
+static void losertree_adjust(LoserTree *lt, int s);
+static bool losertree_pop(const ExternalSort *es, LoserTree *lt, SortRecord *r);
+static void losertree_free(LoserTree *lt);
+
+/* the number of runs that can be merged at once according to the fan-in and the memory budget */
+static int merge_fan_in(const ExternalSort *es);
+
+void *es_malloc(size_t size) {
+    void *p = malloc(size);
+    if (p == NULL)
+        _DEBUG(ERROR, "Allocation failed at the external sort");
+    return p;
+}
+
+int sortrecord_comp(const void *a, const void *b) {
+    const SortRecord *ra = (const SortRecord*) a;
+    const SortRecord *rb = (const SortRecord*) b;
+    if (ra->key < rb->key)
+        return -1;
+    if (ra->key > rb->key)
+        return 1;
+    if (ra->pointer < rb->pointer)
+        return -1;
+    if (ra->pointer > rb->pointer)
+        return 1;
+    return 0;
+}
+
+uint8_t *alloc_block(const ExternalSort *es) {
+    uint8_t *buf;
+    if (es->spec.io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &buf, es->spec.block_size, es->spec.block_size)) {
+            _DEBUG(ERROR, "Allocation failed at alloc_block");
+            return NULL;
+        }
+    } else {
+        buf = (uint8_t*) malloc(es->spec.block_size);
+        if (buf == NULL)
+            _DEBUG(ERROR, "Allocation failed at alloc_block");
+    }
+    return buf;
+}
+
+SortRun *new_run(ExternalSort *es) {
+    SortRun *run = (SortRun*) malloc(sizeof (SortRun));
+    char *path = (char*) malloc(strlen(es->spec.temp_file) + 12);
+
+    if (run == NULL || path == NULL) {
+        free(run);
+        free(path);
+        _DEBUG(ERROR, "Allocation failed at new_run");
+        return NULL;
+    }
+    run->fs.index_path = path;
+    sprintf(run->fs.index_path, "%s.%d", es->spec.temp_file, es->run_id);
+    run->fs.page_size = es->spec.block_size;
+    run->fs.io_access = es->spec.io_access;
+    run->nofrecords = 0;
+    run->nofblocks = 0;
+    es->run_id++;
+    return run;
+}
+
+void remove_run(SortRun *run) {
+    if (run->nofblocks > 0)
+        tempfile_remove(&run->fs);
+    free(run->fs.index_path);
+    free(run);
+}
+
+void append_run(ExternalSort *es, SortRun *run) {
+    if (es->nofruns == es->maxruns) {
+        //the old array is kept on failures, thus externalsort_free still releases its runs
+        SortRun **runs = (SortRun**) realloc(es->runs, sizeof (SortRun*) * es->maxruns * 2);
+        if (runs == NULL)
+            _DEBUG(ERROR, "Allocation failed at append_run");
+        es->runs = runs;
+        es->maxruns *= 2;
+    }
+    es->runs[es->nofruns] = run;
+    es->nofruns++;
+}
+
+void runwriter_add(const ExternalSort *es, RunWriter *w, const SortRecord *r) {
+    memcpy(w->buf + w->inbuf * sizeof (SortRecord), r, sizeof (SortRecord));
+    w->inbuf++;
+    w->run->nofrecords++;
+    if (w->inbuf == es->records_per_block) {
+        w->run->nofblocks++;
+        tempfile_write_blocks(&w->run->fs, w->block, w->buf, 1);
+        w->block++;
+        w->inbuf = 0;
+    }
+}
+
+void runwriter_close(const ExternalSort *es, RunWriter *w) {
+    if (w->inbuf > 0) {
+        //the remaining space of the last block is not used
+        memset(w->buf + w->inbuf * sizeof (SortRecord), 0, es->spec.block_size - w->inbuf * sizeof (SortRecord));
+        w->run->nofblocks++;
+        tempfile_write_blocks(&w->run->fs, w->block, w->buf, 1);
+        w->block++;
+        w->inbuf = 0;
+    }
+}
+
+void write_run_from_memory(ExternalSort *es) {
+    RunWriter w;
+    uint64_t i;
+
+    qsort(es->records, es->nofrecords, sizeof (SortRecord), sortrecord_comp);
+
+    w.run = es->writing = new_run(es);
+    w.buf = es->writing_buf = alloc_block(es);
+    w.block = 0;
+    w.inbuf = 0;
+    for (i = 0; i < es->nofrecords; i++)
+        runwriter_add(es, &w, &(es->records[i]));
+    runwriter_close(es, &w);
+    free(w.buf);
+    es->writing_buf = NULL;
+
+    append_run(es, w.run);
+    es->writing = NULL;
+    es->nofrecords = 0;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _sort_runs_num++;
+#endif
+}
+
+void runreader_load(const ExternalSort *es, RunReader *r) {
+    if (r->remaining == 0) {
+        r->exhausted = true;
+        return;
+    }
+    tempfile_read_blocks(&r->run->fs, r->block, r->buf, 1);
+    r->block++;
+    if (r->remaining < (uint64_t) es->records_per_block)
+        r->inbuf = (int) r->remaining;
+    else
+        r->inbuf = es->records_per_block;
+    r->remaining -= r->inbuf;
+    r->pos = 0;
+}
+
+void runreader_advance(const ExternalSort *es, RunReader *r) {
+    r->pos++;
+    if (r->pos == r->inbuf)
+        runreader_load(es, r);
+}
+
+LoserTree *losertree_create(const ExternalSort *es, SortRun **runs, int k, bool final, LoserTree **owner) {
+    LoserTree *lt = (LoserTree*) es_malloc(sizeof (LoserTree));
+    int i;
+
+    lt->k = 0;
+    lt->final = final;
+    lt->readers = NULL;
+    lt->tree = NULL;
+    *owner = lt;
+    //the blocks of the readers are NULL until they are allocated (see losertree_free)
+    lt->readers = (RunReader*) calloc(k, sizeof (RunReader));
+    if (lt->readers == NULL)
+        _DEBUG(ERROR, "Allocation failed at losertree_create");
+    lt->k = k;
+    lt->tree = (int*) es_malloc(sizeof (int) * k);
+    for (i = 0; i < k; i++) {
+        lt->readers[i].run = runs[i];
+        lt->readers[i].buf = alloc_block(es);
+        lt->readers[i].block = 0;
+        lt->readers[i].pos = 0;
+        lt->readers[i].inbuf = 0;
+        lt->readers[i].remaining = runs[i]->nofrecords;
+        lt->readers[i].exhausted = false;
+        runreader_load(es, &(lt->readers[i]));
+    }
+
+    /* the reader k is a virtual reader that is smaller than any other reader
+     * then, the tree is built by adjusting the leaves from the last one to the first one */
+    for (i = 0; i < k; i++)
+        lt->tree[i] = k;
+    for (i = k - 1; i >= 0; i--)
+        losertree_adjust(lt, i);
+
+    return lt;
+}
+
+/* is the current record of the reader a greater than the current record of the reader b?
+ * an exhausted reader is greater than any other reader */
+bool losertree_greater(const LoserTree *lt, int a, int b) {
+    const RunReader *ra, *rb;
+    if (a == lt->k)
+        return false;
+    if (b == lt->k)
+        return true;
+    ra = &(lt->readers[a]);
+    rb = &(lt->readers[b]);
+    if (ra->exhausted)
+        return !rb->exhausted;
+    if (rb->exhausted)
+        return false;
+    return sortrecord_comp(ra->buf + ra->pos * sizeof (SortRecord), rb->buf + rb->pos * sizeof (SortRecord)) > 0;
+}
+
+/* it replays the matches from the leaf s to the root */
+void losertree_adjust(LoserTree *lt, int s) {
+    int t = (s + lt->k) / 2;
+    int aux;
+    while (t > 0) {
+        if (losertree_greater(lt, s, lt->tree[t])) {
+            //s loses the match and the winner goes up
+            aux = s;
+            s = lt->tree[t];
+            lt->tree[t] = aux;
+        }
+        t /= 2;
+    }
+    lt->tree[0] = s;
+}
+
+bool losertree_pop(const ExternalSort *es, LoserTree *lt, SortRecord *r) {
+    RunReader *winner = &(lt->readers[lt->tree[0]]);
+    if (winner->exhausted)
+        return false;
+    memcpy(r, winner->buf + winner->pos * sizeof (SortRecord), sizeof (SortRecord));
+    if (lt->final && winner->pos + 1 == winner->inbuf) {
+        //the reading of the blocks of the last merge is also accounted as a cost of the sort
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        runreader_advance(es, winner);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sort_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sort_time += get_elapsed_time(start, end);
+#endif
+    } else {
+        runreader_advance(es, winner);
+    }
+    losertree_adjust(lt, lt->tree[0]);
+    return true;
+}
+
+void losertree_free(LoserTree *lt) {
+    int i;
+    for (i = 0; i < lt->k; i++)
+        free(lt->readers[i].buf);
+    free(lt->readers);
+    free(lt->tree);
+    free(lt);
+}
+
+int merge_fan_in(const ExternalSort *es) {
+    //each input run and the output run have a block in main memory
+    int fan_in = (int) (es->spec.memory_budget / es->spec.block_size) - 1;
+    if (fan_in > es->spec.fan_in)
+        fan_in = es->spec.fan_in;
+    if (fan_in < 2)
+        fan_in = 2;
+    return fan_in;
+}
+
+ExternalSort *externalsort_create(const ExternalSortSpecification *spec) {
+    ExternalSort *es;
+
+    if (spec->block_size < (int) sizeof (SortRecord)) {
+        _DEBUGF(ERROR, "The block size (%d) of the external sort is smaller than a record", spec->block_size);
+        return NULL;
+    }
+
+    es = (ExternalSort*) es_malloc(sizeof (ExternalSort));
+    memcpy(&es->spec, spec, sizeof (ExternalSortSpecification));
+    es->spec.temp_file = (char*) es_malloc(strlen(spec->temp_file) + 1);
+    strcpy(es->spec.temp_file, spec->temp_file);
+    es->records_per_block = spec->block_size / sizeof (SortRecord);
+
+    es->capacity = spec->memory_budget / sizeof (SortRecord);
+    if (es->capacity < (uint64_t) es->records_per_block)
+        es->capacity = es->records_per_block;
+    es->records = (SortRecord*) es_malloc(sizeof (SortRecord) * es->capacity);
+    es->nofrecords = 0;
+    es->total = 0;
+
+    es->maxruns = 16;
+    es->nofruns = 0;
+    es->runs = (SortRun**) es_malloc(sizeof (SortRun*) * es->maxruns);
+    es->run_id = 0;
+
+    es->finished = false;
+    es->output = 0;
+    es->merge = NULL;
+
+    es->writing = NULL;
+    es->writing_buf = NULL;
+    es->pass_merge = NULL;
+    es->pass = NULL;
+    es->nofpass = 0;
+    es->pass_next = 0;
+    return es;
+}
+
+void externalsort_add(ExternalSort *es, uint64_t key, int pointer, const BBox *bbox) {
+    SortRecord *r;
+
+    if (es->finished) {
+        _DEBUG(ERROR, "Records cannot be added into a finished external sort");
+        return;
+    }
+
+    //the memory area is full, then we generate a new run
+    if (es->nofrecords == es->capacity) {
+#ifdef COLLECT_STATISTICAL_DATA
+        struct timespec cpustart;
+        struct timespec cpuend;
+        struct timespec start;
+        struct timespec end;
+
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        write_run_from_memory(es);
+
+#ifdef COLLECT_STATISTICAL_DATA
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _sort_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _sort_time += get_elapsed_time(start, end);
+#endif
+    }
+
+    r = &(es->records[es->nofrecords]);
+    r->key = key;
+    r->pointer = pointer;
+    memcpy(&(r->bbox), bbox, sizeof (BBox));
+    es->nofrecords++;
+    es->total++;
+}
+
+void externalsort_finish(ExternalSort *es) {
+    int fan_in, i, j, k;
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if (es->finished)
+        return;
+    es->finished = true;
+
+    if (es->nofruns == 0) {
+        //all the records fit in main memory
+        qsort(es->records, es->nofrecords, sizeof (SortRecord), sortrecord_comp);
+    } else {
+        if (es->nofrecords > 0)
+            write_run_from_memory(es);
+        //the memory area is now used by the blocks of the merge
+        free(es->records);
+        es->records = NULL;
+
+        fan_in = merge_fan_in(es);
+        /* each pass merges groups of fan_in runs, we stop when the last merge can be done at once */
+        while (es->nofruns > fan_in) {
+            SortRun **next_runs = (SortRun**) es_malloc(sizeof (SortRun*) * (es->nofruns / fan_in + 1));
+
+            //the runs of this pass are owned by es->pass until they are merged
+            es->pass = es->runs;
+            es->nofpass = es->nofruns;
+            es->pass_next = 0;
+            es->maxruns = es->nofpass / fan_in + 1;
+            es->runs = next_runs;
+            es->nofruns = 0;
+
+            for (i = 0; i < es->nofpass; i += fan_in) {
+                RunWriter w;
+                SortRecord r;
+
+                k = (es->nofpass - i < fan_in) ? es->nofpass - i : fan_in;
+                //a single run is simply kept to the next pass
+                if (k == 1) {
+                    append_run(es, es->pass[i]);
+                    es->pass_next = i + 1;
+                    continue;
+                }
+                losertree_create(es, es->pass + i, k, false, &es->pass_merge);
+                w.run = es->writing = new_run(es);
+                w.buf = es->writing_buf = alloc_block(es);
+                w.block = 0;
+                w.inbuf = 0;
+                while (losertree_pop(es, es->pass_merge, &r))
+                    runwriter_add(es, &w, &r);
+                runwriter_close(es, &w);
+                free(w.buf);
+                es->writing_buf = NULL;
+                losertree_free(es->pass_merge);
+                es->pass_merge = NULL;
+
+                for (j = i; j < i + k; j++)
+                    remove_run(es->pass[j]);
+                es->pass_next = i + k;
+                append_run(es, w.run);
+                es->writing = NULL;
+            }
+            free(es->pass);
+            es->pass = NULL;
+            es->nofpass = 0;
+        }
+
+        losertree_create(es, es->runs, es->nofruns, true, &es->merge);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _sort_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _sort_time += get_elapsed_time(start, end);
+#endif
+}
+
+bool externalsort_next(ExternalSort *es, SortRecord *r) {
+    if (!es->finished) {
+        _DEBUG(ERROR, "The external sort must be finished before retrieving its records");
+        return false;
+    }
+    if (es->merge == NULL) {
+        if (es->output == es->nofrecords)
+            return false;
+        memcpy(r, &(es->records[es->output]), sizeof (SortRecord));
+        es->output++;
+        return true;
+    }
+    return losertree_pop(es, es->merge, r);
+}
+
+uint64_t externalsort_size(const ExternalSort *es) {
+    return es->total;
+}
+
+void externalsort_free(ExternalSort *es) {
+    int i;
+    if (es->merge != NULL)
+        losertree_free(es->merge);
+    //the resources of an operation interrupted by an error
+    if (es->pass_merge != NULL)
+        losertree_free(es->pass_merge);
+    if (es->writing != NULL)
+        remove_run(es->writing);
+    free(es->writing_buf);
+    if (es->pass != NULL) {
+        for (i = es->pass_next; i < es->nofpass; i++)
+            remove_run(es->pass[i]);
+        free(es->pass);
+    }
+    for (i = 0; i < es->nofruns; i++)
+        remove_run(es->runs[i]);
+    free(es->runs);
+    if (es->records != NULL)
+        free(es->records);
+    free(es->spec.temp_file);
+    free(es);
+}
@@ -0,0 +1,74 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+ * File:   external_sort.h
+ *
+ * Created on October 18, 2026
+ */
+
+/* This file specifies an external-memory sort of compact records (key + pointer + bbox),
+ * which is used by the sort-based bulk loading algorithms when the dataset does not fit in main memory.
+ *
+ * The records are firstly accumulated in a memory area of memory_budget bytes.
+ * When this area is full, its records are sorted and written as a run in a temporary file.
+ * Then, the runs are merged by using a loser tree with at most fan_in runs per merge.
+ * Intermediate merges are performed until the number of runs is at most fan_in;
+ * the last merge is performed on demand by externalsort_next.
+ * If all the records fit in the memory area, no temporary file is created.
+ * All the memory of an external sort is allocated by malloc, thus, it survives the end of a SPI connection.
+ *
+ * The temporary files are read and written in blocks of block_size bytes by using the io_handler
+ * (see tempfile_*_blocks), which performs sequential I/O operations.
+ */
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "bbox_handler.h"
+
+/* a compact record to be sorted by its key (ties are ordered by the pointer) */
+typedef struct {
+    uint64_t key; //the sort key of the record (e.g., a hilbert value)
+    int pointer; //the row identifier of the object
+    BBox bbox;
+} SortRecord;
+
+/* the parameters of an external sort */
+typedef struct {
+    char *temp_file; //the prefix of the temporary files (e.g., /opt/index.sort), the runs are stored in temp_file.<run>
+    size_t memory_budget; //the number of bytes of the records kept in main memory
+    int fan_in; //the maximum number of runs merged at once
+    int block_size; //the size in bytes of the I/O blocks (it must be a multiple of the page size for the direct access)
+    uint8_t io_access; //NORMAL_ACCESS or DIRECT_ACCESS (see io_handler.h)
+} ExternalSortSpecification;
+
+typedef struct ExternalSort ExternalSort;
+
+/* it creates an empty external sort (the specification is copied) */
+extern ExternalSort *externalsort_create(const ExternalSortSpecification *spec);
+/* it adds a record to be sorted, this can generate a new run */
+extern void externalsort_add(ExternalSort *es, uint64_t key, int pointer, const BBox *bbox);
+/* it finishes the input of records and prepares the sorted output
+ * after this function, the records are only retrieved by using externalsort_next */
+extern void externalsort_finish(ExternalSort *es);
+/* it copies the next record (in the key order) to r, it returns false if there is no more records */
+extern bool externalsort_next(ExternalSort *es, SortRecord *r);
+/* the number of added records */
+extern uint64_t externalsort_size(const ExternalSort *es);
+/* it frees the external sort and removes its temporary files */
+extern void externalsort_free(ExternalSort *es);
+
+#endif /* EXTERNAL_SORT_H */
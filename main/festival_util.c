@@ -18,6 +18,7 @@
 #include "festival_defs.h"
 #include "spatial_index.h"
 #include "header_handler.h"
+#include "storage_handler.h"
 #include "log_messages.h"
 
 /*this is the current method to read a spatial index from its header file*/
@@ -29,7 +30,11 @@ void index_specification_set_constructor(construct_from_header cons) {
 }
 
 SpatialIndex *spatialindex_from_header(const char *file) {
-    return constructor(file);
+    SpatialIndex *si = constructor(file);
+    //the buffer may be prewarmed in the first access of the process (see storage_save_buffer_state)
+    if (si != NULL)
+        storage_auto_prewarm_buffer(si, file);
+    return si;
 }
 
 SpatialIndexResult *spatial_index_result_create() {
@@ -38,11 +43,13 @@ SpatialIndexResult *spatial_index_result_create() {
     sir->num_entries = 0;
     sir->row_id = (int*) lwalloc(sizeof (int) * sir->max);
     sir->final_result = false; //the default is false
+    sir->final_entry = NULL;
     return sir;
 }
 
 void spatial_index_result_free(SpatialIndexResult *sir) {
     if (sir->row_id) lwfree(sir->row_id);
+    if (sir->final_entry) lwfree(sir->final_entry);
     lwfree(sir);
 }
 
@@ -51,12 +58,26 @@ void spatial_index_result_add(SpatialIndexResult *result, int row_id) {
     if (result->max < result->num_entries + 1) {
         result->max *= 2;
         result->row_id = (int*) lwrealloc(result->row_id, sizeof (int) * result->max);
+        if (result->final_entry)
+            result->final_entry = (bool*) lwrealloc(result->final_entry, sizeof (bool) * result->max);
     }
 
     result->row_id[result->num_entries] = row_id;
+    if (result->final_entry)
+        result->final_entry[result->num_entries] = false;
     result->num_entries++;
 }
 
+void spatial_index_result_add_final(SpatialIndexResult *result, int row_id) {
+    /* the flags are only allocated when the first final entry is added */
+    if (result->final_entry == NULL) {
+        result->final_entry = (bool*) lwalloc(sizeof (bool) * result->max);
+        memset(result->final_entry, 0, sizeof (bool) * result->max);
+    }
+    spatial_index_result_add(result, row_id);
+    result->final_entry[result->num_entries - 1] = true;
+}
+
 Source *create_source(char *schema, char *table, char *column, char *pk) {
     Source *src = (Source*) lwalloc(sizeof (Source));
     src->schema = schema;
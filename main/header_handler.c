@@ -42,6 +42,12 @@
 #define uthash_malloc(sz) lwalloc(sz)
 #define uthash_free(ptr,sz) lwfree(ptr)
 
+/* the headers start with their size, the type of index, this magic number, and the version of their layout
+ * the version must be incremented whenever the serialization of a specification changes,
+ * thus the headers of old indices raise an error instead of being misread */
+#define HEADER_MAGIC    0x46535456
+#define HEADER_VERSION  2
+
 /*our buffer of SpatialIndex (the header) -- 
  * it does not store the root node, which should be retrieved*/
 typedef struct HeaderBuffer {
@@ -58,6 +64,9 @@ static HeaderBuffer *headers = NULL;
 static int hh_spc_open(const char *path);
 
 static size_t hh_get_total_size(const char *path);
+static size_t hh_get_size_version(void);
+static size_t hh_serialize_version(uint8_t *buf);
+static void hh_check_version(const char *path);
 
 /*auxiliary functions to serialize, deserialize, and so on*/
 static size_t hh_get_size_source(const Source *src);
@@ -192,6 +201,43 @@ uint8_t hh_get_index_type(const char* path) {
     return idx_type;
 }
 
+size_t hh_get_size_version() {
+    return sizeof (uint32_t) + sizeof (uint8_t);
+}
+
+size_t hh_serialize_version(uint8_t *buf) {
+    uint32_t magic = HEADER_MAGIC;
+    uint8_t version = HEADER_VERSION;
+
+    memcpy(buf, &magic, sizeof (uint32_t));
+    memcpy(buf + sizeof (uint32_t), &version, sizeof (uint8_t));
+    return hh_get_size_version();
+}
+
+void hh_check_version(const char *path) {
+    int file;
+    uint32_t magic = 0;
+    uint8_t version = 0;
+
+    file = hh_spc_open(path);
+    if (lseek(file, sizeof (size_t) + sizeof (uint8_t), SEEK_SET) < 0) {
+        _DEBUG(ERROR, "Error in lseek in check_version");
+    }
+    if (read(file, &magic, sizeof (uint32_t)) != sizeof (uint32_t) || magic != HEADER_MAGIC) {
+        close(file);
+        _DEBUGF(ERROR, "The header \'%s\' was written by an older version of FESTIval and cannot be read. "
+                "The index must be rebuilt.", path);
+        return;
+    }
+    if (read(file, &version, sizeof (uint8_t)) != sizeof (uint8_t) || version != HEADER_VERSION) {
+        close(file);
+        _DEBUGF(ERROR, "The header \'%s\' has the version %d, but this version of FESTIval reads the version %d. "
+                "The index must be rebuilt.", path, version, HEADER_VERSION);
+        return;
+    }
+    close(file);
+}
+
 size_t hh_get_size_source(const Source *src) {
     size_t ret = 0;
 
@@ -555,6 +601,8 @@ size_t hh_get_size_buffer_spec(const BufferSpecification *bs) {
         ret += sizeof (size_t) + sizeof (size_t); //A1 and Am sizes
     } else if (bs->buffer_type == BUFFER_2Q) {
         ret += sizeof (size_t) + sizeof (size_t) + sizeof (size_t); //A1in, A1out, and Am sizes
+    } else if (bs->buffer_type == BUFFER_CFLRU) {
+        ret += sizeof (double); //window_perc
     }
 
     return ret;
@@ -604,6 +652,12 @@ size_t hh_serialize_buffer_spec(const BufferSpecification *bs, uint8_t *buf) {
         /* Am size */
         memcpy(loc, &(spec->Am_size), sizeof (size_t));
         loc += sizeof (size_t);
+    } else if (bs->buffer_type == BUFFER_CFLRU) {
+        BufferCFLRUSpecification *spec = (BufferCFLRUSpecification*) bs->buf_additional_param;
+
+        /* window_perc */
+        memcpy(loc, &(spec->window_perc), sizeof (double));
+        loc += sizeof (double);
     }
 
     return_size = (size_t) (loc - buf);
@@ -657,6 +711,14 @@ BufferSpecification *hh_get_buffer_spec_from_serialization(uint8_t *buf, size_t
         memcpy(&(spec->Am_size), buf, sizeof (size_t));
         buf += sizeof (size_t);
 
+        bs->buf_additional_param = (void*) spec;
+    } else if (bs->buffer_type == BUFFER_CFLRU) {
+        BufferCFLRUSpecification *spec = (BufferCFLRUSpecification*) lwalloc(sizeof (BufferCFLRUSpecification));
+
+        /* window_perc */
+        memcpy(&(spec->window_perc), buf, sizeof (double));
+        buf += sizeof (double);
+
         bs->buf_additional_param = (void*) spec;
     }
 
@@ -779,12 +841,16 @@ size_t hh_get_size_rtreespec(void) {
     ret += sizeof (int); //min_entries_int_node    
     ret += sizeof (int); //min_entries_leaf_node
     ret += sizeof (uint8_t); //split
+    ret += sizeof (uint8_t); //nof_clip_points
+    ret += sizeof (uint8_t); //aggregate
+    ret += sizeof (uint8_t); //leaf_hint
 
     return ret;
 }
 
 size_t hh_serialize_rtreespec(const RTreeSpecification *spec, uint8_t *buf) {
     uint8_t *loc = buf;
+    uint8_t tmp;
     size_t return_size;
 
     /* or_id */
@@ -811,12 +877,27 @@ size_t hh_serialize_rtreespec(const RTreeSpecification *spec, uint8_t *buf) {
     memcpy(loc, &(spec->split_type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    /*nof_clip_points*/
+    memcpy(loc, &(spec->nof_clip_points), sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    /* aggregate */
+    tmp = spec->aggregate ? 1 : 0;
+    memcpy(loc, &tmp, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    /* leaf_hint */
+    tmp = spec->leaf_hint ? 1 : 0;
+    memcpy(loc, &tmp, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
     return_size = (size_t) (loc - buf);
     return return_size;
 }
 
 void hh_set_rtreespec_from_serialization(RTreeSpecification *spec, uint8_t *buf, size_t *size) {
     uint8_t *start_ptr = buf;
+    uint8_t tmp;
 
     /* or_id */
     memcpy(&(spec->or_id), buf, sizeof (int));
@@ -842,6 +923,20 @@ void hh_set_rtreespec_from_serialization(RTreeSpecification *spec, uint8_t *buf,
     memcpy(&(spec->split_type), buf, sizeof (uint8_t));
     buf += sizeof (uint8_t);
 
+    /*nof_clip_points*/
+    memcpy(&(spec->nof_clip_points), buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+
+    /* aggregate */
+    memcpy(&tmp, buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+    spec->aggregate = (tmp == 1);
+
+    /* leaf_hint */
+    memcpy(&tmp, buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+    spec->leaf_hint = (tmp == 1);
+
     if (size)
         *size = buf - start_ptr;
 }
@@ -859,12 +954,16 @@ size_t hh_get_size_rstartreespec() {
     ret += sizeof (double); //reinsert_perc_leaf_node
     ret += sizeof (uint8_t); //reinsertion type
     ret += sizeof (int); //max_neighbors_to_examine
+    ret += sizeof (uint8_t); //nof_clip_points
+    ret += sizeof (uint8_t); //aggregate
+    ret += sizeof (uint8_t); //leaf_hint
 
     return ret;
 }
 
 size_t hh_serialize_rstartreespec(const RStarTreeSpecification *spec, uint8_t *buf) {
     uint8_t *loc = buf;
+    uint8_t tmp;
     size_t return_size;
 
     /* or_id */
@@ -903,12 +1002,27 @@ size_t hh_serialize_rstartreespec(const RStarTreeSpecification *spec, uint8_t *b
     memcpy(loc, &(spec->max_neighbors_to_examine), sizeof (int));
     loc += sizeof (int);
 
+    /* nof_clip_points */
+    memcpy(loc, &(spec->nof_clip_points), sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    /* aggregate */
+    tmp = spec->aggregate ? 1 : 0;
+    memcpy(loc, &tmp, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
+    /* leaf_hint */
+    tmp = spec->leaf_hint ? 1 : 0;
+    memcpy(loc, &tmp, sizeof (uint8_t));
+    loc += sizeof (uint8_t);
+
     return_size = (size_t) (loc - buf);
     return return_size;
 }
 
 void hh_set_rstartreespec_from_serialization(RStarTreeSpecification *spec, uint8_t *buf, size_t *size) {
     uint8_t *start_ptr = buf;
+    uint8_t tmp;
 
     /* or_id */
     memcpy(&(spec->or_id), buf, sizeof (int));
@@ -946,6 +1060,20 @@ void hh_set_rstartreespec_from_serialization(RStarTreeSpecification *spec, uint8
     memcpy(&(spec->max_neighbors_to_examine), buf, sizeof (int));
     buf += sizeof (int);
 
+    /* nof_clip_points */
+    memcpy(&(spec->nof_clip_points), buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+
+    /* aggregate */
+    memcpy(&tmp, buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+    spec->aggregate = (tmp == 1);
+
+    /* leaf_hint */
+    memcpy(&tmp, buf, sizeof (uint8_t));
+    buf += sizeof (uint8_t);
+    spec->leaf_hint = (tmp == 1);
+
     if (size)
         *size = buf - start_ptr;
 }
@@ -1483,6 +1611,7 @@ void hh_write_rtree_header(const char *path, const RTree *r) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -1502,6 +1631,9 @@ void hh_write_rtree_header(const char *path, const RTree *r) {
     memcpy(loc, &(r->type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -1562,6 +1694,8 @@ SpatialIndex *hh_construct_rtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     //then we read the source
     src = hh_get_source_from_serialization(loc, &t_read);
@@ -1626,6 +1760,7 @@ void hh_write_rstartree_header(const char *path, const RStarTree *r) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -1645,6 +1780,9 @@ void hh_write_rstartree_header(const char *path, const RStarTree *r) {
     memcpy(loc, &(r->type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rstartreespec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -1705,6 +1843,8 @@ SpatialIndex *hh_construct_rstartree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     //then we read the generic_tree_specialization
     src = hh_get_source_from_serialization(loc, &t_read);
@@ -1778,6 +1918,7 @@ void hh_write_hilbertrtree_header(const char *path, const HilbertRTree *r) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -1797,6 +1938,9 @@ void hh_write_hilbertrtree_header(const char *path, const HilbertRTree *r) {
     memcpy(loc, &(r->type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -1857,6 +2001,8 @@ SpatialIndex *hh_construct_hilbertrtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     //then we read the source
     src = hh_get_source_from_serialization(loc, &t_read);
@@ -1922,6 +2068,7 @@ void hh_write_fastrtree_header(const char *path, const FASTRTree *fastr) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -1942,6 +2089,9 @@ void hh_write_fastrtree_header(const char *path, const FASTRTree *fastr) {
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec, fastspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2004,6 +2154,8 @@ SpatialIndex *hh_construct_fastrtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2081,6 +2233,7 @@ void hh_write_fastrstartree_header(const char *path, const FASTRStarTree *fastr)
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2101,6 +2254,9 @@ void hh_write_fastrstartree_header(const char *path, const FASTRStarTree *fastr)
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rstartreespec, fastspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2163,6 +2319,8 @@ SpatialIndex *hh_construct_fastrstartree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2239,6 +2397,7 @@ void hh_write_fasthilbertrtree_header(const char *path, const FASTHilbertRTree *
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2259,6 +2418,9 @@ void hh_write_fasthilbertrtree_header(const char *path, const FASTHilbertRTree *
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec, fastspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2321,6 +2483,8 @@ SpatialIndex *hh_construct_fasthilbertrtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2383,6 +2547,7 @@ void hh_write_fortree_header(const char *path, const FORTree *r) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2402,6 +2567,9 @@ void hh_write_fortree_header(const char *path, const FORTree *r) {
     memcpy(loc, &(r->type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2462,6 +2630,8 @@ SpatialIndex *hh_construct_fortree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2523,6 +2693,7 @@ void hh_write_efindrtree_header(const char *path, const eFINDRTree *efindr) {
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2543,6 +2714,9 @@ void hh_write_efindrtree_header(const char *path, const eFINDRTree *efindr) {
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec, efindspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2617,6 +2791,8 @@ SpatialIndex *hh_construct_efindrtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2704,6 +2880,7 @@ void hh_write_efindrstartree_header(const char *path, const eFINDRStarTree *efin
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2724,6 +2901,9 @@ void hh_write_efindrstartree_header(const char *path, const eFINDRStarTree *efin
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rstartreespec, efindspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2786,6 +2966,8 @@ SpatialIndex *hh_construct_efindrstartree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -2866,6 +3048,7 @@ void hh_write_efindhilbertrtree_header(const char *path, const eFINDHilbertRTree
 
     /* size of header, type of index and other sizes */
     bufsize = sizeof (uint8_t) + sizeof (size_t);
+    bufsize += hh_get_size_version();
     bufsize += hh_get_size_source(r->base.src);
     bufsize += hh_get_size_generic_spec(r->base.gp);
     bufsize += hh_get_size_buffer_spec(r->base.bs);
@@ -2886,6 +3069,9 @@ void hh_write_efindhilbertrtree_header(const char *path, const eFINDHilbertRTree
     memcpy(loc, &(type), sizeof (uint8_t));
     loc += sizeof (uint8_t);
 
+    //we then write the magic number and the version of the header
+    loc += hh_serialize_version(loc);
+
     //then we write the remaining data: source, genericparameters, bufferspec, rtreesinfo, rtreespec, efindspec
     loc += hh_serialize_source(r->base.src, loc);
     loc += hh_serialize_generic_spec(r->base.gp, loc);
@@ -2948,6 +3134,8 @@ SpatialIndex *hh_construct_efindhilbertrtree_from_header(const char *path) {
     loc += sizeof (size_t);
     //we jump the idx_type
     loc += sizeof (uint8_t);
+    //we jump the magic number and the version (they were checked by festival_get_spatialindex)
+    loc += hh_get_size_version();
 
     src = hh_get_source_from_serialization(loc, &t_read);
     loc += t_read;
@@ -3272,6 +3460,8 @@ SpatialIndex *festival_get_spatialindex(const char *idx_spc_path) {
     }
     //otherwise, we should recover it from the header file
 
+    //the layout of the header must be the one of this version
+    hh_check_version(idx_spc_path);
     idx_type = hh_get_index_type(idx_spc_path);
 
     /*a jump table is not the best approach here because 
@@ -60,7 +60,7 @@ void disk_close(IDX_FILE f) {
 
 void raw_read(IDX_FILE f, int page_size, int page_num, uint8_t *buf, int bufsize) {
     int real_size;
-    if (lseek(f, page_num * page_size, SEEK_SET) < 0) {
+    if (lseek(f, (off_t) page_num * page_size, SEEK_SET) < 0) {
         _DEBUG(ERROR, "Error in lseek in raw_read");
     }
 
@@ -71,7 +71,7 @@ void raw_read(IDX_FILE f, int page_size, int page_num, uint8_t *buf, int bufsize
 
 void raw_write(IDX_FILE f, int page_size, int page_num, uint8_t *buf, int bufsize) {
     int real_size;
-    if (lseek(f, page_num * page_size, SEEK_SET) < 0) {
+    if (lseek(f, (off_t) page_num * page_size, SEEK_SET) < 0) {
         _DEBUG(ERROR, "Error in lseek in raw_write");
     }
 
@@ -309,3 +309,20 @@ void disk_write(const FileSpecification *fs, int *pages, uint8_t *buf, int pagen
 #endif
 }
 
+void tempfile_write_blocks(const FileSpecification *fs, int block, uint8_t *buf, int nofblocks) {
+    IDX_FILE f = disk_open(fs);
+    raw_write(f, fs->page_size, block, buf, nofblocks * fs->page_size);
+    disk_close(f);
+}
+
+void tempfile_read_blocks(const FileSpecification *fs, int block, uint8_t *buf, int nofblocks) {
+    IDX_FILE f = disk_open(fs);
+    raw_read(f, fs->page_size, block, buf, nofblocks * fs->page_size);
+    disk_close(f);
+}
+
+void tempfile_remove(const FileSpecification *fs) {
+    if (unlink(fs->index_path) == -1) {
+        _DEBUGF(WARNING, "It was impossible to remove the temporary file \'%s\'", fs->index_path);
+    }
+}
@@ -52,6 +52,15 @@ for instance, pages 1, 2, and 3 will be sequentially written in only one raw_rea
 extern void disk_write(const FileSpecification *fs, int *pages, uint8_t *buf, int pagenum);
 extern void disk_read(const FileSpecification *fs, int *pages, uint8_t *buf, int pagenum);
 
+/* perform the write and read operations in nofblocks consecutive blocks (of page_size bytes) of a temporary file
+ * (e.g., the runs of the external sort), starting at the block number block
+ * they are sequentially performed in only one raw operation and are not accounted as reads/writes of the index
+ */
+extern void tempfile_write_blocks(const FileSpecification *fs, int block, uint8_t *buf, int nofblocks);
+extern void tempfile_read_blocks(const FileSpecification *fs, int block, uint8_t *buf, int nofblocks);
+/* remove a temporary file */
+extern void tempfile_remove(const FileSpecification *fs);
+
 
 #endif /* _IO_HANDLER_H */
 
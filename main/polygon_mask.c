@@ -0,0 +1,342 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+#include "polygon_mask.h"
+#include "math_util.h"
+
+#include <stdlib.h> //for qsort
+#include <string.h>
+
+/* the column (or row) of the grid in which a coordinate is located */
+static int mask_cell_of(double v, double min, double length, int grid_size);
+/* it checks if an edge shares at least one point with a (closed) rectangle */
+static bool edge_intersects_rect(const MaskEdge *e, double xmin, double ymin, double xmax, double ymax);
+/* it returns true if the polygon is an axis-aligned rectangle */
+static bool polygon_is_rectangle(const LWGEOM *geom, const BBox *bbox);
+/* ray casting restricted to the cells of a row of the grid */
+static bool mask_point_in_polygon(const PolygonMask *mask, double px, double py);
+static int double_cmp(const void *a, const void *b);
+
+int mask_cell_of(double v, double min, double length, int grid_size) {
+    int c = (int) ((v - min) / length);
+    if (c < 0)
+        c = 0;
+    if (c >= grid_size)
+        c = grid_size - 1;
+    return c;
+}
+
+bool edge_intersects_rect(const MaskEdge *e, double xmin, double ymin, double xmax, double ymax) {
+    double dx, dy;
+    double s[4];
+    int i;
+    bool pos = false, neg = false;
+
+    /* the bounding box of the edge must share some point with the rectangle */
+    if (DB_MAX(e->x1, e->x2) < xmin || DB_MIN(e->x1, e->x2) > xmax ||
+            DB_MAX(e->y1, e->y2) < ymin || DB_MIN(e->y1, e->y2) > ymax)
+        return false;
+
+    /* the edge (i.e., its line) separates the rectangle if all the corners lie on the same side */
+    dx = e->x2 - e->x1;
+    dy = e->y2 - e->y1;
+    s[0] = dx * (ymin - e->y1) - dy * (xmin - e->x1);
+    s[1] = dx * (ymin - e->y1) - dy * (xmax - e->x1);
+    s[2] = dx * (ymax - e->y1) - dy * (xmin - e->x1);
+    s[3] = dx * (ymax - e->y1) - dy * (xmax - e->x1);
+    for (i = 0; i < 4; i++) {
+        if (s[i] > 0.0)
+            pos = true;
+        else if (s[i] < 0.0)
+            neg = true;
+        else
+            return true;
+    }
+    return pos && neg;
+}
+
+bool polygon_is_rectangle(const LWGEOM *geom, const BBox *bbox) {
+    LWPOLY *poly;
+    POINT2D pt;
+    uint32_t i;
+
+    if (geom->type != POLYGONTYPE)
+        return false;
+    poly = lwgeom_as_lwpoly(geom);
+    if (poly->nrings != 1 || poly->rings[0]->npoints != 5)
+        return false;
+    for (i = 0; i < poly->rings[0]->npoints; i++) {
+        getPoint2d_p(poly->rings[0], i, &pt);
+        if ((pt.x != bbox->min[0] && pt.x != bbox->max[0]) ||
+                (pt.y != bbox->min[1] && pt.y != bbox->max[1]))
+            return false;
+    }
+    return true;
+}
+
+int double_cmp(const void *a, const void *b) {
+    double da = *(const double*) a;
+    double db = *(const double*) b;
+    if (da < db)
+        return -1;
+    if (da > db)
+        return 1;
+    return 0;
+}
+
+bool mask_point_in_polygon(const PolygonMask *mask, double px, double py) {
+    int row, col, start, k, c;
+    const MaskEdge *e;
+    double xc;
+    bool inside = false;
+
+    row = mask_cell_of(py, mask->bbox.min[1], mask->cell_height, mask->grid_size);
+    start = mask_cell_of(px, mask->bbox.min[0], mask->cell_width, mask->grid_size);
+
+    /* an edge crossing the horizontal ray is registered in the cell in which the crossing occurs.
+     * Thus, we only count a crossing in this cell in order to avoid duplicates */
+    for (col = start; col < mask->grid_size; col++) {
+        c = row * mask->grid_size + col;
+        for (k = mask->cell_start[c]; k < mask->cell_start[c + 1]; k++) {
+            e = &mask->edges[mask->cell_edges[k]];
+            if ((e->y1 > py) != (e->y2 > py)) {
+                xc = e->x1 + (py - e->y1) * (e->x2 - e->x1) / (e->y2 - e->y1);
+                if (xc > px && mask_cell_of(xc, mask->bbox.min[0], mask->cell_width, mask->grid_size) == col)
+                    inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+PolygonMask *polygonmask_create(const LWGEOM *geom) {
+    PolygonMask *mask;
+    LWPOLY **polys;
+    LWMPOLY *mpoly;
+    LWPOLY *poly;
+    POINT2D p1, p2;
+    int nofpolys;
+    int g, ncells;
+    int i, r, c, row, col;
+    int c0, c1, r0, r1;
+    uint32_t j, k;
+    int *fill;
+    double *crossings;
+    int ncross, cur;
+    double xmin, ymin, xmax, ymax, yc, xc;
+    MaskEdge *e;
+
+    if (geom == NULL || lwgeom_is_empty(geom))
+        return NULL;
+
+    if (geom->type == POLYGONTYPE) {
+        poly = lwgeom_as_lwpoly(geom);
+        polys = &poly;
+        nofpolys = 1;
+    } else if (geom->type == MULTIPOLYGONTYPE) {
+        mpoly = lwgeom_as_lwmpoly(geom);
+        polys = mpoly->geoms;
+        nofpolys = (int) mpoly->ngeoms;
+    } else {
+        return NULL;
+    }
+
+    mask = (PolygonMask*) lwalloc(sizeof (PolygonMask));
+    mask->nofedges = 0;
+    for (i = 0; i < nofpolys; i++) {
+        for (j = 0; j < polys[i]->nrings; j++) {
+            if (polys[i]->rings[j]->npoints > 1)
+                mask->nofedges += polys[i]->rings[j]->npoints - 1;
+        }
+    }
+    if (mask->nofedges == 0) {
+        lwfree(mask);
+        return NULL;
+    }
+
+    /* we collect the edges of all the rings and the bounding box of the polygon */
+    mask->edges = (MaskEdge*) lwalloc(sizeof (MaskEdge) * mask->nofedges);
+    mask->bbox.min[0] = mask->bbox.min[1] = DBL_MAX;
+    mask->bbox.max[0] = mask->bbox.max[1] = -DBL_MAX;
+    e = mask->edges;
+    for (i = 0; i < nofpolys; i++) {
+        for (j = 0; j < polys[i]->nrings; j++) {
+            for (k = 1; k < polys[i]->rings[j]->npoints; k++) {
+                getPoint2d_p(polys[i]->rings[j], k - 1, &p1);
+                getPoint2d_p(polys[i]->rings[j], k, &p2);
+                e->x1 = p1.x;
+                e->y1 = p1.y;
+                e->x2 = p2.x;
+                e->y2 = p2.y;
+                mask->bbox.min[0] = DB_MIN(mask->bbox.min[0], DB_MIN(p1.x, p2.x));
+                mask->bbox.min[1] = DB_MIN(mask->bbox.min[1], DB_MIN(p1.y, p2.y));
+                mask->bbox.max[0] = DB_MAX(mask->bbox.max[0], DB_MAX(p1.x, p2.x));
+                mask->bbox.max[1] = DB_MAX(mask->bbox.max[1], DB_MAX(p1.y, p2.y));
+                e++;
+            }
+        }
+    }
+
+    /* the mask is useless for degenerated polygons and rectangles */
+    if (DB_IS_ZERO(mask->bbox.max[0] - mask->bbox.min[0]) ||
+            DB_IS_ZERO(mask->bbox.max[1] - mask->bbox.min[1]) ||
+            polygon_is_rectangle(geom, &mask->bbox)) {
+        lwfree(mask->edges);
+        lwfree(mask);
+        return NULL;
+    }
+
+    /* the grid has approximately one edge per cell */
+    g = (int) ceil(sqrt((double) mask->nofedges));
+    if (g < 1)
+        g = 1;
+    if (g > MASK_MAX_GRID_SIZE)
+        g = MASK_MAX_GRID_SIZE;
+    ncells = g * g;
+    mask->grid_size = g;
+    mask->cell_width = (mask->bbox.max[0] - mask->bbox.min[0]) / g;
+    mask->cell_height = (mask->bbox.max[1] - mask->bbox.min[1]) / g;
+    mask->cell_status = (uint8_t*) lwalloc(sizeof (uint8_t) * ncells);
+    mask->cell_start = (int*) lwalloc(sizeof (int) * (ncells + 1));
+    memset(mask->cell_start, 0, sizeof (int) * (ncells + 1));
+
+    /* first pass: we count the edges per cell
+     * second pass: we store them (i.e., a counting sort)
+     * cells are slightly enlarged in order to register edges passing exactly on their borders */
+    fill = NULL;
+    mask->cell_edges = NULL;
+    for (r = 0; r < 2; r++) {
+        for (i = 0; i < mask->nofedges; i++) {
+            e = &mask->edges[i];
+            c0 = mask_cell_of(DB_MIN(e->x1, e->x2) - DB_TOLERANCE, mask->bbox.min[0], mask->cell_width, g);
+            c1 = mask_cell_of(DB_MAX(e->x1, e->x2) + DB_TOLERANCE, mask->bbox.min[0], mask->cell_width, g);
+            r0 = mask_cell_of(DB_MIN(e->y1, e->y2) - DB_TOLERANCE, mask->bbox.min[1], mask->cell_height, g);
+            r1 = mask_cell_of(DB_MAX(e->y1, e->y2) + DB_TOLERANCE, mask->bbox.min[1], mask->cell_height, g);
+            for (row = r0; row <= r1; row++) {
+                for (col = c0; col <= c1; col++) {
+                    xmin = mask->bbox.min[0] + col * mask->cell_width - DB_TOLERANCE;
+                    ymin = mask->bbox.min[1] + row * mask->cell_height - DB_TOLERANCE;
+                    xmax = mask->bbox.min[0] + (col + 1) * mask->cell_width + DB_TOLERANCE;
+                    ymax = mask->bbox.min[1] + (row + 1) * mask->cell_height + DB_TOLERANCE;
+                    if (edge_intersects_rect(e, xmin, ymin, xmax, ymax)) {
+                        c = row * g + col;
+                        if (r == 0)
+                            mask->cell_start[c + 1]++;
+                        else
+                            mask->cell_edges[fill[c]++] = i;
+                    }
+                }
+            }
+        }
+        if (r == 0) {
+            for (c = 0; c < ncells; c++)
+                mask->cell_start[c + 1] += mask->cell_start[c];
+            mask->cell_edges = (int*) lwalloc(sizeof (int) * DB_MAX(mask->cell_start[ncells], 1));
+            fill = (int*) lwalloc(sizeof (int) * ncells);
+            memcpy(fill, mask->cell_start, sizeof (int) * ncells);
+        }
+    }
+    lwfree(fill);
+
+    /* the status of the cells without edges is given by a scanline in the center of each row
+     * (since no edge crosses these cells, their centers are not on the boundary of the polygon) */
+    crossings = (double*) lwalloc(sizeof (double) * mask->nofedges);
+    for (row = 0; row < g; row++) {
+        yc = mask->bbox.min[1] + (row + 0.5) * mask->cell_height;
+        ncross = 0;
+        for (i = 0; i < mask->nofedges; i++) {
+            e = &mask->edges[i];
+            if ((e->y1 > yc) != (e->y2 > yc))
+                crossings[ncross++] = e->x1 + (yc - e->y1) * (e->x2 - e->x1) / (e->y2 - e->y1);
+        }
+        qsort(crossings, ncross, sizeof (double), double_cmp);
+        cur = 0;
+        for (col = 0; col < g; col++) {
+            c = row * g + col;
+            xc = mask->bbox.min[0] + (col + 0.5) * mask->cell_width;
+            while (cur < ncross && crossings[cur] < xc)
+                cur++;
+            if (mask->cell_start[c + 1] > mask->cell_start[c])
+                mask->cell_status[c] = MASK_CELL_BOUNDARY;
+            else if (cur % 2 == 1)
+                mask->cell_status[c] = MASK_CELL_INSIDE;
+            else
+                mask->cell_status[c] = MASK_CELL_OUTSIDE;
+        }
+    }
+    lwfree(crossings);
+
+    return mask;
+}
+
+uint8_t polygonmask_classify(const PolygonMask *mask, const BBox *bbox) {
+    double xmin, ymin, xmax, ymax;
+    int c0, c1, r0, r1, row, col, c, k;
+    bool seen_inside = false;
+    bool seen_outside = false;
+    const int g = mask->grid_size;
+
+    /* the rectangle is enlarged by the tolerance, as done in the bbox_handler */
+    xmin = bbox->min[0] - DB_TOLERANCE;
+    ymin = bbox->min[1] - DB_TOLERANCE;
+    xmax = bbox->max[0] + DB_TOLERANCE;
+    ymax = bbox->max[1] + DB_TOLERANCE;
+
+    if (xmax < mask->bbox.min[0] || xmin > mask->bbox.max[0] ||
+            ymax < mask->bbox.min[1] || ymin > mask->bbox.max[1])
+        return MASK_DISJOINT;
+
+    c0 = mask_cell_of(xmin, mask->bbox.min[0], mask->cell_width, g);
+    c1 = mask_cell_of(xmax, mask->bbox.min[0], mask->cell_width, g);
+    r0 = mask_cell_of(ymin, mask->bbox.min[1], mask->cell_height, g);
+    r1 = mask_cell_of(ymax, mask->bbox.min[1], mask->cell_height, g);
+
+    for (row = r0; row <= r1; row++) {
+        for (col = c0; col <= c1; col++) {
+            c = row * g + col;
+            if (mask->cell_status[c] == MASK_CELL_INSIDE) {
+                seen_inside = true;
+            } else if (mask->cell_status[c] == MASK_CELL_OUTSIDE) {
+                seen_outside = true;
+            } else {
+                for (k = mask->cell_start[c]; k < mask->cell_start[c + 1]; k++) {
+                    if (edge_intersects_rect(&mask->edges[mask->cell_edges[k]], xmin, ymin, xmax, ymax))
+                        return MASK_PARTIAL;
+                }
+            }
+        }
+    }
+
+    /* here, no edge shares a point with the rectangle
+     * therefore, the rectangle is either entirely inside or entirely outside the polygon */
+    if (xmin < mask->bbox.min[0] || xmax > mask->bbox.max[0] ||
+            ymin < mask->bbox.min[1] || ymax > mask->bbox.max[1])
+        return MASK_DISJOINT;
+    if (seen_inside)
+        return MASK_INSIDE;
+    if (seen_outside)
+        return MASK_DISJOINT;
+    /* all the cells have edges, we then check the center of the rectangle */
+    if (mask_point_in_polygon(mask, (xmin + xmax) / 2.0, (ymin + ymax) / 2.0))
+        return MASK_INSIDE;
+    return MASK_DISJOINT;
+}
+
+void polygonmask_free(PolygonMask *mask) {
+    if (mask != NULL) {
+        lwfree(mask->edges);
+        lwfree(mask->cell_status);
+        lwfree(mask->cell_start);
+        lwfree(mask->cell_edges);
+        lwfree(mask);
+    }
+}
@@ -0,0 +1,84 @@
+/**********************************************************************
+ *
+ * FESTIval - Framework to Evaluate SpaTial Indices in non-VolAtiLe memories and hard disk drives.
+ * https://accarniel.github.io/FESTIval/
+ *
+ * Copyright (C) 2016-2020 Anderson Chaves Carniel <accarniel@gmail.com>
+ *
+ * This is free software; you can redistribute and/or modify it under
+ * the terms of the GNU General Public Licence. See the COPYING file.
+ *
+ **********************************************************************/
+
+/*
+ * File:   polygon_mask.h
+ *
+ * Created on October 18, 2026
+ */
+
+/* A polygon mask is a lightweight index built over the edges of a polygonal query object
+ * (POLYGON or MULTIPOLYGON). It classifies bounding boxes of index entries with respect to the
+ * query polygon itself, instead of the bounding box of the query polygon.
+ *
+ * The edges of the polygon are distributed in a uniform grid laid over the bounding box of the polygon.
+ * Cells that are not crossed by any edge are marked as inside or outside the polygon,
+ * which allows us to classify most of the bounding boxes without testing any edge.
+ *
+ * A classification is always conservative: a bounding box is only classified as disjoint (or inside)
+ * if it is guaranteed that the bounding box does not share any point with the polygon
+ * (or that it is entirely in the interior of the polygon).
+ */
+
+#ifndef POLYGON_MASK_H
+#define POLYGON_MASK_H
+
+#include <liblwgeom.h>
+#include <stdbool.h>
+#include "bbox_handler.h"
+
+/* results of a classification */
+#define MASK_DISJOINT           0 //the bounding box does not share any point with the polygon
+#define MASK_PARTIAL            1 //the bounding box might intersect the boundary of the polygon
+#define MASK_INSIDE             2 //the bounding box is entirely contained in the interior of the polygon
+
+/* status of the cells of the grid */
+#define MASK_CELL_OUTSIDE       0
+#define MASK_CELL_INSIDE        1
+#define MASK_CELL_BOUNDARY      2 //there is at least one edge crossing this cell
+
+/* maximum number of cells per dimension */
+#define MASK_MAX_GRID_SIZE      64
+
+typedef struct {
+    double x1, y1;
+    double x2, y2;
+} MaskEdge;
+
+typedef struct {
+    BBox bbox; //the bounding box of the polygon
+
+    int nofedges;
+    MaskEdge *edges; //the edges of all rings (i.e., including holes)
+
+    int grid_size; //number of cells per dimension
+    double cell_width;
+    double cell_height;
+    uint8_t *cell_status; //status of each cell (grid_size * grid_size, row-major)
+    /* the edges crossing the cell c are stored in cell_edges[cell_start[c]] .. cell_edges[cell_start[c+1]-1] */
+    int *cell_start;
+    int *cell_edges;
+} PolygonMask;
+
+/* it builds the polygon mask of a geometry
+ * it returns NULL if the geometry is not a polygon or a multipolygon,
+ * or if the polygon is equal to its bounding box (e.g., a range query), since
+ * the mask would not improve the bounding box checking in these cases */
+extern PolygonMask *polygonmask_create(const LWGEOM *geom);
+
+/* it classifies a bounding box with respect to the polygon (see the MASK_* definitions) */
+extern uint8_t polygonmask_classify(const PolygonMask *mask, const BBox *bbox);
+
+extern void polygonmask_free(PolygonMask *mask);
+
+#endif /* POLYGON_MASK_H */
+
@@ -101,6 +101,10 @@ typedef struct {
 #define BUFFER_HLRU         2 //the traditional LRU cache that considers the height of the nodes
 #define BUFFER_S2Q          3 //the simplified 2Q cache, see s2q.c
 #define BUFFER_2Q           4 //the full version of 2Q cache, see full2q.c
+#define BUFFER_ARC          5 //the adaptive replacement cache, see arc.c
+#define BUFFER_CLOCKPRO     6 //the CLOCK-Pro cache, see clockpro.c
+#define BUFFER_CFLRU        7 //the clean-first LRU cache, see cflru.c
+#define BUFFER_SHARED       8 //the buffer pool shared by the backends, see shared_buffer.c
 
 typedef struct {
     uint8_t buffer_type; //type of this buffer (see above)
@@ -121,6 +125,10 @@ typedef struct {
     size_t Am_size;
 } Buffer2QSpecification;
 
+typedef struct {
+    double window_perc; //size of the clean-first window as a percentage of the buffer (negative means adaptive)
+} BufferCFLRUSpecification;
+
 /************************************
  STRUCT FOR QUERY PROCESSING
  ************************************/
@@ -131,6 +139,9 @@ typedef struct {
     int num_entries; //the number of entries
     int max; //maximum of entries
     bool final_result; //do these entries correspond to the final result of the query?
+    /* it indicates which entries are already in the final result (e.g., in distance queries)
+     * it is NULL if there is no such entry */
+    bool *final_entry;
 } SpatialIndexResult;
 
 /************************************
@@ -171,6 +182,27 @@ typedef struct _SpatialIndexInterface {
      *  the third parameter is the predicate to be considered (see bbox_handler.h)
      * */
     SpatialIndexResult* (*search_ss)(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate);
+    /*search a index for the objects that intersect or are equal to a point (point location):
+     *  the parameters are the same of search_ss, but the LWGEOM must be a point with bbox 
+     *  and the predicate must be INTERSECTS or EQUAL
+     * entries located at the point are marked as final entries (see SpatialIndexResult)
+     * (it is NULL for indices without a specialized point location, which use search_ss instead)
+     * */
+    SpatialIndexResult* (*search_pt)(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate);
+    /*search a index for the objects within a distance of a spatial object (distance range query):
+     *  first parameter is the self index, 
+     *  the second is the LWGEOM object for the query 
+     *  the third parameter is the distance
+     * entries that certainly are within the distance are marked as final entries (see SpatialIndexResult)
+     * */
+    SpatialIndexResult* (*search_dw)(SpatialIndex *si, const LWGEOM *search_object, double distance);
+    /*count the objects within a distance of a spatial object by using the aggregate counts of the index:
+     *  the first three parameters are the same of search_dw,
+     *  the fourth parameter receives the number of objects that certainly are within the distance
+     * the returned result contains only the candidates that still need the refinement step
+     * (it is NULL for indices that do not store aggregate counts)
+     * */
+    SpatialIndexResult* (*count_dw)(SpatialIndex *si, const LWGEOM *search_object, double distance, uint64_t *nofobjects);
     /* write the header of the index in a specified file that contains specific info about the index
      * the first parameter is the self index while the second is the header file
      * */
@@ -205,6 +237,18 @@ static inline SpatialIndexResult *spatialindex_spatial_selection(SpatialIndex *s
     return s->vtable->search_ss(s, so, p);
 }
 
+static inline SpatialIndexResult *spatialindex_point_location(SpatialIndex *s, const LWGEOM *so, uint8_t p) {
+    return s->vtable->search_pt(s, so, p);
+}
+
+static inline SpatialIndexResult *spatialindex_distance_selection(SpatialIndex *s, const LWGEOM *so, double d) {
+    return s->vtable->search_dw(s, so, d);
+}
+
+static inline SpatialIndexResult *spatialindex_distance_count(SpatialIndex *s, const LWGEOM *so, double d, uint64_t *n) {
+    return s->vtable->count_dw(s, so, d, n);
+}
+
 static inline bool spatialindex_header_writer(SpatialIndex *s, const char *file) {
     return s->vtable->write_header(s, file);
 }
@@ -248,6 +292,8 @@ extern void generic_parameters_free(GenericParameters *gp);
 /*this function adds a row_id to the result of a query */
 extern SpatialIndexResult *spatial_index_result_create(void);
 extern void spatial_index_result_add(SpatialIndexResult *sir, int row_id);
+/*the same as above, but the row_id is marked as a final entry (i.e., it does not need the refinement step)*/
+extern void spatial_index_result_add_final(SpatialIndexResult *sir, int row_id);
 extern void spatial_index_result_free(SpatialIndexResult *sir);
 
 #endif /* SPATIAL_INDEX_SPEC_H */
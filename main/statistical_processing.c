@@ -156,6 +156,25 @@ int _efind_write_temporal_control_stride = 0; //the number of that the temporal
 int _efind_write_temporal_control_seqstride = 0; //the number of that the temporal control for writes was performed (mixed version)
 int _efind_write_temporal_control_filled = 0; //the number of that the temporal control for writes had to be completed with random nodes
 
+/*for the external sort of the bulk loading*/
+double _sort_time = 0.0; //time to sort the records of the bulk loading (run generation and merges)
+double _sort_cpu_time = 0.0; //the same of previous but for cpu time
+int _sort_runs_num = 0; //number of runs written in temporary files
+
+/*for the batch operations*/
+int _batch_num = 0; //number of processed batches
+int _batch_op_num = 0; //number of operations (insertions, deletions, or updates) processed in batches
+
+/*for the sequential-insert fast path of R-trees and R*-trees*/
+int _leaf_hint_num = 0; //number of insertions done in the leaf node of the hint (i.e., without the choose_node)
+
+/*for the standard buffers (see BufferPolicy in buffer_handler.h)*/
+int _sbuffer_page_num = 0; //number of pages stored in the standard buffer before its last flushing
+int _sbuffer_ghost_hit = 0; //number of faults on pages remembered by the ARC (B1 and B2) and CLOCK-Pro (test pages) buffers
+int _sbuffer_written_pages = 0; //number of pages written back together by the standard buffer (see buffer_write_sorted_pages)
+int _sbuffer_write_runs = 0; //number of runs of consecutive pages of these writes (i.e., the number of writes after the coalescing)
+int _sbuffer_bg_write_num = 0; //number of pages written by the background writer (they are not counted in the writes of the buffer)
+
 /*the other statistical values with respect to the flash simulator are extracted from the flashdbsim global variables*/
 
 //local global variables
@@ -397,6 +416,197 @@ void statistic_reset_variables() {
     _efind_write_temporal_control_stride = 0; //the number of that the temporal control for writes was performed (stride version)
     _efind_write_temporal_control_seqstride = 0; //the number of that the temporal control for writes was performed (mixed version)
     _efind_write_temporal_control_filled = 0; //the number of that the temporal control for writes had to be completed with random nodes
+
+    /* statistical values for the external sort */
+    _sort_time = 0.0;
+    _sort_cpu_time = 0.0;
+    _sort_runs_num = 0;
+
+    /* statistical values for the batch operations */
+    _batch_num = 0;
+    _batch_op_num = 0;
+
+    /* statistical values for the sequential-insert fast path */
+    _leaf_hint_num = 0;
+
+    /* statistical values for the standard buffers */
+    _sbuffer_page_num = 0;
+    _sbuffer_ghost_hit = 0;
+    _sbuffer_written_pages = 0;
+    _sbuffer_write_runs = 0;
+    _sbuffer_bg_write_num = 0;
+}
+
+/* the variables of a statistic context (see statistic_context_use) */
+#define STATISTIC_CONTEXT_VARIABLES(V) \
+    V(double, _total_time) \
+    V(double, _index_time) \
+    V(double, _filter_time) \
+    V(double, _refinement_time) \
+    V(double, _retrieving_objects_time) \
+    V(double, _processing_predicates_time) \
+    V(double, _read_time) \
+    V(double, _write_time) \
+    V(double, _split_time) \
+    V(double, _total_cpu_time) \
+    V(double, _index_cpu_time) \
+    V(double, _filter_cpu_time) \
+    V(double, _refinement_cpu_time) \
+    V(double, _retrieving_objects_cpu_time) \
+    V(double, _processing_predicates_cpu_time) \
+    V(double, _read_cpu_time) \
+    V(double, _write_cpu_time) \
+    V(double, _split_cpu_time) \
+    V(int, _cand_num) \
+    V(int, _result_num) \
+    V(int, _read_num) \
+    V(int, _write_num) \
+    V(int, _split_int_num) \
+    V(int, _split_leaf_num) \
+    V(unsigned long long int, _processed_entries_num) \
+    V(int, _reinsertion_num) \
+    V(int, _visited_int_node_num) \
+    V(int, _visited_leaf_node_num) \
+    V(int, _written_int_node_num) \
+    V(int, _written_leaf_node_num) \
+    V(int, _deleted_int_node_num) \
+    V(int, _deleted_leaf_node_num) \
+    V(DynamicArrayInt *, _writes_per_height) \
+    V(DynamicArrayInt *, _reads_per_height) \
+    V(RWOrder *, _rw_order) \
+    V(double, _flushing_time) \
+    V(double, _flushing_cpu_time) \
+    V(int, _flushing_num) \
+    V(int, _flushed_nodes_num) \
+    V(int, _mod_node_buffer_num) \
+    V(int, _new_node_buffer_num) \
+    V(int, _del_node_buffer_num) \
+    V(int, _cur_mod_node_buffer_num) \
+    V(int, _cur_new_node_buffer_num) \
+    V(int, _cur_del_node_buffer_num) \
+    V(int, _cur_buffer_size) \
+    V(double, _ret_node_from_buf_time) \
+    V(double, _ret_node_from_buf_cpu_time) \
+    V(double, _write_log_time) \
+    V(double, _write_log_cpu_time) \
+    V(double, _compactation_log_time) \
+    V(double, _compactation_log_cpu_time) \
+    V(double, _recovery_log_time) \
+    V(double, _recovery_log_cpu_time) \
+    V(int, _compactation_log_num) \
+    V(int, _write_log_num) \
+    V(int, _read_log_num) \
+    V(int, _cur_log_size) \
+    V(int, _nof_unnecessary_flushed_nodes) \
+    V(int, _height) \
+    V(int, _entries_int_nodes) \
+    V(int, _entries_leaf_nodes) \
+    V(int, _internal_nodes_num) \
+    V(int, _leafs_nodes_num) \
+    V(int, _int_o_nodes_num) \
+    V(int, _leaf_o_nodes_num) \
+    V(int, _entries_int_o_nodes) \
+    V(int, _entries_leaf_o_nodes) \
+    V(int, _merge_back_num) \
+    V(int, _sbuffer_page_fault) \
+    V(int, _sbuffer_page_hit) \
+    V(double, _sbuffer_find_time) \
+    V(double, _sbuffer_find_cpu_time) \
+    V(double, _sbuffer_flushing_time) \
+    V(double, _sbuffer_flushing_cpu_time) \
+    V(int, _read_buffer_page_hit) \
+    V(int, _read_buffer_page_fault) \
+    V(int, _cur_read_buffer_size) \
+    V(double, _read_buffer_put_node_cpu_time) \
+    V(double, _read_buffer_put_node_time) \
+    V(double, _read_buffer_get_node_cpu_time) \
+    V(double, _read_buffer_get_node_time) \
+    V(int, _efind_force_node_in_read_buffer) \
+    V(int, _efind_write_temporal_control_sequential) \
+    V(int, _efind_write_temporal_control_stride) \
+    V(int, _efind_write_temporal_control_seqstride) \
+    V(int, _efind_write_temporal_control_filled) \
+    V(double, _sort_time) \
+    V(double, _sort_cpu_time) \
+    V(int, _sort_runs_num) \
+    V(int, _batch_num) \
+    V(int, _batch_op_num) \
+    V(int, _leaf_hint_num) \
+    V(int, _sbuffer_page_num) \
+    V(int, _sbuffer_ghost_hit) \
+    V(int, _sbuffer_written_pages) \
+    V(int, _sbuffer_write_runs) \
+    V(int, _sbuffer_bg_write_num)
+
+typedef struct StatisticContext {
+    char *key;
+#define STATISTIC_CONTEXT_FIELD(type, name) type name;
+    STATISTIC_CONTEXT_VARIABLES(STATISTIC_CONTEXT_FIELD)
+#undef STATISTIC_CONTEXT_FIELD
+    struct StatisticContext *next;
+} StatisticContext;
+
+static StatisticContext *contexts = NULL; //all the created contexts
+/* the active context (NULL means the default context)
+ * while a context is active, its struct keeps the values of the default context */
+static StatisticContext *active_context = NULL;
+
+/* it exchanges the values of the global variables and the values of ctx */
+static void statistic_context_swap(StatisticContext *ctx) {
+#define STATISTIC_CONTEXT_SWAP(type, name) { type tmp = name; name = ctx->name; ctx->name = tmp; }
+    STATISTIC_CONTEXT_VARIABLES(STATISTIC_CONTEXT_SWAP)
+#undef STATISTIC_CONTEXT_SWAP
+}
+
+void statistic_context_use(const char *key) {
+    StatisticContext *ctx;
+
+    //we firstly go back to the default context
+    if (active_context != NULL) {
+        statistic_context_swap(active_context);
+        active_context = NULL;
+    }
+    if (key == NULL)
+        return;
+
+    for (ctx = contexts; ctx != NULL; ctx = ctx->next) {
+        if (strcmp(ctx->key, key) == 0)
+            break;
+    }
+    if (ctx == NULL) {
+        //a new context starts with reset values (all of them are equal to zero) and its own arrays
+        ctx = (StatisticContext*) lwalloc(sizeof (StatisticContext));
+        memset(ctx, 0, sizeof (StatisticContext));
+        statistic_context_swap(ctx);
+        initiate_statistic_values();
+        statistic_context_swap(ctx);
+
+        ctx->key = (char*) lwalloc(strlen(key) + 1);
+        strcpy(ctx->key, key);
+        ctx->next = contexts;
+        contexts = ctx;
+    }
+
+    statistic_context_swap(ctx);
+    active_context = ctx;
+}
+
+void statistic_context_free_all() {
+    StatisticContext *ctx;
+
+    statistic_context_use(NULL);
+    while (contexts != NULL) {
+        ctx = contexts;
+        contexts = ctx->next;
+
+        //its arrays are freed as the global ones
+        statistic_context_swap(ctx);
+        statistic_free_allocated_memory();
+        statistic_context_swap(ctx);
+
+        lwfree(ctx->key);
+        lwfree(ctx);
+    }
 }
 
 static ArrayNode *create_arraynode(void);
@@ -626,6 +836,18 @@ int insert_statistic_bufferconfig() {
     } else if (_buffer_type == BUFFER_HLRU) {
         buf_type = lwalloc(sizeof ("HLRU"));
         sprintf(buf_type, "HLRU");
+    } else if (_buffer_type == BUFFER_ARC) {
+        buf_type = lwalloc(sizeof ("ARC"));
+        sprintf(buf_type, "ARC");
+    } else if (_buffer_type == BUFFER_CLOCKPRO) {
+        buf_type = lwalloc(sizeof ("CLOCKPRO"));
+        sprintf(buf_type, "CLOCKPRO");
+    } else if (_buffer_type == BUFFER_CFLRU) {
+        buf_type = lwalloc(sizeof ("CFLRU"));
+        sprintf(buf_type, "CFLRU");
+    } else if (_buffer_type == BUFFER_SHARED) {
+        buf_type = lwalloc(sizeof ("SHARED"));
+        sprintf(buf_type, "SHARED");
     }
 
     sprintf(select, "SELECT buf_id FROM fds.bufferconfiguration "
@@ -1030,7 +1252,18 @@ int insert_execution(const SpatialIndex *si, int idx_id, uint8_t variant, const
     stringbuffer_append(sb, "efind_write_tc_sequential, ");
     stringbuffer_append(sb, "efind_write_tc_stride, ");
     stringbuffer_append(sb, "efind_write_tc_seqstride, ");
-    stringbuffer_append(sb, "efind_write_tc_filled");
+    stringbuffer_append(sb, "efind_write_tc_filled, ");
+    stringbuffer_append(sb, "sort_time, ");
+    stringbuffer_append(sb, "sort_cpu_time, ");
+    stringbuffer_append(sb, "sort_runs_num, ");
+    stringbuffer_append(sb, "batch_num, ");
+    stringbuffer_append(sb, "batch_op_num, ");
+    stringbuffer_append(sb, "leaf_hint_num, ");
+    stringbuffer_append(sb, "sbuffer_page_num, ");
+    stringbuffer_append(sb, "sbuffer_ghost_hit, ");
+    stringbuffer_append(sb, "sbuffer_written_pages, ");
+    stringbuffer_append(sb, "sbuffer_write_runs, ");
+    stringbuffer_append(sb, "sbuffer_bg_write_num");
 
     stringbuffer_append(sb, ") VALUES (");
 
@@ -1254,7 +1487,18 @@ int insert_execution(const SpatialIndex *si, int idx_id, uint8_t variant, const
     stringbuffer_aprintf(sb, "%d, ", _efind_write_temporal_control_sequential);
     stringbuffer_aprintf(sb, "%d, ", _efind_write_temporal_control_stride);
     stringbuffer_aprintf(sb, "%d, ", _efind_write_temporal_control_seqstride);
-    stringbuffer_aprintf(sb, "%d", _efind_write_temporal_control_filled);
+    stringbuffer_aprintf(sb, "%d, ", _efind_write_temporal_control_filled);
+    stringbuffer_aprintf(sb, "%.17g, ", _sort_time);
+    stringbuffer_aprintf(sb, "%.17g, ", _sort_cpu_time);
+    stringbuffer_aprintf(sb, "%d, ", _sort_runs_num);
+    stringbuffer_aprintf(sb, "%d, ", _batch_num);
+    stringbuffer_aprintf(sb, "%d, ", _batch_op_num);
+    stringbuffer_aprintf(sb, "%d, ", _leaf_hint_num);
+    stringbuffer_aprintf(sb, "%d, ", _sbuffer_page_num);
+    stringbuffer_aprintf(sb, "%d, ", _sbuffer_ghost_hit);
+    stringbuffer_aprintf(sb, "%d, ", _sbuffer_written_pages);
+    stringbuffer_aprintf(sb, "%d, ", _sbuffer_write_runs);
+    stringbuffer_aprintf(sb, "%d", _sbuffer_bg_write_num);
 
     stringbuffer_append(sb, ") RETURNING pe_id");
 
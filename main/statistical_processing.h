@@ -196,6 +196,25 @@ extern int _efind_write_temporal_control_stride; //the number of that the tempor
 extern int _efind_write_temporal_control_seqstride; //the number of that the temporal control for writes was performed (mixed version) (done)
 extern int _efind_write_temporal_control_filled; //the number of that the temporal control for writes had to be completed with random nodes (done)
 
+/*for the external sort of the bulk loading*/
+extern double _sort_time; //time to sort the records of the bulk loading (run generation and merges)
+extern double _sort_cpu_time; //the same of previous but for cpu time
+extern int _sort_runs_num; //number of runs written in temporary files
+
+/*for the batch operations*/
+extern int _batch_num; //number of processed batches
+extern int _batch_op_num; //number of operations (insertions, deletions, or updates) processed in batches
+
+/*for the sequential-insert fast path of R-trees and R*-trees*/
+extern int _leaf_hint_num; //number of insertions done in the leaf node of the hint (i.e., without the choose_node)
+
+/*for the standard buffers (see BufferPolicy in buffer_handler.h)*/
+extern int _sbuffer_page_num; //number of pages stored in the standard buffer before its last flushing
+extern int _sbuffer_ghost_hit; //number of faults on pages remembered by the ARC (B1 and B2) and CLOCK-Pro (test pages) buffers
+extern int _sbuffer_written_pages; //number of pages written back together by the standard buffer (see buffer_write_sorted_pages)
+extern int _sbuffer_write_runs; //number of runs of consecutive pages of these writes (i.e., the number of writes after the coalescing)
+extern int _sbuffer_bg_write_num; //number of pages written by the background writer (they are not counted in the writes of the buffer)
+
 /*the other statistical values with respect to the flash simulator are extracted from the flashdbsim global variables*/
 
 /************************************
@@ -226,6 +245,20 @@ extern void statistic_free_allocated_memory(void);
 //this function reset all global variables related to the time/count collections
 extern void statistic_reset_variables(void);
 
+/* statistic contexts keep the statistical data of several indices that are manipulated in the same workload
+ * (e.g., indices built from a single scan of their source)
+ * a context is identified by a key (e.g., the absolute path of its index) and stores all the variables above,
+ * except for _STORING, _COLLECT_READ_WRITE_ORDER, _execution_name, and _query_predicate, which are shared
+ * the statistical values of the flash simulator are also shared */
+
+/*this function activates the context of key: the global variables are saved in the previously active context
+ * and the values of the context of key are loaded (a new context starts with reset values)
+ * key equal to NULL activates the default context (i.e., the one used when no context was activated)*/
+extern void statistic_context_use(const char *key);
+
+/*this function activates the default context and frees all the other contexts*/
+extern void statistic_context_free_all(void);
+
 /*this function returns the CPU time in order to compute the CPU time used*/
 extern struct timespec get_CPU_time(void);
 
@@ -15,140 +15,67 @@
 #include "storage_handler.h"
 #include "../buffer/buffer_handler.h" //it also includes the iohandler, and flashdbsimhandler
 #include "log_messages.h"
+#include "statistical_processing.h"
+
+#include <sys/types.h>  /* required by open() */
+#include <unistd.h>     /* read(), write() */
+#include <fcntl.h>      /* open() */
+#include <stdlib.h>     /* qsort() */
+
+/* the state of a buffer is stored in a file next to the header of the index (see storage_save_buffer_state) */
+#define BUFFER_STATE_SUFFIX     ".bufferstate"
+
+typedef struct {
+    uint8_t buffer_type; //the buffer that stored the pages
+    uint8_t auto_prewarm; //should it be loaded in the first access to the index by the process?
+    int nofpages;
+} BufferStateHeader;
 
 void storage_read_one_page(const SpatialIndex *si, int page, uint8_t *buf, int height) {
     /*this page is stored in the disk?*/
     if (si->bs->buffer_type == BUFFER_NONE) {
-        FileSpecification fs;
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_read_one_page(&fs, page, buf);
-        else if (si->gp->storage_system->type == FLASHDBSIM) {
-            flashdbsim_read_one_page(si, page, buf);
-        } else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_read_one_page(si, page, buf);
     } else { /*in this case, this page is stored in a buffer scheme*/
-        switch (si->bs->buffer_type) {
-            case BUFFER_LRU:
-            {
-                buffer_lru_find(si, page, buf);
-                break;
-            }
-            case BUFFER_HLRU:
-            {
-                buffer_hlru_find(si, page, buf, height);
-                break;
-            }
-            case BUFFER_S2Q:
-            {
-                buffer_s2q_find(si, page, buf);
-                break;
-            }
-            case BUFFER_2Q:
-            {
-                buffer_2q_find(si, page, buf);
-                break;
-            }
-            default:
-                _DEBUGF(ERROR, "There is no this buffer scheme: %d ", si->bs->buffer_type);
-        }
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+        policy->find(si, page, buf, height);
     }
 }
 
+uint8_t *storage_pin_page(const SpatialIndex *si, int page, int height) {
+    if (si->bs->buffer_type != BUFFER_NONE) {
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+        if (policy->pin != NULL)
+            return policy->pin(si, page, height);
+    }
+    return NULL;
+}
+
+void storage_unpin_page(const SpatialIndex *si, int page) {
+    const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+    policy->unpin(page);
+}
+
 void storage_write_one_page(const SpatialIndex *si, uint8_t *buf, int page, int height) {   
     /*this page is stored in the disk?*/
     if (si->bs->buffer_type == BUFFER_NONE) {
-        FileSpecification fs;
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write_one_page(&fs, page, buf);
-        else if (si->gp->storage_system->type == FLASHDBSIM) {
-            flashdbsim_write_one_page(si, buf, page);
-        } else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_write_one_page(si, page, buf);
     } else { /*in this case, this page is stored in a buffer scheme*/
-        switch (si->bs->buffer_type) {
-            case BUFFER_LRU:
-            {
-                buffer_lru_add(si, page, buf);
-                break;
-            }
-            case BUFFER_HLRU:
-            {
-                buffer_hlru_add(si, page, buf, height);
-                break;
-            }
-            case BUFFER_S2Q:
-            {
-                buffer_s2q_add(si, page, buf);
-                break;
-            }
-            case BUFFER_2Q:
-            {
-                buffer_2q_add(si, page, buf);
-                break;
-            }
-            default:
-                _DEBUGF(ERROR, "There is no this buffer scheme: %d ", si->bs->buffer_type);
-        }
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+        policy->add(si, page, buf, height);
     }
 }
 
 void storage_read_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int *height, int pagenum) {
     /*this page is stored in the disk?*/
     if (si->bs->buffer_type == BUFFER_NONE) {
-        FileSpecification fs;
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_read(&fs, pages, buf, pagenum);
-        else if (si->gp->storage_system->type == FLASHDBSIM) {
-            flashdbsim_read_pages(si, pages, buf, pagenum);
-        } else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_read_pages(si, pages, buf, pagenum);
     } else { /*in this case, this page is stored in a buffer scheme*/
         /*since the available buffers do not support sequential reads, we perform pagenum reads*/
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
         int i;
         int page_size = si->gp->page_size;
-        switch (si->bs->buffer_type) {
-            case BUFFER_LRU:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_lru_find(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            case BUFFER_HLRU:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_hlru_find(si, pages[i], buf + i * page_size, height[i]);
-                }
-                break;
-            }
-            case BUFFER_S2Q:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_s2q_find(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            case BUFFER_2Q:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_2q_find(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            default:
-                _DEBUGF(ERROR, "There is no this buffer scheme: %d ", si->bs->buffer_type);
+        for (i = 0; i < pagenum; i++) {
+            policy->find(si, pages[i], buf + i * page_size, height[i]);
         }
     }
 }
@@ -156,90 +83,250 @@ void storage_read_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int *h
 void storage_write_pages(const SpatialIndex *si, int *pages, uint8_t *buf, int *height, int pagenum) {
     /*this page is stored in the disk?*/
     if (si->bs->buffer_type == BUFFER_NONE) {
-        FileSpecification fs;
-        fs.index_path = si->index_file;
-        fs.io_access = si->gp->io_access;
-        fs.page_size = si->gp->page_size;
-
-        if (si->gp->storage_system->type == SSD || si->gp->storage_system->type == HDD)
-            disk_write(&fs, pages, buf, pagenum);
-        else if (si->gp->storage_system->type == FLASHDBSIM) {
-            flashdbsim_write_pages(si, pages, buf, pagenum);
-        } else
-            _DEBUGF(ERROR, "There is no this storage system: %d ", si->gp->storage_system->type);
+        buffer_write_pages(si, pages, buf, pagenum);
     } else { /*in this case, this page is stored in a buffer scheme*/
         /*since the available buffers do not support sequential writes, we perform pagenum writes*/
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
         int i;
         int page_size = si->gp->page_size;
-        switch (si->bs->buffer_type) {
-            case BUFFER_LRU:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_lru_add(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            case BUFFER_HLRU:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_hlru_add(si, pages[i], buf + i * page_size, height[i]);
-                }
-                break;
-            }
-            case BUFFER_S2Q:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_s2q_add(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            case BUFFER_2Q:
-            {
-                for (i = 0; i < pagenum; i++) {
-                    buffer_2q_add(si, pages[i], buf + i * page_size);
-                }
-                break;
-            }
-            default:
-                _DEBUGF(ERROR, "There is no this buffer scheme: %d ", si->bs->buffer_type);
+        for (i = 0; i < pagenum; i++) {
+            policy->add(si, pages[i], buf + i * page_size, height[i]);
         }
     }
 }
 
 void storage_update_tree_height(const SpatialIndex *si, int new_height) {
-    if (si->bs->buffer_type == BUFFER_HLRU) {
-        //an update is only needed for HLRU
-        buffer_hlru_update_tree_height(new_height);
-    } //other types of buffers should be included here as elseif cases
+    if (si->bs->buffer_type != BUFFER_NONE) {
+        //an update is only needed for policies that consider the height of the nodes (e.g., HLRU)
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+        if (policy->on_height_change != NULL)
+            policy->on_height_change(new_height);
+    }
 }
 
 void storage_flush_all(const SpatialIndex *si) {
-    switch (si->bs->buffer_type) {
-        case BUFFER_NONE: //there is nothing to do here
-            break;
-        case BUFFER_LRU:
-        {
-            buffer_lru_flush_all(si);
-            break;
-        }
-        case BUFFER_HLRU:
-        {
-            buffer_hlru_flush_all(si);
-            break;
+    if (si->bs->buffer_type != BUFFER_NONE) {
+        const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+        buffer_bgwriter_check(si->bs->buffer_type);
+#ifdef COLLECT_STATISTICAL_DATA
+        //the number of pages kept in the buffer until this flushing
+        _sbuffer_page_num = policy->number_of_pages();
+#endif
+        policy->flush_all(si);
+    }
+}
+
+static char *storage_buffer_state_file(const char *header_file) {
+    size_t len = strlen(header_file);
+    size_t suffix = strlen(".header");
+    char *file;
+
+    //the extension of the header is replaced
+    if (len >= suffix && strcmp(header_file + len - suffix, ".header") == 0)
+        len -= suffix;
+    file = (char*) lwalloc(len + strlen(BUFFER_STATE_SUFFIX) + 1);
+    memcpy(file, header_file, len);
+    strcpy(file + len, BUFFER_STATE_SUFFIX);
+    return file;
+}
+
+/* it reads the state of the buffer, it returns false if there is no state file */
+static bool storage_read_buffer_state(const char *header_file, BufferStateHeader *h, int **pages, int **heights) {
+    char *file = storage_buffer_state_file(header_file);
+    int fd;
+    bool ret = false;
+
+    if ((fd = open(file, O_RDONLY)) >= 0) {
+        if (read(fd, h, sizeof (BufferStateHeader)) == sizeof (BufferStateHeader) && h->nofpages >= 0) {
+            *pages = (int*) lwalloc(sizeof (int) * (h->nofpages + 1));
+            *heights = (int*) lwalloc(sizeof (int) * (h->nofpages + 1));
+            if (read(fd, *pages, sizeof (int) * h->nofpages) == (ssize_t) (sizeof (int) * h->nofpages) &&
+                    read(fd, *heights, sizeof (int) * h->nofpages) == (ssize_t) (sizeof (int) * h->nofpages)) {
+                ret = true;
+            } else {
+                lwfree(*pages);
+                lwfree(*heights);
+            }
         }
-        case BUFFER_S2Q:
-        {
-            buffer_s2q_flush_all(si);
-            break;
+        if (!ret)
+            _DEBUGF(WARNING, "The file '%s' is not a valid state of a buffer", file);
+        close(fd);
+    }
+    lwfree(file);
+    return ret;
+}
+
+bool storage_save_buffer_state(const SpatialIndex *si, const char *header_file, bool auto_prewarm) {
+    const BufferPolicy *policy;
+    BufferStateHeader h;
+    int *pages, *heights;
+    char *file;
+    int fd, i, n;
+    bool ret = true;
+
+    if (si->bs->buffer_type == BUFFER_NONE) {
+        _DEBUG(WARNING, "The index does not have a buffer to be saved");
+        return false;
+    }
+
+    policy = buffer_get_policy(si->bs->buffer_type);
+    n = (int) policy->number_of_pages();
+    pages = (int*) lwalloc(sizeof (int) * (n + 1));
+    heights = (int*) lwalloc(sizeof (int) * (n + 1));
+    //the heights are only known by some policies (e.g., HLRU)
+    for (i = 0; i < n; i++)
+        heights[i] = -1;
+
+    memset(&h, 0, sizeof (BufferStateHeader));
+    h.buffer_type = si->bs->buffer_type;
+    h.auto_prewarm = auto_prewarm ? 1 : 0;
+    h.nofpages = policy->resident_pages(pages, heights, n);
+
+    file = storage_buffer_state_file(header_file);
+    if ((fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR)) < 0) {
+        _DEBUGF(WARNING, "It was impossible to create the file '%s'", file);
+        ret = false;
+    } else {
+        if (write(fd, &h, sizeof (BufferStateHeader)) != sizeof (BufferStateHeader) ||
+                write(fd, pages, sizeof (int) * h.nofpages) != (ssize_t) (sizeof (int) * h.nofpages) ||
+                write(fd, heights, sizeof (int) * h.nofpages) != (ssize_t) (sizeof (int) * h.nofpages)) {
+            _DEBUGF(WARNING, "It was impossible to write the file '%s'", file);
+            ret = false;
         }
-        case BUFFER_2Q:
-        {
-            buffer_2q_flush_all(si);
-            break;
+        close(fd);
+    }
+
+    lwfree(file);
+    lwfree(pages);
+    lwfree(heights);
+    return ret;
+}
+
+/* a page to be read and its position in the state of the buffer */
+typedef struct {
+    int page;
+    int pos;
+} BufferStateRead;
+
+static int buffer_state_read_comp(const void *a, const void *b) {
+    int p1 = ((const BufferStateRead*) a)->page;
+    int p2 = ((const BufferStateRead*) b)->page;
+    return (p1 > p2) - (p1 < p2);
+}
+
+/* it reads the pages in the order of their identifiers (thus, consecutive pages are read together)
+ * and loads them in the order of the state (i.e., the most valuable pages are the last loaded ones) */
+static int storage_prewarm_from_state(const SpatialIndex *si, const BufferStateHeader *h, int *pages, int *heights) {
+    const BufferPolicy *policy = buffer_get_policy(si->bs->buffer_type);
+    int nofframes = policy->capacity(si);
+    int first = 0;
+    int n, i;
+    BufferStateRead *r;
+    int *sorted, *slot;
+    uint8_t *volatile buf = NULL; //it is volatile since it is modified inside PG_TRY
+#ifdef COLLECT_STATISTICAL_DATA
+    uint8_t storing = _STORING;
+#endif
+
+    if (h->buffer_type != si->bs->buffer_type) {
+        _DEBUGF(WARNING, "The saved state belongs to another type of buffer (%d), it was not loaded", h->buffer_type);
+        return 0;
+    }
+
+    //only the most valuable pages that fit in the buffer are loaded
+    if (h->nofpages > nofframes)
+        first = h->nofpages - nofframes;
+    n = h->nofpages - first;
+    if (n <= 0)
+        return 0;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    //the prewarming is not considered in the statistical data
+    _STORING = 1;
+#endif
+
+    r = (BufferStateRead*) lwalloc(sizeof (BufferStateRead) * n);
+    for (i = 0; i < n; i++) {
+        r[i].page = pages[first + i];
+        r[i].pos = i;
+    }
+    qsort(r, n, sizeof (BufferStateRead), buffer_state_read_comp);
+
+    sorted = (int*) lwalloc(sizeof (int) * n);
+    slot = (int*) lwalloc(sizeof (int) * n);
+    for (i = 0; i < n; i++) {
+        sorted[i] = r[i].page;
+        slot[r[i].pos] = i;
+    }
+    lwfree(r);
+
+    //the flag of the statistical data must be restored even if the reading or the loading raises an error
+    PG_TRY();
+    {
+        buf = buffer_alloc_pages(si, n);
+        buffer_read_pages(si, sorted, buf, n);
+
+        for (i = 0; i < n; i++) {
+            policy->load(si, pages[first + i], buf + (size_t) slot[i] * si->gp->page_size, heights[first + i]);
         }
-        default:
-            _DEBUGF(ERROR, "There is no this buffer scheme: %d ", si->bs->buffer_type);
     }
+    PG_CATCH();
+    {
+        if (buf != NULL)
+            buffer_free_page(si, buf);
+#ifdef COLLECT_STATISTICAL_DATA
+        _STORING = storing;
+#endif
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    buffer_free_page(si, buf);
+    lwfree(sorted);
+    lwfree(slot);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _STORING = storing;
+#endif
+    return n;
+}
+
+int storage_prewarm_buffer(const SpatialIndex *si, const char *header_file) {
+    BufferStateHeader h;
+    int *pages, *heights;
+    int n;
+
+    if (si->bs->buffer_type == BUFFER_NONE) {
+        _DEBUG(WARNING, "The index does not have a buffer to be prewarmed");
+        return 0;
+    }
+    if (!storage_read_buffer_state(header_file, &h, &pages, &heights)) {
+        _DEBUG(WARNING, "There is no saved state of the buffer of this index");
+        return 0;
+    }
+    n = storage_prewarm_from_state(si, &h, pages, heights);
+    lwfree(pages);
+    lwfree(heights);
+    return n;
+}
+
+void storage_auto_prewarm_buffer(const SpatialIndex *si, const char *header_file) {
+    static bool checked = false; //only the first access of the process is considered
+    BufferStateHeader h;
+    int *pages, *heights;
+
+    if (checked)
+        return;
+    checked = true;
+
+    if (si->bs->buffer_type == BUFFER_NONE || buffer_get_policy(si->bs->buffer_type)->number_of_pages() > 0)
+        return;
+    if (!storage_read_buffer_state(header_file, &h, &pages, &heights))
+        return;
+    if (h.auto_prewarm)
+        storage_prewarm_from_state(si, &h, pages, heights);
+    lwfree(pages);
+    lwfree(heights);
 }
 
 //flash for flashdbsim to know if it is ready to be used or not
@@ -33,6 +33,13 @@
 extern void storage_read_one_page(const SpatialIndex *si, int page, uint8_t *buf, int height); 
 extern void storage_write_one_page(const SpatialIndex *si, uint8_t *buf, int page, int height);
 
+/*zero-copy reads: if the page is stored in the buffer of the index, it returns its frame (which must not be modified)
+ and the page is pinned, that is, it is not evicted until storage_unpin_page is called
+ it returns NULL if the page is not in the buffer (or the index has no buffer that supports pinning),
+ then the caller has to read the page by using storage_read_one_page*/
+extern uint8_t *storage_pin_page(const SpatialIndex *si, int page, int height);
+extern void storage_unpin_page(const SpatialIndex *si, int page);
+
 /*this is for the handling of several pages together, which commonly will be sequential pages
  when the current index is using traditional buffers:
  * when pagenum is greater than 0, it will perform pagenum times teh corresponding function.
@@ -49,6 +56,15 @@ extern void storage_update_tree_height(const SpatialIndex *si, int new_height);
 /* if a buffer is used by this index, them we apply all the modifications contained in such buffer*/
 extern void storage_flush_all(const SpatialIndex *si);
 
+/* it saves the identifiers of the pages stored in the buffer (and their heights for HLRU) in a file next to
+ * the header of the index, auto_prewarm indicates that the pages are automatically loaded
+ * in the first access to the index by a process (see storage_auto_prewarm_buffer) */
+extern bool storage_save_buffer_state(const SpatialIndex *si, const char *header_file, bool auto_prewarm);
+/* it loads the pages saved by storage_save_buffer_state in the buffer, it returns the number of loaded pages */
+extern int storage_prewarm_buffer(const SpatialIndex *si, const char *header_file);
+/* it is called by spatialindex_from_header */
+extern void storage_auto_prewarm_buffer(const SpatialIndex *si, const char *header_file);
+
 extern bool is_flashdbsim_initialized;
 
 extern void check_flashsimulator_initialization(const StorageSystem *s);
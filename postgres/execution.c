@@ -30,20 +30,27 @@
 #include "../main/header_handler.h" //to get spatial index from header
 #include "../main/log_messages.h" //for messages
 #include "../main/statistical_processing.h" //for statistical processing
+#include "../buffer/buffer_handler.h" //for the background writer of the standard buffers
 
 /*information about the specification of each index*/
 #include "../rtree/rtree.h"
 #include "../rstartree/rstartree.h"
 #include "../hilbertrtree/hilbertrtree.h"
+#include "../hilbertrtree/hilbert_value.h" //for the order of batches
 #include "../fast/fast_buffer.h"
 #include "../fortree/fortree_buffer.h"
 #include "../fast/fast_flush_module.h"
 #include "../efind/efind_flushing_manager.h"
 #include "../efind/efind_read_buffer_policies.h"
+#include "../fast/fast_log_module.h" //for the log groups of batches
+#include "../efind/efind_log_manager.h"
 
 #include "query.h" //for query processing
 
 #include "access/htup_details.h"
+#include "catalog/pg_type.h" //for INT8OID
+#include "utils/array.h" //for the arrays of batches
+#include "utils/lsyscache.h"
 #include "utils/builtins.h"
 
 #include "../festival_config.h"
@@ -54,13 +61,116 @@
 static GenericParameters *read_basicconfiguration_from_fds(int bc_id);
 static Source *read_source_from_fds(int src_id);
 static BufferSpecification *read_bufferconfiguration_from_fds(int buf_id, int page_size);
-static void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size);
-static void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_size);
+static void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size, uint8_t idx_type);
+static void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_size, uint8_t idx_type);
 static void set_hilbertrtreespec_from_fds(HilbertRTreeSpecification *spec, int sc_id, int page_size);
 static FASTSpecification *set_fastspec_from_fds(int sc_id, int *index_type);
 static FORTreeSpecification *set_fortreespec_from_fds(int sc_id, int page_size);
 static eFINDSpecification *set_efindspec_from_fds(int sc_id, int *index_type);
 
+/* number of rows fetched at a time by the cursor of the bulk loading */
+#define BULKLOAD_FETCH_SIZE 100000
+/* number of pages of each I/O block of the external sort of the bulk loading */
+#define BULKLOAD_SORT_BLOCK_PAGES 64
+/* number of rows of each page of the keyset pagination of the build from a source */
+#define BUILD_PAGE_ROWS 100000
+
+/* types of the operations of a batch */
+#define BATCH_INSERT    1
+#define BATCH_REMOVE    2
+#define BATCH_UPDATE    3
+
+/* an operation of a batch and its sort key */
+typedef struct {
+    hilbert_value_t key;
+    int index; //the position of the operation in the arrays of the batch
+} BatchOrder;
+
+static int batch_order_comp(const void *a, const void *b);
+/* it reads a batch from an array of pointers and an array of geometries with the same length
+ * it returns the number of elements */
+static int read_batch(ArrayType *pointers, ArrayType *geoms, int **ptrs, LWGEOM ***lwgeoms);
+/* it returns the order in which the operations of a batch are applied
+ * if sort is true, the operations follow the hilbert values of the bboxes of geoms (for locality),
+ * otherwise, they follow the order of the arrays */
+static int *batch_order(LWGEOM **geoms, int n, bool sort);
+/* it applies a batch of operations (BATCH_INSERT, BATCH_REMOVE, or BATCH_UPDATE) by obtaining the index only once
+ * the arguments are the index_name, index_path, the arrays of the batch, and the sort flag as the last argument
+ * for FAST and eFIND indices, the log entries of the batch are written as a single group */
+static bool process_batch(PG_FUNCTION_ARGS, uint8_t operation);
+/* it inserts all the objects of the source src_id into the nofindices indices of sis by reading the source only once
+ * if keys is not NULL, the statistical data of the index sis[i] is collected in the statistic context keys[i]
+ * (the default context is active at the end) */
+static void build_from_source(SpatialIndex **sis, char **keys, int nofindices, int src_id, int progress_interval);
+/* it reads the pointers and bboxes of all the objects of a source by using a cursor
+ * the objects are added into ble, or into es with their hilbert values as keys (for Hilbert R-trees)
+ * it returns the SRID of the objects */
+static int read_bulkload_entries(const Source *src, BulkLoadEntries *ble, ExternalSort *es);
+
+int read_bulkload_entries(const Source *src, BulkLoadEntries *ble, ExternalSort *es) {
+    char *query;
+    SPIPlanPtr plan;
+    Portal portal;
+    GSERIALIZED *g;
+    GBOX gbox;
+    BBox bbox;
+    Datum d;
+    bool isnull;
+    int pointer;
+    int srid = 0;
+    uint64 i, n;
+
+    query = lwalloc(strlen(src->pk) + strlen(src->column) + strlen(src->schema) + strlen(src->table) + 32);
+    sprintf(query, "SELECT %s::int4, %s FROM %s.%s", src->pk, src->column, src->schema, src->table);
+
+    if (SPI_OK_CONNECT != SPI_connect()) {
+        SPI_finish();
+        _DEBUG(ERROR, "read_bulkload_entries: could not connect to SPI manager");
+        return 0;
+    }
+    plan = SPI_prepare(query, 0, NULL);
+    if (plan == NULL) {
+        SPI_finish();
+        _DEBUG(ERROR, "read_bulkload_entries: could not prepare the SELECT command");
+        return 0;
+    }
+    portal = SPI_cursor_open(NULL, plan, NULL, NULL, true);
+
+    do {
+        SPI_cursor_fetch(portal, true, BULKLOAD_FETCH_SIZE);
+        n = SPI_processed;
+        for (i = 0; i < n; i++) {
+            pointer = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull));
+            if (isnull)
+                continue;
+            d = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2, &isnull);
+            if (isnull)
+                continue;
+
+            //we only need the bbox of the object, and empty objects are not indexed
+            g = (GSERIALIZED*) PG_DETOAST_DATUM(d);
+            if (gserialized_get_gbox_p(g, &gbox) == LW_SUCCESS) {
+                srid = gserialized_get_srid(g);
+                gbox_to_bbox(&gbox, &bbox);
+                //the hilbert value of each object is computed only once
+                if (es != NULL)
+                    externalsort_add(es, hilbertvalue_compute(&bbox, srid), pointer, &bbox);
+                else
+                    bulkload_entries_add(ble, pointer, &bbox);
+            }
+            if ((Pointer) g != DatumGetPointer(d))
+                pfree(g);
+        }
+        SPI_freetuptable(SPI_tuptable);
+    } while (n > 0);
+
+    SPI_cursor_close(portal);
+    SPI_finish();
+
+    lwfree(query);
+    return srid;
+}
+
 GenericParameters *read_basicconfiguration_from_fds(int bc_id) {
     GenericParameters *gp;
     char query[512];
@@ -315,6 +425,55 @@ BufferSpecification *read_bufferconfiguration_from_fds(int buf_id, int page_size
         bs->buffer_type = BUFFER_LRU;
     } else if (strcmp(t, "HLRU") == 0) {
         bs->buffer_type = BUFFER_HLRU;
+    } else if (strcmp(t, "ARC") == 0) {
+        bs->buffer_type = BUFFER_ARC;
+    } else if (strcmp(t, "CLOCKPRO") == 0) {
+        bs->buffer_type = BUFFER_CLOCKPRO;
+    } else if (strcmp(t, "SHARED") == 0) {
+        bs->buffer_type = BUFFER_SHARED;
+    } else if (strncmp(t, "CFLRU", 5) == 0) {
+        char *ptr;
+        char *start;
+        MemoryContext old_context;
+        BufferCFLRUSpecification *spec_cflru;
+
+        old_context = MemoryContextSwitchTo(TopMemoryContext);
+        spec_cflru = (BufferCFLRUSpecification*) lwalloc(sizeof (BufferCFLRUSpecification));
+
+        bs->buffer_type = BUFFER_CFLRU;
+
+        start = t;
+
+        //the parameter of the CFLRU is optional and it is provided in the following format
+        //CFLRU(window_size_perc); without it, the window is adapted from the costs of reads and writes
+        spec_cflru->window_perc = -1.0;
+        t += 5;
+        while (isspace(*t)) t++;
+        if (*t == '(') {
+            t += 1; //parentheses
+            //the number
+            spec_cflru->window_perc = strtod(t, &ptr);
+            t = ptr;
+
+            while (isspace(*t)) t++;
+            if (*t == ')')
+                t += 1; //parentheses
+            else
+                _DEBUGF(ERROR, "Invalid format (%s). "
+                    "Format to define the parameter of CFLRU buffer is: CFLRU(window_size_perc)", start);
+
+            if (spec_cflru->window_perc < 0 || spec_cflru->window_perc > 100) {
+                _DEBUGF(ERROR, "Value %f is not valid for the CFLRU buffer", spec_cflru->window_perc);
+            }
+        } else if (*t != '\0') {
+            _DEBUGF(ERROR, "Invalid format (%s). "
+                "Format to define the parameter of CFLRU buffer is: CFLRU(window_size_perc)", start);
+        }
+
+        bs->buf_additional_param = (void*) spec_cflru;
+
+        MemoryContextSwitchTo(old_context);
+        t = start;
     } else if (strncmp(t, "S2Q", 3) == 0) {
         double a1_perc = -1.0;
         int nofpages;
@@ -446,19 +605,21 @@ BufferSpecification *read_bufferconfiguration_from_fds(int buf_id, int page_size
     return bs;
 }
 
-void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size) {
+void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size, uint8_t idx_type) {
     int split;
+    int clip_points;
+    size_t int_entry_size;
     double max_fill_leaf_nodes;
     double max_fill_int_nodes;
     double min_fill_leaf_nodes;
     double min_fill_int_nodes;
 
-    char query[256];
+    char query[512];
     int err;
     char *s;
 
     sprintf(query, "SELECT upper(split_type), min_fill_int_nodes, "
-            "min_fill_leaf_nodes, max_fill_int_nodes, max_fill_leaf_nodes, o.or_id "
+            "min_fill_leaf_nodes, max_fill_int_nodes, max_fill_leaf_nodes, o.or_id, clip_points, aggregate, leaf_hint "
             "FROM fds.rtreeconfiguration as c, fds.occupancyrate as o "
             "WHERE c.or_id = o.or_id AND sc_id = %d;", sc_id);
 
@@ -486,6 +647,9 @@ void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size)
     max_fill_int_nodes = atof(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 4));
     max_fill_leaf_nodes = atof(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 5));
     spec->or_id = atoi(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 6));
+    clip_points = atoi(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 7));
+    spec->aggregate = (strcmp(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 8), "t") == 0);
+    spec->leaf_hint = (strcmp(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 9), "t") == 0);
 
     if (strcmp(s, "EXPONENTIAL") == 0) {
         split = RTREE_EXPONENTIAL_SPLIT;
@@ -507,18 +671,30 @@ void set_rtreespec_from_fds(RTreeSpecification *spec, int sc_id, int page_size)
     SPI_finish();
 
     spec->split_type = split;
+    /* clip points are only maintained by disk-based R-trees 
+     * since the buffers of the flash-aware indices only store modifications of pointers and bboxes */
+    if (idx_type == CONVENTIONAL_RTREE && clip_points > 0)
+        spec->nof_clip_points = (uint8_t) (clip_points > MAX_CLIP_POINTS ? MAX_CLIP_POINTS : clip_points);
+    else
+        spec->nof_clip_points = 0;
+    int_entry_size = rentry_size_with_clips(spec->nof_clip_points);
+    /* entries of internal nodes of aggregate R-trees also store the number of objects of their subtrees */
+    if (spec->aggregate)
+        int_entry_size += sizeof (uint32_t);
     spec->max_entries_leaf_node = rtreesinfo_get_max_entries(CONVENTIONAL_RTREE,
             page_size, rentry_size(), max_fill_leaf_nodes / 100.0);
     spec->max_entries_int_node = rtreesinfo_get_max_entries(CONVENTIONAL_RTREE,
-            page_size, rentry_size(), max_fill_int_nodes / 100.0);
+            page_size, int_entry_size, max_fill_int_nodes / 100.0);
     spec->min_entries_leaf_node = rtreesinfo_get_min_entries(CONVENTIONAL_RTREE,
             spec->max_entries_leaf_node, min_fill_leaf_nodes / 100.0);
     spec->min_entries_int_node = rtreesinfo_get_min_entries(CONVENTIONAL_RTREE,
             spec->max_entries_int_node, min_fill_int_nodes / 100.0);
 }
 
-void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_size) {
+void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_size, uint8_t idx_type) {
     char query[512];
+    int clip_points;
+    size_t int_entry_size;
     int err;
     char *s;
     double max_fill_leaf_nodes;
@@ -529,7 +705,7 @@ void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_
 
     sprintf(query, "SELECT reinsertion_perc_internal_node, reinsertion_perc_leaf_node, "
             "upper(reinsertion_type), max_neighbors_exam, min_fill_int_nodes, "
-            "min_fill_leaf_nodes, max_fill_int_nodes, max_fill_leaf_nodes, o.or_id "
+            "min_fill_leaf_nodes, max_fill_int_nodes, max_fill_leaf_nodes, o.or_id, clip_points, aggregate, leaf_hint "
             "FROM fds.rstartreeconfiguration as c, fds.occupancyrate as o "
             "WHERE c.or_id = o.or_id AND sc_id = %d;", sc_id);
 
@@ -560,6 +736,9 @@ void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_
     max_fill_int_nodes = atof(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 7));
     max_fill_leaf_nodes = atof(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 8));
     rs->or_id = atoi(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 9));
+    clip_points = atoi(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 10));
+    rs->aggregate = (strcmp(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 11), "t") == 0);
+    rs->leaf_hint = (strcmp(SPI_getvalue(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 12), "t") == 0);
 
     if (strcmp(s, "FAR REINSERT") == 0) {
         rein_tp = FAR_REINSERT;
@@ -573,10 +752,19 @@ void set_rstartreespec_from_fds(RStarTreeSpecification *rs, int sc_id, int page_
     SPI_finish();
 
     rs->reinsert_type = rein_tp;
+    /* clip points are only maintained by disk-based R*-trees (see set_rtreespec_from_fds) */
+    if (idx_type == CONVENTIONAL_RSTARTREE && clip_points > 0)
+        rs->nof_clip_points = (uint8_t) (clip_points > MAX_CLIP_POINTS ? MAX_CLIP_POINTS : clip_points);
+    else
+        rs->nof_clip_points = 0;
+    int_entry_size = rentry_size_with_clips(rs->nof_clip_points);
+    /* see set_rtreespec_from_fds */
+    if (rs->aggregate)
+        int_entry_size += sizeof (uint32_t);
     rs->max_entries_leaf_node = rtreesinfo_get_max_entries(CONVENTIONAL_RSTARTREE,
             page_size, rentry_size(), max_fill_leaf_nodes / 100.0);
     rs->max_entries_int_node = rtreesinfo_get_max_entries(CONVENTIONAL_RSTARTREE,
-            page_size, rentry_size(), max_fill_int_nodes / 100.0);
+            page_size, int_entry_size, max_fill_int_nodes / 100.0);
     rs->min_entries_leaf_node = rtreesinfo_get_min_entries(CONVENTIONAL_RSTARTREE,
             rs->max_entries_leaf_node, min_fill_leaf_nodes / 100.0);
     rs->min_entries_int_node = rtreesinfo_get_min_entries(CONVENTIONAL_RSTARTREE,
@@ -954,6 +1142,8 @@ Datum STI_store_index_snapshot(PG_FUNCTION_ARGS);
 Datum STI_set_execution_name(PG_FUNCTION_ARGS);
 /* a function to indicates that we want to collect the read and write order*/
 Datum STI_collect_read_write_order(PG_FUNCTION_ARGS);
+/* a function that activates the statistic context of an index (NULL activates the default context)*/
+Datum STI_use_statistic_context(PG_FUNCTION_ARGS);
 
 /* one function for each type of operation */
 
@@ -963,6 +1153,12 @@ Datum STI_create_empty_index(PG_FUNCTION_ARGS);
 Datum STI_finish_fai(PG_FUNCTION_ARGS);
 /* apply all the modified nodes stored in the standard buffer (e.g., LRU) and clean it*/
 Datum STI_finish_buffer(PG_FUNCTION_ARGS);
+/* set the percentage of clean frames kept by the background writer of the standard buffer (0 disables it)*/
+Datum STI_set_background_writer(PG_FUNCTION_ARGS);
+/* save the pages stored in the standard buffer in a file next to the header of the index */
+Datum STI_save_buffer_state(PG_FUNCTION_ARGS);
+/* load the pages saved by STI_save_buffer_state in the standard buffer */
+Datum STI_prewarm_buffer(PG_FUNCTION_ARGS);
 /*insert an entry in a created spatial index - an usual operation*/
 Datum STI_insert_entry(PG_FUNCTION_ARGS);
 /* remove an entry from a created spatial index */
@@ -971,6 +1167,22 @@ Datum STI_remove_entry(PG_FUNCTION_ARGS);
 Datum STI_update_entry(PG_FUNCTION_ARGS);
 /*execute a query on a constructed spatial index*/
 Datum STI_query_spatial_index(PG_FUNCTION_ARGS);
+/*count the objects within a distance of a geometry by using a constructed spatial index*/
+Datum STI_count_spatial_index(PG_FUNCTION_ARGS);
+/*set the number of threads of the filter step of range queries (1 means the sequential search)*/
+Datum STI_set_parallel_search(PG_FUNCTION_ARGS);
+/*build an empty spatial index from all the objects of its source by packing its nodes*/
+Datum STI_bulk_load(PG_FUNCTION_ARGS);
+/*insert all the objects of a source into a spatial index, one by one (i.e., by using its insertion algorithm)*/
+Datum STI_build_from_source(PG_FUNCTION_ARGS);
+/*the same of the previous one, but for several spatial indices fed by a single scan of the source*/
+Datum STI_build_many_from_source(PG_FUNCTION_ARGS);
+/*insert, remove, and update a batch of entries in a created spatial index*/
+Datum STI_insert_batch(PG_FUNCTION_ARGS);
+Datum STI_remove_batch(PG_FUNCTION_ARGS);
+Datum STI_update_batch(PG_FUNCTION_ARGS);
+/*remove all the objects inside a window from a created spatial index in one traversal*/
+Datum STI_remove_region(PG_FUNCTION_ARGS);
 
 
 /*variables to collect times in order to guarantee the total elapsed time*/
@@ -993,7 +1205,8 @@ Datum STI_start_collect_statistical_data(PG_FUNCTION_ARGS) {
     else
         _COLLECT_READ_WRITE_ORDER = 1;
 
-    //we also free any previous statistical data
+    //we also free any previous statistical data (including the contexts of other indices)
+    statistic_context_free_all();
     statistic_free_allocated_memory();
     //we need also to reset the corresponding variables
     statistic_reset_variables();
@@ -1024,6 +1237,28 @@ Datum STI_collect_read_write_order(PG_FUNCTION_ARGS) {
     PG_RETURN_BOOL(true);
 }
 
+PG_FUNCTION_INFO_V1(STI_use_statistic_context);
+
+Datum STI_use_statistic_context(PG_FUNCTION_ARGS) {
+#ifdef COLLECT_STATISTICAL_DATA
+    char *key = NULL;
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    if (!PG_ARGISNULL(0))
+        key = text_to_cstring(PG_GETARG_TEXT_PP(0));
+
+    statistic_context_use(key);
+
+    if (key != NULL)
+        lwfree(key);
+
+    MemoryContextSwitchTo(oldcontext);
+#endif
+    PG_RETURN_BOOL(true);
+}
+
 PG_FUNCTION_INFO_V1(STI_store_collected_statistical_data);
 
 Datum STI_store_collected_statistical_data(PG_FUNCTION_ARGS) {
@@ -1312,14 +1547,14 @@ Datum STI_create_empty_index(PG_FUNCTION_ARGS) {
         //we persist an empty root node since we are creating an empty index
         si = rtree_empty_create(index_file, src, gp, bs, true);
         rtree = (void *) si;
-        set_rtreespec_from_fds(rtree->spec, sc_id, gp->page_size);
+        set_rtreespec_from_fds(rtree->spec, sc_id, gp->page_size, type);
     } else if (type == CONVENTIONAL_RSTARTREE) {
         RStarTree *r;
 
         //we persist an empty root node since we are creating an empty index
         si = rstartree_empty_create(index_file, src, gp, bs, true);
         r = (void *) si;
-        set_rstartreespec_from_fds(r->spec, sc_id, gp->page_size);
+        set_rstartreespec_from_fds(r->spec, sc_id, gp->page_size, type);
     } else if (type == CONVENTIONAL_HILBERT_RTREE) {
         HilbertRTree *r;
 
@@ -1353,14 +1588,14 @@ Datum STI_create_empty_index(PG_FUNCTION_ARGS) {
             fi = (void *) si;
             rstar = fi->fast_index.fast_rstartree;
             rstar->rstartree->base.sc_id = sc_id;
-            set_rstartreespec_from_fds(rstar->rstartree->spec, fs->index_sc_id, gp->page_size);
+            set_rstartreespec_from_fds(rstar->rstartree->spec, fs->index_sc_id, gp->page_size, type);
         } else if (type == FAST_RTREE_TYPE) {
             FASTRTree *r;
             si = fastrtree_empty_create(index_file, src, gp, bs, fs, true);
             fi = (void *) si;
             r = fi->fast_index.fast_rtree;
             r->rtree->base.sc_id = sc_id;
-            set_rtreespec_from_fds(r->rtree->spec, fs->index_sc_id, gp->page_size);
+            set_rtreespec_from_fds(r->rtree->spec, fs->index_sc_id, gp->page_size, type);
         } else if (type == FAST_HILBERT_RTREE_TYPE) {
             FASTHilbertRTree *r;
             si = fasthilbertrtree_empty_create(index_file, src, gp, bs, fs, true);
@@ -1399,7 +1634,7 @@ Datum STI_create_empty_index(PG_FUNCTION_ARGS) {
             fi = (void *) si;
             rstar = fi->efind_index.efind_rstartree;
             rstar->rstartree->base.sc_id = sc_id;
-            set_rstartreespec_from_fds(rstar->rstartree->spec, fs->index_sc_id, gp->page_size);
+            set_rstartreespec_from_fds(rstar->rstartree->spec, fs->index_sc_id, gp->page_size, type);
 
             //we should set the sizes of the 2Q properly
             if (rstar->spec->read_buffer_policy == eFIND_2Q_RBP) {
@@ -1411,7 +1646,7 @@ Datum STI_create_empty_index(PG_FUNCTION_ARGS) {
             fi = (void *) si;
             r = fi->efind_index.efind_rtree;
             r->rtree->base.sc_id = sc_id;
-            set_rtreespec_from_fds(r->rtree->spec, fs->index_sc_id, gp->page_size);
+            set_rtreespec_from_fds(r->rtree->spec, fs->index_sc_id, gp->page_size, type);
 
             //we should set the sizes of the 2Q properly
             if (r->spec->read_buffer_policy == eFIND_2Q_RBP) {
@@ -1563,6 +1798,93 @@ Datum STI_finish_fai(PG_FUNCTION_ARGS) {
     PG_RETURN_BOOL(true);
 }
 
+PG_FUNCTION_INFO_V1(STI_set_background_writer);
+
+Datum STI_set_background_writer(PG_FUNCTION_ARGS) {
+    double clean_perc = PG_GETARG_FLOAT8(0);
+
+    //it is applied to the buffer created after the next flushing of the standard buffer
+    buffer_bgwriter_set(clean_perc);
+
+    PG_RETURN_BOOL(true);
+}
+
+PG_FUNCTION_INFO_V1(STI_save_buffer_state);
+
+Datum STI_save_buffer_state(PG_FUNCTION_ARGS) {
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+    bool auto_prewarm;
+    bool ret;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    auto_prewarm = PG_GETARG_BOOL(2);
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    si = spatialindex_from_header(spc_path);
+
+    ret = storage_save_buffer_state(si, spc_path, auto_prewarm);
+
+    spatialindex_destroy(si);
+
+    lwfree(index_path);
+    lwfree(index_name);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_RETURN_BOOL(ret);
+}
+
+PG_FUNCTION_INFO_V1(STI_prewarm_buffer);
+
+Datum STI_prewarm_buffer(PG_FUNCTION_ARGS) {
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+    int n;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    si = spatialindex_from_header(spc_path);
+
+    n = storage_prewarm_buffer(si, spc_path);
+
+    spatialindex_destroy(si);
+
+    lwfree(index_path);
+    lwfree(index_name);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_RETURN_INT32(n);
+}
+
 PG_FUNCTION_INFO_V1(STI_finish_buffer);
 
 Datum STI_finish_buffer(PG_FUNCTION_ARGS) {
@@ -1877,6 +2199,390 @@ Datum STI_update_entry(PG_FUNCTION_ARGS) {
     PG_RETURN_BOOL(true);
 }
 
+int batch_order_comp(const void *a, const void *b) {
+    const BatchOrder *x = (const BatchOrder*) a;
+    const BatchOrder *y = (const BatchOrder*) b;
+    if (x->key < y->key)
+        return -1;
+    else if (x->key > y->key)
+        return 1;
+    else
+        return x->index - y->index;
+}
+
+int read_batch(ArrayType *pointers, ArrayType *geoms, int **ptrs, LWGEOM ***lwgeoms) {
+    Datum *pdatums, *gdatums;
+    bool *pnulls, *gnulls;
+    int np, ng, i;
+    int16 typlen;
+    bool typbyval;
+    char typalign;
+    GSERIALIZED *g;
+
+    deconstruct_array(pointers, INT4OID, sizeof (int32), true, 'i', &pdatums, &pnulls, &np);
+    get_typlenbyvalalign(ARR_ELEMTYPE(geoms), &typlen, &typbyval, &typalign);
+    deconstruct_array(geoms, ARR_ELEMTYPE(geoms), typlen, typbyval, typalign, &gdatums, &gnulls, &ng);
+
+    if (np != ng) {
+        _DEBUGF(ERROR, "The number of pointers (%d) and geometries (%d) of the batch are different", np, ng);
+        return 0;
+    }
+
+    *ptrs = (int*) lwalloc(sizeof (int) * (np > 0 ? np : 1));
+    *lwgeoms = (LWGEOM**) lwalloc(sizeof (LWGEOM*) * (np > 0 ? np : 1));
+    for (i = 0; i < np; i++) {
+        if (pnulls[i] || gnulls[i]) {
+            _DEBUGF(ERROR, "The element %d of the batch is NULL", i + 1);
+            return 0;
+        }
+        (*ptrs)[i] = DatumGetInt32(pdatums[i]);
+
+        g = (GSERIALIZED*) PG_DETOAST_DATUM(gdatums[i]);
+        (*lwgeoms)[i] = lwgeom_from_gserialized(g);
+        /*
+         ** See if we have a bounding box, add one if we don't have one.
+         */
+        if ((!(*lwgeoms)[i]->bbox) && (!lwgeom_is_empty((*lwgeoms)[i]))) {
+            lwgeom_add_bbox((*lwgeoms)[i]);
+        }
+        //the lwgeom is a copy of the serialized geometry, except for its bbox
+        if ((Pointer) g != DatumGetPointer(gdatums[i]))
+            pfree(g);
+    }
+
+    pfree(pdatums);
+    pfree(pnulls);
+    pfree(gdatums);
+    pfree(gnulls);
+    return np;
+}
+
+int *batch_order(LWGEOM **geoms, int n, bool sort) {
+    int *order = (int*) lwalloc(sizeof (int) * (n > 0 ? n : 1));
+    BatchOrder *bo;
+    BBox bbox, extent;
+    bool has_extent = false;
+    int i, d;
+
+    if (!sort) {
+        for (i = 0; i < n; i++)
+            order[i] = i;
+        return order;
+    }
+
+    /* the hilbert values are computed over the extent of the centers of the batch
+     * (thus, any SRID is supported and the whole resolution of the curve is used by the batch) */
+    for (i = 0; i < n; i++) {
+        if (geoms[i]->bbox == NULL)
+            continue;
+        gbox_to_bbox(geoms[i]->bbox, &bbox);
+        for (d = 0; d < NUM_OF_DIM; d++) {
+            double c = (bbox.min[d] + bbox.max[d]) / 2.0;
+            if (!has_extent || c < extent.min[d])
+                extent.min[d] = c;
+            if (!has_extent || c > extent.max[d])
+                extent.max[d] = c;
+        }
+        has_extent = true;
+    }
+
+    bo = (BatchOrder*) lwalloc(sizeof (BatchOrder) * (n > 0 ? n : 1));
+    for (i = 0; i < n; i++) {
+        bo[i].index = i;
+        //empty objects do not have bboxes, then they are placed at the beginning
+        if (geoms[i]->bbox != NULL) {
+            gbox_to_bbox(geoms[i]->bbox, &bbox);
+            bo[i].key = calculate_hilbert_value_in_extent((bbox.min[0] + bbox.max[0]) / 2.0,
+                    (bbox.min[1] + bbox.max[1]) / 2.0, &extent);
+        } else {
+            bo[i].key = 0;
+        }
+    }
+    qsort(bo, n, sizeof (BatchOrder), batch_order_comp);
+    for (i = 0; i < n; i++)
+        order[i] = bo[i].index;
+
+    lwfree(bo);
+    return order;
+}
+
+bool process_batch(PG_FUNCTION_ARGS, uint8_t operation) {
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+#endif
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+    bool sort = PG_GETARG_BOOL(PG_NARGS() - 1);
+
+    int *ptrs, *new_ptrs = NULL;
+    LWGEOM **geoms, **new_geoms = NULL;
+    int *order;
+    int n, i, k;
+    uint8_t type;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+    n = read_batch(PG_GETARG_ARRAYTYPE_P(2), PG_GETARG_ARRAYTYPE_P(3), &ptrs, &geoms);
+    if (operation == BATCH_UPDATE) {
+        if (read_batch(PG_GETARG_ARRAYTYPE_P(4), PG_GETARG_ARRAYTYPE_P(5), &new_ptrs, &new_geoms) != n) {
+            _DEBUG(ERROR, "The old and new entries of the batch have different lengths");
+        }
+    }
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    //the index is obtained only once for the whole batch
+    si = spatialindex_from_header(spc_path);
+    type = spatialindex_get_type(si);
+
+    //the updates are ordered by their old geometries since they are firstly removed
+    order = batch_order(geoms, n, sort);
+
+    if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE || type == FAST_HILBERT_RTREE_TYPE)
+        fast_log_begin_group();
+    else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE || type == eFIND_HILBERT_RTREE_TYPE)
+        efind_log_begin_group();
+
+    PG_TRY();
+    {
+        for (i = 0; i < n; i++) {
+            k = order[i];
+
+#ifdef COLLECT_STATISTICAL_DATA
+            /* we collect the index time of each operation (as their single versions do) */
+            cpustart = get_CPU_time();
+            start = get_current_time();
+#endif
+
+            if (operation == BATCH_INSERT)
+                spatialindex_insert(si, ptrs[k], geoms[k]);
+            else if (operation == BATCH_REMOVE)
+                spatialindex_remove(si, ptrs[k], geoms[k]);
+            else
+                spatialindex_update(si, ptrs[k], geoms[k], new_ptrs[k], new_geoms[k]);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            cpuend = get_CPU_time();
+            end = get_current_time();
+
+            _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+            _index_time += get_elapsed_time(start, end);
+#endif
+        }
+    }
+    PG_CATCH();
+    {
+        //the entries of the operations already applied are written and the group is closed
+        if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE || type == FAST_HILBERT_RTREE_TYPE)
+            fast_log_end_group();
+        else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE || type == eFIND_HILBERT_RTREE_TYPE)
+            efind_log_end_group();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE || type == FAST_HILBERT_RTREE_TYPE)
+        fast_log_end_group();
+    else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE || type == eFIND_HILBERT_RTREE_TYPE)
+        efind_log_end_group();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _batch_num++;
+    _batch_op_num += n;
+#endif
+
+    //cleaning the used memory
+    //we do not free si here because it is stored in the header buffer
+    for (i = 0; i < n; i++) {
+        lwgeom_free(geoms[i]);
+        if (new_geoms != NULL)
+            lwgeom_free(new_geoms[i]);
+    }
+    lwfree(geoms);
+    lwfree(ptrs);
+    if (new_geoms != NULL) {
+        lwfree(new_geoms);
+        lwfree(new_ptrs);
+    }
+    lwfree(order);
+    lwfree(index_name);
+    lwfree(index_path);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    return true;
+}
+
+PG_FUNCTION_INFO_V1(STI_insert_batch);
+
+Datum STI_insert_batch(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(process_batch(fcinfo, BATCH_INSERT));
+}
+
+PG_FUNCTION_INFO_V1(STI_remove_batch);
+
+Datum STI_remove_batch(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(process_batch(fcinfo, BATCH_REMOVE));
+}
+
+PG_FUNCTION_INFO_V1(STI_update_batch);
+
+Datum STI_update_batch(PG_FUNCTION_ARGS) {
+    PG_RETURN_BOOL(process_batch(fcinfo, BATCH_UPDATE));
+}
+
+/*index_name, index_path, window*/
+PG_FUNCTION_INFO_V1(STI_remove_region);
+
+Datum STI_remove_region(PG_FUNCTION_ARGS) {
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+#endif
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+
+    LWGEOM *lwgeom;
+    GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(2);
+    BBox window;
+    uint8_t type;
+    bool ret = false;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+    lwgeom = lwgeom_from_gserialized(geom);
+    if (lwgeom_is_empty(lwgeom)) {
+        _DEBUG(ERROR, "This is an empty geometry");
+    }
+    if (!lwgeom->bbox) {
+        lwgeom_add_bbox(lwgeom);
+    }
+    gbox_to_bbox(lwgeom->bbox, &window);
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    si = spatialindex_from_header(spc_path);
+    type = spatialindex_get_type(si);
+    /* the Hilbert R-tree has its own reorganization of nodes (sibling nodes) */
+    if (type != CONVENTIONAL_RTREE && type != CONVENTIONAL_RSTARTREE &&
+            type != FAST_RTREE_TYPE && type != FAST_RSTARTREE_TYPE &&
+            type != eFIND_RTREE_TYPE && type != eFIND_RSTARTREE_TYPE && type != FORTREE_TYPE) {
+        _DEBUGF(ERROR, "Region deletion is not supported by the index type %d", type);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    /* we collect the index time by avoiding the overhead of the header!
+     the header time is included in the total_time */
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    //the modifications of the whole region are appended in the log by a single write
+    if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE)
+        fast_log_begin_group();
+    else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE)
+        efind_log_begin_group();
+
+    PG_TRY();
+    {
+        if (type == CONVENTIONAL_RTREE) {
+            RNodeStack *removed_nodes = rnode_stack_init();
+            ret = rtree_remove_region((void *) si, &window, removed_nodes, true);
+            rnode_stack_destroy(removed_nodes);
+        } else if (type == CONVENTIONAL_RSTARTREE) {
+            ret = rstartree_remove_region((void *) si, &window);
+        } else if (type == FAST_RTREE_TYPE) {
+            FASTIndex *fi = (void *) si;
+            FASTRTree *fr = fi->fast_index.fast_rtree;
+            RNodeStack *removed_nodes = rnode_stack_init();
+            rtree_set_fastspecification(fr->spec);
+            ret = rtree_remove_region(fr->rtree, &window, removed_nodes, true);
+            rnode_stack_destroy(removed_nodes);
+        } else if (type == FAST_RSTARTREE_TYPE) {
+            FASTIndex *fi = (void *) si;
+            FASTRStarTree *fr = fi->fast_index.fast_rstartree;
+            rstartree_set_fastspecification(fr->spec);
+            ret = rstartree_remove_region(fr->rstartree, &window);
+        } else if (type == eFIND_RTREE_TYPE) {
+            eFINDIndex *fi = (void *) si;
+            eFINDRTree *er = fi->efind_index.efind_rtree;
+            RNodeStack *removed_nodes = rnode_stack_init();
+            rtree_set_efindspecification(er->spec);
+            ret = rtree_remove_region(er->rtree, &window, removed_nodes, true);
+            rnode_stack_destroy(removed_nodes);
+        } else if (type == FORTREE_TYPE) {
+            ret = fortree_remove_region((void *) si, &window);
+        } else {
+            eFINDIndex *fi = (void *) si;
+            eFINDRStarTree *er = fi->efind_index.efind_rstartree;
+            rstartree_set_efindspecification(er->spec);
+            ret = rstartree_remove_region(er->rstartree, &window);
+        }
+    }
+    PG_CATCH();
+    {
+        //the entries of the modifications already applied are written and the group is closed
+        if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE)
+            fast_log_end_group();
+        else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE)
+            efind_log_end_group();
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE)
+        fast_log_end_group();
+    else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE)
+        efind_log_end_group();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _index_time += get_elapsed_time(start, end);
+#endif
+
+    //cleaning the used memory
+    lwgeom_free(lwgeom);
+    lwfree(index_path);
+    lwfree(index_name);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+    PG_FREE_IF_COPY(geom, 2);
+
+    PG_RETURN_BOOL(ret);
+}
+
 #define xpstrdup(tgtvar_, srcvar_) \
        do { \
            if (srcvar_) \
@@ -1897,6 +2603,8 @@ Datum STI_query_spatial_index(PG_FUNCTION_ARGS) {
     GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(3);
     int predicate = PG_GETARG_INT32(4);
     int type_of_processing = PG_GETARG_INT32(5);
+    //the distance is only used by distance range queries
+    double distance = PG_GETARG_FLOAT8(6);
     char *spc_path;
 
     SpatialIndex *si;
@@ -1958,6 +2666,10 @@ Datum STI_query_spatial_index(PG_FUNCTION_ARGS) {
             lwgeom = input;
             lwfree(bbox);
         }
+    } else if (type_query == DISTANCE_RANGE_QUERY_TYPE) {
+        if (distance < 0.0) {
+            _DEBUGF(ERROR, "Invalid distance (%f) for the DISTANCE_RANGE_QUERY_TYPE", distance);
+        }
     }
 
     spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
@@ -1969,7 +2681,10 @@ Datum STI_query_spatial_index(PG_FUNCTION_ARGS) {
 
     /*the index_time is collected inside this function
      the reason is that the query is processed in two steps: filtering and refinement*/
-    result = process_spatial_selection(si, lwgeom, predicate, type_query, type_of_processing);
+    if (type_query == DISTANCE_RANGE_QUERY_TYPE)
+        result = process_distance_selection(si, lwgeom, distance, type_of_processing);
+    else
+        result = process_spatial_selection(si, lwgeom, predicate, type_query, type_of_processing);
 
     lwgeom_free(lwgeom);
     lwfree(spc_path);
@@ -2060,3 +2775,458 @@ Datum STI_query_spatial_index(PG_FUNCTION_ARGS) {
 
     return (Datum) 0;
 }
+
+PG_FUNCTION_INFO_V1(STI_set_parallel_search);
+
+Datum STI_set_parallel_search(PG_FUNCTION_ARGS) {
+    int nofthreads = PG_GETARG_INT32(0);
+
+    //it is applied to the range queries of the R-trees and R*-trees (see rtree_search)
+    rtree_set_search_threads(nofthreads);
+
+    PG_RETURN_BOOL(true);
+}
+
+/*index_name, index_path, geometry, processing_option, distance*/
+PG_FUNCTION_INFO_V1(STI_count_spatial_index);
+
+Datum STI_count_spatial_index(PG_FUNCTION_ARGS) {
+    char *index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    char *index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    GSERIALIZED *geom = PG_GETARG_GSERIALIZED_P(2);
+    int type_of_processing = PG_GETARG_INT32(3);
+    double distance = PG_GETARG_FLOAT8(4);
+    LWGEOM *lwgeom;
+    char *spc_path;
+    SpatialIndex *si;
+    uint64_t count;
+    MemoryContext oldcontext;
+
+    // this will survives until a restart of the server in order to collect statistical data
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+    lwgeom = lwgeom_from_gserialized(geom);
+
+    /*checking if the input is valid*/
+    if (lwgeom_is_empty(lwgeom)) {
+        _DEBUG(ERROR, "This is an empty geometry");
+    }
+    if (distance < 0.0) {
+        _DEBUGF(ERROR, "Invalid distance (%f) for counting the objects", distance);
+    }
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    si = spatialindex_from_header(spc_path);
+
+    /*the index_time is collected inside this function*/
+    count = process_distance_count(si, lwgeom, distance, type_of_processing);
+
+    lwgeom_free(lwgeom);
+    lwfree(spc_path);
+    lwfree(index_name);
+    lwfree(index_path);
+
+    //back to the current context
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_FREE_IF_COPY(geom, 2);
+    PG_RETURN_INT64(count);
+}
+
+/*index_name, index_path, fill_factor, sort_memory, sort_fan_in*/
+PG_FUNCTION_INFO_V1(STI_bulk_load);
+
+Datum STI_bulk_load(PG_FUNCTION_ARGS) {
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+#endif
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+    double fill_factor = PG_GETARG_FLOAT8(2);
+    int sort_memory = PG_GETARG_INT32(3); //in kB
+    int sort_fan_in = PG_GETARG_INT32(4);
+    int nofthreads = PG_GETARG_INT32(5); //only used by the STR packing
+
+    //they are volatile since they are modified inside PG_TRY
+    BulkLoadEntries *volatile ble = NULL;
+    ExternalSort *volatile es = NULL;
+    int srid;
+    uint8_t type;
+    volatile bool ret = false;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+    if (fill_factor <= 0.0 || fill_factor > 1.0) {
+        _DEBUGF(ERROR, "Invalid fill factor (%f) for the bulk loading", fill_factor);
+    }
+    if (sort_memory <= 0 || sort_fan_in < 2) {
+        _DEBUGF(ERROR, "Invalid memory (%d kB) or fan-in (%d) for the sort of the bulk loading", sort_memory, sort_fan_in);
+    }
+    if (nofthreads < 1) {
+        _DEBUGF(ERROR, "Invalid number of threads (%d) for the bulk loading", nofthreads);
+    }
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    si = spatialindex_from_header(spc_path);
+    type = spatialindex_get_type(si);
+    if (type < CONVENTIONAL_RTREE || type > eFIND_HILBERT_RTREE_TYPE) {
+        _DEBUGF(ERROR, "Bulk loading is not supported by the index type %d", type);
+    }
+
+    /* the sort and the entries are allocated with malloc and the sort also creates temporary files,
+     * then they are released if the reading or the bulk loading raises an error */
+    PG_TRY();
+    {
+        /* the objects are read once from the source
+         * for Hilbert R-trees, they are sorted by their hilbert values by using an external sort
+         * (it is created before the reading since its runs are generated while the objects are read)*/
+        if (type == CONVENTIONAL_HILBERT_RTREE || type == FAST_HILBERT_RTREE_TYPE || type == eFIND_HILBERT_RTREE_TYPE) {
+            ExternalSortSpecification ess;
+
+            ess.temp_file = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".sort") + 1);
+            strcpy(ess.temp_file, index_path);
+            strcat(ess.temp_file, index_name);
+            strcat(ess.temp_file, ".sort");
+            ess.memory_budget = (size_t) sort_memory * 1024;
+            ess.fan_in = sort_fan_in;
+            ess.block_size = si->gp->page_size * BULKLOAD_SORT_BLOCK_PAGES;
+            ess.io_access = si->gp->io_access;
+
+            es = externalsort_create(&ess);
+            lwfree(ess.temp_file);
+
+            srid = read_bulkload_entries(si->src, NULL, es);
+            externalsort_finish(es);
+        } else {
+            ble = bulkload_entries_create();
+            srid = read_bulkload_entries(si->src, ble, NULL);
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        /* we collect the index time by avoiding the overhead of the reading of the source */
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+
+        if (type == CONVENTIONAL_RTREE) {
+            ret = rtree_bulk_load((void *) si, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == CONVENTIONAL_RSTARTREE) {
+            ret = rstartree_bulk_load((void *) si, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == CONVENTIONAL_HILBERT_RTREE) {
+            ret = hilbertrtree_bulk_load((void *) si, es, srid, fill_factor);
+        } else if (type == FAST_RTREE_TYPE) {
+            FASTIndex *fi = (void *) si;
+            FASTRTree *fr = fi->fast_index.fast_rtree;
+            rtree_set_fastspecification(fr->spec);
+            ret = rtree_bulk_load(fr->rtree, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == FAST_RSTARTREE_TYPE) {
+            FASTIndex *fi = (void *) si;
+            FASTRStarTree *fr = fi->fast_index.fast_rstartree;
+            rstartree_set_fastspecification(fr->spec);
+            ret = rstartree_bulk_load(fr->rstartree, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == FAST_HILBERT_RTREE_TYPE) {
+            FASTIndex *fi = (void *) si;
+            FASTHilbertRTree *fr = fi->fast_index.fast_hilbertrtree;
+            hilbertrtree_set_fastspecification(fr->spec);
+            ret = hilbertrtree_bulk_load(fr->hilbertrtree, es, srid, fill_factor);
+        } else if (type == FORTREE_TYPE) {
+            ret = fortree_bulk_load((void *) si, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == eFIND_RTREE_TYPE) {
+            eFINDIndex *fi = (void *) si;
+            eFINDRTree *er = fi->efind_index.efind_rtree;
+            rtree_set_efindspecification(er->spec);
+            ret = rtree_bulk_load(er->rtree, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else if (type == eFIND_RSTARTREE_TYPE) {
+            eFINDIndex *fi = (void *) si;
+            eFINDRStarTree *er = fi->efind_index.efind_rstartree;
+            rstartree_set_efindspecification(er->spec);
+            ret = rstartree_bulk_load(er->rstartree, ble->entries, ble->nofentries, fill_factor, nofthreads);
+        } else {
+            eFINDIndex *fi = (void *) si;
+            eFINDHilbertRTree *er = fi->efind_index.efind_hilbertrtree;
+            hilbertrtree_set_efindspecification(er->spec);
+            ret = hilbertrtree_bulk_load(er->hilbertrtree, es, srid, fill_factor);
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _index_time += get_elapsed_time(start, end);
+#endif
+    }
+    PG_CATCH();
+    {
+        if (ble != NULL)
+            bulkload_entries_free(ble);
+        if (es != NULL)
+            externalsort_free(es);
+        PG_RE_THROW();
+    }
+    PG_END_TRY();
+
+    //the whole structure of the index was built, then we write its header
+    spatialindex_header_writer(si, spc_path);
+
+    //we do not free si here because it is stored in the header buffer
+    if (ble != NULL)
+        bulkload_entries_free(ble);
+    if (es != NULL)
+        externalsort_free(es);
+    lwfree(index_name);
+    lwfree(index_path);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_RETURN_BOOL(ret);
+}
+
+void build_from_source(SpatialIndex **sis, char **keys, int nofindices, int src_id, int progress_interval) {
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+#endif
+    Source *src;
+    char *query;
+
+    SPIPlanPtr plan;
+    Portal portal;
+    Oid argtypes[1] = {INT8OID};
+    Datum values[1];
+    GSERIALIZED *g;
+    LWGEOM *lwgeom;
+    Datum d;
+    bool isnull;
+    int pointer;
+    int64 last_key = PG_INT64_MIN; //the last primary key value read (keyset pagination)
+    uint64 i, n, nofrows;
+    uint64 total = 0;
+    int k;
+
+    src = read_source_from_fds(src_id);
+
+    /* each page of rows is read by a cursor that starts after the last read primary key
+     * thus, a page does not depend on the number of the previously read rows (as OFFSET does)*/
+    query = lwalloc(strlen(src->pk) * 3 + strlen(src->column) + strlen(src->schema) + strlen(src->table) + 80);
+    sprintf(query, "SELECT %s::int4, %s FROM %s.%s WHERE %s > $1 ORDER BY %s LIMIT %d",
+            src->pk, src->column, src->schema, src->table, src->pk, src->pk, BUILD_PAGE_ROWS);
+
+    if (SPI_OK_CONNECT != SPI_connect()) {
+        SPI_finish();
+        _DEBUG(ERROR, "build_from_source: could not connect to SPI manager");
+        return;
+    }
+    plan = SPI_prepare(query, 1, argtypes);
+    if (plan == NULL) {
+        SPI_finish();
+        _DEBUG(ERROR, "build_from_source: could not prepare the SELECT command");
+        return;
+    }
+    //the indices must be modified in the TopMemoryContext (SPI_connect changed the current memory context)
+    MemoryContextSwitchTo(TopMemoryContext);
+
+    do {
+        values[0] = Int64GetDatum(last_key);
+        portal = SPI_cursor_open(NULL, plan, values, NULL, true);
+        nofrows = 0;
+        do {
+            SPI_cursor_fetch(portal, true, BULKLOAD_FETCH_SIZE);
+            n = SPI_processed;
+            nofrows += n;
+            for (i = 0; i < n; i++) {
+                pointer = DatumGetInt32(SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull));
+                if (isnull)
+                    continue;
+                last_key = pointer;
+                d = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2, &isnull);
+                if (isnull)
+                    continue;
+
+                //the object is decoded only once for all the indices
+                g = (GSERIALIZED*) PG_DETOAST_DATUM(d);
+                lwgeom = lwgeom_from_gserialized(g);
+                /*
+                 ** See if we have a bounding box, add one if we don't have one.
+                 */
+                if ((!lwgeom->bbox) && (!lwgeom_is_empty(lwgeom))) {
+                    lwgeom_add_bbox(lwgeom);
+                }
+
+                for (k = 0; k < nofindices; k++) {
+#ifdef COLLECT_STATISTICAL_DATA
+                    //each index has its own statistical data
+                    if (keys != NULL)
+                        statistic_context_use(keys[k]);
+
+                    /* we collect the index time by avoiding the overhead of the reading of the source
+                     (as FT_Insert does for the header) */
+                    cpustart = get_CPU_time();
+                    start = get_current_time();
+#endif
+
+                    spatialindex_insert(sis[k], pointer, lwgeom);
+
+#ifdef COLLECT_STATISTICAL_DATA
+                    cpuend = get_CPU_time();
+                    end = get_current_time();
+
+                    _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+                    _index_time += get_elapsed_time(start, end);
+#endif
+                }
+
+                lwgeom_free(lwgeom);
+                if ((Pointer) g != DatumGetPointer(d))
+                    pfree(g);
+
+                total++;
+                if (progress_interval > 0 && total % progress_interval == 0) {
+                    _DEBUGF(NOTICE, "%lu objects inserted into %d index(es)", (unsigned long) total, nofindices);
+                }
+            }
+            SPI_freetuptable(SPI_tuptable);
+        } while (n > 0);
+        SPI_cursor_close(portal);
+    } while (nofrows == BUILD_PAGE_ROWS);
+
+    SPI_finish();
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (keys != NULL)
+        statistic_context_use(NULL);
+#endif
+
+    source_free(src);
+    lwfree(query);
+}
+
+PG_FUNCTION_INFO_V1(STI_build_from_source);
+
+Datum STI_build_from_source(PG_FUNCTION_ARGS) {
+    SpatialIndex *si;
+    char *spc_path;
+
+    char *index_name;
+    char *index_path;
+    int src_id = PG_GETARG_INT32(2);
+    int progress_interval = PG_GETARG_INT32(3); //0 means no progress report
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    index_name = text_to_cstring(PG_GETARG_TEXT_PP(0));
+    index_path = text_to_cstring(PG_GETARG_TEXT_PP(1));
+
+    spc_path = lwalloc(strlen(index_name) + strlen(index_path) + strlen(".header") + 1);
+    strcpy(spc_path, index_path);
+    strcat(spc_path, index_name);
+    strcat(spc_path, ".header");
+
+    //the index is obtained only once for all the objects
+    si = spatialindex_from_header(spc_path);
+
+    build_from_source(&si, NULL, 1, src_id, progress_interval);
+
+    //cleaning the used memory 
+    //we do not free si here because it is stored in the header buffer
+    lwfree(index_name);
+    lwfree(index_path);
+    lwfree(spc_path);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_RETURN_BOOL(true);
+}
+
+PG_FUNCTION_INFO_V1(STI_build_many_from_source);
+
+Datum STI_build_many_from_source(PG_FUNCTION_ARGS) {
+    SpatialIndex **sis;
+    char **paths;
+    char *spc_path;
+    int src_id = PG_GETARG_INT32(1);
+    int progress_interval = PG_GETARG_INT32(2); //0 means no progress report
+
+    Datum *datums;
+    bool *nulls;
+    int nofindices, k;
+    int noffai = 0, nofbuffered = 0;
+
+    MemoryContext oldcontext;
+    // this will survives until a restart of the server
+    oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+    deconstruct_array(PG_GETARG_ARRAYTYPE_P(0), TEXTOID, -1, false, 'i', &datums, &nulls, &nofindices);
+    if (nofindices == 0) {
+        _DEBUG(ERROR, "At least one index must be informed");
+        PG_RETURN_BOOL(false);
+    }
+
+    sis = (SpatialIndex**) lwalloc(sizeof (SpatialIndex*) * nofindices);
+    paths = (char**) lwalloc(sizeof (char*) * nofindices);
+    for (k = 0; k < nofindices; k++) {
+        if (nulls[k]) {
+            _DEBUGF(ERROR, "The path of the index %d is NULL", k + 1);
+            PG_RETURN_BOOL(false);
+        }
+        //the absolute path is the key of the statistic context of the index (see FT_UseStatisticContext)
+        paths[k] = TextDatumGetCString(datums[k]);
+
+        spc_path = lwalloc(strlen(paths[k]) + strlen(".header") + 1);
+        strcpy(spc_path, paths[k]);
+        strcat(spc_path, ".header");
+        //each index is obtained only once for all the objects
+        sis[k] = spatialindex_from_header(spc_path);
+        lwfree(spc_path);
+
+        /* the write buffer of the flash-aware indices and the standard buffer are singletons of the process
+         * since each object is inserted into all the indices, switching them between the indices would
+         * flush them at each insertion (see the documentation of FT_BuildFromSource) */
+        if (spatialindex_get_type(sis[k]) >= FAST_RTREE_TYPE)
+            noffai++;
+        if (sis[k]->bs->buffer_type != BUFFER_NONE)
+            nofbuffered++;
+        if (noffai > 1 || nofbuffered > 1) {
+            _DEBUG(ERROR, "At most one flash-aware index and at most one index with a standard buffer can be built at once");
+            PG_RETURN_BOOL(false);
+        }
+    }
+
+    build_from_source(sis, paths, nofindices, src_id, progress_interval);
+
+    //cleaning the used memory
+    //we do not free the indices here because they are stored in the header buffer
+    for (k = 0; k < nofindices; k++)
+        pfree(paths[k]);
+    lwfree(paths);
+    lwfree(sis);
+    pfree(datums);
+    pfree(nulls);
+
+    MemoryContextSwitchTo(oldcontext);
+
+    PG_RETURN_BOOL(true);
+}
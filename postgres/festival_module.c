@@ -22,6 +22,8 @@
 #include "postgres.h"
 #include "fmgr.h"
 
+#include "../buffer/buffer_handler.h" //for buffer_shared_init
+
 
 /*
  * This is required for builds against pgsql
@@ -42,6 +44,9 @@ _PG_init(void)
     /* install PostgreSQL handlers */
     pg_install_lwgeom_handlers();
 
+    /* the SHARED buffer (only if FESTIval is in shared_preload_libraries) */
+    buffer_shared_init();
+
     /* initialize geometry backend */
     //lwgeom_init_backend();
 }
@@ -49,6 +49,19 @@ void query_set_processor_ss(filter_step_processor_ss f, refinement_step_processo
     if (r) refinement_step_ss = r;
 }
 
+/* Default filter and refinement processors for distance range queries
+ * _dw means: distance within */
+static SpatialIndexResult * default_filter_step_dw(SpatialIndex *si, LWGEOM *input, double distance);
+static QueryResult * default_refinement_step_dw(SpatialIndexResult *candidates, Source *src,
+        GenericParameters *gp, LWGEOM *input, double distance);
+filter_step_processor_dw filter_step_dw = default_filter_step_dw;
+refinement_step_processor_dw refinement_step_dw = default_refinement_step_dw;
+
+void query_set_processor_dw(filter_step_processor_dw f, refinement_step_processor_dw r) {
+    if (f) filter_step_dw = f;
+    if (r) refinement_step_dw = r;
+}
+
 /* auxiliary functions
  */
 static LWGEOM **retrieve_geoms_from_postgres(const Source *src, int *row_ids, int count);
@@ -56,6 +69,8 @@ static LWGEOM **retrieve_geoms_from_postgres(const Source *src, int *row_ids, in
 static QueryResult *process_disjoint(const QueryResult *res, const char *table, const char *column, const char *pk);
 /* this function checks the topological predicate by using the GEOS */
 static int process_predicate(LWGEOM *input, LWGEOM *geom, uint8_t p, uint8_t refin);
+/* this function checks if the distance between two geometries is less than or equal to the distance */
+static int process_distance(LWGEOM *input, LWGEOM *geom, double distance);
 
 SpatialIndexResult * default_filter_step_ss(SpatialIndex *si, LWGEOM *input, uint8_t p, uint8_t query_type) {
     SpatialIndexResult *result;
@@ -80,7 +95,11 @@ SpatialIndexResult * default_filter_step_ss(SpatialIndex *si, LWGEOM *input, uin
 
     result = NULL;
 
-    if (p == OVERLAP
+    /* point queries are processed by the point location of the index, if it is available */
+    if (query_type == POINT_QUERY_TYPE && input->type == POINTTYPE && 
+            si->vtable->search_pt != NULL && (p == INTERSECTS || p == EQUAL))
+        result = spatialindex_point_location(si, input, p);
+    else if (p == OVERLAP
             || p == MEET
             || p == DISJOINT /* note that we will make the complement after */
             || p == INTERSECTS)
@@ -166,17 +185,49 @@ QueryResult * default_refinement_step_ss(SpatialIndexResult *candidates, Source
             lwfree(geoms);
         } else {
             int j;
-            int aux = candidates->num_entries;
+            int n = candidates->num_entries;
+            int *row_ids = candidates->row_id;
+            int *final_ids = NULL;
+            int nofinal = 0;
+            int aux;
+
+            /* final entries (i.e., objects located at the query point of a point query) 
+             * satisfy the predicate, thus their geometries are retrieved without checking the predicate
+             * (the stored geometry is returned since it can be a different type of object with another SRID) */
+            if (candidates->final_entry != NULL) {
+                row_ids = (int*) lwalloc(sizeof (int) * candidates->num_entries);
+                final_ids = (int*) lwalloc(sizeof (int) * candidates->num_entries);
+                n = 0;
+                for (i = 0; i < candidates->num_entries; i++) {
+                    if (candidates->final_entry[i])
+                        final_ids[nofinal++] = candidates->row_id[i];
+                    else
+                        row_ids[n++] = candidates->row_id[i];
+                }
 
-            for (i = 0; i < candidates->num_entries; i += OFFSET_QUERY) {
+                for (i = 0; i < nofinal; i += OFFSET_QUERY) {
+                    total = (nofinal - i < OFFSET_QUERY) ? nofinal - i : OFFSET_QUERY;
+                    geoms = retrieve_geoms_from_postgres(src, final_ids + i, total);
+                    for (j = 0; j < total; j++) {
+                        result->nofentries++;
+                        result->geoms[result->nofentries - 1] = geoms[j];
+                        result->row_id[result->nofentries - 1] = final_ids[i + j];
+                    }
+                    lwfree(geoms);
+                }
+                lwfree(final_ids);
+            }
+
+            aux = n;
+            for (i = 0; i < n; i += OFFSET_QUERY) {
                 aux -= OFFSET_QUERY;
 
                 if (aux < 0)
-                    total = candidates->num_entries - offset;
+                    total = n - offset;
                 else
                     total = OFFSET_QUERY;
 
-                geoms = retrieve_geoms_from_postgres(src, candidates->row_id + offset, total);
+                geoms = retrieve_geoms_from_postgres(src, row_ids + offset, total);
 
                 for (j = 0; j < total; j++) {
                     /*check the predicate: is the input (which can be a range query) 
@@ -186,7 +237,7 @@ QueryResult * default_refinement_step_ss(SpatialIndexResult *candidates, Source
                         /*if so, we add this geom object in the final result */
                         result->nofentries++;
                         result->geoms[result->nofentries - 1] = geoms[j];
-                        result->row_id[result->nofentries - 1] = candidates->row_id[i + j];
+                        result->row_id[result->nofentries - 1] = row_ids[i + j];
                     } else {
                         /*otherwise, we free it */
                         lwgeom_free(geoms[j]);
@@ -197,6 +248,8 @@ QueryResult * default_refinement_step_ss(SpatialIndexResult *candidates, Source
 
                 offset += OFFSET_QUERY;
             }
+            if (row_ids != candidates->row_id)
+                lwfree(row_ids);
         }
 
         /*if the predicate is disjoint then we have to perform the complement of the result
@@ -225,6 +278,121 @@ QueryResult * default_refinement_step_ss(SpatialIndexResult *candidates, Source
     return result;
 }
 
+SpatialIndexResult * default_filter_step_dw(SpatialIndex *si, LWGEOM *input, double distance) {
+    SpatialIndexResult *result;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if ((!input->bbox) && (!lwgeom_is_empty(input))) {
+        lwgeom_add_bbox(input);
+    }
+
+    result = spatialindex_distance_selection(si, input, distance);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _filter_cpu_time += get_elapsed_time(cpustart, cpuend);
+
+    _index_time += get_elapsed_time(start, end);
+    _filter_time += get_elapsed_time(start, end);
+
+    //this is the number of candidates
+    if (result != NULL)
+        _cand_num = result->num_entries;
+    else
+        _cand_num = 0;
+#endif
+    return result;
+}
+
+QueryResult * default_refinement_step_dw(SpatialIndexResult *candidates, Source *src,
+        GenericParameters *gp, LWGEOM *input, double distance) {
+    int i, j, k;
+    QueryResult *result = NULL;
+    LWGEOM **geoms;
+    int *row_ids;
+    int n;
+    int total;
+    bool check;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if (candidates == NULL) {
+        _DEBUG(ERROR, "List of candidates is NULL in the refinement step");
+        return NULL;
+    }
+    if (candidates->num_entries == 0) {
+        result = create_empty_query_result();
+        return result;
+    }
+
+    result = create_query_result(candidates->num_entries);
+    row_ids = (int*) lwalloc(sizeof (int) * candidates->num_entries);
+
+    /* the retrieval of the geometries may change the order of the row_ids
+     * therefore, we first process the final entries (k = 0) and then the remaining candidates (k = 1) */
+    for (k = 0; k < 2; k++) {
+        check = (k == 1);
+        n = 0;
+        for (i = 0; i < candidates->num_entries; i++) {
+            if ((candidates->final_entry != NULL && candidates->final_entry[i]) != check)
+                row_ids[n++] = candidates->row_id[i];
+        }
+
+        for (i = 0; i < n; i += OFFSET_QUERY) {
+            total = (n - i < OFFSET_QUERY) ? n - i : OFFSET_QUERY;
+
+            geoms = retrieve_geoms_from_postgres(src, row_ids + i, total);
+
+            for (j = 0; j < total; j++) {
+                if (check) {
+                    lwgeom_set_srid(input, lwgeom_get_srid(geoms[j]));
+                }
+                if (!check || process_distance(input, geoms[j], distance)) {
+                    result->nofentries++;
+                    result->geoms[result->nofentries - 1] = geoms[j];
+                    result->row_id[result->nofentries - 1] = row_ids[i + j];
+                } else {
+                    lwgeom_free(geoms[j]);
+                }
+            }
+            lwfree(geoms);
+        }
+    }
+    lwfree(row_ids);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _refinement_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _refinement_time += get_elapsed_time(start, end);
+    //this is the number of results
+    _result_num = result->nofentries;
+#endif
+
+    return result;
+}
+
 void query_result_free(QueryResult * qr, uint8_t tp) {
     int i;
     if (qr->geoms != NULL && qr->max > 0) {
@@ -607,6 +775,34 @@ int process_predicate(LWGEOM *input, LWGEOM *geom, uint8_t p, uint8_t refin) {
     return result;
 }
 
+int process_distance(LWGEOM *input, LWGEOM *geom, double distance) {
+    int result;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    /* the tolerance version stops as soon as a distance smaller than the tolerance is found
+     * (this is the same approach of the ST_DWithin from PostGIS) */
+    result = (lwgeom_mindistance2d_tolerance(input, geom, distance) <= distance);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _processing_predicates_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _processing_predicates_time += get_elapsed_time(start, end);
+#endif
+
+    return result;
+}
+
 /*this function is responsible to handle several types of queries, such as:
  (i) range query considering input rectangular-shaped,
  (ii) generic object as input, named object query,
@@ -647,3 +843,127 @@ QueryResult *process_spatial_selection(SpatialIndex *si, LWGEOM *input,
 
     return result;
 }
+
+QueryResult *process_distance_selection(SpatialIndex *si, LWGEOM *input,
+        double distance, uint8_t processing_type) {
+    SpatialIndexResult *sir;
+    QueryResult *result = NULL;
+
+    if (processing_type == FILTER_AND_REFINEMENT_STEPS) {
+        sir = filter_step_dw(si, input, distance);
+        result = refinement_step_dw(sir, si->src, si->gp, input, distance);
+
+        spatial_index_result_free(sir);
+    } else if (processing_type == ONLY_FILTER_STEP) {
+        sir = filter_step_dw(si, input, distance);
+        if (sir->num_entries == 0) {
+            result = create_empty_query_result();
+        } else {
+            result = create_query_result(sir->num_entries);
+            memcpy(result->row_id, sir->row_id, sir->num_entries * sizeof (int));
+            result->nofentries = sir->num_entries;
+        }
+
+        spatial_index_result_free(sir);
+    } else {
+        _DEBUGF(ERROR, "Invalid parameter value for processing_option (%d)", processing_type);
+    }
+
+    return result;
+}
+
+uint64_t process_distance_count(SpatialIndex *si, LWGEOM *input,
+        double distance, uint8_t processing_type) {
+    SpatialIndexResult *sir;
+    uint64_t count = 0;
+    LWGEOM **geoms;
+    int i, j, total;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    struct timespec cpustart;
+    struct timespec cpuend;
+    struct timespec start;
+    struct timespec end;
+#endif
+
+    if (processing_type != FILTER_AND_REFINEMENT_STEPS && processing_type != ONLY_FILTER_STEP) {
+        _DEBUGF(ERROR, "Invalid parameter value for processing_option (%d)", processing_type);
+        return 0;
+    }
+
+    /* execution of the filter step */
+#ifdef COLLECT_STATISTICAL_DATA
+    cpustart = get_CPU_time();
+    start = get_current_time();
+#endif
+
+    if ((!input->bbox) && (!lwgeom_is_empty(input))) {
+        lwgeom_add_bbox(input);
+    }
+
+    if (si->vtable->count_dw != NULL) {
+        sir = spatialindex_distance_count(si, input, distance, &count);
+    } else {
+        /* the index does not store aggregate counts, 
+         * then we count the final entries and keep the remaining candidates */
+        SpatialIndexResult *all = spatialindex_distance_selection(si, input, distance);
+        sir = spatial_index_result_create();
+        for (i = 0; i < all->num_entries; i++) {
+            if (all->final_entry != NULL && all->final_entry[i])
+                count++;
+            else
+                spatial_index_result_add(sir, all->row_id[i]);
+        }
+        spatial_index_result_free(all);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    cpuend = get_CPU_time();
+    end = get_current_time();
+
+    _index_cpu_time += get_elapsed_time(cpustart, cpuend);
+    _filter_cpu_time += get_elapsed_time(cpustart, cpuend);
+
+    _index_time += get_elapsed_time(start, end);
+    _filter_time += get_elapsed_time(start, end);
+
+    //this is the number of candidates
+    _cand_num = count + sir->num_entries;
+#endif
+
+    if (processing_type == ONLY_FILTER_STEP) {
+        count += sir->num_entries;
+    } else {
+        /* execution of the refinement step (only for the candidates that cross the boundary of the query) */
+#ifdef COLLECT_STATISTICAL_DATA
+        cpustart = get_CPU_time();
+        start = get_current_time();
+#endif
+        for (i = 0; i < sir->num_entries; i += OFFSET_QUERY) {
+            total = (sir->num_entries - i < OFFSET_QUERY) ? sir->num_entries - i : OFFSET_QUERY;
+
+            geoms = retrieve_geoms_from_postgres(si->src, sir->row_id + i, total);
+            for (j = 0; j < total; j++) {
+                lwgeom_set_srid(input, lwgeom_get_srid(geoms[j]));
+                if (process_distance(input, geoms[j], distance))
+                    count++;
+                lwgeom_free(geoms[j]);
+            }
+            lwfree(geoms);
+        }
+#ifdef COLLECT_STATISTICAL_DATA
+        cpuend = get_CPU_time();
+        end = get_current_time();
+
+        _refinement_cpu_time += get_elapsed_time(cpustart, cpuend);
+        _refinement_time += get_elapsed_time(start, end);
+#endif
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _result_num = count;
+#endif
+
+    spatial_index_result_free(sir);
+    return count;
+}
@@ -42,6 +42,7 @@ v. 30, n. 2, p. 170–231, 1998.
 #define GENERIC_SELECTION_QUERY_TYPE    1
 #define RANGE_QUERY_TYPE                2
 #define POINT_QUERY_TYPE                3
+#define DISTANCE_RANGE_QUERY_TYPE       4 //the objects within a distance of the input (i.e., ST_DWithin)
 
 /*Types of processing of a spatial query*/
 #define FILTER_AND_REFINEMENT_STEPS  1
@@ -71,6 +72,15 @@ typedef QueryResult* (*refinement_step_processor_ss)(SpatialIndexResult *candida
 /*the user is able to change it for his/her own functions in order to process the filter and refinement steps for spatial selections*/
 extern void query_set_processor_ss(filter_step_processor_ss f, refinement_step_processor_ss r);
 
+/* it defines how to compute the filter and refinement steps of distance range queries
+ * the candidates marked as final entries (see SpatialIndexResult) do not need the refinement */
+typedef SpatialIndexResult* (*filter_step_processor_dw)(SpatialIndex *si, LWGEOM *input, double distance);
+typedef QueryResult* (*refinement_step_processor_dw)(SpatialIndexResult *candidates, Source *src, 
+        GenericParameters *gp, LWGEOM *input, double distance);
+
+/*the user is able to change it for his/her own functions in order to process the filter and refinement steps for distance range queries*/
+extern void query_set_processor_dw(filter_step_processor_dw f, refinement_step_processor_dw r);
+
 /* we define the following query: spatial selection 
  * index = the spatial index 
  * input = the point/region/window query
@@ -81,5 +91,22 @@ extern void query_set_processor_ss(filter_step_processor_ss f, refinement_step_p
 QueryResult *process_spatial_selection(SpatialIndex *si, LWGEOM *input, 
         uint8_t predicate, uint8_t query_type, uint8_t processing_type);
 
+/* we define the following query: distance range query
+ * index = the spatial index 
+ * input = the query object
+ * distance = the maximum distance between the input and the returned objects
+ * processing_type = which step of the query we will process (see above)
+ */
+QueryResult *process_distance_selection(SpatialIndex *si, LWGEOM *input, 
+        double distance, uint8_t processing_type);
+
+/* we define the following query: distance range count (the number of objects returned by a distance range query)
+ * the aggregate counts of the index are used when available (see count_dw in spatial_index.h),
+ * otherwise the final entries of the distance range query are counted
+ * with ONLY_FILTER_STEP the candidates are included in the count (i.e., it is an upper bound)
+ */
+uint64_t process_distance_count(SpatialIndex *si, LWGEOM *input,
+        double distance, uint8_t processing_type);
+
 #endif /* QUERY_H */
 
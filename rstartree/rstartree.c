@@ -92,10 +92,15 @@ static void adjust_rstartree(RStarTree *rstar, RNode *chosen_node, int height, R
 static void reinsert_rstartree(RStarTree *rstar, RNode *chosen_node, int chosen_address, int height, RNodeStack *stack);
 /*insert an entry in a determined height of the tree (height = 0 is an insert in a leaf node)*/
 static void insert_entry_rstartree(RStarTree *rstar, REntry *input, int height);
+/* the sequential-insert fast path (see RLeafHint and rtree_insert_with_leaf_hint in rtree.h)
+ * it returns false without modifying the tree if the normal insertion algorithm must be used */
+static bool insert_entry_with_hint_rstartree(RStarTree *rstar, REntry *input);
 /* original deletion algorithm from R-tree 
  * but it uses the insert_rstartree to reinsert the removed nodes
  */
 static bool delete_entry_rstartree(RStarTree *rstar, const REntry *to_remove);
+/*D4 of the deletion: the only child of the root node becomes the new root node*/
+static void shorten_rstartree(RStarTree *rstar);
 
 RNode *choose_node_rstartree(RStarTree *rstar, REntry *input, int i_height, RNodeStack *stack, int *chosen_address) {
     RNode *n;
@@ -282,6 +287,7 @@ void adjust_rstartree(RStarTree *rstar, RNode *chosen_node, int cn_height, RNode
     RNode *n;
 
     bool adjusting = true;
+    bool modified_bbox, modified_count;
 
     /*AT1 [Initialize.] Set N=L  */
     n = rnode_clone(chosen_node);
@@ -301,14 +307,26 @@ all entry rectangles in N.*/
         rstar->current_node = rnode_stack_pop(stack, &parent_add, &entry);
         n_bbox = rnode_compute_bbox(n);
 
-        //we check if it is necessary to modify the BBOX of this parent
-        if (!bbox_check_predicate(n_bbox, rstar->current_node->entries[entry]->bbox, EQUAL)) {
-            memcpy(rstar->current_node->entries[entry]->bbox, n_bbox, sizeof (BBox));
+        modified_bbox = !bbox_check_predicate(n_bbox, rstar->current_node->entries[entry]->bbox, EQUAL);
+        modified_count = false;
+        /* in aggregate R*-trees, the number of objects of the subtree may change without changing its bbox */
+        if (rstar->spec->aggregate)
+            modified_count = rentry_update_count(rstar->current_node->entries[entry], n, h);
+
+        //we check if it is necessary to modify the BBOX (or the count) of this parent
+        if (modified_bbox || modified_count) {
+            if (modified_bbox)
+                memcpy(rstar->current_node->entries[entry]->bbox, n_bbox, sizeof (BBox));
+            rentry_update_clips(rstar->current_node->entries[entry], n, rstar->spec->nof_clip_points);
 
             if (rstar->type == CONVENTIONAL_RSTARTREE) {
                 put_rnode(&rstar->base, rstar->current_node, parent_add, h + 1);
             } else if (rstar->type == FAST_RSTARTREE_TYPE) {
-                fb_put_mod_bbox(&rstar->base, fast_spc, parent_add, bbox_clone(n_bbox), entry, h + 1);
+                if (modified_bbox)
+                    fb_put_mod_bbox(&rstar->base, fast_spc, parent_add, bbox_clone(n_bbox), entry, h + 1);
+                if (modified_count)
+                    fb_put_mod_count(&rstar->base, fast_spc, parent_add,
+                        rstar->current_node->entries[entry]->count, entry, h + 1);
             } else if (rstar->type == eFIND_RSTARTREE_TYPE) {
                 efind_buf_mod_node(&rstar->base, efind_spc, parent_add,
                         (void *) rentry_clone(rstar->current_node->entries[entry]), h + 1);
@@ -327,6 +345,15 @@ all entry rectangles in N.*/
             n = rstar->current_node;
             rstar->current_node = NULL;
         } else {
+            /* the bbox is the same, but the dead space of n may have changed
+             * since clip points are only maintained by conventional R*-trees, we only write the parent*/
+            if (rentry_update_clips(rstar->current_node->entries[entry], n, rstar->spec->nof_clip_points)) {
+                put_rnode(&rstar->base, rstar->current_node, parent_add, h + 1);
+#ifdef COLLECT_STATISTICAL_DATA
+                _written_int_node_num++;
+                insert_writes_per_height(h + 1, 1);
+#endif
+            }
             adjusting = false;
         }
         lwfree(n_bbox);
@@ -419,6 +446,8 @@ bounding rectangle of N*/
                 //we modify the pointer and the bbox
                 fb_put_mod_pointer(&rstar->base, fast_spc, chosen_address, new->entries[in]->pointer, in, cn_height);
                 fb_put_mod_bbox(&rstar->base, fast_spc, chosen_address, bbox_clone(new->entries[in]->bbox), in, cn_height);
+                if (new->entries[in]->count > 0)
+                    fb_put_mod_count(&rstar->base, fast_spc, chosen_address, new->entries[in]->count, in, cn_height);
             }
         }
         //we need to 'del' the remaining entries in the reverse order
@@ -512,6 +541,9 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
             } else if (rstar->type == FAST_RSTARTREE_TYPE) {
                 fb_put_mod_pointer(&rstar->base, fast_spc, chosen_address, input->pointer, chosen_node->nofentries - 1, i_height);
                 fb_put_mod_bbox(&rstar->base, fast_spc, chosen_address, bbox_clone(input->bbox), chosen_node->nofentries - 1, i_height);
+                //entries inserted in internal nodes of aggregate R*-trees carry the count of their subtrees
+                if (input->count > 0)
+                    fb_put_mod_count(&rstar->base, fast_spc, chosen_address, input->count, chosen_node->nofentries - 1, i_height);
             } else if (rstar->type == eFIND_RSTARTREE_TYPE) {
                 efind_buf_mod_node(&rstar->base, efind_spc, chosen_address,
                         (void*) rentry_clone(input), i_height);
@@ -534,6 +566,16 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
             //_DEBUG(NOTICE, "Adjusting the tree");
             adjust_rstartree(rstar, chosen_node, i_height, stack);
             //_DEBUG(NOTICE, "adjusted");
+            /* the leaf node is the hint of the next insertion if it is not the root node
+             * (its parent entry now has the bbox of the leaf node, see adjust_rstartree) */
+            if (i_height == 0 && rstar->info->height > 0) {
+                BBox *leaf_bbox = rnode_compute_bbox(chosen_node);
+                rstar->hint.page = chosen_address;
+                memcpy(&(rstar->hint.bbox), leaf_bbox, sizeof (BBox));
+                lwfree(leaf_bbox);
+            } else {
+                rstar->hint.page = -1;
+            }
             rnode_free(chosen_node);
             rnode_stack_destroy(stack);
             break;
@@ -562,6 +604,8 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
             //_DEBUG(NOTICE, "Processing reinsertion...");
             reinsert_rstartree(rstar, chosen_node, chosen_address, i_height, stack);
             //_DEBUG(NOTICE, "Done");
+            //the reinsertion modified other nodes after the insertions of the removed entries
+            rstar->hint.page = -1;
             rnode_free(chosen_node);
             rnode_stack_destroy(stack);
             break;
@@ -587,6 +631,7 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
             chosen_node = NULL;
 
             split_address = rtreesinfo_get_valid_page(rstar->info);
+            rstar->hint.page = -1;
 
             if (rstar->type == CONVENTIONAL_RSTARTREE) {
                 //we have to update the content of the chosen_node to l
@@ -674,6 +719,9 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
 
                 //the first entry of our new root is the old root node
                 rnode_add_rentry(new_root, rentry_create(rstar->info->root_page, rnode_compute_bbox(l)));
+                rentry_update_clips(new_root->entries[0], l, rstar->spec->nof_clip_points);
+                if (rstar->spec->aggregate)
+                    rentry_update_count(new_root->entries[0], l, i_height);
 
                 if (rstar->type == FAST_RSTARTREE_TYPE) {
                     //we put the new node in the buffer
@@ -687,7 +735,7 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
                     efind_buf_create_node(&rstar->base, efind_spc, new_root_add,
                             rstar->info->height);
                     efind_buf_mod_node(&rstar->base, efind_spc, new_root_add,
-                            (void *) rentry_create(rstar->info->root_page, rnode_compute_bbox(l)),
+                            (void *) rentry_clone(new_root->entries[0]),
                             rstar->info->height);
                 }
                 storage_update_tree_height(&rstar->base, rstar->info->height);
@@ -702,28 +750,46 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
                  which will be inserted in the next iteration of this while
                  */
                 input = rentry_create(split_address, rnode_compute_bbox(ll));
+                rentry_update_clips(input, ll, rstar->spec->nof_clip_points);
+                if (rstar->spec->aggregate)
+                    rentry_update_count(input, ll, i_height);
                 //_DEBUGF(NOTICE, "New root node created with id %d", chosen_address);
             } else {
                 BBox *l_bbox;
+                bool modified_bbox, modified_count;
                 //_DEBUG(NOTICE, "Checking if the parent should be modified");
                 p_entry = 0;
                 parent = rnode_stack_pop(stack, &chosen_address, &p_entry);
                 l_bbox = rnode_compute_bbox(l);
-                /*we check if the entry of parent that corresponds to l need to be updated*/
-                if (!bbox_check_predicate(l_bbox, parent->entries[p_entry]->bbox, EQUAL)) {
+                modified_bbox = !bbox_check_predicate(l_bbox, parent->entries[p_entry]->bbox, EQUAL);
+                if (modified_bbox)
                     memcpy(parent->entries[p_entry]->bbox, l_bbox, sizeof (BBox));
+                /*l has less objects than before the split in aggregate R*-trees*/
+                modified_count = false;
+                if (rstar->spec->aggregate)
+                    modified_count = rentry_update_count(parent->entries[p_entry], l, i_height);
+                /*we check if the entry of parent that corresponds to l need to be updated*/
+                if (modified_bbox || modified_count) {
                     //_DEBUG(NOTICE, "Yes, it should");
                     //we only update the bbox for FAST e eFIND. We do not need to update in other cases because the parent will be written in the next iteration
                     if (rstar->type == FAST_RSTARTREE_TYPE) {
-                        fb_put_mod_bbox(&rstar->base, fast_spc, chosen_address, bbox_clone(l_bbox), p_entry, i_height + 1);
+                        if (modified_bbox)
+                            fb_put_mod_bbox(&rstar->base, fast_spc, chosen_address, bbox_clone(l_bbox), p_entry, i_height + 1);
+                        if (modified_count)
+                            fb_put_mod_count(&rstar->base, fast_spc, chosen_address, parent->entries[p_entry]->count, p_entry, i_height + 1);
                     } else if (rstar->type == eFIND_RSTARTREE_TYPE) {
                         efind_buf_mod_node(&rstar->base, efind_spc, chosen_address, (void*) rentry_clone(parent->entries[p_entry]), i_height + 1);
                     }
                 }
                 lwfree(l_bbox);
+                /*the parent is written in the next iteration, together with the clip points of l*/
+                rentry_update_clips(parent->entries[p_entry], l, rstar->spec->nof_clip_points);
 
                 /*now the input is the split node*/
                 input = rentry_create(split_address, rnode_compute_bbox(ll));
+                rentry_update_clips(input, ll, rstar->spec->nof_clip_points);
+                if (rstar->spec->aggregate)
+                    rentry_update_count(input, ll, i_height);
                 /*now the chosen_node will be the parent*/
                 chosen_node = parent;
             }
@@ -738,6 +804,22 @@ void insert_entry_rstartree(RStarTree *rstar, REntry *input, int i_height) {
 
 }
 
+bool insert_entry_with_hint_rstartree(RStarTree *rstar, REntry *input) {
+    /* in aggregate R*-trees and R*-trees with clip points, the parent entry depends on the content of the leaf node */
+    if (!rstar->spec->leaf_hint || rstar->spec->aggregate || rstar->spec->nof_clip_points > 0)
+        return false;
+
+    //the fast path of the R-tree is used, thus it needs our specifications
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+
+    //a full leaf node needs the overflow treatment (i.e., the forced reinsertion), thus the normal insertion is used
+    return rtree_insert_with_leaf_hint(&rstar->base, rstar->type, &(rstar->hint),
+            rstar->spec->max_entries_leaf_node, input);
+}
+
 RTree *rstartree_to_rtree(RStarTree *rstar) {
     RTree *r;
     SpatialIndex *si_rtree;
@@ -769,6 +851,10 @@ RTree *rstartree_to_rtree(RStarTree *rstar) {
     r->spec->min_entries_int_node = rstar->spec->min_entries_int_node;
     r->spec->min_entries_leaf_node = rstar->spec->min_entries_leaf_node;
     r->spec->split_type = RSTARTREE_SPLIT;
+    r->spec->nof_clip_points = rstar->spec->nof_clip_points;
+    r->spec->aggregate = rstar->spec->aggregate;
+    //the converted r-tree is only used for a single operation
+    r->spec->leaf_hint = false;
 
     return r;
 }
@@ -780,6 +866,90 @@ void free_converted_rtree(RTree *rtree) {
     lwfree(rtree);
 }
 
+bool rstartree_bulk_load(RStarTree *rstar, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads) {
+    RTree *r;
+    bool ret;
+
+    if (rstar->type != CONVENTIONAL_RSTARTREE && rstar->type != FAST_RSTARTREE_TYPE
+            && rstar->type != eFIND_RSTARTREE_TYPE) {
+        _DEBUGF(ERROR, "Bulk loading is not supported by the R*-tree type %d", rstar->type);
+        return false;
+    }
+
+    //the packing is the same of the rtree since they have the same nodes
+    r = rstartree_to_rtree(rstar);
+
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+
+    ret = rtree_bulk_load(r, entries, n, fill_factor, nofthreads);
+    rstar->hint.page = -1;
+
+    //the info is shared, but the root node is not
+    if (rstar->current_node != NULL)
+        rnode_free(rstar->current_node);
+    rstar->current_node = rnode_clone(r->current_node);
+
+    free_converted_rtree(r);
+    return ret;
+}
+
+void shorten_rstartree(RStarTree *rstar) {
+    int p;
+    RNode *new_root = NULL;
+    p = rstar->current_node->entries[0]->pointer;
+
+    /*remove from the disk*/
+    if (rstar->type == CONVENTIONAL_RSTARTREE) {
+        del_rnode(&rstar->base, rstar->info->root_page, rstar->info->height);
+    } else if (rstar->type == FAST_RSTARTREE_TYPE) {
+        fb_del_node(&rstar->base, fast_spc, rstar->info->root_page, rstar->info->height);
+    } else if (rstar->type == eFIND_RSTARTREE_TYPE) {
+        //we update the height of three
+        if (efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
+            efind_readbuffer_hlru_set_tree_height(rstar->info->height - 1);
+        efind_buf_del_node(&rstar->base, efind_spc, rstar->info->root_page, rstar->info->height);
+    } else {
+        _DEBUGF(ERROR, "Invalid R*-tree specification %d", rstar->type);
+    }
+    storage_update_tree_height(&rstar->base, rstar->info->height - 1);
+    
+    //we add the removed page as an empty page now
+    rtreesinfo_add_empty_page(rstar->info, rstar->info->root_page);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _deleted_int_node_num++;
+    insert_writes_per_height(rstar->info->height, 1);
+#endif
+
+    /* from now on, we modify the RSTARTREE*/
+    rnode_free(rstar->current_node);
+    rstar->info->root_page = p;
+
+    if (rstar->type == CONVENTIONAL_RSTARTREE)
+        new_root = get_rnode(&rstar->base, p, rstar->info->height - 1);
+    else if (rstar->type == FAST_RSTARTREE_TYPE)
+        new_root = (RNode *) fb_retrieve_node(&rstar->base, p, rstar->info->height - 1);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        new_root = (RNode *) efind_buf_retrieve_node(&rstar->base, efind_spc, p, rstar->info->height - 1);
+
+    rstar->current_node = new_root;
+    rstar->info->height--;
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (rstar->info->height > 0) {
+        //we visited one internal node, then we add it
+        _visited_int_node_num++;
+    } else {
+        //we visited one leaf node
+        _visited_leaf_node_num++;
+    }
+    insert_reads_per_height(rstar->info->height, 1);
+#endif
+}
+
 bool delete_entry_rstartree(RStarTree *rstar, const REntry *to_remove) {
     RTree *r;
     RNodeStack *removed_nodes;
@@ -815,61 +985,56 @@ bool delete_entry_rstartree(RStarTree *rstar, const REntry *to_remove) {
 
     /*D4 [Shorten tree.] If the root node has only one child after the tree has
 been adjusted, make the child the new root*/
-    if (rstar->current_node->nofentries == 1 && rstar->info->height > 0) {
-        int p;
-        RNode *new_root = NULL;
-        p = rstar->current_node->entries[0]->pointer;
-
-        /*remove from the disk*/
-        if (rstar->type == CONVENTIONAL_RSTARTREE) {
-            del_rnode(&rstar->base, rstar->info->root_page, rstar->info->height);
-        } else if (rstar->type == FAST_RSTARTREE_TYPE) {
-            fb_del_node(&rstar->base, fast_spc, rstar->info->root_page, rstar->info->height);
-        } else if (rstar->type == eFIND_RSTARTREE_TYPE) {
-            //we update the height of three
-            if (efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
-                efind_readbuffer_hlru_set_tree_height(rstar->info->height - 1);
-            efind_buf_del_node(&rstar->base, efind_spc, rstar->info->root_page, rstar->info->height);
-        } else {
-            _DEBUGF(ERROR, "Invalid R*-tree specification %d", rstar->type);
-        }
-        storage_update_tree_height(&rstar->base, rstar->info->height - 1);
-        
-        //we add the removed page as an empty page now
-        rtreesinfo_add_empty_page(rstar->info, rstar->info->root_page);
+    if (rstar->current_node->nofentries == 1 && rstar->info->height > 0)
+        shorten_rstartree(rstar);
 
-#ifdef COLLECT_STATISTICAL_DATA
-        _deleted_int_node_num++;
-        insert_writes_per_height(rstar->info->height, 1);
-#endif
+    //the leaf node of the hint may have been shrunk or removed
+    rstar->hint.page = -1;
 
-        /* from now on, we modify the RSTARTREE*/
-        rnode_free(rstar->current_node);
-        rstar->info->root_page = p;
+    /*freeing memory*/
+    rnode_stack_destroy(removed_nodes);
+    free_converted_rtree(r);
 
-        if (rstar->type == CONVENTIONAL_RSTARTREE)
-            new_root = get_rnode(&rstar->base, p, rstar->info->height - 1);
-        else if (rstar->type == FAST_RSTARTREE_TYPE)
-            new_root = (RNode *) fb_retrieve_node(&rstar->base, p, rstar->info->height - 1);
-        else if (rstar->type == eFIND_RSTARTREE_TYPE)
-            new_root = (RNode *) efind_buf_retrieve_node(&rstar->base, efind_spc, p, rstar->info->height - 1);
+    return ret;
+}
 
-        rstar->current_node = new_root;
-        rstar->info->height--;
+/*region deletion (defined in rstartree.h)*/
+bool rstartree_remove_region(RStarTree *rstar, const BBox *window) {
+    RTree *r;
+    RNodeStack *removed_nodes;
+    bool ret;
+    int i;
+    RNode *n;
+    int level;
 
-#ifdef COLLECT_STATISTICAL_DATA
-        if (rstar->info->height > 0) {
-            //we visited one internal node, then we add it
-            _visited_int_node_num++;
-        } else {
-            //we visited one leaf node
-            _visited_leaf_node_num++;
+    //the same region deletion of the rtree, but the removed nodes are reinserted by the R*-tree
+    r = rstartree_to_rtree(rstar);
+
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+
+    removed_nodes = rnode_stack_init();
+    ret = rtree_remove_region(r, window, removed_nodes, false);
+
+    rnode_free(rstar->current_node);
+    rstar->current_node = rnode_clone(r->current_node);
+
+    while (removed_nodes->size > 0) {
+        n = rnode_stack_pop(removed_nodes, &level, NULL);
+        for (i = 0; i < n->nofentries; i++) {
+            insert_entry_rstartree(rstar, rentry_clone(n->entries[i]), level);
         }
-        insert_reads_per_height(rstar->info->height, 1);
-#endif        
+        rnode_free(n);
     }
 
-    /*freeing memory*/
+    /*D4 [Shorten tree.] several levels can become useless here*/
+    while (rstar->current_node->nofentries == 1 && rstar->info->height > 0)
+        shorten_rstartree(rstar);
+
+    rstar->hint.page = -1;
+
     rnode_stack_destroy(removed_nodes);
     free_converted_rtree(r);
 
@@ -899,6 +1064,10 @@ static bool rstartree_insert(SpatialIndex *si, int pointer, const LWGEOM *geom)
 
     input = rentry_create(pointer, bbox);
 
+    //if the leaf node of the hint covers the input and has room, there is no overflow treatment
+    if (insert_entry_with_hint_rstartree(rstar, input))
+        return true;
+
     /*Algorithm InsertData
 ID1 Invoke Insert starting with the leaf level as a
 parameter, to Insert a new data rectangle*/
@@ -941,8 +1110,10 @@ static SpatialIndexResult *rstartree_search_ss(SpatialIndex *si, const LWGEOM *s
     BBox *search = (BBox*) lwalloc(sizeof (BBox));
     RStarTree *rstar = (void *) si;
     RTree *r;
+    PolygonMask *mask;
 
     gbox_to_bbox(search_object->bbox, search);
+    mask = polygonmask_create(search_object);
 
     //we first convert the rstartree to an rtree since this is the same search algorithm
     r = rstartree_to_rtree(rstar);
@@ -951,13 +1122,80 @@ static SpatialIndexResult *rstartree_search_ss(SpatialIndex *si, const LWGEOM *s
         rtree_set_fastspecification(fast_spc);
     else if (rstar->type == eFIND_RSTARTREE_TYPE)
         rtree_set_efindspecification(efind_spc);
-    sir = rtree_search(r, search, predicate);
+    sir = rtree_search(r, search, mask, predicate);
 
     free_converted_rtree(r);
+    polygonmask_free(mask);
     lwfree(search);
     return sir;
 }
 
+static SpatialIndexResult *rstartree_search_pt(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate) {
+    SpatialIndexResult *sir;
+    BBox *point = (BBox*) lwalloc(sizeof (BBox));
+    RStarTree *rstar = (void *) si;
+    RTree *r;
+
+    gbox_to_bbox(search_object->bbox, point);
+
+    //we first convert the rstartree to an rtree since this is the same search algorithm
+    r = rstartree_to_rtree(rstar);
+
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+    sir = rtree_point_search(r, point, predicate);
+
+    free_converted_rtree(r);
+    lwfree(point);
+    return sir;
+}
+
+static SpatialIndexResult *rstartree_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    SpatialIndexResult *sir;
+    RStarTree *rstar = (void *) si;
+    RTree *r;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    //we first convert the rstartree to an rtree since this is the same search algorithm
+    r = rstartree_to_rtree(rstar);
+
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+    sir = rtree_distance_search(r, dq);
+
+    free_converted_rtree(r);
+    distancequery_free(dq);
+    return sir;
+}
+
+static SpatialIndexResult *rstartree_count_dw(SpatialIndex *si, const LWGEOM *search_object, double distance, uint64_t *nofobjects) {
+    SpatialIndexResult *sir;
+    RStarTree *rstar = (void *) si;
+    RTree *r;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    //the aggregate counts are maintained in the same way of the rtree
+    r = rstartree_to_rtree(rstar);
+
+    if (rstar->type == FAST_RSTARTREE_TYPE)
+        rtree_set_fastspecification(fast_spc);
+    else if (rstar->type == eFIND_RSTARTREE_TYPE)
+        rtree_set_efindspecification(efind_spc);
+    sir = rtree_distance_count(r, dq, nofobjects);
+
+    free_converted_rtree(r);
+    distancequery_free(dq);
+    return sir;
+}
+
 static bool rstartree_header_writer(SpatialIndex *si, const char *file) {
     festival_header_writer(file, CONVENTIONAL_RSTARTREE, si);
     return true;
@@ -984,8 +1222,8 @@ SpatialIndex *rstartree_empty_create(char *file, Source *src, GenericParameters
 
     /*define the general functions of the rstartree*/
     static const SpatialIndexInterface vtable = {rstartree_get_type,
-        rstartree_insert, rstartree_remove, rstartree_update, rstartree_search_ss,
-        rstartree_header_writer, rstartree_destroy};
+        rstartree_insert, rstartree_remove, rstartree_update, rstartree_search_ss, rstartree_search_pt,
+        rstartree_search_dw, rstartree_count_dw, rstartree_header_writer, rstartree_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -1001,6 +1239,7 @@ SpatialIndex *rstartree_empty_create(char *file, Source *src, GenericParameters
     rstar->reinsert = (bool*) lwalloc(sizeof (bool)*1);
     rstar->reinsert[0] = true;
     rstar->current_node = NULL;
+    rstar->hint.page = -1;
 
     //we have to persist the empty node
     if (persist) {
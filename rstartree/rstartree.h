@@ -49,6 +49,9 @@ typedef struct {
     double reinsert_perc_leaf_node; //the percentage to be considered in the reinsertion policy (only for leaf nodes)
     uint8_t reinsert_type; //(see above)
     int max_neighbors_to_examine; //parameter considered in the insertion routine    
+    uint8_t nof_clip_points; //maximum number of clip points of the entries of internal nodes (0 means no clipping, see rnode.h)
+    bool aggregate; //if true, the entries of internal nodes store the number of objects of their subtrees
+    bool leaf_hint; //if true, the insertions employ the sequential-insert fast path (see RLeafHint in rtree.h)
 } RStarTreeSpecification;
 
 /* THE DEFINITION OF A R*-TREE INDEX as a subtype of spatialindex */
@@ -61,6 +64,7 @@ typedef struct {
     RTreesInfo *info; //information about this index
     RNode *current_node; //what is the current rnode of this index?
     bool *reinsert; //an array indicating if a height (the index of the array) have reinserted entries
+    RLeafHint hint; //the hint of the sequential-insert fast path (only used if spec->leaf_hint is true)
 } RStarTree;
 
 
@@ -76,6 +80,11 @@ extern void rstartree_set_efindspecification(eFINDSpecification *fesp);
 
 /* an auxiliary function to convert a RStarTree to a RTree index since we reuse some algorithms of RTREE*/
 extern RTree *rstartree_to_rtree(RStarTree *rstar);
+/* bulk loading of an empty R*-tree (see rtree_bulk_load) */
+extern bool rstartree_bulk_load(RStarTree *rstar, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads);
+/* region deletion of the R*-tree (see rtree_remove_region), the removed nodes are reinserted by the R*-tree insertion */
+extern bool rstartree_remove_region(RStarTree *rstar, const BBox *window);
+
 /* an auxiliary function to free an converted RTree index (THIS IS ONLY VALID HERE!)*/
 extern void free_converted_rtree(RTree *rtree);
 
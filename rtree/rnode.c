@@ -14,6 +14,7 @@
 #include "rnode.h"
 
 #include <string.h> /* for memcpy */
+#include <stdlib.h> /* for qsort */
 #include <malloc.h> /* for posix_memalign */
 #include <stringbuffer.h> /* for stringbuffer of postgis */
 #include <lwgeom_geos.h> /* for lwgeom_union and so on*/
@@ -56,14 +57,12 @@ void rnode_remove_rentry(RNode *node, int entry) {
     } else {
         /*tested with valgrind and it is OK!*/
         if (entry < node->nofentries - 1) {
-            lwfree(node->entries[entry]->bbox);
-            lwfree(node->entries[entry]);
+            rentry_free(node->entries[entry]);
             node->entries[entry] = NULL;
             memmove(node->entries + entry, node->entries + (entry + 1), sizeof (node->entries[0]) * (node->nofentries - entry - 1));
         } else if (entry == node->nofentries - 1) {
             //if this is the last element, we only remove it from the memory
-            lwfree(node->entries[entry]->bbox);
-            lwfree(node->entries[entry]);
+            rentry_free(node->entries[entry]);
         }
 
         /* We have one less point */
@@ -83,6 +82,14 @@ REntry *rentry_clone(const REntry *entry) {
     copied->bbox = b;
 
     memcpy(copied->bbox, entry->bbox, sizeof (BBox));
+
+    copied->count = entry->count;
+    copied->nofclips = entry->nofclips;
+    copied->clips = NULL;
+    if (entry->nofclips > 0) {
+        copied->clips = (ClipPoint*) lwalloc(sizeof (ClipPoint) * entry->nofclips);
+        memcpy(copied->clips, entry->clips, sizeof (ClipPoint) * entry->nofclips);
+    }
     return copied;
 }
 
@@ -114,14 +121,12 @@ void rnode_copy(RNode *dest, const RNode *src) {
         for (i = old - 1; i >= src->nofentries; i--) {
             del++;
             if (i < old - 1) {
-                lwfree(dest->entries[i]->bbox);
-                lwfree(dest->entries[i]);
+                rentry_free(dest->entries[i]);
                 dest->entries[i] = NULL;
                 memmove(dest->entries + i, dest->entries + (i + 1), sizeof (dest->entries[0]) * (old - i - 1));
             } else if (i == (old - 1)) {
                 //if this is the last element, we only remove it from the memory
-                lwfree(dest->entries[i]->bbox);
-                lwfree(dest->entries[i]);
+                rentry_free(dest->entries[i]);
             }
         }
         if (del + src->nofentries != old) {
@@ -133,9 +138,23 @@ void rnode_copy(RNode *dest, const RNode *src) {
         if (i >= old) {
             dest->entries[i] = (REntry*) lwalloc(sizeof (REntry));
             dest->entries[i]->bbox = (BBox*) lwalloc(sizeof (BBox));
+            dest->entries[i]->nofclips = 0;
+            dest->entries[i]->clips = NULL;
         }
         dest->entries[i]->pointer = src->entries[i]->pointer;
+        dest->entries[i]->count = src->entries[i]->count;
         memcpy(dest->entries[i]->bbox, src->entries[i]->bbox, sizeof (BBox));
+
+        if (dest->entries[i]->nofclips != src->entries[i]->nofclips) {
+            if (dest->entries[i]->clips)
+                lwfree(dest->entries[i]->clips);
+            dest->entries[i]->clips = NULL;
+            if (src->entries[i]->nofclips > 0)
+                dest->entries[i]->clips = (ClipPoint*) lwalloc(sizeof (ClipPoint) * src->entries[i]->nofclips);
+            dest->entries[i]->nofclips = src->entries[i]->nofclips;
+        }
+        if (src->entries[i]->nofclips > 0)
+            memcpy(dest->entries[i]->clips, src->entries[i]->clips, sizeof (ClipPoint) * src->entries[i]->nofclips);
     }
 }
 
@@ -167,6 +186,9 @@ REntry *rentry_create(int pointer, BBox *bbox) {
     REntry *entry = (REntry*) lwalloc(sizeof (REntry));
     entry->pointer = pointer;
     entry->bbox = bbox;
+    entry->nofclips = 0;
+    entry->clips = NULL;
+    entry->count = 0;
     return entry;
 }
 
@@ -178,11 +200,40 @@ RNode *rnode_create_empty() {
     return r;
 }
 
+/*return true if some entry of the node has clip points*/
+static bool rnode_has_clips(const RNode *node) {
+    int i;
+    for (i = 0; i < node->nofentries; i++) {
+        if (node->entries[i]->nofclips > 0)
+            return true;
+    }
+    return false;
+}
+
+/*return true if some entry of the node stores the number of objects of its subtree*/
+static bool rnode_has_counts(const RNode *node) {
+    int i;
+    for (i = 0; i < node->nofentries; i++) {
+        if (node->entries[i]->count > 0)
+            return true;
+    }
+    return false;
+}
+
 /*return the size in bytes of a rnode instance*/
 size_t rnode_size(const RNode *node) {
     size_t size = 0;
+    int i;
     size += sizeof (uint32_t); //nofentries
     size += rentry_size() * node->nofentries;
+    if (rnode_has_clips(node)) {
+        for (i = 0; i < node->nofentries; i++) {
+            size += sizeof (uint8_t); //nofclips
+            size += (sizeof (uint8_t) + sizeof (double) * NUM_OF_DIM) * node->entries[i]->nofclips;
+        }
+    }
+    if (rnode_has_counts(node))
+        size += sizeof (uint32_t) * node->nofentries; //count of each entry
     return size;
 }
 
@@ -194,15 +245,22 @@ size_t rentry_size() {
     return size; // = 4+(8*2*2) = 36
 }
 
+/*return the maximum size in bytes of a rentry with clip points */
+size_t rentry_size_with_clips(uint8_t nofclips) {
+    size_t size = rentry_size();
+    if (nofclips > 0) {
+        size += sizeof (uint8_t); //nofclips
+        size += (sizeof (uint8_t) + sizeof (double) * NUM_OF_DIM) * nofclips; //corner and point of each clip
+    }
+    return size; // = 36+1+(1+8*2)*nofclips
+}
+
 void rnode_free(RNode *node) {
     if (node) {
         if (node->entries && node->nofentries > 0) {
             int i;
             for (i = 0; i < node->nofentries; i++) {
-                if (node->entries[i]->bbox) {
-                    lwfree(node->entries[i]->bbox);
-                }
-                lwfree(node->entries[i]);
+                rentry_free(node->entries[i]);
             }
             lwfree(node->entries);
         }
@@ -214,6 +272,8 @@ void rentry_free(REntry *entry) {
     if (entry) {
         if (entry->bbox)
             lwfree(entry->bbox);
+        if (entry->clips)
+            lwfree(entry->clips);
         lwfree(entry);
     }
 }
@@ -221,29 +281,47 @@ void rentry_free(REntry *entry) {
 /* read a node from the file or buffer */
 RNode *get_rnode(const SpatialIndex *si, int page_num, int height) {
     RNode *node = rnode_create_empty();
-    int i;
-    uint8_t *buf;
+    int i, j;
+    uint8_t *buf = NULL;
     uint8_t *loc;
-
-    if (si->gp->io_access == DIRECT_ACCESS) {
-        //then the memory must be aligned in blocks!
-        if (posix_memalign((void**) &buf, si->gp->page_size, si->gp->page_size)) {
-            _DEBUG(ERROR, "Allocation failed at get_rnode");
-            return NULL;
+    uint32_t header;
+    bool with_clips = false;
+    bool with_counts = false;
+
+    //if the node is in the buffer, we deserialize it directly from its frame
+    loc = storage_pin_page(si, page_num, height);
+    if (loc == NULL) {
+        if (si->gp->io_access == DIRECT_ACCESS) {
+            //then the memory must be aligned in blocks!
+            if (posix_memalign((void**) &buf, si->gp->page_size, si->gp->page_size)) {
+                _DEBUG(ERROR, "Allocation failed at get_rnode");
+                return NULL;
+            }
+        } else {
+            buf = (uint8_t*) lwalloc(si->gp->page_size);
         }
-    } else {
-        buf = (uint8_t*) lwalloc(si->gp->page_size);
-    }
 
-    //we recover the requested node
-    storage_read_one_page(si, page_num, buf, height);
+        //we recover the requested node
+        storage_read_one_page(si, page_num, buf, height);
 
-    loc = buf;
+        loc = buf;
+    }
 
     /* now we have to deserialize the buf*/
-    memcpy(&node->nofentries, loc, sizeof (uint32_t));
+    memcpy(&header, loc, sizeof (uint32_t));
     loc += sizeof (uint32_t);
 
+    /* the flags of clip points and counts are not checked for invalid nodes (i.e., -1) */
+    if ((int) header >= 0 && (header & RNODE_CLIPPED_FLAG)) {
+        with_clips = true;
+        header &= ~RNODE_CLIPPED_FLAG;
+    }
+    if ((int) header >= 0 && (header & RNODE_AGGREGATE_FLAG)) {
+        with_counts = true;
+        header &= ~RNODE_AGGREGATE_FLAG;
+    }
+    node->nofentries = (int) header;
+
     if (node->nofentries == 0) {
         if (page_num != 0) {
             /*we allows this situation since a flushing operation can choose 
@@ -269,9 +347,33 @@ RNode *get_rnode(const SpatialIndex *si, int page_num, int height) {
 
         memcpy(node->entries[i]->bbox, loc, sizeof (BBox));
         loc += sizeof (BBox);
+
+        node->entries[i]->nofclips = 0;
+        node->entries[i]->clips = NULL;
+        if (with_clips) {
+            memcpy(&(node->entries[i]->nofclips), loc, sizeof (uint8_t));
+            loc += sizeof (uint8_t);
+
+            if (node->entries[i]->nofclips > 0)
+                node->entries[i]->clips = (ClipPoint*) lwalloc(sizeof (ClipPoint) * node->entries[i]->nofclips);
+            for (j = 0; j < node->entries[i]->nofclips; j++) {
+                memcpy(&(node->entries[i]->clips[j].corner), loc, sizeof (uint8_t));
+                loc += sizeof (uint8_t);
+                memcpy(node->entries[i]->clips[j].point, loc, sizeof (double) * NUM_OF_DIM);
+                loc += sizeof (double) * NUM_OF_DIM;
+            }
+        }
+
+        node->entries[i]->count = 0;
+        if (with_counts) {
+            memcpy(&(node->entries[i]->count), loc, sizeof (uint32_t));
+            loc += sizeof (uint32_t);
+        }
     }
 
-    if (si->gp->io_access == DIRECT_ACCESS) {
+    if (buf == NULL) {
+        storage_unpin_page(si, page_num);
+    } else if (si->gp->io_access == DIRECT_ACCESS) {
         free(buf);
     } else {
         lwfree(buf);
@@ -281,9 +383,7 @@ RNode *get_rnode(const SpatialIndex *si, int page_num, int height) {
 
 /* write the node to file */
 void put_rnode(const SpatialIndex *si, const RNode *node, int page_num, int height) {
-    uint8_t *loc;
     uint8_t *buf;
-    int i;
 
     if (si->gp->io_access == DIRECT_ACCESS) {
         //then the memory must be aligned in blocks!
@@ -295,19 +395,8 @@ void put_rnode(const SpatialIndex *si, const RNode *node, int page_num, int heig
         buf = (uint8_t*) lwalloc(si->gp->page_size);
     }
 
-    loc = buf;
-
     /* now we have to serialize the node into the buf*/
-    memcpy(loc, &node->nofentries, sizeof (uint32_t));
-    loc += sizeof (uint32_t);
-
-    for (i = 0; i < node->nofentries; i++) {
-        memcpy(loc, &(node->entries[i]->pointer), sizeof (uint32_t));
-        loc += sizeof (uint32_t);
-
-        memcpy(loc, node->entries[i]->bbox, sizeof (BBox));
-        loc += sizeof (BBox);
-    }
+    rnode_serialize(node, buf);
 
     //we store the node
     storage_write_one_page(si, buf, page_num, height);
@@ -352,7 +441,7 @@ void del_rnode(const SpatialIndex *si, int page_num, int height) {
 
 void rnode_serialize(const RNode *node, uint8_t *buf) {
     uint8_t *loc;
-    int i;
+    int i, j;
     loc = buf;
     if (node == NULL) {
         int inv = -1;
@@ -360,8 +449,19 @@ void rnode_serialize(const RNode *node, uint8_t *buf) {
         memcpy(loc, &inv, sizeof (int32_t));
         loc += sizeof (int32_t);
     } else {
+        bool with_clips = rnode_has_clips(node);
+        bool with_counts = rnode_has_counts(node);
+        uint32_t header = (uint32_t) node->nofentries;
+        /* we only store the clip points if there is at least one entry with clip points 
+         * thus, nodes without clipping have the same format as before*/
+        if (with_clips)
+            header |= RNODE_CLIPPED_FLAG;
+        /* the same holds for the counts of aggregate R-trees */
+        if (with_counts)
+            header |= RNODE_AGGREGATE_FLAG;
+
         /* now we have to serialize the node into the buf*/
-        memcpy(loc, &(node->nofentries), sizeof (uint32_t));
+        memcpy(loc, &header, sizeof (uint32_t));
         loc += sizeof (uint32_t);
 
         for (i = 0; i < node->nofentries; i++) {
@@ -370,6 +470,22 @@ void rnode_serialize(const RNode *node, uint8_t *buf) {
 
             memcpy(loc, node->entries[i]->bbox, sizeof (BBox));
             loc += sizeof (BBox);
+
+            if (with_clips) {
+                memcpy(loc, &(node->entries[i]->nofclips), sizeof (uint8_t));
+                loc += sizeof (uint8_t);
+                for (j = 0; j < node->entries[i]->nofclips; j++) {
+                    memcpy(loc, &(node->entries[i]->clips[j].corner), sizeof (uint8_t));
+                    loc += sizeof (uint8_t);
+                    memcpy(loc, node->entries[i]->clips[j].point, sizeof (double) * NUM_OF_DIM);
+                    loc += sizeof (double) * NUM_OF_DIM;
+                }
+            }
+
+            if (with_counts) {
+                memcpy(loc, &(node->entries[i]->count), sizeof (uint32_t));
+                loc += sizeof (uint32_t);
+            }
         }
     }
 }
@@ -505,6 +621,146 @@ void rentry_create_bbox(const REntry **entries, int n, BBox *un) {
     }
 }
 
+/* comparison function used to sort the (mirrored) corners of the entries by the first dimension */
+static int clip_corner_asc_comp(const void *elem1, const void *elem2) {
+    const double *f = (const double*) elem1;
+    const double *s = (const double*) elem2;
+    if (f[0] > s[0]) return 1;
+    if (f[0] < s[0]) return -1;
+    return 0;
+}
+
+/* it computes the best clip point (i.e., the one that clips the largest area) of a corner of the bbox.
+ * the coordinates are mirrored according to the corner; thus, the corner is always handled as the lower-left corner.
+ * then, we follow the staircase formed by the corners of the entries that are the closest to the corner.
+ * it returns the clipped area (0 if there is no dead space in this corner) */
+static double rnode_best_clip_of_corner(const RNode *node, const BBox *bbox, uint8_t corner, ClipPoint *clip) {
+    double *pts;
+    double sign[NUM_OF_DIM];
+    double c[NUM_OF_DIM];
+    double miny, area;
+    double best = 0.0;
+    int i, d;
+
+    for (d = 0; d <= MAX_DIM; d++) {
+        sign[d] = (corner & (1 << d)) ? -1.0 : 1.0;
+        c[d] = (corner & (1 << d)) ? -bbox->max[d] : bbox->min[d];
+    }
+
+    pts = (double*) lwalloc(sizeof (double) * NUM_OF_DIM * node->nofentries);
+    for (i = 0; i < node->nofentries; i++) {
+        for (d = 0; d <= MAX_DIM; d++) {
+            pts[i * NUM_OF_DIM + d] = (corner & (1 << d)) ?
+                    -node->entries[i]->bbox->max[d] : node->entries[i]->bbox->min[d];
+        }
+    }
+    qsort(pts, node->nofentries, sizeof (double) * NUM_OF_DIM, clip_corner_asc_comp);
+
+    /* the rectangle formed by the corner and the point (x of the entry i, the lowest y of the previous entries)
+     * does not contain the interior of any entry */
+    miny = pts[1];
+    for (i = 1; i < node->nofentries; i++) {
+        area = (pts[i * NUM_OF_DIM] - c[0]) * (miny - c[1]);
+        if (area > best) {
+            best = area;
+            clip->corner = corner;
+            clip->point[0] = sign[0] * pts[i * NUM_OF_DIM];
+            clip->point[1] = sign[1] * miny;
+        }
+        miny = DB_MIN(miny, pts[i * NUM_OF_DIM + 1]);
+    }
+
+    lwfree(pts);
+    return best;
+}
+
+bool rentry_update_clips(REntry *entry, const RNode *node, uint8_t max_clips) {
+    ClipPoint candidates[MAX_CLIP_POINTS];
+    double areas[MAX_CLIP_POINTS];
+    ClipPoint chosen[MAX_CLIP_POINTS];
+    uint8_t n = 0;
+    uint8_t corner;
+    int i, best;
+    bool modified;
+
+    if (max_clips > 0 && node->nofentries > 1) {
+        for (corner = 0; corner < MAX_CLIP_POINTS; corner++) {
+            areas[corner] = rnode_best_clip_of_corner(node, entry->bbox, corner, &candidates[corner]);
+        }
+        /* we keep the clip points that clip the largest areas */
+        while (n < max_clips) {
+            best = -1;
+            for (i = 0; i < MAX_CLIP_POINTS; i++) {
+                if (!DB_IS_ZERO(areas[i]) && (best == -1 || areas[i] > areas[best]))
+                    best = i;
+            }
+            if (best == -1)
+                break;
+            chosen[n++] = candidates[best];
+            areas[best] = 0.0;
+        }
+    }
+
+    modified = (n != entry->nofclips);
+    for (i = 0; i < n && !modified; i++) {
+        modified = chosen[i].corner != entry->clips[i].corner ||
+                DB_IS_NOT_EQUAL(chosen[i].point[0], entry->clips[i].point[0]) ||
+                DB_IS_NOT_EQUAL(chosen[i].point[1], entry->clips[i].point[1]);
+    }
+
+    if (modified) {
+        if (entry->clips)
+            lwfree(entry->clips);
+        entry->clips = NULL;
+        if (n > 0) {
+            entry->clips = (ClipPoint*) lwalloc(sizeof (ClipPoint) * n);
+            memcpy(entry->clips, chosen, sizeof (ClipPoint) * n);
+        }
+        entry->nofclips = n;
+    }
+    return modified;
+}
+
+uint32_t rnode_count_objects(const RNode *node, int height) {
+    uint32_t count = 0;
+    int i;
+    if (height == 0)
+        return (uint32_t) node->nofentries;
+    for (i = 0; i < node->nofentries; i++) {
+        count += node->entries[i]->count;
+    }
+    return count;
+}
+
+bool rentry_update_count(REntry *entry, const RNode *node, int height) {
+    uint32_t count = rnode_count_objects(node, height);
+    if (entry->count == count)
+        return false;
+    entry->count = count;
+    return true;
+}
+
+bool rentry_is_clipped(const REntry *entry, const BBox *query) {
+    int i, d;
+    bool inside;
+
+    for (i = 0; i < entry->nofclips; i++) {
+        inside = true;
+        for (d = 0; d <= MAX_DIM && inside; d++) {
+            if (entry->clips[i].corner & (1 << d)) {
+                /* the dead space is between the clip point and the max of the bbox */
+                inside = DB_GT(DB_MAX(query->min[d], entry->bbox->min[d]), entry->clips[i].point[d]);
+            } else {
+                /* the dead space is between the min of the bbox and the clip point */
+                inside = DB_LT(DB_MIN(query->max[d], entry->bbox->max[d]), entry->clips[i].point[d]);
+            }
+        }
+        if (inside)
+            return true;
+    }
+    return false;
+}
+
 void rnode_print(const RNode *node, int node_id) {
     int i;
     char *print;
@@ -32,10 +32,34 @@
  * REntry is a entry of the R-tree and R*-tree
  */
 
+/* the maximum number of clip points of an entry (one per corner of its bbox) */
+#define MAX_CLIP_POINTS (1 << NUM_OF_DIM)
+
+/* flag stored together with the number of entries of a serialized node
+ * it indicates that the entries of this node are followed by their clip points */
+#define RNODE_CLIPPED_FLAG 0x40000000
+
+/* flag stored together with the number of entries of a serialized node
+ * it indicates that each entry of this node is followed by the number of objects of its subtree (aggregate R-trees) */
+#define RNODE_AGGREGATE_FLAG 0x20000000
+
+/* a clip point of a bbox, as defined in:
+ * SIDLAUSKAS, D.; CHESTER, S.; ZACHARATOU, E. T.; AILAMAKI, A. Improving spatial data processing 
+ * by clipping minimum bounding boxes. In ICDE 2018, p. 425-436.
+ * the rectangle formed by the corner of the bbox and the clip point does not contain any data,
+ * that is, it is dead space that can be pruned by queries */
+typedef struct {
+    uint8_t corner; //the bit d is 1 if the corner is formed by max[d], otherwise it is formed by min[d]
+    double point[NUM_OF_DIM]; //the coordinates of the clip point
+} ClipPoint;
+
 /*definition of an entry of a RNODE*/
 typedef struct {
     int pointer; //which can be to the object (leaf) or to the child node (internal)
     BBox *bbox; //the bbox of the element
+    uint8_t nofclips; //number of clip points of the bbox (only for entries of internal nodes)
+    ClipPoint *clips; //the clip points of the bbox, if any
+    uint32_t count; //number of objects in the subtree of the entry (only for entries of internal nodes of aggregate R-trees)
 } REntry;
 
 /*if the node is in the height equal to 0, then it is a leaf node*/
@@ -68,6 +92,9 @@ extern size_t rnode_size(const RNode *node);
 /* return the size of a rentry */
 extern size_t rentry_size(void);
 
+/* return the maximum size of a rentry that stores at most nofclips clip points */
+extern size_t rentry_size_with_clips(uint8_t nofclips);
+
 /* free a RNODE */
 extern void rnode_free(RNode *node);
 
@@ -107,6 +134,22 @@ extern double rentry_margin(const REntry **entries, int n);
 /*set the coordinates of a bbox by considering a set of entries (union of all these entries)*/
 extern void rentry_create_bbox(const REntry **entries, int n, BBox *un);
 
+/* (re)compute the clip points of an entry that points to the node (at most max_clips points are kept)
+ * it returns true if the clip points of the entry were modified */
+extern bool rentry_update_clips(REntry *entry, const RNode *node, uint8_t max_clips);
+
+/* return the number of objects stored in the subtree of a node with a given height
+ * (i.e., its number of entries if it is a leaf node, or the sum of the counts of its entries otherwise) */
+extern uint32_t rnode_count_objects(const RNode *node, int height);
+
+/* (re)compute the number of objects of an entry that points to the node with the given height
+ * it returns true if the count of the entry was modified */
+extern bool rentry_update_count(REntry *entry, const RNode *node, int height);
+
+/* check if the intersection between the query and the bbox of the entry is only formed by dead space
+ * (i.e., it is covered by some clip point of the entry) */
+extern bool rentry_is_clipped(const REntry *entry, const BBox *query);
+
 /*it shows in the standard output of the postgresql a RNODE - only for debug modes*/
 extern void rnode_print(const RNode *node, int node_id);
 
@@ -12,6 +12,10 @@
  *
  **********************************************************************/
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for O_DIRECT (parallel search) */
+#endif
+
 /* This file implements the R-tree index according to the original article from Guttman
  * Reference: GUTTMAN, A. R-trees: A dynamic index structure for spatial searching. SIGMOD Record,
 ACM, New York, NY, USA, v. 14, n. 2, p. 47–57, 1984. 
@@ -23,16 +27,115 @@ ACM, New York, NY, USA, v. 14, n. 2, p. 47–57, 1984.
 #include "../main/math_util.h" //to calculate aproximations with double values
 
 #include "../fast/fast_buffer.h" //for FAST indices
+#include "../fast/fast_flush_module.h"
+#include "../fast/fast_log_module.h"
 
 #include "../efind/efind_buffer_manager.h" //for eFIND indices
 #include "../efind/efind_read_buffer_policies.h"
+#include "../efind/efind_temporal_control.h"
+#include "../efind/efind_log_manager.h"
 
 #include "../main/header_handler.h" //for header storage
 
 #include "../main/storage_handler.h" //for the tree height update
+#include "../main/io_handler.h" //for DIRECT_ACCESS (bulk loading)
+#include <pthread.h> //for the parallel bulk loading and the parallel search
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "../main/statistical_processing.h" // in order to collect statistical data
 
+/* number of packed nodes that the bulk loading writes together (i.e., in a sequential write)
+ * for flash-aware indices, the flushing unit size is used instead */
+#define BULKLOAD_WRITE_PAGES 64
+/* number of leaf nodes that each thread of the parallel bulk loading packs at a time */
+#define BULKLOAD_THREAD_PAGES 256
+
+/* a contiguous range of leaf nodes packed by a thread of the parallel bulk loading
+ * the threads only touch memory allocated by malloc (i.e., they do not call palloc, ereport, or SPI) */
+typedef struct {
+    const BulkLoadEntry *entries; //the entries of the first node of the range
+    int n; //total number of entries of the leaf level
+    int cap; //the number of entries of each node
+    int min; //the minimum number of entries of a node
+    int first_node; //the first leaf node of the range
+    int nofnodes; //number of leaf nodes of the range
+    int page_size;
+    uint8_t *buf; //the serialized leaf nodes of the range (one page per node)
+    BBox *bboxes; //the bboxes of all the leaf nodes of the leaf level
+} LeafPackingTask;
+
+/*it serializes the leaf nodes of a task and computes their bboxes*/
+static void *pack_leaves_worker(void *arg);
+/*it packs the leaf level by using nofthreads threads, the leaf nodes are written in the pages 0..(nofleaves-1)
+ by sequential writes of write_unit pages. It returns the number of leaf nodes and their parent entries*/
+static int parallel_pack_leaves(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor,
+        int nofthreads, int write_unit, REntry ***parents);
+
+/* the parallel search hands at least this number of subtrees to each thread (if the tree has enough nodes) */
+#define PARALLEL_SEARCH_TASKS_PER_THREAD 8
+/* number of row identifiers of each chunk of the result of a thread of the parallel search */
+#define PARALLEL_SEARCH_CHUNK_SIZE 4096
+
+/* number of threads of the filter step of range queries (1 means the sequential search) */
+static int search_nofthreads = 1;
+
+/* a subtree to be traversed by a thread of the parallel search */
+typedef struct {
+    int page; //the page of its root node
+    int height; //the height of its root node
+    bool collect; //all the entries of the subtree are added without checking the predicate (see collect_subtree)
+} SearchTask;
+
+/* a piece of the result of a thread, the row identifiers of a chunk belong to only one task */
+typedef struct SearchChunk {
+    int row_id[PARALLEL_SEARCH_CHUNK_SIZE];
+    int n;
+    int task;
+    struct SearchChunk *next;
+} SearchChunk;
+
+/* a thread of the parallel search, which takes tasks until all of them are taken
+ * the threads only touch memory allocated by malloc (i.e., they do not call palloc, ereport, or SPI)
+ * and they read the nodes from the storage device by using pread (i.e., the buffer is not accessed) */
+typedef struct {
+    /* shared with the other threads (read only) */
+    const BBox *query;
+    const PolygonMask *mask;
+    uint8_t predicate;
+    int fd;
+    int page_size;
+    const SearchTask *tasks;
+    int noftasks;
+    atomic_int *next_task;
+    int *owner; //the thread that processed each task (each position is written by only one thread)
+    int id;
+    /* private */
+    uint8_t *buf; //the page being processed
+    SearchTask *stack; //the subtrees to be traversed
+    int stack_size;
+    int stack_max;
+    SearchChunk *first; //the result of this thread
+    SearchChunk *last;
+    int error; //errno of a failed read or allocation (0 means no error)
+    /* statistical data */
+    int visited_int_node_num;
+    int visited_leaf_node_num;
+    int processed_entries_num;
+    int read_num;
+    int *reads_per_height;
+} SearchWorker;
+
+/*it traverses the subtrees of the tasks taken by a thread of the parallel search*/
+static void *parallel_search_worker(void *arg);
+/*parallel version of recursive_search for conventional R-trees stored in HDDs or SSDs
+ the top levels are expanded by the caller thread until there are enough subtrees for the threads,
+ the result has the same order of the sequential search*/
+static SpatialIndexResult *parallel_search(RTree *rtree, const BBox *query, const PolygonMask *mask,
+        uint8_t predicate, SpatialIndexResult *result);
+
 /*we need this function in order to make this R-tree index "FASTable"
  that is, in order to be used as a FAST index*/
 static FASTSpecification *fast_spc;
@@ -49,12 +152,46 @@ void rtree_set_efindspecification(eFINDSpecification *fesp) {
     efind_spc = fesp;
 }
 
-/*recursive search for the r-tree, such that specified in the original R-tree paper.*/
+/*it checks whether the subtree of an entry of an internal node must be visited by a range query
+ m receives the classification of the entry against the polygon mask, if any*/
+static bool search_internal_entry(const REntry *entry, const BBox *query, const PolygonMask *mask, uint8_t predicate,
+        uint8_t *m);
+/*it checks whether an entry of a leaf node is a candidate of a range query*/
+static bool search_leaf_entry(const BBox *bbox, const BBox *query, const PolygonMask *mask, uint8_t predicate);
+/*recursive search for the r-tree, such that specified in the original R-tree paper.
+ mask is the polygon mask of the query object, if any (see polygon_mask.h)*/
 static SpatialIndexResult *recursive_search(RTree *rtree,
         const BBox *query,
+        const PolygonMask *mask,
+        uint8_t predicate,
+        int height,
+        SpatialIndexResult *result);
+/*it adds all the entries of the subtree rooted by the current node without checking any predicate
+ final indicates that the entries are added as final entries (i.e., they do not need the refinement step)*/
+static SpatialIndexResult *collect_subtree(RTree *rtree, int height, bool final, SpatialIndexResult *result);
+/*recursive search for point queries (point location)
+ point is the query point as a degenerated bbox and predicate is either INTERSECTS or EQUAL*/
+static SpatialIndexResult *recursive_search_pt(RTree *rtree,
+        const BBox *point,
         uint8_t predicate,
         int height,
         SpatialIndexResult *result);
+/*recursive search for distance range queries
+ within indicates that all the entries of the current node are within the distance of the query object*/
+static SpatialIndexResult *recursive_search_dw(RTree *rtree,
+        const DistanceQuery *dq,
+        bool within,
+        int height,
+        SpatialIndexResult *result);
+/*recursive count for distance range queries (aggregate R-trees)
+ the count of the subtrees that are within the distance is summed in nofobjects
+ and only the entries of the leaf nodes that cross the boundary of the query are returned as candidates*/
+static SpatialIndexResult *recursive_count_dw(RTree *rtree,
+        const DistanceQuery *dq,
+        bool within,
+        int height,
+        SpatialIndexResult *result,
+        uint64_t *nofobjects);
 
 /*this function choose the best node to add the new entry in a determined height
  it returns a copy of a RNode */
@@ -64,17 +201,67 @@ static RNode *adjust_tree(RTree *rtree, RNode *l, RNode *ll, int *split_address,
 /* functions to insert a new entry into rtree in a determined height. 
  * The input entry is freed in this function.*/
 static void insert_entry(RTree *rtree, REntry *input, int height);
+/* the sequential-insert fast path (see RLeafHint in rtree.h)
+ * it inserts input directly in the leaf node of the hint if the bbox of the hint covers input and the node has room
+ * it returns false without modifying the tree if the normal insertion algorithm must be used */
+static bool insert_entry_with_hint(RTree *rtree, REntry *input);
 /*function to condense the tree after a remotion*/
 static void condense_tree(RTree *rtree, RNode *l, RNodeStack *stack, RNodeStack *removed_nodes, bool reinsert);
+/*D4 of the deletion: the only child of the root node becomes the new root node*/
+static void shorten_tree(RTree *rtree);
+
+/* functions of the region deletion (see rtree_remove_region) */
+static RNode *read_rnode(RTree *rtree, int page, int height);
+static void rewrite_rnode(RTree *rtree, const RNode *node, int page, int height);
+static void delete_rnode_page(RTree *rtree, int page, int height);
+static void drop_subtree(RTree *rtree, int page, int height);
+static bool remove_region_node(RTree *rtree, RNode *node, int height, const BBox *window, RNodeStack *orphans);
+static void push_orphan(RTree *rtree, RNodeStack *removed_nodes, RNode *n, int level);
+
+bool search_internal_entry(const REntry *entry, const BBox *query, const PolygonMask *mask, uint8_t predicate,
+        uint8_t *m) {
+    uint8_t p = predicate;
+    /* there are two cases here:
+     1 - if the predicate is not inside
+         then, we must check if there is an intersection
+     2 - otherwise, the predicate is inside,
+         then, we must check if the query object is inside of the entry
+     This is evaluated since if the query object is inside of the entry, 
+     * then all the children of this entry will also be contained in the query
+     That is, it minimizes the selected paths */
+    if (p != INSIDE_OR_COVEREDBY)
+        p = INTERSECTS;
+
+    /* we also check if the query only reaches the dead space of the entry
+     * by using its clip points, if any (see rnode.h) */
+    if (!bbox_check_predicate(query, entry->bbox, p) || rentry_is_clipped(entry, query))
+        return false;
+
+    /* if the query object is a polygon, we check the entry against the polygon itself
+     * note that all the predicates employed in the filter step require an intersection */
+    *m = MASK_PARTIAL;
+    if (mask != NULL) {
+        *m = polygonmask_classify(mask, entry->bbox);
+        if (*m == MASK_DISJOINT)
+            return false;
+    }
+    return true;
+}
+
+bool search_leaf_entry(const BBox *bbox, const BBox *query, const PolygonMask *mask, uint8_t predicate) {
+    return bbox_check_predicate(query, bbox, predicate) &&
+            (mask == NULL || polygonmask_classify(mask, bbox) != MASK_DISJOINT);
+}
 
 SpatialIndexResult *recursive_search(RTree *rtree,
         const BBox *query,
+        const PolygonMask *mask,
         uint8_t predicate,
         int height,
         SpatialIndexResult *result) {
     RNode *node;
     int i;
-    uint8_t p;
+    uint8_t m;
 
     /* we copy the current node for backtracking purposes 
      that is, in order to follow several positive paths in the tree*/
@@ -88,23 +275,11 @@ whose root node is pointed to by Ep
      Note that we improve it by using the next comment.*/
     if (height != 0) {
         for (i = 0; i < rtree->current_node->nofentries; i++) {
-            p = predicate;
-            /* there are two cases here:
-             1 - if the predicate is not inside
-                 then, we must check if there is an intersection
-             2 - otherwise, the predicate is inside,
-                 then, we must check if the query object is inside of the entry
-             This is evaluated since if the query object is inside of the entry, 
-             * then all the children of this entry will also be contained in the query
-             That is, it minimizes the selected paths */
-            if (p != INSIDE_OR_COVEREDBY)
-                p = INTERSECTS;
-
 #ifdef COLLECT_STATISTICAL_DATA
             _processed_entries_num++;
 #endif
 
-            if (bbox_check_predicate(query, rtree->current_node->entries[i]->bbox, p)) {
+            if (search_internal_entry(rtree->current_node->entries[i], query, mask, predicate, &m)) {
                 //we get the node in which the entry points to
                 if (rtree->type == CONVENTIONAL_RTREE)
                     rtree->current_node = get_rnode(&rtree->base,
@@ -129,7 +304,12 @@ whose root node is pointed to by Ep
                 insert_reads_per_height(height - 1, 1);
 #endif
 
-                result = recursive_search(rtree, query, predicate, height - 1, result);
+                /* if the entry is entirely inside the query polygon, 
+                 * then all the entries of its subtree intersect the query object */
+                if (m == MASK_INSIDE && predicate == INTERSECTS)
+                    result = collect_subtree(rtree, height - 1, false, result);
+                else
+                    result = recursive_search(rtree, query, mask, predicate, height - 1, result);
 
                 /*after to traverse this child, we need to back 
                  * the reference of the current_node for the original one */
@@ -150,15 +330,300 @@ whether EI overlaps S. If so, E is a qualifying record
             /*  * We employ MBRs relationships, like defined in: 
              * CLEMENTINI, E.; SHARMA, J.; EGENHOFER, M. J. Modelling topological spatial relations:
  Strategies for query processing. Computers & Graphics, v. 18, n. 6, p. 815–822, 1994.*/
-            if (bbox_check_predicate(query, rtree->current_node->entries[i]->bbox, predicate)) {
+            if (search_leaf_entry(rtree->current_node->entries[i]->bbox, query, mask, predicate)) {
+                spatial_index_result_add(result, rtree->current_node->entries[i]->pointer);
+            }
+        }
+    }
+    rnode_free(node);
+    return result;
+}
+
+SpatialIndexResult *collect_subtree(RTree *rtree, int height, bool final, SpatialIndexResult *result) {
+    RNode *node;
+    int i;
+
+    if (height != 0) {
+        node = rnode_clone(rtree->current_node);
+        for (i = 0; i < node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            if (rtree->type == CONVENTIONAL_RTREE)
+                rtree->current_node = get_rnode(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == FAST_RTREE_TYPE)
+                rtree->current_node = (RNode *) fb_retrieve_node(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == eFIND_RTREE_TYPE)
+                rtree->current_node = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                    node->entries[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
+            }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            result = collect_subtree(rtree, height - 1, final, result);
+
+            rnode_copy(rtree->current_node, node);
+        }
+        rnode_free(node);
+    } else {
+        for (i = 0; i < rtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            if (final)
+                spatial_index_result_add_final(result, rtree->current_node->entries[i]->pointer);
+            else
+                spatial_index_result_add(result, rtree->current_node->entries[i]->pointer);
+        }
+    }
+    return result;
+}
+
+SpatialIndexResult *recursive_search_pt(RTree *rtree,
+        const BBox *point,
+        uint8_t predicate,
+        int height,
+        SpatialIndexResult *result) {
+    RNode *node;
+    int *order;
+    double *areas;
+    double area;
+    int i, j, n;
+
+    if (height != 0) {
+        node = rnode_clone(rtree->current_node);
+        order = (int*) lwalloc(sizeof (int) * node->nofentries);
+        areas = (double*) lwalloc(sizeof (double) * node->nofentries);
+
+        /* only the entries containing the point are visited
+         * and they are ordered by their areas, that is, the smallest one is visited first */
+        n = 0;
+        for (i = 0; i < node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            if (!bbox_contains_point(node->entries[i]->bbox, point->min) ||
+                    rentry_is_clipped(node->entries[i], point))
+                continue;
+
+            area = bbox_area(node->entries[i]->bbox);
+            for (j = n; j > 0 && areas[j - 1] > area; j--) {
+                areas[j] = areas[j - 1];
+                order[j] = order[j - 1];
+            }
+            areas[j] = area;
+            order[j] = i;
+            n++;
+        }
+
+        for (j = 0; j < n; j++) {
+            i = order[j];
+            if (rtree->type == CONVENTIONAL_RTREE)
+                rtree->current_node = get_rnode(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == FAST_RTREE_TYPE)
+                rtree->current_node = (RNode *) fb_retrieve_node(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == eFIND_RTREE_TYPE)
+                rtree->current_node = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                    node->entries[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
+            }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            /* if the entry is degenerated to the point, then all the objects of its subtree 
+             * are located at the point and we do not need to check them anymore */
+            if (bbox_is_point(node->entries[i]->bbox, point->min))
+                result = collect_subtree(rtree, height - 1, true, result);
+            else
+                result = recursive_search_pt(rtree, point, predicate, height - 1, result);
+
+            rnode_copy(rtree->current_node, node);
+        }
+
+        lwfree(order);
+        lwfree(areas);
+        rnode_free(node);
+    } else {
+        for (i = 0; i < rtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            if (!bbox_contains_point(rtree->current_node->entries[i]->bbox, point->min))
+                continue;
+
+            /* an object whose bbox is degenerated to the point is equal to the point
+             * otherwise, it can only intersect the point */
+            if (bbox_is_point(rtree->current_node->entries[i]->bbox, point->min))
+                spatial_index_result_add_final(result, rtree->current_node->entries[i]->pointer);
+            else if (predicate == INTERSECTS)
                 spatial_index_result_add(result, rtree->current_node->entries[i]->pointer);
+        }
+    }
+    return result;
+}
+
+SpatialIndexResult *recursive_search_dw(RTree *rtree,
+        const DistanceQuery *dq,
+        bool within,
+        int height,
+        SpatialIndexResult *result) {
+    RNode *node;
+    int i;
+    uint8_t c;
+
+    node = rnode_clone(rtree->current_node);
+
+    if (height != 0) {
+        for (i = 0; i < rtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within) {
+                /* MINDIST-based pruning, the dead space of the entry is also considered */
+                c = distancequery_classify(dq, rtree->current_node->entries[i]->bbox, false);
+                if (c == DQ_DISJOINT || rentry_is_clipped(rtree->current_node->entries[i], &dq->window))
+                    continue;
+            }
+
+            if (rtree->type == CONVENTIONAL_RTREE)
+                rtree->current_node = get_rnode(&rtree->base,
+                    rtree->current_node->entries[i]->pointer, height - 1);
+            else if (rtree->type == FAST_RTREE_TYPE)
+                rtree->current_node = (RNode *) fb_retrieve_node(&rtree->base,
+                    rtree->current_node->entries[i]->pointer, height - 1);
+            else if (rtree->type == eFIND_RTREE_TYPE)
+                rtree->current_node = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                    rtree->current_node->entries[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
             }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            /* if the MAXDIST of the entry is within the distance, then its subtree is accepted */
+            result = recursive_search_dw(rtree, dq, c == DQ_WITHIN, height - 1, result);
+
+            rnode_copy(rtree->current_node, node);
+        }
+    } else {
+        for (i = 0; i < rtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within)
+                c = distancequery_classify(dq, rtree->current_node->entries[i]->bbox, true);
+
+            if (c == DQ_WITHIN)
+                spatial_index_result_add_final(result, rtree->current_node->entries[i]->pointer);
+            else if (c == DQ_PARTIAL)
+                spatial_index_result_add(result, rtree->current_node->entries[i]->pointer);
         }
     }
     rnode_free(node);
     return result;
 }
 
+SpatialIndexResult *recursive_count_dw(RTree *rtree,
+        const DistanceQuery *dq,
+        bool within,
+        int height,
+        SpatialIndexResult *result,
+        uint64_t *nofobjects) {
+    RNode *node;
+    int i;
+    uint8_t c;
+
+    if (height != 0) {
+        node = rnode_clone(rtree->current_node);
+        for (i = 0; i < node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within) {
+                c = distancequery_classify(dq, node->entries[i]->bbox, false);
+                if (c == DQ_DISJOINT || rentry_is_clipped(node->entries[i], &dq->window))
+                    continue;
+            }
+
+            /* the subtree is covered by the query and its count is stored in the entry,
+             * therefore we do not need to visit it */
+            if (c == DQ_WITHIN && node->entries[i]->count > 0) {
+                *nofobjects += node->entries[i]->count;
+                continue;
+            }
+
+            if (rtree->type == CONVENTIONAL_RTREE)
+                rtree->current_node = get_rnode(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == FAST_RTREE_TYPE)
+                rtree->current_node = (RNode *) fb_retrieve_node(&rtree->base,
+                    node->entries[i]->pointer, height - 1);
+            else if (rtree->type == eFIND_RTREE_TYPE)
+                rtree->current_node = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                    node->entries[i]->pointer, height - 1);
+            else //it should not happen
+                _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height - 1 != 0) {
+                _visited_int_node_num++;
+            } else {
+                _visited_leaf_node_num++;
+            }
+            insert_reads_per_height(height - 1, 1);
+#endif
+
+            result = recursive_count_dw(rtree, dq, c == DQ_WITHIN, height - 1, result, nofobjects);
+
+            rnode_copy(rtree->current_node, node);
+        }
+        rnode_free(node);
+    } else {
+        for (i = 0; i < rtree->current_node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+            _processed_entries_num++;
+#endif
+            c = DQ_WITHIN;
+            if (!within)
+                c = distancequery_classify(dq, rtree->current_node->entries[i]->bbox, true);
+
+            if (c == DQ_WITHIN)
+                (*nofobjects)++;
+            else if (c == DQ_PARTIAL)
+                spatial_index_result_add(result, rtree->current_node->entries[i]->pointer);
+        }
+    }
+    return result;
+}
+
 RNode *choose_node(RTree *rtree, REntry *input, int h, RNodeStack *stack, int *chosen_address) {
     RNode *n = NULL;
 
@@ -282,16 +747,28 @@ all entry rectangles in N.*/
         /*in negative case, we maybe change only the BBOX of the parent*/
         /*in positive case, we change the BBOX of the parent and add the new entry*/
         if (nn->nofentries == 0) {
-            //we check if it is necessary to modify the BBOX of this parent
-            if (!bbox_check_predicate(n_bbox, rtree->current_node->entries[entry]->bbox, EQUAL)) {
-                memcpy(rtree->current_node->entries[entry]->bbox, n_bbox, sizeof (BBox));
+            bool modified_bbox = !bbox_check_predicate(n_bbox, rtree->current_node->entries[entry]->bbox, EQUAL);
+            bool modified_count = false;
+            /* in aggregate R-trees, the number of objects of the subtree changes in every insertion */
+            if (rtree->spec->aggregate)
+                modified_count = rentry_update_count(rtree->current_node->entries[entry], n, h);
+
+            //we check if it is necessary to modify the BBOX (or the count) of this parent
+            if (modified_bbox || modified_count) {
+                if (modified_bbox)
+                    memcpy(rtree->current_node->entries[entry]->bbox, n_bbox, sizeof (BBox));
+                rentry_update_clips(rtree->current_node->entries[entry], n, rtree->spec->nof_clip_points);
 
                 //    _DEBUGF(NOTICE, "adjusted the entry %d", entry);
 
                 if (rtree->type == CONVENTIONAL_RTREE) {
                     put_rnode(&rtree->base, rtree->current_node, parent_add, h + 1);
                 } else if (rtree->type == FAST_RTREE_TYPE) {
-                    fb_put_mod_bbox(&rtree->base, fast_spc, parent_add, bbox_clone(n_bbox), entry, h + 1);
+                    if (modified_bbox)
+                        fb_put_mod_bbox(&rtree->base, fast_spc, parent_add, bbox_clone(n_bbox), entry, h + 1);
+                    if (modified_count)
+                        fb_put_mod_count(&rtree->base, fast_spc, parent_add,
+                            rtree->current_node->entries[entry]->count, entry, h + 1);
                 } else if (rtree->type == eFIND_RTREE_TYPE) {
                     efind_buf_mod_node(&rtree->base, efind_spc, parent_add,
                             (void*) rentry_clone(rtree->current_node->entries[entry]), h + 1);
@@ -310,6 +787,15 @@ all entry rectangles in N.*/
                 n = rtree->current_node;
                 rtree->current_node = NULL;
             } else {
+                /* the bbox is the same, but the dead space of n may have changed
+                 * since clip points are only maintained by conventional R-trees, we only write the parent*/
+                if (rentry_update_clips(rtree->current_node->entries[entry], n, rtree->spec->nof_clip_points)) {
+                    put_rnode(&rtree->base, rtree->current_node, parent_add, h + 1);
+#ifdef COLLECT_STATISTICAL_DATA
+                    _written_int_node_num++;
+                    insert_writes_per_height(h + 1, 1);
+#endif
+                }
                 adjusting = false;
             }
 
@@ -324,11 +810,18 @@ all entry rectangles in N.*/
 
             //we update the bbox of the parent since it changed because of split
             memcpy(rtree->current_node->entries[entry]->bbox, n_bbox, sizeof (BBox));
+            rentry_update_clips(rtree->current_node->entries[entry], n, rtree->spec->nof_clip_points);
             //we compute the bbox of the split node
             bbox_split = rnode_compute_bbox(nn);
 
             //we add the entry here without checking
             rnode_add_rentry(rtree->current_node, rentry_create(*split_address, bbox_split));
+            rentry_update_clips(rtree->current_node->entries[rtree->current_node->nofentries - 1],
+                    nn, rtree->spec->nof_clip_points);
+            if (rtree->spec->aggregate) {
+                rentry_update_count(rtree->current_node->entries[entry], n, h);
+                rentry_update_count(rtree->current_node->entries[rtree->current_node->nofentries - 1], nn, h);
+            }
 
             /*AT5 [Move up to next level.] Set N=P and
 set NN=PP If a split occurred, Repeat from AT2.*/
@@ -345,13 +838,20 @@ set NN=PP If a split occurred, Repeat from AT2.*/
                     //we put the new pointer and new bbox for the split node
                     fb_put_mod_pointer(&rtree->base, fast_spc, parent_add, *split_address, rtree->current_node->nofentries - 1, h + 1);
                     fb_put_mod_bbox(&rtree->base, fast_spc, parent_add, bbox_clone(bbox_split), rtree->current_node->nofentries - 1, h + 1);
+                    if (rtree->spec->aggregate) {
+                        fb_put_mod_count(&rtree->base, fast_spc, parent_add,
+                                rtree->current_node->entries[entry]->count, entry, h + 1);
+                        fb_put_mod_count(&rtree->base, fast_spc, parent_add,
+                                rtree->current_node->entries[rtree->current_node->nofentries - 1]->count,
+                                rtree->current_node->nofentries - 1, h + 1);
+                    }
                 } else if (rtree->type == eFIND_RTREE_TYPE) {
                     //we put the modification of the bbox
                     efind_buf_mod_node(&rtree->base, efind_spc, parent_add,
                             (void *) rentry_clone(rtree->current_node->entries[entry]), h + 1);
                     //we put the new entry which points to the split node
                     efind_buf_mod_node(&rtree->base, efind_spc, parent_add,
-                            (void *) rentry_create(*split_address, bbox_clone(bbox_split)), h + 1);
+                            (void *) rentry_clone(rtree->current_node->entries[rtree->current_node->nofentries - 1]), h + 1);
                 } else {
                     _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
                 }
@@ -520,6 +1020,9 @@ old entrees of L
         } else if (rtree->type == FAST_RTREE_TYPE) {
             fb_put_mod_pointer(&rtree->base, fast_spc, chosen_address, input->pointer, chosen_node->nofentries - 1, height);
             fb_put_mod_bbox(&rtree->base, fast_spc, chosen_address, bbox_clone(input->bbox), chosen_node->nofentries - 1, height);
+            //entries that are reinserted in internal nodes of aggregate R-trees carry the count of their subtrees
+            if (input->count > 0)
+                fb_put_mod_count(&rtree->base, fast_spc, chosen_address, input->count, chosen_node->nofentries - 1, height);
         } else if (rtree->type == eFIND_RTREE_TYPE) {
             efind_buf_mod_node(&rtree->base, efind_spc, chosen_address,
                     (void *) rentry_clone(input), height);
@@ -652,6 +1155,12 @@ create a new root whose children are the two resulting nodes */
 
         entry1 = rentry_create(rtree->info->root_page, rnode_compute_bbox(rtree->current_node));
         entry2 = rentry_create(split_address, rnode_compute_bbox(new));
+        rentry_update_clips(entry1, rtree->current_node, rtree->spec->nof_clip_points);
+        rentry_update_clips(entry2, new, rtree->spec->nof_clip_points);
+        if (rtree->spec->aggregate) {
+            rentry_update_count(entry1, rtree->current_node, rtree->info->height - 1);
+            rentry_update_count(entry2, new, rtree->info->height - 1);
+        }
 
         //we add the new two entries into the new root node
         rnode_add_rentry(new_root, entry1);
@@ -695,12 +1204,79 @@ create a new root whose children are the two resulting nodes */
         rtree->current_node = new_root;
         rnode_free(new);
     }
+    /* the leaf node is the hint of the next insertion if it was not split and it is not the root node
+     * (its parent entry now has the bbox of the leaf node, see adjust_tree) */
+    if (height == 0 && split_address == -1 && rtree->info->height > 0) {
+        BBox *leaf_bbox = rnode_compute_bbox(chosen_node);
+        rtree->hint.page = chosen_address;
+        memcpy(&(rtree->hint.bbox), leaf_bbox, sizeof (BBox));
+        lwfree(leaf_bbox);
+    } else {
+        rtree->hint.page = -1;
+    }
+
     rnode_free(chosen_node);
     rnode_free(l); //note: it was allocated
     rnode_free(ll); //note: it was allocated
     rnode_stack_destroy(stack);
 }
 
+bool rtree_insert_with_leaf_hint(SpatialIndex *base, uint8_t type, const RLeafHint *hint,
+        int max_entries_leaf_node, REntry *input) {
+    RNode *leaf = NULL;
+
+    if (hint->page < 0 || !bbox_check_predicate(input->bbox, &(hint->bbox), INSIDE_OR_COVEREDBY))
+        return false;
+
+    //the leaf node is read through the buffers, thus, it has the pending modifications of FAST and eFIND
+    if (type == CONVENTIONAL_RTREE || type == CONVENTIONAL_RSTARTREE)
+        leaf = get_rnode(base, hint->page, 0);
+    else if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE)
+        leaf = (RNode *) fb_retrieve_node(base, hint->page, 0);
+    else if (type == eFIND_RTREE_TYPE || type == eFIND_RSTARTREE_TYPE)
+        leaf = (RNode *) efind_buf_retrieve_node(base, efind_spc, hint->page, 0);
+    else
+        _DEBUGF(ERROR, "Invalid R-tree specification %d", type);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _visited_leaf_node_num++;
+    insert_reads_per_height(0, 1);
+#endif
+
+    //it would be split (or need the overflow treatment of the R*-tree), then we employ the normal insertion
+    if (leaf->nofentries >= max_entries_leaf_node) {
+        rnode_free(leaf);
+        return false;
+    }
+
+    rnode_add_rentry(leaf, input);
+    if (type == CONVENTIONAL_RTREE || type == CONVENTIONAL_RSTARTREE) {
+        put_rnode(base, leaf, hint->page, 0);
+    } else if (type == FAST_RTREE_TYPE || type == FAST_RSTARTREE_TYPE) {
+        fb_put_mod_pointer(base, fast_spc, hint->page, input->pointer, leaf->nofentries - 1, 0);
+        fb_put_mod_bbox(base, fast_spc, hint->page, bbox_clone(input->bbox), leaf->nofentries - 1, 0);
+    } else {
+        efind_buf_mod_node(base, efind_spc, hint->page, (void *) rentry_clone(input), 0);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _written_leaf_node_num++;
+    insert_writes_per_height(0, 1);
+    _leaf_hint_num++;
+#endif
+
+    rnode_free(leaf);
+    return true;
+}
+
+bool insert_entry_with_hint(RTree *rtree, REntry *input) {
+    /* in aggregate R-trees and R-trees with clip points, the parent entry depends on the content of the leaf node */
+    if (!rtree->spec->leaf_hint || rtree->spec->aggregate || rtree->spec->nof_clip_points > 0)
+        return false;
+    return rtree_insert_with_leaf_hint(&rtree->base, rtree->type, &(rtree->hint),
+            rtree->spec->max_entries_leaf_node, input);
+}
+
 /*we have to reinsert the removed nodes? if true, then we have to add it
 otherwise, we don't reinsert and the caller is responsible to do it*/
 void condense_tree(RTree *rtree, RNode *l, RNodeStack *stack, RNodeStack *removed_nodes, bool reinsert) {
@@ -713,6 +1289,7 @@ void condense_tree(RTree *rtree, RNode *l, RNodeStack *stack, RNodeStack *remove
 
     bool adjusting = true;
     bool removed = true;
+    bool modified_bbox, modified_count;
 
     /*CT1 [Initialize ] Set N=L Set Q, the set of eliminated nodes, to be empty*/
     n = rnode_clone(l);
@@ -801,14 +1378,27 @@ P and add N to set Q.*/
 
             removed = false;
 
+            modified_bbox = !bbox_check_predicate(bbox, rtree->current_node->entries[parent_entry]->bbox, EQUAL);
+            modified_count = false;
+            /* in aggregate R-trees, the number of objects of the subtree changes in every deletion */
+            if (rtree->spec->aggregate)
+                modified_count = rentry_update_count(rtree->current_node->entries[parent_entry], n, cur_height);
+
             //check if we need to adjust the parent entry
-            if (!bbox_check_predicate(bbox, rtree->current_node->entries[parent_entry]->bbox, EQUAL)) {
-                memcpy(rtree->current_node->entries[parent_entry]->bbox, bbox, sizeof (BBox));
+            if (modified_bbox || modified_count) {
+                if (modified_bbox)
+                    memcpy(rtree->current_node->entries[parent_entry]->bbox, bbox, sizeof (BBox));
+                /* the clip points of n were computed for the previous bbox */
+                rentry_update_clips(rtree->current_node->entries[parent_entry], n, rtree->spec->nof_clip_points);
 
                 if (rtree->type == CONVENTIONAL_RTREE) {
                     put_rnode(&rtree->base, rtree->current_node, parent_add, cur_height + 1);
                 } else if (rtree->type == FAST_RTREE_TYPE) {
-                    fb_put_mod_bbox(&rtree->base, fast_spc, parent_add, bbox_clone(bbox), parent_entry, cur_height + 1);
+                    if (modified_bbox)
+                        fb_put_mod_bbox(&rtree->base, fast_spc, parent_add, bbox_clone(bbox), parent_entry, cur_height + 1);
+                    if (modified_count)
+                        fb_put_mod_count(&rtree->base, fast_spc, parent_add,
+                            rtree->current_node->entries[parent_entry]->count, parent_entry, cur_height + 1);
                 } else if (rtree->type == eFIND_RTREE_TYPE) {
                     efind_buf_mod_node(&rtree->base, efind_spc, parent_add,
                             (void *) rentry_clone(rtree->current_node->entries[parent_entry]), cur_height + 1);
@@ -870,72 +1460,1159 @@ will be on the same level as leaves of the main tree*/
     }
 }
 
-/*default searching algorithm of the R-tree (defined in rtree.h)*/
-SpatialIndexResult *rtree_search(RTree *rtree, const BBox *search, uint8_t predicate) {
-    SpatialIndexResult *sir = spatial_index_result_create();
-    /* current node here MUST be equal to the root node */
-    if (rtree->current_node != NULL) {
-        sir = recursive_search(rtree, search, predicate, rtree->info->height, sir);
+void shorten_tree(RTree *rtree) {
+    int p = rtree->current_node->entries[0]->pointer;
+    RNode *new_root = NULL;
+
+    //_DEBUG(NOTICE, "We have to cut the tree");
+
+    if (rtree->type == CONVENTIONAL_RTREE) {
+        del_rnode(&rtree->base, rtree->info->root_page, rtree->info->height);
+    } else if (rtree->type == FAST_RTREE_TYPE) {
+        fb_del_node(&rtree->base, fast_spc, rtree->info->root_page, rtree->info->height);
+    } else if (rtree->type == eFIND_RTREE_TYPE) {
+        //we update the height of the tree
+        if (efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
+            efind_readbuffer_hlru_set_tree_height(rtree->info->height - 1);
+        efind_buf_del_node(&rtree->base, efind_spc,
+                rtree->info->root_page, rtree->info->height);
+    } else {
+        _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
     }
-    return sir;
-}
+    storage_update_tree_height(&rtree->base, rtree->info->height - 1);
+    rnode_free(rtree->current_node);
 
-/*default algorithm to remove an entry in a R-tree (defined in rtree.h)*/
-bool rtree_remove_with_removed_nodes(RTree *rtree, const REntry *to_remove, RNodeStack *removed_nodes, bool reinsert) {
+    //we add the removed page as an empty page now
+    rtreesinfo_add_empty_page(rtree->info, rtree->info->root_page);
 
-    /*D1 [Find node containing record ] Invoke FindLeaf to locate the leaf
-node L containing E Stop if the record was not found.*/
+#ifdef COLLECT_STATISTICAL_DATA
+    _deleted_int_node_num++;
+    insert_writes_per_height(rtree->info->height, 1);
+#endif
 
-    /*the FindLeaf is inlined here in order to do this in an iterative way */
+    rtree->info->root_page = p;
 
-    RNodeStack *stack;
-    int i, entry;
-    int parent_add;
-    int found_index;
-    bool inside;
-    RNode *n = NULL;
-    RNode *found_node = NULL;
-    int h;
+    if (rtree->type == CONVENTIONAL_RTREE)
+        new_root = get_rnode(&rtree->base, p, rtree->info->height - 1);
+    else if (rtree->type == FAST_RTREE_TYPE)
+        new_root = (RNode *) fb_retrieve_node(&rtree->base, p, rtree->info->height - 1);
+    else if (rtree->type == eFIND_RTREE_TYPE) {
+        new_root = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                p, rtree->info->height - 1);
+    }
 
-    found_index = -1;
-    inside = false;
-    stack = rnode_stack_init();
-    h = rtree->info->height;
+#ifdef COLLECT_STATISTICAL_DATA
+    if (rtree->info->height > 1) {
+        //we visited one internal node, then we add it
+        _visited_int_node_num++;
+    } else {
+        //we visited one leaf node
+        _visited_leaf_node_num++;
+    }
+    insert_reads_per_height(rtree->info->height - 1, 1);
+#endif
 
-    rnode_stack_push(stack, rnode_clone(rtree->current_node), rtree->info->root_page, -1);
+    rtree->current_node = new_root;
+    rtree->info->height--;
 
-    //_DEBUG(NOTICE, "Searching subtrees");
+    //_DEBUG(NOTICE, "done");
+}
+
+RNode *read_rnode(RTree *rtree, int page, int height) {
+    RNode *node = NULL;
+
+    if (rtree->type == CONVENTIONAL_RTREE)
+        node = get_rnode(&rtree->base, page, height);
+    else if (rtree->type == FAST_RTREE_TYPE)
+        node = (RNode *) fb_retrieve_node(&rtree->base, page, height);
+    else if (rtree->type == eFIND_RTREE_TYPE)
+        node = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc, page, height);
+    else
+        _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
 
-    /*FL1. [Search subtrees ] If T is not a leaf, check each entry F in T 
-     * to determine if FI overlaps EI For each such entry invoke FindLeaf on the
-tree whose root is pointed to by Fp until E is found or all entries have
-been checked*/
-    while (found_index == -1 && stack->size > 0) {
-        n = rnode_stack_peek(stack, &parent_add, &entry);
-        entry += 1;
-        inside = false;
-        //it is an internal node
-        if (h != 0) {
-            for (i = entry; i < n->nofentries; i++) {
 #ifdef COLLECT_STATISTICAL_DATA
-                _processed_entries_num++;
+    if (height != 0) {
+        //we visited one internal node, then we add it
+        _visited_int_node_num++;
+    } else {
+        //we visited one leaf node
+        _visited_leaf_node_num++;
+    }
+    insert_reads_per_height(height, 1);
 #endif
-                //check if it is a good entry
-                if (bbox_check_predicate(to_remove->bbox, n->entries[i]->bbox, INSIDE_OR_COVEREDBY)) {
-                    //if yes, we need to update the chosen entry
-                    stack->top->entry_of_parent = i;
 
-                    //next, we read the node whose this entry points to
-                    parent_add = n->entries[i]->pointer;
+    return node;
+}
 
-                    if (rtree->type == CONVENTIONAL_RTREE)
-                        n = get_rnode(&rtree->base, n->entries[i]->pointer, h - 1);
-                    else if (rtree->type == FAST_RTREE_TYPE)
-                        n = (RNode *) fb_retrieve_node(&rtree->base, n->entries[i]->pointer, h - 1);
-                    else if (rtree->type == eFIND_RTREE_TYPE)
-                        n = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
-                            n->entries[i]->pointer, h - 1);
-                    else
+/* several entries of the node may have been removed, thus we write the whole node
+ * (FAST and eFIND remove the old version and create the node again, as in the split of adjust_tree) */
+void rewrite_rnode(RTree *rtree, const RNode *node, int page, int height) {
+    int i;
+
+    if (rtree->type == CONVENTIONAL_RTREE) {
+        put_rnode(&rtree->base, node, page, height);
+    } else if (rtree->type == FAST_RTREE_TYPE) {
+        fb_del_node(&rtree->base, fast_spc, page, height);
+        fb_put_new_node(&rtree->base, fast_spc, page, (void *) rnode_clone(node), height);
+    } else if (rtree->type == eFIND_RTREE_TYPE) {
+        efind_buf_del_node(&rtree->base, efind_spc, page, height);
+        efind_buf_create_node(&rtree->base, efind_spc, page, height);
+        for (i = 0; i < node->nofentries; i++) {
+            efind_buf_mod_node(&rtree->base, efind_spc, page,
+                    (void *) rentry_clone(node->entries[i]), height);
+        }
+    } else {
+        _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (height != 0)
+        _written_int_node_num++;
+    else
+        _written_leaf_node_num++;
+    insert_writes_per_height(height, 1);
+#endif
+}
+
+void delete_rnode_page(RTree *rtree, int page, int height) {
+    if (rtree->type == CONVENTIONAL_RTREE) {
+        del_rnode(&rtree->base, page, height);
+    } else if (rtree->type == FAST_RTREE_TYPE) {
+        fb_del_node(&rtree->base, fast_spc, page, height);
+    } else if (rtree->type == eFIND_RTREE_TYPE) {
+        efind_buf_del_node(&rtree->base, efind_spc, page, height);
+    } else {
+        _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+    }
+
+    //we add the removed page as an empty page now
+    rtreesinfo_add_empty_page(rtree->info, page);
+
+#ifdef COLLECT_STATISTICAL_DATA
+    if (height != 0) {
+        //we removed an internal node, then we add it
+        _deleted_int_node_num++;
+    } else {
+        //we removed a leaf node
+        _deleted_leaf_node_num++;
+    }
+    insert_writes_per_height(height, 1);
+#endif
+}
+
+/* it removes the subtree whose root node is stored in page
+ * only the internal nodes are read since they store the pages of their children (the leaf nodes are not read) */
+void drop_subtree(RTree *rtree, int page, int height) {
+    RNode *node;
+    int i;
+
+    if (height > 0) {
+        node = read_rnode(rtree, page, height);
+        for (i = 0; i < node->nofentries; i++) {
+            drop_subtree(rtree, node->entries[i]->pointer, height - 1);
+        }
+        rnode_free(node);
+    }
+    delete_rnode_page(rtree, page, height);
+}
+
+/* it removes from the subtree of node (which is in main memory) the objects inside the window
+ * the entries inside the window are removed without visiting their subtrees
+ * the children intersecting the window are processed recursively and written here,
+ * except for the under-full ones, which are eliminated and stored in orphans
+ * it returns true if node was modified, then the caller is responsible to write it */
+bool remove_region_node(RTree *rtree, RNode *node, int height, const BBox *window, RNodeStack *orphans) {
+    RNode *child;
+    REntry *entry;
+    BBox *bbox;
+    int i, page, min;
+    bool modified = false;
+
+    //the backward traversal keeps the positions of the entries not processed yet
+    for (i = node->nofentries - 1; i >= 0; i--) {
+        entry = node->entries[i];
+
+#ifdef COLLECT_STATISTICAL_DATA
+        _processed_entries_num++;
+#endif
+
+        if (bbox_check_predicate(entry->bbox, window, INSIDE_OR_COVEREDBY)) {
+            //the whole subtree (or object) is removed
+            if (height > 0)
+                drop_subtree(rtree, entry->pointer, height - 1);
+            rnode_remove_rentry(node, i);
+            modified = true;
+        } else if (height > 0 && bbox_check_predicate(window, entry->bbox, INTERSECTS) &&
+                !rentry_is_clipped(entry, window)) {
+            //a boundary node
+            page = entry->pointer;
+            child = read_rnode(rtree, page, height - 1);
+            if (remove_region_node(rtree, child, height - 1, window, orphans)) {
+                if (height - 1 == 0)
+                    min = rtree->spec->min_entries_leaf_node;
+                else
+                    min = rtree->spec->min_entries_int_node;
+
+                if (child->nofentries < min) {
+                    /* [Eliminate under-full node.] its remaining entries are reinserted later */
+                    delete_rnode_page(rtree, page, height - 1);
+                    rnode_remove_rentry(node, i);
+                    if (child->nofentries > 0) {
+                        rnode_stack_push(orphans, child, height - 1, -1);
+                        child = NULL;
+                    }
+                } else {
+                    /* [Adjust covering rectangle.] */
+                    rewrite_rnode(rtree, child, page, height - 1);
+                    bbox = rnode_compute_bbox(child);
+                    memcpy(entry->bbox, bbox, sizeof (BBox));
+                    lwfree(bbox);
+                    rentry_update_clips(entry, child, rtree->spec->nof_clip_points);
+                    if (rtree->spec->aggregate)
+                        rentry_update_count(entry, child, height - 1);
+                }
+                modified = true;
+            }
+            if (child != NULL)
+                rnode_free(child);
+        }
+    }
+    return modified;
+}
+
+/* it stores an eliminated node whose entries will be reinserted at level
+ * if the tree is no longer high enough, the node is replaced by its children */
+void push_orphan(RTree *rtree, RNodeStack *removed_nodes, RNode *n, int level) {
+    RNode *child;
+    int i;
+
+    if (level > 0 && level >= rtree->info->height) {
+        for (i = 0; i < n->nofentries; i++) {
+            child = read_rnode(rtree, n->entries[i]->pointer, level - 1);
+            delete_rnode_page(rtree, n->entries[i]->pointer, level - 1);
+            push_orphan(rtree, removed_nodes, child, level - 1);
+        }
+        rnode_free(n);
+    } else {
+        rnode_stack_push(removed_nodes, n, level, -1);
+    }
+}
+
+/*region deletion (defined in rtree.h)*/
+bool rtree_remove_region(RTree *rtree, const BBox *window, RNodeStack *removed_nodes, bool reinsert) {
+    RNodeStack *orphans;
+    RNode *n;
+    bool removed;
+    int i, level;
+
+    //the leaf node of the hint may be removed
+    rtree->hint.page = -1;
+
+    if (rtree->current_node == NULL)
+        return false;
+
+    orphans = rnode_stack_init();
+
+    removed = remove_region_node(rtree, rtree->current_node, rtree->info->height, window, orphans);
+
+    if (removed) {
+        if (rtree->current_node->nofentries == 0 && rtree->info->height > 0) {
+            /* all the children of the root node were eliminated
+             * then, the root node becomes an empty leaf node */
+            if (rtree->type == CONVENTIONAL_RTREE) {
+                del_rnode(&rtree->base, rtree->info->root_page, rtree->info->height);
+            } else if (rtree->type == FAST_RTREE_TYPE) {
+                fb_del_node(&rtree->base, fast_spc, rtree->info->root_page, rtree->info->height);
+            } else if (rtree->type == eFIND_RTREE_TYPE) {
+                //we update the height of the tree
+                if (efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
+                    efind_readbuffer_hlru_set_tree_height(0);
+                efind_buf_del_node(&rtree->base, efind_spc,
+                        rtree->info->root_page, rtree->info->height);
+            } else {
+                _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
+            }
+            storage_update_tree_height(&rtree->base, 0);
+            rtree->info->height = 0;
+
+            if (rtree->type == CONVENTIONAL_RTREE) {
+                put_rnode(&rtree->base, rtree->current_node, rtree->info->root_page, 0);
+            } else if (rtree->type == FAST_RTREE_TYPE) {
+                fb_put_new_node(&rtree->base, fast_spc, rtree->info->root_page,
+                        (void *) rnode_clone(rtree->current_node), 0);
+            } else {
+                efind_buf_create_node(&rtree->base, efind_spc, rtree->info->root_page, 0);
+            }
+
+#ifdef COLLECT_STATISTICAL_DATA
+            _written_leaf_node_num++;
+            insert_writes_per_height(0, 1);
+#endif
+        } else {
+            rewrite_rnode(rtree, rtree->current_node, rtree->info->root_page, rtree->info->height);
+        }
+    }
+
+    while (orphans->size > 0) {
+        n = rnode_stack_pop(orphans, &level, NULL);
+        push_orphan(rtree, removed_nodes, n, level);
+    }
+    rnode_stack_destroy(orphans);
+
+    /* [Re-insert orphaned entries.] as in condense_tree */
+    if (reinsert) {
+        while (removed_nodes->size > 0) {
+            n = rnode_stack_pop(removed_nodes, &level, NULL);
+            for (i = 0; i < n->nofentries; i++) {
+                //we have to pass COPIES of the entries since this function destroy it
+                insert_entry(rtree, rentry_clone(n->entries[i]), level);
+            }
+            rnode_free(n);
+        }
+
+        /* [Shorten tree.] several levels can become useless here */
+        while (rtree->current_node->nofentries == 1 && rtree->info->height > 0)
+            shorten_tree(rtree);
+    }
+
+    return removed;
+}
+
+/*default searching algorithm of the R-tree (defined in rtree.h)*/
+SpatialIndexResult *rtree_search(RTree *rtree, const BBox *search, const PolygonMask *mask, uint8_t predicate) {
+    SpatialIndexResult *sir = spatial_index_result_create();
+    /* current node here MUST be equal to the root node */
+    if (rtree->current_node != NULL) {
+        //the threads read the nodes from the storage device by themselves (i.e., they cannot see the modified nodes of a buffer)
+        //thus, indices with buffers, the flash-aware versions, and the flash simulator are not supported
+        if (search_nofthreads > 1 && rtree->info->height > 0 && rtree->type == CONVENTIONAL_RTREE &&
+                rtree->base.bs->buffer_type == BUFFER_NONE &&
+                (rtree->base.gp->storage_system->type == HDD || rtree->base.gp->storage_system->type == SSD))
+            sir = parallel_search(rtree, search, mask, predicate, sir);
+        else
+            sir = recursive_search(rtree, search, mask, predicate, rtree->info->height, sir);
+    }
+    return sir;
+}
+
+/*point query (defined in rtree.h)*/
+SpatialIndexResult *rtree_point_search(RTree *rtree, const BBox *point, uint8_t predicate) {
+    SpatialIndexResult *sir = spatial_index_result_create();
+    /* current node here MUST be equal to the root node */
+    if (rtree->current_node != NULL) {
+        sir = recursive_search_pt(rtree, point, predicate, rtree->info->height, sir);
+    }
+    return sir;
+}
+
+/*distance range query (defined in rtree.h)*/
+SpatialIndexResult *rtree_distance_search(RTree *rtree, const DistanceQuery *dq) {
+    SpatialIndexResult *sir = spatial_index_result_create();
+    /* current node here MUST be equal to the root node */
+    if (rtree->current_node != NULL) {
+        sir = recursive_search_dw(rtree, dq, false, rtree->info->height, sir);
+    }
+    return sir;
+}
+
+/*distance range count (defined in rtree.h)*/
+SpatialIndexResult *rtree_distance_count(RTree *rtree, const DistanceQuery *dq, uint64_t *nofobjects) {
+    SpatialIndexResult *sir = spatial_index_result_create();
+    *nofobjects = 0;
+    /* current node here MUST be equal to the root node */
+    if (rtree->current_node != NULL) {
+        sir = recursive_count_dw(rtree, dq, false, rtree->info->height, sir, nofobjects);
+    }
+    return sir;
+}
+
+void rtree_set_search_threads(int nofthreads) {
+    if (nofthreads < 1) {
+        _DEBUGF(ERROR, "Invalid number of threads (%d) for the search", nofthreads);
+        return;
+    }
+    search_nofthreads = nofthreads;
+}
+
+int rtree_get_search_threads(void) {
+    return search_nofthreads;
+}
+
+static bool search_worker_push(SearchWorker *w, int page, int height, bool collect) {
+    if (w->stack_size == w->stack_max) {
+        SearchTask *stack = (SearchTask*) realloc(w->stack, sizeof (SearchTask) * w->stack_max * 2);
+        if (stack == NULL) {
+            w->error = ENOMEM;
+            return false;
+        }
+        w->stack = stack;
+        w->stack_max *= 2;
+    }
+    w->stack[w->stack_size].page = page;
+    w->stack[w->stack_size].height = height;
+    w->stack[w->stack_size].collect = collect;
+    w->stack_size++;
+    return true;
+}
+
+static bool search_worker_add(SearchWorker *w, int task, int row_id) {
+    if (w->last == NULL || w->last->task != task || w->last->n == PARALLEL_SEARCH_CHUNK_SIZE) {
+        SearchChunk *chunk = (SearchChunk*) malloc(sizeof (SearchChunk));
+        if (chunk == NULL) {
+            w->error = ENOMEM;
+            return false;
+        }
+        chunk->n = 0;
+        chunk->task = task;
+        chunk->next = NULL;
+        if (w->last != NULL)
+            w->last->next = chunk;
+        else
+            w->first = chunk;
+        w->last = chunk;
+    }
+    w->last->row_id[w->last->n++] = row_id;
+    return true;
+}
+
+/* it reads and processes a node of the subtree of a task
+ * the entries are read in the format of rnode_serialize (see get_rnode) without allocating REntries */
+static bool search_worker_visit(SearchWorker *w, int task, const SearchTask *node) {
+    uint8_t *loc = w->buf;
+    uint32_t header;
+    bool with_clips = false;
+    bool with_counts = false;
+    int nofentries, first, i, j;
+    BBox bbox;
+    ClipPoint clips[MAX_CLIP_POINTS];
+    REntry entry;
+    SearchTask tmp;
+    uint8_t m;
+
+    if (pread(w->fd, w->buf, w->page_size, (off_t) node->page * w->page_size) != w->page_size) {
+        w->error = errno != 0 ? errno : EIO;
+        return false;
+    }
+    w->read_num++;
+    w->reads_per_height[node->height]++;
+    if (node->height != 0)
+        w->visited_int_node_num++;
+    else
+        w->visited_leaf_node_num++;
+
+    memcpy(&header, loc, sizeof (uint32_t));
+    loc += sizeof (uint32_t);
+    //an invalid node
+    if ((int) header < 0)
+        return true;
+    if (header & RNODE_CLIPPED_FLAG) {
+        with_clips = true;
+        header &= ~RNODE_CLIPPED_FLAG;
+    }
+    if (header & RNODE_AGGREGATE_FLAG) {
+        with_counts = true;
+        header &= ~RNODE_AGGREGATE_FLAG;
+    }
+    nofentries = (int) header;
+
+    entry.bbox = &bbox;
+    entry.clips = clips;
+    entry.nofclips = 0;
+    first = w->stack_size;
+    for (i = 0; i < nofentries; i++) {
+        memcpy(&(entry.pointer), loc, sizeof (uint32_t));
+        loc += sizeof (uint32_t);
+        memcpy(&bbox, loc, sizeof (BBox));
+        loc += sizeof (BBox);
+        if (with_clips) {
+            memcpy(&(entry.nofclips), loc, sizeof (uint8_t));
+            loc += sizeof (uint8_t);
+            if (entry.nofclips > MAX_CLIP_POINTS) {
+                w->error = EINVAL;
+                return false;
+            }
+            for (j = 0; j < entry.nofclips; j++) {
+                memcpy(&(clips[j].corner), loc, sizeof (uint8_t));
+                loc += sizeof (uint8_t);
+                memcpy(clips[j].point, loc, sizeof (double) * NUM_OF_DIM);
+                loc += sizeof (double) * NUM_OF_DIM;
+            }
+        }
+        if (with_counts)
+            loc += sizeof (uint32_t);
+
+        w->processed_entries_num++;
+        if (node->height == 0) {
+            if (node->collect || search_leaf_entry(&bbox, w->query, w->mask, w->predicate)) {
+                if (!search_worker_add(w, task, entry.pointer))
+                    return false;
+            }
+        } else if (node->collect) {
+            if (!search_worker_push(w, entry.pointer, node->height - 1, true))
+                return false;
+        } else if (search_internal_entry(&entry, w->query, w->mask, w->predicate, &m)) {
+            if (!search_worker_push(w, entry.pointer, node->height - 1, m == MASK_INSIDE && w->predicate == INTERSECTS))
+                return false;
+        }
+    }
+
+    //the children are pushed in reverse order, thus they are visited in the order of the sequential search
+    for (i = first, j = w->stack_size - 1; i < j; i++, j--) {
+        tmp = w->stack[i];
+        w->stack[i] = w->stack[j];
+        w->stack[j] = tmp;
+    }
+    return true;
+}
+
+void *parallel_search_worker(void *arg) {
+    SearchWorker *w = (SearchWorker*) arg;
+    SearchTask node;
+    int t;
+
+    while (w->error == 0 && (t = atomic_fetch_add(w->next_task, 1)) < w->noftasks) {
+        w->owner[t] = w->id;
+        w->stack[0] = w->tasks[t];
+        w->stack_size = 1;
+        while (w->stack_size > 0) {
+            node = w->stack[--w->stack_size];
+            if (!search_worker_visit(w, t, &node))
+                break;
+        }
+    }
+    return NULL;
+}
+
+/* it appends the subtrees of the qualifying entries of a node to the tasks of the parallel search */
+static void parallel_search_add_tasks(const RNode *node, int height, bool collect, const BBox *query,
+        const PolygonMask *mask, uint8_t predicate, SearchTask **tasks, int *noftasks, int *max_tasks) {
+    int i;
+    uint8_t m = MASK_PARTIAL;
+
+    for (i = 0; i < node->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+        _processed_entries_num++;
+#endif
+        if (collect || search_internal_entry(node->entries[i], query, mask, predicate, &m)) {
+            if (*noftasks == *max_tasks) {
+                *max_tasks *= 2;
+                *tasks = (SearchTask*) lwrealloc(*tasks, sizeof (SearchTask) * (*max_tasks));
+            }
+            (*tasks)[*noftasks].page = node->entries[i]->pointer;
+            (*tasks)[*noftasks].height = height - 1;
+            (*tasks)[*noftasks].collect = collect || (m == MASK_INSIDE && predicate == INTERSECTS);
+            (*noftasks)++;
+        }
+    }
+}
+
+/* it releases the memory of the threads of the parallel search (which may be partially allocated) */
+static void parallel_search_release(SearchWorker *workers, int nofthreads, pthread_t *threads, bool *created,
+        int *owner) {
+    SearchChunk *chunk;
+    int t;
+
+    if (workers != NULL) {
+        for (t = 0; t < nofthreads; t++) {
+            while (workers[t].first != NULL) {
+                chunk = workers[t].first;
+                workers[t].first = chunk->next;
+                free(chunk);
+            }
+            free(workers[t].buf);
+            free(workers[t].stack);
+            free(workers[t].reads_per_height);
+        }
+    }
+    free(workers);
+    free(threads);
+    free(created);
+    free(owner);
+}
+
+/* it traverses the subtrees of the tasks by using the caller thread (i.e., without threads) */
+static SpatialIndexResult *parallel_search_sequential(RTree *rtree, const BBox *query, const PolygonMask *mask,
+        uint8_t predicate, const SearchTask *tasks, int noftasks, SpatialIndexResult *result) {
+    RNode *root = rtree->current_node;
+    int t;
+
+    for (t = 0; t < noftasks; t++) {
+        rtree->current_node = get_rnode(&rtree->base, tasks[t].page, tasks[t].height);
+#ifdef COLLECT_STATISTICAL_DATA
+        if (tasks[t].height != 0)
+            _visited_int_node_num++;
+        else
+            _visited_leaf_node_num++;
+        insert_reads_per_height(tasks[t].height, 1);
+#endif
+        if (tasks[t].collect)
+            result = collect_subtree(rtree, tasks[t].height, false, result);
+        else
+            result = recursive_search(rtree, query, mask, predicate, tasks[t].height, result);
+        rnode_free(rtree->current_node);
+        rtree->current_node = root;
+    }
+    return result;
+}
+
+SpatialIndexResult *parallel_search(RTree *rtree, const BBox *query, const PolygonMask *mask,
+        uint8_t predicate, SpatialIndexResult *result) {
+    SearchTask *tasks, *next;
+    int noftasks, nofnext, max_tasks, max_next;
+    SearchWorker *workers;
+    pthread_t *threads;
+    bool *created;
+    int *owner;
+    atomic_int next_task;
+    SearchChunk *chunk;
+    RNode *node;
+    int page_size = rtree->base.gp->page_size;
+    int nofthreads = search_nofthreads;
+    int flag = O_RDONLY;
+    int height, fd, t, i;
+    int error = 0;
+    bool allocated;
+
+    /* the top levels are expanded by this thread until there are enough subtrees for the threads
+     * the first level comes from the root node, which is kept in main memory */
+    height = rtree->info->height;
+    max_tasks = rtree->current_node->nofentries + 1;
+    tasks = (SearchTask*) lwalloc(sizeof (SearchTask) * max_tasks);
+    noftasks = 0;
+    parallel_search_add_tasks(rtree->current_node, height, false, query, mask, predicate,
+            &tasks, &noftasks, &max_tasks);
+    height--;
+    while (noftasks > 0 && noftasks < nofthreads * PARALLEL_SEARCH_TASKS_PER_THREAD && height > 0) {
+        max_next = noftasks * 2;
+        next = (SearchTask*) lwalloc(sizeof (SearchTask) * max_next);
+        nofnext = 0;
+        for (t = 0; t < noftasks; t++) {
+            node = get_rnode(&rtree->base, tasks[t].page, height);
+#ifdef COLLECT_STATISTICAL_DATA
+            _visited_int_node_num++;
+            insert_reads_per_height(height, 1);
+#endif
+            parallel_search_add_tasks(node, height, tasks[t].collect, query, mask, predicate,
+                    &next, &nofnext, &max_next);
+            rnode_free(node);
+        }
+        lwfree(tasks);
+        tasks = next;
+        noftasks = nofnext;
+        height--;
+    }
+
+    if (noftasks == 0) {
+        lwfree(tasks);
+        return result;
+    }
+
+    if (rtree->base.gp->io_access == DIRECT_ACCESS)
+        flag |= O_DIRECT;
+    if ((fd = open(rtree->base.index_file, flag)) < 0) {
+        _DEBUGF(WARNING, "It was impossible to open the \'%s\' for the parallel search, "
+                "the search is sequential", rtree->base.index_file);
+        result = parallel_search_sequential(rtree, query, mask, predicate, tasks, noftasks, result);
+        lwfree(tasks);
+        return result;
+    }
+    if (nofthreads > noftasks)
+        nofthreads = noftasks;
+
+    /* the memory touched by the threads is allocated by malloc */
+    workers = (SearchWorker*) calloc(nofthreads, sizeof (SearchWorker));
+    threads = (pthread_t*) malloc(sizeof (pthread_t) * nofthreads);
+    created = (bool*) malloc(sizeof (bool) * nofthreads);
+    owner = (int*) malloc(sizeof (int) * noftasks);
+    allocated = (workers != NULL && threads != NULL && created != NULL && owner != NULL);
+    atomic_init(&next_task, 0);
+    for (t = 0; allocated && t < nofthreads; t++) {
+        workers[t].query = query;
+        workers[t].mask = mask;
+        workers[t].predicate = predicate;
+        workers[t].fd = fd;
+        workers[t].page_size = page_size;
+        workers[t].tasks = tasks;
+        workers[t].noftasks = noftasks;
+        workers[t].next_task = &next_task;
+        workers[t].owner = owner;
+        workers[t].id = t;
+        workers[t].stack_max = 64;
+        workers[t].stack = (SearchTask*) malloc(sizeof (SearchTask) * workers[t].stack_max);
+        workers[t].reads_per_height = (int*) calloc(rtree->info->height + 1, sizeof (int));
+        if (rtree->base.gp->io_access == DIRECT_ACCESS) {
+            //then the memory must be aligned in blocks!
+            if (posix_memalign((void**) &(workers[t].buf), page_size, page_size))
+                workers[t].buf = NULL;
+        } else {
+            workers[t].buf = (uint8_t*) malloc(page_size);
+        }
+        if (workers[t].stack == NULL || workers[t].reads_per_height == NULL || workers[t].buf == NULL)
+            allocated = false;
+    }
+    if (!allocated) {
+        //everything is released before raising the error, which does not return
+        parallel_search_release(workers, nofthreads, threads, created, owner);
+        lwfree(tasks);
+        close(fd);
+        _DEBUG(ERROR, "Allocation failed at parallel_search");
+        return result;
+    }
+
+    for (t = 0; t < nofthreads; t++)
+        created[t] = (pthread_create(&threads[t], NULL, parallel_search_worker, &workers[t]) == 0);
+    for (t = 0; t < nofthreads; t++) {
+        if (created[t])
+            pthread_join(threads[t], NULL);
+        else //if the thread could not be created, the caller takes the remaining tasks
+            parallel_search_worker(&workers[t]);
+    }
+    close(fd);
+
+    for (t = 0; t < nofthreads; t++) {
+        if (workers[t].error != 0)
+            error = workers[t].error;
+#ifdef COLLECT_STATISTICAL_DATA
+        _visited_int_node_num += workers[t].visited_int_node_num;
+        _visited_leaf_node_num += workers[t].visited_leaf_node_num;
+        _processed_entries_num += workers[t].processed_entries_num;
+        if (_STORING == 0)
+            _read_num += workers[t].read_num;
+        for (i = 0; i <= rtree->info->height; i++) {
+            if (workers[t].reads_per_height[i] > 0)
+                insert_reads_per_height(i, workers[t].reads_per_height[i]);
+        }
+#endif
+    }
+
+    /* the results are merged in the order of the tasks, which is the order of the sequential search */
+    if (error == 0) {
+        for (t = 0; t < noftasks; t++) {
+            SearchWorker *w = &workers[owner[t]];
+            while (w->first != NULL && w->first->task == t) {
+                chunk = w->first;
+                for (i = 0; i < chunk->n; i++)
+                    spatial_index_result_add(result, chunk->row_id[i]);
+                w->first = chunk->next;
+                free(chunk);
+            }
+        }
+    }
+
+    parallel_search_release(workers, nofthreads, threads, created, owner);
+    lwfree(tasks);
+
+    if (error != 0) {
+        _DEBUGF(ERROR, "The parallel search could not read a node of the index \'%s\' (errno %d)",
+                rtree->base.index_file, error);
+    }
+    return result;
+}
+
+void *pack_leaves_worker(void *arg) {
+    LeafPackingTask *task = (LeafPackingTask*) arg;
+    const BulkLoadEntry *e = task->entries;
+    BBox *un;
+    uint8_t *loc;
+    uint32_t size;
+    int i, j, d;
+
+    for (i = 0; i < task->nofnodes; i++) {
+        size = (uint32_t) bulkload_node_size(task->n, task->cap, task->min, task->first_node + i);
+        un = &(task->bboxes[task->first_node + i]);
+        memcpy(un, &(e[0].bbox), sizeof (BBox));
+
+        /* this is the format of rnode_serialize for leaf nodes, which have no clip points and no counts */
+        loc = task->buf + i * task->page_size;
+        memcpy(loc, &size, sizeof (uint32_t));
+        loc += sizeof (uint32_t);
+        for (j = 0; j < (int) size; j++) {
+            memcpy(loc, &(e[j].pointer), sizeof (uint32_t));
+            loc += sizeof (uint32_t);
+            memcpy(loc, &(e[j].bbox), sizeof (BBox));
+            loc += sizeof (BBox);
+
+            for (d = 0; d <= MAX_DIM; d++) {
+                un->min[d] = DB_MIN(un->min[d], e[j].bbox.min[d]);
+                un->max[d] = DB_MAX(un->max[d], e[j].bbox.max[d]);
+            }
+        }
+        e += size;
+    }
+    return NULL;
+}
+
+int parallel_pack_leaves(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor,
+        int nofthreads, int write_unit, REntry ***parents) {
+    LeafPackingTask *tasks;
+    pthread_t *threads;
+    bool *created;
+    BBox *bboxes;
+    RNode *leaf;
+    uint8_t *buf;
+    int *pages, *heights;
+    int page_size = rtree->base.gp->page_size;
+    //a batch is a multiple of the write unit, thus, the writes of a batch are aligned to the write unit
+    int batch_size = ((nofthreads * BULKLOAD_THREAD_PAGES + write_unit - 1) / write_unit) * write_unit;
+    int cap, min, nofnodes, batch, first, offset, nt, t, i, j, w;
+
+    cap = bulkload_node_capacity(rtree->spec->max_entries_leaf_node,
+            rtree->spec->min_entries_leaf_node, fill_factor);
+    min = rtree->spec->min_entries_leaf_node;
+
+    bulkload_str_order_parallel(entries, n, cap, nofthreads);
+    nofnodes = bulkload_number_of_nodes(n, cap);
+
+    /* the memory touched by the threads is allocated by malloc */
+    if (rtree->base.gp->io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &buf, page_size, (size_t) page_size * batch_size)) {
+            _DEBUG(ERROR, "Allocation failed at parallel_pack_leaves");
+            return 0;
+        }
+    } else {
+        buf = (uint8_t*) malloc((size_t) page_size * batch_size);
+    }
+    bboxes = (BBox*) malloc(sizeof (BBox) * nofnodes);
+    tasks = (LeafPackingTask*) malloc(sizeof (LeafPackingTask) * nofthreads);
+    threads = (pthread_t*) malloc(sizeof (pthread_t) * nofthreads);
+    created = (bool*) malloc(sizeof (bool) * nofthreads);
+    if (buf == NULL || bboxes == NULL || tasks == NULL || threads == NULL || created == NULL) {
+        _DEBUG(ERROR, "Allocation failed at parallel_pack_leaves");
+        return 0;
+    }
+    pages = (int*) lwalloc(sizeof (int) * batch_size);
+    heights = (int*) lwalloc(sizeof (int) * batch_size);
+
+    /* each batch is packed by the threads (each thread packs a contiguous range of leaf nodes)
+     * and then it is sequentially written by the caller thread */
+    offset = 0;
+    for (first = 0; first < nofnodes; first += batch) {
+        batch = (nofnodes - first < batch_size) ? nofnodes - first : batch_size;
+
+        nt = 0;
+        for (t = 0; t * BULKLOAD_THREAD_PAGES < batch; t++) {
+            tasks[t].entries = entries + offset;
+            tasks[t].n = n;
+            tasks[t].cap = cap;
+            tasks[t].min = min;
+            tasks[t].first_node = first + t * BULKLOAD_THREAD_PAGES;
+            tasks[t].nofnodes = (batch - t * BULKLOAD_THREAD_PAGES < BULKLOAD_THREAD_PAGES) ?
+                    batch - t * BULKLOAD_THREAD_PAGES : BULKLOAD_THREAD_PAGES;
+            tasks[t].page_size = page_size;
+            tasks[t].buf = buf + (size_t) t * BULKLOAD_THREAD_PAGES * page_size;
+            tasks[t].bboxes = bboxes;
+            for (i = 0; i < tasks[t].nofnodes; i++)
+                offset += bulkload_node_size(n, cap, min, tasks[t].first_node + i);
+
+            created[t] = (pthread_create(&threads[t], NULL, pack_leaves_worker, &tasks[t]) == 0);
+            nt++;
+        }
+        for (t = 0; t < nt; t++) {
+            if (created[t])
+                pthread_join(threads[t], NULL);
+            else //if the thread could not be created, the caller packs its nodes
+                pack_leaves_worker(&tasks[t]);
+        }
+
+        for (i = 0; i < batch; i++) {
+            pages[i] = first + i;
+            heights[i] = 0;
+        }
+        for (i = 0; i < batch; i += write_unit) {
+            w = (batch - i < write_unit) ? batch - i : write_unit;
+            storage_write_pages(&rtree->base, pages + i, buf + (size_t) i * page_size, heights + i, w);
+        }
+    }
+
+#ifdef COLLECT_STATISTICAL_DATA
+    _written_leaf_node_num += nofnodes;
+    insert_writes_per_height(0, nofnodes);
+#endif
+
+    /* the entries pointing to the leaf nodes are created by the caller thread
+     * the clip points and the counts need the leaf nodes, which are then rebuilt here only if needed */
+    *parents = (REntry**) lwalloc(sizeof (REntry*) * nofnodes);
+    offset = 0;
+    for (i = 0; i < nofnodes; i++) {
+        int size = bulkload_node_size(n, cap, min, i);
+        (*parents)[i] = rentry_create(i, bbox_clone(&(bboxes[i])));
+        if (rtree->spec->nof_clip_points > 0 || rtree->spec->aggregate) {
+            leaf = rnode_create_empty();
+            for (j = offset; j < offset + size; j++)
+                rnode_add_rentry(leaf, rentry_create(entries[j].pointer, bbox_clone(&(entries[j].bbox))));
+            rentry_update_clips((*parents)[i], leaf, rtree->spec->nof_clip_points);
+            if (rtree->spec->aggregate)
+                rentry_update_count((*parents)[i], leaf, 0);
+            rnode_free(leaf);
+        }
+        offset += size;
+    }
+
+    free(buf);
+    free(bboxes);
+    free(tasks);
+    free(threads);
+    free(created);
+    lwfree(pages);
+    lwfree(heights);
+
+    return nofnodes;
+}
+
+/*STR bulk loading (defined in rtree.h)*/
+bool rtree_bulk_load(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads) {
+    int write_unit = BULKLOAD_WRITE_PAGES;
+    bool ret;
+
+    if (rtree->type != CONVENTIONAL_RTREE && rtree->type != FAST_RTREE_TYPE && rtree->type != eFIND_RTREE_TYPE) {
+        _DEBUGF(ERROR, "Bulk loading is not supported by the R-tree type %d", rtree->type);
+        return false;
+    }
+    if (rtree->info->height != 0 || (rtree->current_node != NULL && rtree->current_node->nofentries > 0)) {
+        _DEBUG(ERROR, "Bulk loading requires an empty index");
+        return false;
+    }
+    if (n == 0)
+        return true;
+
+    /* the empty root node of FAST and eFIND indices is still in their buffers and logs
+     * we discard them since the packed nodes are directly written in the storage device
+     * by using writes of flushing units. After that, the index works with an empty write buffer and a clean log */
+    if (rtree->type == FAST_RTREE_TYPE) {
+        fb_destroy_buffer(rtree->type);
+        fast_destroy_flushing();
+        clean_fast_log(fast_spc);
+        write_unit = fast_spc->flushing_unit_size;
+    } else if (rtree->type == eFIND_RTREE_TYPE) {
+        efind_write_buf_destroy(rtree->type);
+        efind_read_buf_destroy(efind_spc, rtree->type);
+        efind_temporal_control_destroy();
+        efind_clean_log(efind_spc);
+        write_unit = efind_spc->flushing_unit_size;
+    }
+
+    ret = rtree_bulk_pack(rtree, entries, n, fill_factor, nofthreads, write_unit);
+
+    if (rtree->type == eFIND_RTREE_TYPE && efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
+        efind_readbuffer_hlru_set_tree_height(rtree->info->height);
+
+    return ret;
+}
+
+/*STR packing of an empty index with RNodes (defined in rtree.h)*/
+bool rtree_bulk_pack(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads, int write_unit) {
+    BulkLoadEntry *order = entries; //the entries of the current level in the STR order
+    REntry **level = NULL; //the entries of the current level (for internal nodes)
+    REntry **parents = NULL; //the entries pointing to the nodes of the current level
+    RNode *node = NULL;
+    uint8_t *buf;
+    int *pages, *heights;
+    int nofpages = 0;
+    int page_size = rtree->base.gp->page_size;
+    int page = 0, height = 0, m = n;
+    int cap, min, nofnodes, size, offset, i, j;
+
+    //the packed nodes replace the previous ones
+    rtree->hint.page = -1;
+
+    if (n == 0)
+        return true;
+    if (write_unit < 1)
+        write_unit = BULKLOAD_WRITE_PAGES;
+
+    if (rtree->base.gp->io_access == DIRECT_ACCESS) {
+        //then the memory must be aligned in blocks!
+        if (posix_memalign((void**) &buf, page_size, page_size * write_unit)) {
+            _DEBUG(ERROR, "Allocation failed at rtree_bulk_pack");
+            return false;
+        }
+    } else {
+        buf = (uint8_t*) lwalloc(page_size * write_unit);
+    }
+    pages = (int*) lwalloc(sizeof (int) * write_unit);
+    heights = (int*) lwalloc(sizeof (int) * write_unit);
+
+    /* the leaf level is packed in parallel if it has more than one node
+     * the upper levels are small, then they are packed by this thread */
+    if (nofthreads > 1 && n > bulkload_node_capacity(rtree->spec->max_entries_leaf_node,
+            rtree->spec->min_entries_leaf_node, fill_factor)) {
+        parents = NULL;
+        m = parallel_pack_leaves(rtree, entries, n, fill_factor, nofthreads, write_unit, &parents);
+        page = m;
+
+        //the entries of the next level point to the packed nodes
+        level = parents;
+        order = (BulkLoadEntry*) lwalloc(sizeof (BulkLoadEntry) * m);
+        for (i = 0; i < m; i++) {
+            order[i].pointer = i;
+            memcpy(&(order[i].bbox), parents[i]->bbox, sizeof (BBox));
+        }
+        height = 1;
+    }
+
+    /* the levels are packed bottom-up and their nodes are written in sequential pages
+     * each write ends at a multiple of write_unit (i.e., the writes are aligned to the write unit)
+     * the root node is the last written node */
+    while (true) {
+        if (height == 0) {
+            cap = bulkload_node_capacity(rtree->spec->max_entries_leaf_node,
+                    rtree->spec->min_entries_leaf_node, fill_factor);
+            min = rtree->spec->min_entries_leaf_node;
+        } else {
+            cap = bulkload_node_capacity(rtree->spec->max_entries_int_node,
+                    rtree->spec->min_entries_int_node, fill_factor);
+            min = rtree->spec->min_entries_int_node;
+        }
+
+        bulkload_str_order(order, m, cap);
+        nofnodes = bulkload_number_of_nodes(m, cap);
+        if (nofnodes > 1)
+            parents = (REntry**) lwalloc(sizeof (REntry*) * nofnodes);
+
+        offset = 0;
+        for (i = 0; i < nofnodes; i++) {
+            size = bulkload_node_size(m, cap, min, i);
+            node = rnode_create_empty();
+            for (j = offset; j < offset + size; j++) {
+                if (height == 0)
+                    rnode_add_rentry(node, rentry_create(order[j].pointer, bbox_clone(&(order[j].bbox))));
+                else
+                    rnode_add_rentry(node, level[order[j].pointer]);
+            }
+            offset += size;
+
+            rnode_serialize(node, buf + nofpages * page_size);
+            pages[nofpages] = page;
+            heights[nofpages] = height;
+            nofpages++;
+            if ((page + 1) % write_unit == 0) {
+                storage_write_pages(&rtree->base, pages, buf, heights, nofpages);
+                nofpages = 0;
+            }
+
+#ifdef COLLECT_STATISTICAL_DATA
+            if (height == 0)
+                _written_leaf_node_num++;
+            else
+                _written_int_node_num++;
+#endif
+
+            //the root node is kept as the current node of the index
+            if (nofnodes == 1)
+                break;
+
+            parents[i] = rentry_create(page, rnode_compute_bbox(node));
+            rentry_update_clips(parents[i], node, rtree->spec->nof_clip_points);
+            if (rtree->spec->aggregate)
+                rentry_update_count(parents[i], node, height);
+
+            rnode_free(node);
+            page++;
+        }
+
+#ifdef COLLECT_STATISTICAL_DATA
+        insert_writes_per_height(height, nofnodes);
+#endif
+
+        //the entries of this level are now owned by the packed nodes
+        if (height > 0) {
+            lwfree(level);
+            lwfree(order);
+        }
+
+        if (nofnodes == 1)
+            break;
+
+        //the entries of the next level point to the packed nodes
+        level = parents;
+        order = (BulkLoadEntry*) lwalloc(sizeof (BulkLoadEntry) * nofnodes);
+        for (i = 0; i < nofnodes; i++) {
+            order[i].pointer = i;
+            memcpy(&(order[i].bbox), parents[i]->bbox, sizeof (BBox));
+        }
+        m = nofnodes;
+        height++;
+    }
+
+    if (nofpages > 0)
+        storage_write_pages(&rtree->base, pages, buf, heights, nofpages);
+
+    if (rtree->base.gp->io_access == DIRECT_ACCESS) {
+        free(buf);
+    } else {
+        lwfree(buf);
+    }
+    lwfree(pages);
+    lwfree(heights);
+
+    if (rtree->current_node != NULL)
+        rnode_free(rtree->current_node);
+    rtree->current_node = node;
+    rtree->info->root_page = page;
+    rtree->info->last_allocated_page = page;
+    rtree->info->height = height;
+    storage_update_tree_height(&rtree->base, height);
+
+    return true;
+}
+
+/*default algorithm to remove an entry in a R-tree (defined in rtree.h)*/
+bool rtree_remove_with_removed_nodes(RTree *rtree, const REntry *to_remove, RNodeStack *removed_nodes, bool reinsert) {
+
+    /*D1 [Find node containing record ] Invoke FindLeaf to locate the leaf
+node L containing E Stop if the record was not found.*/
+
+    /*the FindLeaf is inlined here in order to do this in an iterative way */
+
+    RNodeStack *stack;
+    int i, entry;
+    int parent_add;
+    int found_index;
+    bool inside;
+    RNode *n = NULL;
+    RNode *found_node = NULL;
+    int h;
+
+    found_index = -1;
+    inside = false;
+    stack = rnode_stack_init();
+    h = rtree->info->height;
+
+    rnode_stack_push(stack, rnode_clone(rtree->current_node), rtree->info->root_page, -1);
+
+    //_DEBUG(NOTICE, "Searching subtrees");
+
+    /*FL1. [Search subtrees ] If T is not a leaf, check each entry F in T 
+     * to determine if FI overlaps EI For each such entry invoke FindLeaf on the
+tree whose root is pointed to by Fp until E is found or all entries have
+been checked*/
+    while (found_index == -1 && stack->size > 0) {
+        n = rnode_stack_peek(stack, &parent_add, &entry);
+        entry += 1;
+        inside = false;
+        //it is an internal node
+        if (h != 0) {
+            for (i = entry; i < n->nofentries; i++) {
+#ifdef COLLECT_STATISTICAL_DATA
+                _processed_entries_num++;
+#endif
+                //check if it is a good entry
+                if (bbox_check_predicate(to_remove->bbox, n->entries[i]->bbox, INSIDE_OR_COVEREDBY)) {
+                    //if yes, we need to update the chosen entry
+                    stack->top->entry_of_parent = i;
+
+                    //next, we read the node whose this entry points to
+                    parent_add = n->entries[i]->pointer;
+
+                    if (rtree->type == CONVENTIONAL_RTREE)
+                        n = get_rnode(&rtree->base, n->entries[i]->pointer, h - 1);
+                    else if (rtree->type == FAST_RTREE_TYPE)
+                        n = (RNode *) fb_retrieve_node(&rtree->base, n->entries[i]->pointer, h - 1);
+                    else if (rtree->type == eFIND_RTREE_TYPE)
+                        n = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
+                            n->entries[i]->pointer, h - 1);
+                    else
                         _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
 
 #ifdef COLLECT_STATISTICAL_DATA
@@ -1014,63 +2691,8 @@ a leaf, check each entry to see if it matches E If E is found return T*/
 
     /*D4 [Shorten tree.] If the root node has only one child after the tree has
 been adjusted, make the child the new root*/
-    if (reinsert && rtree->current_node->nofentries == 1 && rtree->info->height > 0) {
-        int p = rtree->current_node->entries[0]->pointer;
-        RNode *new_root = NULL;
-
-        //_DEBUG(NOTICE, "We have to cut the tree");
-
-        if (rtree->type == CONVENTIONAL_RTREE) {
-            del_rnode(&rtree->base, rtree->info->root_page, rtree->info->height);
-        } else if (rtree->type == FAST_RTREE_TYPE) {
-            fb_del_node(&rtree->base, fast_spc, rtree->info->root_page, rtree->info->height);
-        } else if (rtree->type == eFIND_RTREE_TYPE) {
-            //we update the height of the tree
-            if (efind_spc->read_buffer_policy == eFIND_HLRU_RBP)
-                efind_readbuffer_hlru_set_tree_height(rtree->info->height - 1);
-            efind_buf_del_node(&rtree->base, efind_spc,
-                    rtree->info->root_page, rtree->info->height);
-        } else {
-            _DEBUGF(ERROR, "Invalid R-tree specification %d", rtree->type);
-        }
-        storage_update_tree_height(&rtree->base, rtree->info->height - 1);
-        rnode_free(rtree->current_node);
-
-        //we add the removed page as an empty page now
-        rtreesinfo_add_empty_page(rtree->info, rtree->info->root_page);
-
-#ifdef COLLECT_STATISTICAL_DATA
-        _deleted_int_node_num++;
-        insert_writes_per_height(rtree->info->height, 1);
-#endif
-
-        rtree->info->root_page = p;
-
-        if (rtree->type == CONVENTIONAL_RTREE)
-            new_root = get_rnode(&rtree->base, p, rtree->info->height - 1);
-        else if (rtree->type == FAST_RTREE_TYPE)
-            new_root = (RNode *) fb_retrieve_node(&rtree->base, p, rtree->info->height - 1);
-        else if (rtree->type == eFIND_RTREE_TYPE) {
-            new_root = (RNode *) efind_buf_retrieve_node(&rtree->base, efind_spc,
-                    p, rtree->info->height - 1);
-        }
-
-#ifdef COLLECT_STATISTICAL_DATA
-        if (rtree->info->height > 1) {
-            //we visited one internal node, then we add it
-            _visited_int_node_num++;
-        } else {
-            //we visited one leaf node
-            _visited_leaf_node_num++;
-        }
-        insert_reads_per_height(rtree->info->height - 1, 1);
-#endif
-
-        rtree->current_node = new_root;
-        rtree->info->height--;
-
-        //_DEBUG(NOTICE, "done");
-    }
+    if (reinsert && rtree->current_node->nofentries == 1 && rtree->info->height > 0)
+        shorten_tree(rtree);
 
     rnode_stack_destroy(stack);
 
@@ -1097,7 +2719,8 @@ static bool rtree_insert(SpatialIndex *si, int pointer, const LWGEOM *geom) {
 
     input = rentry_create(pointer, bbox);
 
-    insert_entry(rtree, input, 0);
+    if (!insert_entry_with_hint(rtree, input))
+        insert_entry(rtree, input, 0);
 
     return true;
 }
@@ -1115,6 +2738,8 @@ static bool rtree_remove(SpatialIndex *si, int pointer, const LWGEOM *geom) {
     rem = rentry_create(pointer, bbox);
 
     ret = rtree_remove_with_removed_nodes(rtree, rem, removed_nodes, true);
+    //the condense tree may have shrunk or removed the leaf node of the hint
+    rtree->hint.page = -1;
 
     rnode_stack_destroy(removed_nodes);
     lwfree(rem->bbox);
@@ -1136,15 +2761,57 @@ static SpatialIndexResult *rtree_search_ss(SpatialIndex *si, const LWGEOM *searc
     SpatialIndexResult *sir;
     BBox *search = (BBox*) lwalloc(sizeof (BBox));
     RTree *rtree = (void *) si;
+    PolygonMask *mask;
 
     gbox_to_bbox(search_object->bbox, search);
+    mask = polygonmask_create(search_object);
 
-    sir = rtree_search(rtree, search, predicate);
+    sir = rtree_search(rtree, search, mask, predicate);
 
+    polygonmask_free(mask);
     lwfree(search);
     return sir;
 }
 
+static SpatialIndexResult *rtree_search_pt(SpatialIndex *si, const LWGEOM *search_object, uint8_t predicate) {
+    SpatialIndexResult *sir;
+    BBox *point = (BBox*) lwalloc(sizeof (BBox));
+    RTree *rtree = (void *) si;
+
+    gbox_to_bbox(search_object->bbox, point);
+
+    sir = rtree_point_search(rtree, point, predicate);
+
+    lwfree(point);
+    return sir;
+}
+
+static SpatialIndexResult *rtree_search_dw(SpatialIndex *si, const LWGEOM *search_object, double distance) {
+    SpatialIndexResult *sir;
+    RTree *rtree = (void *) si;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    sir = rtree_distance_search(rtree, dq);
+
+    distancequery_free(dq);
+    return sir;
+}
+
+static SpatialIndexResult *rtree_count_dw(SpatialIndex *si, const LWGEOM *search_object, double distance, uint64_t *nofobjects) {
+    SpatialIndexResult *sir;
+    RTree *rtree = (void *) si;
+    DistanceQuery *dq;
+
+    dq = distancequery_create(search_object, distance);
+
+    sir = rtree_distance_count(rtree, dq, nofobjects);
+
+    distancequery_free(dq);
+    return sir;
+}
+
 static bool rtree_header_writer(SpatialIndex *si, const char *file) {
     festival_header_writer(file, CONVENTIONAL_RTREE, si);
     return true;
@@ -1171,8 +2838,8 @@ SpatialIndex *rtree_empty_create(char *file, Source *src, GenericParameters *gp,
 
     /*define the general functions of the rtree*/
     static const SpatialIndexInterface vtable = {rtree_get_type,
-        rtree_insert, rtree_remove, rtree_update, rtree_search_ss,
-        rtree_header_writer, rtree_destroy};
+        rtree_insert, rtree_remove, rtree_update, rtree_search_ss, rtree_search_pt,
+        rtree_search_dw, rtree_count_dw, rtree_header_writer, rtree_destroy};
     static SpatialIndex base = {&vtable};
     base.bs = bs;
     base.gp = gp;
@@ -1187,6 +2854,7 @@ SpatialIndex *rtree_empty_create(char *file, Source *src, GenericParameters *gp,
     rtree->info = rtreesinfo_create(0, 0, 0);
 
     rtree->current_node = NULL;
+    rtree->hint.page = -1;
 
     //we have to persist the empty node
     if (persist) {
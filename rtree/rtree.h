@@ -30,6 +30,9 @@ ACM, New York, NY, USA, v. 14, n. 2, p. 47–57, 1984.
 
 #include "../main/spatial_index.h" //this is a sub type of spatial_index
 #include "rnode_stack.h" //for the stack of RNodes -- it already includes RNode
+#include "../main/polygon_mask.h" //for polygonal query objects
+#include "../main/distance_query.h" //for distance range queries
+#include "../main/bulk_load.h" //for bulk loading
 
 #include "../fast/fast_spec.h" //for FASTSpec
 
@@ -49,8 +52,21 @@ typedef struct {
 
     /*specific parameters of the R-tree*/
     uint8_t split_type; //type of split adopted for the R-tree (see above)
+    uint8_t nof_clip_points; //maximum number of clip points of the entries of internal nodes (0 means no clipping, see rnode.h)
+    bool aggregate; //if true, the entries of internal nodes store the number of objects of their subtrees
+    bool leaf_hint; //if true, an insertion covered by the last leaf node that received an entry skips the choose_node (see RLeafHint)
 } RTreeSpecification;
 
+/* the last leaf node that received an entry without being split (the sequential-insert fast path)
+ * a new entry covered by its bbox is directly inserted in it if it has room, without descending from the root node
+ * since the bbox of its entry in the parent node does not change, the parent path is not modified
+ * it is invalidated by any other modification of the tree (e.g., splits, deletions, and bulk loading)
+ * and it is only kept in main memory */
+typedef struct {
+    int page; //the page of the leaf node (-1 means that there is no hint)
+    BBox bbox; //the bbox of the entry pointing to the leaf node in its parent node
+} RLeafHint;
+
 /* THE DEFINITION OF A R-TREE INDEX as a TYPE of SpatialIndex*/
 typedef struct {
     SpatialIndex base; //it includes the source, generic parameters, and general functions
@@ -60,6 +76,7 @@ typedef struct {
     RTreeSpecification *spec; //the parameters/specification of this index
     RTreesInfo *info; //information about this index
     RNode *current_node; //what is the current rnode of this index?
+    RLeafHint hint; //the hint of the sequential-insert fast path (only used if spec->leaf_hint is true)
 } RTree;
 
 /* return a new (empty) R-tree index, it only specifies the general parameters but not the specific parameters! */
@@ -76,8 +93,56 @@ extern SpatialIndex *rtree_empty_create(char *file, Source *src, GenericParamete
  * 
  * CLEMENTINI, E.; SHARMA, J.; EGENHOFER, M. J. Modelling topological spatial relations:
 Strategies for query processing. Computers & Graphics, v. 18, n. 6, p. 815–822, 1994.
+ * 
+ * If the query object is a polygon, mask is its polygon mask (otherwise, NULL).
+ * It is used to prune entries that only overlap the bounding box of the polygon and
+ * to directly report the subtrees inside the polygon when the predicate is INTERSECTS
+ *  */
+extern SpatialIndexResult *rtree_search(RTree *rtree, const BBox *search, const PolygonMask *mask, uint8_t predicate);
+
+/* number of threads of rtree_search (1 means the sequential search, which is the default)
+ * with more threads, the top levels are expanded by the caller and the qualifying subtrees are traversed by the threads,
+ * which read the nodes from the storage device
+ * it is only applied to conventional R-trees and R*-trees stored in HDDs or SSDs without a buffer (see BUFFER_NONE)
+ *  */
+extern void rtree_set_search_threads(int nofthreads);
+extern int rtree_get_search_threads(void);
+
+/* point query (point location), point is the query point as a degenerated bbox
+ * it only visits the entries containing the point (the smallest ones first)
+ * and returns the objects located at the point as final entries
+ * predicate must be INTERSECTS or EQUAL (for EQUAL, only the final entries are returned)
+ * this is used for the R*-tree too
+ *  */
+extern SpatialIndexResult *rtree_point_search(RTree *rtree, const BBox *point, uint8_t predicate);
+
+/* distance range query (i.e., the objects within a distance of the query object)
+ * this is used for the R*-tree too
+ * it prunes the entries by using their MINDIST to the query object and
+ * accepts whole subtrees (as final entries) if their MAXDIST is within the distance
  *  */
-extern SpatialIndexResult *rtree_search(RTree *rtree, const BBox *search, uint8_t predicate);
+extern SpatialIndexResult *rtree_distance_search(RTree *rtree, const DistanceQuery *dq);
+
+/* distance range count (aggregate R-trees, this is used for the R*-tree too)
+ * the counts stored in the internal entries are summed for subtrees within the distance,
+ * only the leaf entries that cross the boundary of the query are returned (as candidates)
+ *  */
+extern SpatialIndexResult *rtree_distance_count(RTree *rtree, const DistanceQuery *dq, uint64_t *nofobjects);
+
+/* bulk loading of an empty R-tree by using the Sort-Tile-Recursive (STR) packing (this is used for the R*-tree too)
+ * the entries are reordered and each level is packed bottom-up with nodes filled according to fill_factor
+ * the nodes are written in sequential pages (the root node is the last one)
+ * it is supported by conventional, FAST, and eFIND R-trees. For the flash-aware ones, the nodes are written
+ * in extents aligned to the flushing unit size, their write buffers become empty, and their logs are cleaned
+ * if nofthreads > 1, the leaf level is sorted and serialized by nofthreads threads (the writes are done by the caller)
+ *  */
+extern bool rtree_bulk_load(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads);
+
+/* the STR packing used by rtree_bulk_load, which does not handle buffers and logs of flash-aware indices
+ * it packs an empty index whose nodes are RNodes and writes them with writes of at most write_unit pages
+ * (this is also used by the FOR-tree)
+ *  */
+extern bool rtree_bulk_pack(RTree *rtree, BulkLoadEntry *entries, int n, double fill_factor, int nofthreads, int write_unit);
 
 /* original deletion algorithm from R-tree (this is used for the R*-tree!)
  * It uses the find_leaf and condense_tree, which are static functions in rtree.c
@@ -85,9 +150,25 @@ extern SpatialIndexResult *rtree_search(RTree *rtree, const BBox *search, uint8_
  * set true or false in the reinsert to decide if this algorithm reinsert the removed_nodes
  * the caller is responsible to free the removed_nodes!
  */
-extern bool rtree_remove_with_removed_nodes(RTree *rtree, const REntry *to_remove, 
+extern bool rtree_remove_with_removed_nodes(RTree *rtree, const REntry *to_remove,
         RNodeStack *removed_nodes, bool reinsert);
 
+/* region deletion: it removes all the objects whose bboxes are inside the window in one traversal (this is used for the R*-tree too)
+ * the subtrees whose entries are inside the window are removed without visiting their leaf nodes and
+ * their pages are added as empty pages; only the nodes in the boundary of the window are modified
+ * the under-full nodes are eliminated and set in the stack removed_nodes (with their levels),
+ * which are reinserted at the end if reinsert is true (the caller is responsible to free the removed_nodes!)
+ * it returns true if at least one object was removed
+ */
+extern bool rtree_remove_region(RTree *rtree, const BBox *window, RNodeStack *removed_nodes, bool reinsert);
+
+/* the sequential-insert fast path of the R-tree, also used by the R*-tree (see RLeafHint)
+ * it inserts input in the leaf node of the hint if its bbox covers input and the leaf node has room,
+ * type can be a type of R-tree or R*-tree (the FAST and eFIND specifications of the R-tree must be set)
+ * it returns false without modifying the tree if the normal insertion algorithm must be used */
+extern bool rtree_insert_with_leaf_hint(SpatialIndex *base, uint8_t type, const RLeafHint *hint,
+        int max_entries_leaf_node, REntry *input);
+
 /* for FAST R-tree indices we have to specify this parameter */
 extern void rtree_set_fastspecification(FASTSpecification *fesp);
 
@@ -799,12 +799,8 @@ sum of all margin-values of the different distributions*/
 
     /*freeing memory*/
     for (i = 0; i < NUM_OF_DIM * input->nofentries; i++) {
-        if (lower_distributions[i]->bbox)
-            lwfree(lower_distributions[i]->bbox);
-        lwfree(lower_distributions[i]);
-        if (upper_distributions[i]->bbox)
-            lwfree(upper_distributions[i]->bbox);
-        lwfree(upper_distributions[i]);
+        rentry_free(lower_distributions[i]);
+        rentry_free(upper_distributions[i]);
     }
     lwfree(upper_distributions);
     lwfree(lower_distributions);